@@ -21,12 +21,18 @@ package spartan_example;
 import static java.lang.String.format;
 
 import java.io.*;
+import java.time.Duration;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
 import java.util.Set;
 import java.util.concurrent.ConcurrentHashMap;
 import java.util.concurrent.ExecutorService;
 import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
 import java.util.concurrent.TimeUnit;
 import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
 
 import spartan.Spartan;
 import spartan.SpartanBase;
@@ -163,7 +169,7 @@ public class App extends SpartanBase {
    *             (first argument is the name of the sub-command invoked)
    * @param rspStream the generated results are written to this response stream
    */
-  @SupervisorCommand("GENFIB")
+  @SupervisorCommand(value = "GENFIB", concurrent = true)
   public void generateFibonacciSequence(String[] args, PrintStream rspStream) {
     print_method_call_info(rspStream, clsName, "generateFibonacciSequence", args);
 
@@ -320,6 +326,67 @@ public class App extends SpartanBase {
     }
   }
 
+  /**
+   * A <i>supervisor</i> sub-command that benchmarks {@link Spartan#invokeCommand(String...)} as
+   * called from the <i>supervisor</i> process: invokes a child worker sub-command a number of times
+   * from a number of threads, then reports invocations per second and the average time taken by the
+   * {@link Spartan#invokeCommand(String...)} call itself. Compare the figures of different builds of
+   * the Spartan native library by running it against each. Configuring a warm pool (WarmPoolSize in
+   * config.ini) keeps child JVM creation time from dominating the figures.
+   * <p>
+   * usage: INVOKEBENCH [count [threads [child-cmd [args...]]]] - defaults to 200 GENETL invocations on 4 threads
+   *
+   * @param args command line arguments passed to the <i>supervisor</i> process
+   *             (first argument is the name of the sub-command invoked)
+   * @param rspStream the benchmark results are written to this response stream
+   */
+  @SupervisorCommand("INVOKEBENCH")
+  public void invokeCommandBenchmark(String[] args, PrintStream rspStream) {
+    print_method_call_info(rspStream, clsName, "invokeCommandBenchmark", args);
+
+    try (final PrintStream rsp = rspStream) {
+      final int count = args.length > 1 ? Integer.parseInt(args[1]) : 200;
+      final int threads = args.length > 2 ? Integer.parseInt(args[2]) : 4;
+      final String[] childCmd = args.length > 3 ? Arrays.copyOfRange(args, 3, args.length) : new String[]{ "GENETL" };
+
+      final AtomicInteger remaining = new AtomicInteger(count);
+      final AtomicLong invokeNanos = new AtomicLong();
+      final ExecutorService benchExecutor = Executors.newFixedThreadPool(threads);
+      try {
+        final List<Future<?>> futures = new ArrayList<>(threads);
+        final long start = System.nanoTime();
+        for(int i = 0; i < threads; i++) {
+          futures.add(benchExecutor.submit(() -> {
+            final byte[] buf = new byte[8192];
+            while (remaining.getAndDecrement() > 0) {
+              final long invokeStart = System.nanoTime();
+              final InvokeResponse invokeRsp = Spartan.invokeCommand(childCmd);
+              invokeNanos.addAndGet(System.nanoTime() - invokeStart);
+              _pids.add(invokeRsp.childPID);
+              try (final InputStream childOut = invokeRsp.inStream) {
+                //noinspection StatementWithEmptyBody
+                while (childOut.read(buf) != -1) {} // drain the child output until the child process is done
+              }
+            }
+            return null;
+          }));
+        }
+        for (final Future<?> future : futures) {
+          future.get();
+        }
+        final long elapsedNanos = System.nanoTime() - start;
+        rsp.printf("%d invocations of %s on %d threads in %s:%n  %.1f invocations/sec%n  %s average invokeCommand() call%n",
+            count, String.join(" ", childCmd), threads, Duration.ofNanos(elapsedNanos),
+            count * 1e9 / elapsedNanos, Duration.ofNanos(invokeNanos.get() / Math.max(count, 1)));
+      } finally {
+        benchExecutor.shutdownNow();
+      }
+    } catch(Throwable e) {
+      rspStream.printf("%nERROR: %s: exception thrown:%n", (args.length > 0 ? args[0] : "{invalid command}"));
+      e.printStackTrace(rspStream);
+    }
+  }
+
   /**
    * Example Spartan child worker entry-point method.
    * (Does a simulated processing activity.)
@@ -0,0 +1,217 @@
+/* admission.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include "format2str.h"
+#include "log.h"
+#include "str-split.h"
+#include "admission.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace admission {
+
+  using limits_t = std::unordered_map<std::string, int>; // lower-case command name to its limit
+
+  static limits_t s_max_concurrent;
+  static limits_t s_max_queued;
+  static int s_queue_timeout_ms = 30000;
+
+  struct held_t {
+    uint64_t deadline_ns;
+    std::string msg;
+  };
+  struct cmd_state_t {
+    int running = 0;
+    std::deque<held_t> held;
+  };
+
+  static std::mutex s_mtx;
+  static std::unordered_map<std::string, cmd_state_t> s_cmds;
+  static std::unordered_map<pid_t, std::string> s_pids; // running child processes of limited commands
+  static size_t s_held_count = 0;
+  static uint64_t s_admitted = 0, s_held = 0, s_rejected = 0, s_expired = 0;
+
+  static uint64_t now_ns() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+  }
+
+  static std::string to_key(const std::string &cmd) {
+    std::string key(cmd);
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    return key;
+  }
+
+  static void parse_limits(const char *func_name, const char *limits, const int min_limit, limits_t &limits_map) {
+    limits_map.clear();
+    for (auto &entry : str_split(limits != nullptr ? limits : "", ',')) {
+      entry.erase(std::remove(entry.begin(), entry.end(), ' '), entry.end());
+      if (entry.empty()) continue;
+      const auto pos = entry.find(':');
+      const int limit = pos != std::string::npos && pos + 1 < entry.size() ? atoi(entry.c_str() + pos + 1) : -1;
+      if (pos == 0 || limit < min_limit) {
+        log(LL::WARN, "%s(): invalid limit \"%s\" (expected command:limit, limit >= %d) - ignored",
+            func_name, entry.c_str(), min_limit);
+        continue;
+      }
+      limits_map[to_key(entry.substr(0, pos))] = limit;
+    }
+  }
+
+  static int limit_of(const limits_t &limits_map, const std::string &key, const int default_limit) {
+    auto const it = limits_map.find(key);
+    return it != limits_map.end() ? it->second : default_limit;
+  }
+
+  void set_max_concurrent(const char *limits) { parse_limits(__func__, limits, 1, s_max_concurrent); }
+  void set_max_queued(const char *limits) { parse_limits(__func__, limits, 0, s_max_queued); }
+  void set_queue_timeout(int timeout_ms) { s_queue_timeout_ms = std::max(timeout_ms, 0); }
+  bool is_enabled() { return !s_max_concurrent.empty(); }
+
+  Verdict admit(const std::string &cmd, const std::string &msg) {
+    auto const key = to_key(cmd);
+    const int max_concurrent = limit_of(s_max_concurrent, key, 0);
+    if (max_concurrent == 0) return Verdict::ADMIT; // command is not limited
+
+    std::lock_guard<std::mutex> lk(s_mtx);
+    auto &st = s_cmds[key];
+    if (st.running < max_concurrent) {
+      st.running++;
+      s_admitted++;
+      return Verdict::ADMIT;
+    }
+    if (st.held.size() < static_cast<size_t>(limit_of(s_max_queued, key, 0))) {
+      const auto deadline_ns = now_ns() + static_cast<uint64_t>(s_queue_timeout_ms) * 1000000ULL;
+      st.held.push_back(held_t{ deadline_ns, msg });
+      s_held_count++;
+      s_held++;
+      log(LL::DEBUG, "%s(): command '%s' at its limit of %d running - held (%lu held)",
+          __func__, cmd.c_str(), max_concurrent, st.held.size());
+      return Verdict::HOLD;
+    }
+    s_rejected++;
+    return Verdict::REJECT;
+  }
+
+  void started(pid_t pid, const std::string &cmd) {
+    auto key = to_key(cmd);
+    if (s_max_concurrent.count(key) == 0) return;
+    std::lock_guard<std::mutex> lk(s_mtx);
+    s_pids[pid] = std::move(key);
+  }
+
+  void cancel(const std::string &cmd) {
+    auto const key = to_key(cmd);
+    if (s_max_concurrent.count(key) == 0) return;
+    std::lock_guard<std::mutex> lk(s_mtx);
+    auto &st = s_cmds[key];
+    if (st.running > 0) {
+      st.running--;
+    }
+  }
+
+  bool take_admissible(std::string &msg) {
+    std::lock_guard<std::mutex> lk(s_mtx);
+    if (s_held_count == 0) return false;
+    // of the commands with a free slot, the one whose held msg has waited longest
+    cmd_state_t *next = nullptr;
+    for (auto &item : s_cmds) {
+      auto &st = item.second;
+      if (st.held.empty() || st.running >= limit_of(s_max_concurrent, item.first, 0)) continue;
+      if (next == nullptr || st.held.front().deadline_ns < next->held.front().deadline_ns) {
+        next = &st;
+      }
+    }
+    if (next == nullptr) return false;
+    msg = std::move(next->held.front().msg);
+    next->held.pop_front();
+    s_held_count--;
+    return true;
+  }
+
+  std::vector<std::string> take_expired() {
+    std::vector<std::string> expired;
+    std::lock_guard<std::mutex> lk(s_mtx);
+    if (s_held_count == 0) return expired;
+    const auto curr_ns = now_ns();
+    for (auto &item : s_cmds) {
+      auto &held = item.second.held;
+      while (!held.empty() && held.front().deadline_ns <= curr_ns) {
+        expired.emplace_back(std::move(held.front().msg));
+        held.pop_front();
+        s_held_count--;
+        s_expired++;
+      }
+    }
+    return expired;
+  }
+
+  int ms_until_expiry(int default_ms) {
+    std::lock_guard<std::mutex> lk(s_mtx);
+    if (s_held_count == 0) return default_ms;
+    const auto curr_ns = now_ns();
+    uint64_t earliest_ns = UINT64_MAX;
+    for (const auto &item : s_cmds) {
+      if (!item.second.held.empty()) {
+        earliest_ns = std::min(earliest_ns, item.second.held.front().deadline_ns);
+      }
+    }
+    if (earliest_ns <= curr_ns) return 0;
+    const uint64_t ms = (earliest_ns - curr_ns + 999999ULL) / 1000000ULL;
+    return static_cast<int>(std::min(ms, static_cast<uint64_t>(default_ms)));
+  }
+
+  size_t held_count() {
+    std::lock_guard<std::mutex> lk(s_mtx);
+    return s_held_count;
+  }
+
+  void reap(pid_t pid) {
+    std::lock_guard<std::mutex> lk(s_mtx);
+    auto const it = s_pids.find(pid);
+    if (it == s_pids.end()) return;
+    auto &st = s_cmds[it->second];
+    s_pids.erase(it);
+    if (st.running > 0) {
+      st.running--;
+    }
+  }
+
+  std::string stats_str() {
+    std::lock_guard<std::mutex> lk(s_mtx);
+    std::string running_str;
+    for (const auto &item : s_cmds) {
+      running_str += format2str(", %s: %d running/%lu held",
+                                item.first.c_str(), item.second.running, item.second.held.size());
+    }
+    return format2str("admission control admitted: %llu, held: %llu, rejected: %llu, timed out: %llu%s",
+                      static_cast<unsigned long long>(s_admitted), static_cast<unsigned long long>(s_held),
+                      static_cast<unsigned long long>(s_rejected), static_cast<unsigned long long>(s_expired),
+                      running_str.c_str());
+  }
+}
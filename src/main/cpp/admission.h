@@ -0,0 +1,70 @@
+/* admission.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_ADMISSION_H
+#define SPARTAN_ADMISSION_H
+
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * Per command admission control of the launcher process - applied just before a child process is
+ * forked (or a warm pool child process is handed a command).
+ *
+ * A command with a MaxConcurrent limit runs in at most that many child processes at once. An
+ * invocation beyond the limit is held - up to MaxQueued invocations per command - until a child
+ * process of the command exits, or else it is rejected right away. A held invocation that isn't
+ * admitted within AdmissionQueueTimeout milliseconds is rejected too. A rejected invocation's
+ * client receives the EXIT_REJECTED exit code over its response socket, so it can shed the load
+ * (or retry later) instead of waiting on its own timeout.
+ *
+ * Commands without a MaxConcurrent limit are only subject to the ChildProcessMaxCount limit.
+ */
+namespace admission {
+
+  enum class Verdict : short { ADMIT, HOLD, REJECT };
+
+  // config.ini [ChildProcessSettings] MaxConcurrent and MaxQueued settings - e.g., genetl:2,lookup:8 -
+  // and AdmissionQueueTimeout (milliseconds)
+  void set_max_concurrent(const char *limits);
+  void set_max_queued(const char *limits);
+  void set_queue_timeout(int timeout_ms);
+  bool is_enabled();
+
+  // dispatching thread - ADMIT reserves a child process slot of the command (follow up with started() once
+  // the child process is running, or with cancel()), HOLD keeps the msg until take_admissible() yields it
+  Verdict admit(const std::string &cmd, const std::string &msg);
+  void started(pid_t pid, const std::string &cmd);
+  void cancel(const std::string &cmd);
+  // a held msg whose command now has a free slot (held msgs are admitted ahead of newly dequeued ones)
+  bool take_admissible(std::string &msg);
+  // held msgs that have waited past the queue timeout - the caller rejects them
+  std::vector<std::string> take_expired();
+  // milliseconds until the earliest held msg expires (or default_ms if none is held)
+  int ms_until_expiry(int default_ms);
+  size_t held_count();
+
+  // event loop - a child process was reaped (frees its command's slot, if it was admitted)
+  void reap(pid_t pid);
+
+  // the counters as a log friendly string
+  std::string stats_str();
+}
+
+#endif //SPARTAN_ADMISSION_H
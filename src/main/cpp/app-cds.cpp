@@ -0,0 +1,312 @@
+/* app-cds.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include "format2str.h"
+#include "log.h"
+#include "path-concat.h"
+#include "str-split.h"
+#include "app-cds.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+extern const char* java_home_path();
+extern const char* progname();
+
+namespace app_cds {
+
+  static const char * const jvm_classpath_optn_str = "-Djava.class.path=";
+  static const char * const classlist_prefix = "classlist.";
+  static const char * const training_cfg_fname = "training.cfg";
+  static const char * const merged_classlist_fname = "classes.lst";
+  static const char * const archive_fname = "app.jsa";
+  static const char * const archive_tmp_fname = "app.jsa.tmp";
+  static const char * const dump_log_fname = "dump.log";
+  static const char * const dump_failed_fname = "dump.failed";
+  static const time_t check_interval = 30; // seconds
+
+  static bool s_enabled = false;
+  static std::string s_cache_dir;
+  static std::string s_dump_args;
+
+  // state of the (at most one) background archive dump process
+  static std::mutex s_dump_mtx;
+  static pid_t s_dump_pid = 0;
+  static std::string s_dump_dir;
+  static std::atomic<time_t> s_last_check{0};
+
+  void set_enabled(bool enabled) { s_enabled = enabled; }
+  void set_cache_dir(const char *cache_dir) { s_cache_dir = cache_dir != nullptr ? cache_dir : ""; }
+  void set_dump_args(const char *dump_args) { s_dump_args = dump_args != nullptr ? dump_args : ""; }
+  bool is_enabled() { return s_enabled; }
+
+  static const std::string& cache_dir() {
+    if (s_cache_dir.empty()) {
+      const char * const homedir = getenv("HOME");
+      s_cache_dir = homedir != nullptr && homedir[0] != '\0'
+                    ? format2str("%s/.cache/spartan/%s/appcds", homedir, progname())
+                    : format2str("/tmp/spartan-%s-appcds", progname());
+    }
+    return s_cache_dir;
+  }
+
+  using dir_ptr_t = std::unique_ptr<DIR, void(*)(DIR*)>;
+
+  static dir_ptr_t open_dir(const std::string &path) {
+    return dir_ptr_t(opendir(path.c_str()), [](DIR *p) { if (p != nullptr) closedir(p); });
+  }
+
+  static bool file_exists(const std::string &path) {
+    struct stat st{};
+    return stat(path.c_str(), &st) == 0;
+  }
+
+  static bool make_dirs(const std::string &path) {
+    std::string partial;
+    for (auto const &part : str_split(path.c_str(), kPathSeparator)) {
+      partial += part;
+      partial += kPathSeparator;
+      if (part.empty()) continue;
+      if (mkdir(partial.c_str(), 0755) == -1 && errno != EEXIST) {
+        log(LL::WARN, "%s(): could not create directory \"%s\":\n\t%s", __func__, partial.c_str(), strerror(errno));
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // hashes the classpath, the identity of each of its entries (mtime and size), and
+  // the identity of the loaded libjvm.so - any change yields a different archive key
+  static std::string archive_key(const std::string &classpath, void *hlibjvm) {
+    std::stringstream ss;
+    auto const add_file_identity = [&ss](const char *path) {
+      struct stat st{};
+      if (stat(path, &st) == 0) {
+        ss << '|' << path << ':' << st.st_mtime << ':' << st.st_size;
+      }
+    };
+    ss << classpath;
+    for (auto const &entry : str_split(classpath.c_str(), ':')) {
+      if (!entry.empty()) {
+        add_file_identity(entry.c_str());
+      }
+    }
+    Dl_info info{};
+    void * const sym = hlibjvm != nullptr ? dlsym(hlibjvm, "JNI_CreateJavaVM") : nullptr;
+    if (sym != nullptr && dladdr(sym, &info) != 0 && info.dli_fname != nullptr) {
+      add_file_identity(info.dli_fname);
+    }
+    ss << '|' << java_home_path();
+    return format2str("%016zx", std::hash<std::string>()(ss.str()));
+  }
+
+  // records the working directory and classpath of the training run - the dump process must use the same
+  static void write_training_cfg(const std::string &key_dir, const std::string &classpath) {
+    const auto path = path_concat(key_dir.c_str(), training_cfg_fname);
+    const int fd = open(path.c_str(), O_WRONLY|O_CREAT|O_EXCL, 0644);
+    if (fd == -1) return; // already recorded by another training run
+    std::unique_ptr<char, decltype(&free)> cwd_sp(get_current_dir_name(), &free);
+    const auto content = format2str("%s\n%s\n", cwd_sp ? cwd_sp.get() : ".", classpath.c_str());
+    if (write(fd, content.c_str(), content.size()) != static_cast<ssize_t>(content.size())) {
+      log(LL::WARN, "%s(): failed writing \"%s\":\n\t%s", __func__, path.c_str(), strerror(errno));
+    }
+    close(fd);
+  }
+
+  std::vector<std::string> jvm_options(const std::string &classpath_optn, void *hlibjvm) {
+    std::vector<std::string> optns;
+    if (!s_enabled) return optns;
+    const auto prefix_len = strlen(jvm_classpath_optn_str);
+    const std::string classpath(classpath_optn.compare(0, prefix_len, jvm_classpath_optn_str) == 0
+                                ? classpath_optn.substr(prefix_len) : classpath_optn);
+    const auto key_dir = path_concat(cache_dir().c_str(), archive_key(classpath, hlibjvm).c_str());
+    const auto archive_path = path_concat(key_dir.c_str(), archive_fname);
+    if (file_exists(archive_path)) {
+      optns.emplace_back("-Xshare:auto"); // falls back to no sharing should the archive fail validation
+      optns.emplace_back("-XX:SharedArchiveFile=" + archive_path);
+      log(LL::DEBUG, "%s(): using AppCDS archive \"%s\"", __func__, archive_path.c_str());
+    } else if (!file_exists(path_concat(key_dir.c_str(), dump_failed_fname)) && make_dirs(key_dir)) {
+      write_training_cfg(key_dir, classpath);
+      const auto classlist_path = format2str("%s%c%s%d", key_dir.c_str(), kPathSeparator, classlist_prefix, getpid());
+      optns.emplace_back("-XX:DumpLoadedClassList=" + classlist_path);
+      log(LL::DEBUG, "%s(): AppCDS training run recording class list \"%s\"", __func__, classlist_path.c_str());
+    }
+    assert(optns.size() <= MAX_OPTNS);
+    return optns;
+  }
+
+  // merges the training class lists of the key directory; the training JVM process of a class list
+  // may still be running (the supervisor never exits), so an unterminated last line is ignored
+  static bool merge_class_lists(const std::string &key_dir, const std::vector<std::string> &classlists) {
+    std::set<std::string> classes;
+    for (auto const &fname : classlists) {
+      std::ifstream in(path_concat(key_dir.c_str(), fname.c_str()));
+      std::string line;
+      while (std::getline(in, line)) {
+        if (in.eof()) break; // no terminating newline - partially written
+        if (!line.empty() && line[0] != '#') {
+          classes.insert(line);
+        }
+      }
+    }
+    if (classes.empty()) return false;
+    std::ofstream out(path_concat(key_dir.c_str(), merged_classlist_fname), std::ios::trunc);
+    for (auto const &cls : classes) {
+      out << cls << '\n';
+    }
+    return out.good();
+  }
+
+  static bool read_training_cfg(const std::string &key_dir, std::string &cwd, std::string &classpath) {
+    std::ifstream in(path_concat(key_dir.c_str(), training_cfg_fname));
+    return std::getline(in, cwd) && std::getline(in, classpath);
+  }
+
+  // forks the background java -Xshare:dump process; must be called with s_dump_mtx held
+  static bool start_dump(const std::string &key_dir) {
+    std::string cwd, classpath;
+    if (!read_training_cfg(key_dir, cwd, classpath)) return false;
+    const auto java_exe = format2str("%s/bin/java", java_home_path());
+    const auto classlist_optn = "-XX:SharedClassListFile=" + path_concat(key_dir.c_str(), merged_classlist_fname);
+    const auto archive_optn = "-XX:SharedArchiveFile=" + path_concat(key_dir.c_str(), archive_tmp_fname);
+    const auto log_path = path_concat(key_dir.c_str(), dump_log_fname);
+    std::vector<std::string> args{ java_exe, "-Xshare:dump", classlist_optn, archive_optn };
+    for (auto &arg : str_split(s_dump_args.c_str(), ' ')) {
+      if (!arg.empty()) {
+        args.emplace_back(std::move(arg));
+      }
+    }
+    args.emplace_back("-cp");
+    args.emplace_back(classpath);
+    std::vector<char*> argv;
+    for (auto const &arg : args) {
+      argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    const pid_t pid = fork();
+    if (pid == -1) {
+      log(LL::ERR, "%s(): fork() of AppCDS archive dump process failed:\n\t%s", __func__, strerror(errno));
+      return false;
+    }
+    if (pid == 0) {
+      // only async-signal-safe calls from here to exec
+      const int fd = open(log_path.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+      if (fd != -1) {
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+      }
+      if (chdir(cwd.c_str()) == -1) {
+        _exit(126);
+      }
+      execv(argv[0], argv.data());
+      _exit(127);
+    }
+    s_dump_pid = pid;
+    s_dump_dir = key_dir;
+    log(LL::INFO, "%s(): dumping AppCDS archive in background process %d:\n\t%s", __func__, pid, key_dir.c_str());
+    return true;
+  }
+
+  // a key directory is ready to dump when it has no archive yet and at least one of its training
+  // runs has terminated (i.e., a child command ran to completion while recording its class list)
+  static bool is_ready_to_dump(const std::string &key_dir, std::vector<std::string> &classlists) {
+    if (file_exists(path_concat(key_dir.c_str(), archive_fname)) ||
+        file_exists(path_concat(key_dir.c_str(), dump_failed_fname))) return false;
+    auto const dir_sp = open_dir(key_dir);
+    if (!dir_sp) return false;
+    bool has_completed_run = false;
+    const auto prefix_len = strlen(classlist_prefix);
+    while (auto const entry = readdir(dir_sp.get())) {
+      if (strncmp(entry->d_name, classlist_prefix, prefix_len) != 0) continue;
+      classlists.emplace_back(entry->d_name);
+      const auto pid = static_cast<pid_t>(strtol(entry->d_name + prefix_len, nullptr, 10));
+      if (pid > 0 && kill(pid, 0) == -1 && errno == ESRCH) {
+        has_completed_run = true;
+      }
+    }
+    return has_completed_run;
+  }
+
+  void build_pending_archives() {
+    if (!s_enabled) return;
+    const auto now = time(nullptr);
+    if (now - s_last_check.load() < check_interval) return;
+    s_last_check = now;
+
+    std::unique_lock<std::mutex> lk(s_dump_mtx);
+    if (s_dump_pid != 0) return; // a dump is already in progress
+    auto const dir_sp = open_dir(cache_dir());
+    if (!dir_sp) return;
+    while (auto const entry = readdir(dir_sp.get())) {
+      if (entry->d_name[0] == '.') continue;
+      const auto key_dir = path_concat(cache_dir().c_str(), entry->d_name);
+      std::vector<std::string> classlists;
+      if (is_ready_to_dump(key_dir, classlists) && merge_class_lists(key_dir, classlists) && start_dump(key_dir)) {
+        break; // one dump at a time
+      }
+    }
+  }
+
+  bool reap(pid_t pid, int exit_status) {
+    std::unique_lock<std::mutex> lk(s_dump_mtx);
+    if (pid == 0 || pid != s_dump_pid) return false;
+    s_dump_pid = 0;
+    const auto archive_tmp_path = path_concat(s_dump_dir.c_str(), archive_tmp_fname);
+    const auto archive_path = path_concat(s_dump_dir.c_str(), archive_fname);
+    if (exit_status == 0 && rename(archive_tmp_path.c_str(), archive_path.c_str()) == 0) {
+      log(LL::INFO, "%s(): AppCDS archive is ready for use by subsequently created JVMs:\n\t%s",
+          __func__, archive_path.c_str());
+      // the training class lists have served their purpose
+      auto const dir_sp = open_dir(s_dump_dir);
+      const auto prefix_len = strlen(classlist_prefix);
+      if (dir_sp) {
+        while (auto const entry = readdir(dir_sp.get())) {
+          if (strncmp(entry->d_name, classlist_prefix, prefix_len) == 0) {
+            unlink(path_concat(s_dump_dir.c_str(), entry->d_name).c_str());
+          }
+        }
+      }
+    } else {
+      // don't retrain and redump endlessly - remove the dump.failed marker file to try again
+      unlink(archive_tmp_path.c_str());
+      std::ofstream(path_concat(s_dump_dir.c_str(), dump_failed_fname)) << exit_status << '\n';
+      log(LL::WARN, "%s(): AppCDS archive dump process %d failed (exit status %d) - see \"%s\"",
+          __func__, pid, exit_status, path_concat(s_dump_dir.c_str(), dump_log_fname).c_str());
+    }
+    s_dump_dir.clear();
+    return true;
+  }
+}
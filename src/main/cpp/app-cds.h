@@ -0,0 +1,62 @@
+/* app-cds.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_APP_CDS_H
+#define SPARTAN_APP_CDS_H
+
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * Automatic AppCDS (application class-data sharing) archive generation and reuse.
+ *
+ * Archives are kept under a cache directory in a sub-directory keyed by a hash of the JVM
+ * classpath, the modification times/sizes of its entries (jar files), and the identity of
+ * the loaded libjvm.so (i.e., the JVM version). When a JVM is created and an archive exists
+ * for its key, -XX:SharedArchiveFile is injected into its JavaVMInitArgs. When there is no
+ * archive yet the JVM is instead a training run and records its loaded classes to a class
+ * list file in the key directory (the supervisor and each child command contribute one).
+ *
+ * The launcher process periodically checks for key directories that have training class
+ * lists but no archive and dumps the archive in a background java -Xshare:dump process.
+ * Changing a jar file yields a new key, so a stale archive is simply never used again and
+ * its replacement is trained and dumped in the background as the program keeps running.
+ */
+namespace app_cds {
+
+  // the maximum number of JVM options that jvm_options() returns
+  const unsigned int MAX_OPTNS = 2;
+
+  // config.ini [JvmSettings] AppCDS, AppCDSCacheDir and AppCDSDumpArgs settings
+  void set_enabled(bool enabled);
+  void set_cache_dir(const char *cache_dir);
+  void set_dump_args(const char *dump_args);
+  bool is_enabled();
+
+  // JVM options to inject for a JVM about to be created with the specified -Djava.class.path= option
+  std::vector<std::string> jvm_options(const std::string &classpath_optn, void *hlibjvm);
+
+  // launcher process - dumps archives for trained keys in a background process (throttled, returns at once)
+  void build_pending_archives();
+
+  // returns true if the terminated child process was a background archive dump process
+  bool reap(pid_t pid, int exit_status);
+}
+
+#endif //SPARTAN_APP_CDS_H
@@ -0,0 +1,93 @@
+/* argv-frame-bench.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Microbenchmark of command message parsing - decoding a binary argv frame vs. popt re-tokenizing the
+// quoted, space delimited text command line that preceded it. Each run parses the same message over
+// and over and reports messages per second (and MB/s) for a command line of the given number of args.
+//
+// usage: argv-frame-bench [iterations [arg-count [arg-length]]]
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <popt.h>
+#include "log.h"
+#include "argv-frame.h"
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static void report(const char *name, const int iterations, const size_t msg_size, const long long elapsed_ns,
+                   const size_t checksum)
+{
+  const double secs = static_cast<double>(elapsed_ns) / 1e9;
+  printf("%-8s %10.0f msgs/sec %8.1f MB/s %8.1f ns/msg (%lu byte msg, checksum %lu)\n", name,
+         iterations / secs, static_cast<double>(msg_size) * iterations / secs / (1024 * 1024),
+         static_cast<double>(elapsed_ns) / iterations, msg_size, checksum);
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("argv-frame-bench");
+  const int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+  const int arg_count = argc > 2 ? atoi(argv[2]) : 8;
+  const int arg_length = argc > 3 ? atoi(argv[3]) : 16;
+
+  // the args of a typical command invocation - extended invoke option, uds socket name, sub-command, args
+  std::vector<std::string> args{ "--extended-invoke=false", "/tmp/spartan_uds_12345_1", "GENETL" };
+  for (int i = 0; i < arg_count; i++) {
+    args.emplace_back(static_cast<size_t>(arg_length), static_cast<char>('a' + i % 26));
+  }
+  std::vector<const char*> args_ptrs;
+  std::string cmd_line;
+  for (const auto &arg : args) {
+    args_ptrs.push_back(arg.c_str());
+    cmd_line += (cmd_line.empty() ? "\"" : " \"") + arg + '"';
+  }
+  const std::string frame = argv_frame::encode(static_cast<int>(args_ptrs.size()), args_ptrs.data());
+
+  size_t checksum = 0;
+  argv_frame::frame_t decoded;
+  auto start_ns = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    if (!argv_frame::decode(frame, decoded)) {
+      fprintf(stderr, "argv frame failed to decode\n");
+      return EXIT_FAILURE;
+    }
+    checksum += decoded.args.size() + decoded.args.back().size();
+  }
+  report("frame", iterations, frame.size(), now_ns() - start_ns, checksum);
+
+  checksum = 0;
+  start_ns = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    int argc_cmd_line = 0;
+    const char **argv_cmd_line = nullptr;
+    if (poptParseArgvString(cmd_line.c_str(), &argc_cmd_line, &argv_cmd_line) != 0) {
+      fprintf(stderr, "popt failed to parse command line\n");
+      return EXIT_FAILURE;
+    }
+    checksum += argc_cmd_line + std::string(argv_cmd_line[argc_cmd_line - 1]).size();
+    free(argv_cmd_line);
+  }
+  report("popt", iterations, cmd_line.size(), now_ns() - start_ns, checksum);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+/* argv-frame-fuzz.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Fuzz driver of the argv frame decoder. Each round encodes random args (quotes, spaces, newlines and
+// non-ASCII bytes included) and checks that they decode back verbatim, then decodes mutations of the
+// frame - flipped bytes, truncation, trailing garbage, forged lengths and argc - which must either be
+// rejected or decode to args that lie wholly within the message. Exits non-zero on the first failure.
+// Best run built with -fsanitize=address,undefined.
+//
+// usage: argv-frame-fuzz [rounds [seed]]
+//
+// Built with -DARGV_FRAME_LIBFUZZER (and -fsanitize=fuzzer) it is instead a libFuzzer target.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "log.h"
+#include "argv-frame.h"
+
+// a decoded frame's args must be NUL terminated views into msg
+static bool is_within(const std::string &msg, const argv_frame::frame_t &frame) {
+  auto const begin = msg.data(), end = msg.data() + msg.size();
+  for (const auto &arg : frame.args) {
+    if (arg.data() < begin || arg.data() + arg.size() >= end || arg.data()[arg.size()] != '\0') return false;
+  }
+  return true;
+}
+
+static bool check_mutation(const std::string &msg) {
+  argv_frame::frame_t frame;
+  return !argv_frame::decode(msg, frame) || is_within(msg, frame);
+}
+
+#ifdef ARGV_FRAME_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  const std::string msg(reinterpret_cast<const char*>(data), size);
+  if (!check_mutation(msg)) abort();
+  return 0;
+}
+
+#else
+
+int main(int argc, char **argv) {
+  logger::set_progname("argv-frame-fuzz");
+  const long rounds = argc > 1 ? atol(argv[1]) : 100000;
+  const unsigned seed = argc > 2 ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : std::random_device{}();
+  printf("argv-frame-fuzz: %ld rounds, seed %u\n", rounds, seed);
+  std::mt19937 rnd(seed);
+  auto const rnd_int = [&rnd](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rnd); };
+  static const char special[] = "\"' \t\n\\=-";
+
+  for (long round = 0; round < rounds; round++) {
+    // round-trip of random args
+    const int nargs = rnd_int(0, 12);
+    std::vector<std::string> args;
+    std::vector<const char*> args_ptrs;
+    for (int i = 0; i < nargs; i++) {
+      std::string arg(static_cast<size_t>(rnd_int(0, rnd_int(0, 1) ? 8 : 300)), ' ');
+      for (auto &c : arg) {
+        c = rnd_int(0, 3) == 0 ? special[rnd_int(0, sizeof(special) - 2)] : static_cast<char>(rnd_int(1, 255));
+      }
+      args.emplace_back(std::move(arg));
+    }
+    for (const auto &arg : args) {
+      args_ptrs.push_back(arg.c_str());
+    }
+    const std::string frame = argv_frame::encode(nargs, args_ptrs.data());
+    argv_frame::frame_t decoded;
+    if (!argv_frame::is_frame(frame) || !argv_frame::decode(frame, decoded) || decoded.args.size() != args.size() ||
+        decoded.version != argv_frame::VERSION || decoded.client_pid != getpid() || !is_within(frame, decoded))
+    {
+      fprintf(stderr, "round %ld: frame of %d args failed to round-trip\n", round, nargs);
+      return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < args.size(); i++) {
+      if (args[i].size() != decoded.args[i].size() || memcmp(args[i].data(), decoded.args[i].data(), args[i].size())) {
+        fprintf(stderr, "round %ld: arg %lu differs after round-trip\n", round, i);
+        return EXIT_FAILURE;
+      }
+    }
+
+    // mutations of the frame
+    std::string mutated(frame);
+    switch (rnd_int(0, 4)) {
+      case 0: // flip some bytes anywhere
+        for (int i = rnd_int(1, 8); i > 0; i--) {
+          mutated[static_cast<size_t>(rnd_int(0, static_cast<int>(mutated.size()) - 1))] ^= static_cast<char>(rnd_int(1, 255));
+        }
+        break;
+      case 1: // truncate
+        mutated.resize(static_cast<size_t>(rnd_int(0, static_cast<int>(mutated.size()) - 1)));
+        break;
+      case 2: // trailing garbage
+        mutated.append(static_cast<size_t>(rnd_int(1, 64)), static_cast<char>(rnd_int(0, 255)));
+        break;
+      case 3: { // forge a header field (total size, argc, header size)
+        static const size_t offsets[] = { 6, 8, 12 };
+        const size_t offset = offsets[rnd_int(0, 2)];
+        const uint32_t val = rnd_int(0, 1) ? static_cast<uint32_t>(rnd()) : static_cast<uint32_t>(rnd_int(0, 64));
+        memcpy(&mutated[offset], &val, offset == 6 ? sizeof(uint16_t) : sizeof(uint32_t));
+        break;
+      }
+      default: { // forge the length of an arg
+        if (mutated.size() > 36) {
+          const uint32_t val = rnd_int(0, 1) ? static_cast<uint32_t>(rnd()) : static_cast<uint32_t>(rnd_int(0, 400));
+          memcpy(&mutated[32], &val, sizeof(val));
+        }
+        break;
+      }
+    }
+    if (!check_mutation(mutated)) {
+      fprintf(stderr, "round %ld: mutated frame decoded to args outside of the message\n", round);
+      return EXIT_FAILURE;
+    }
+  }
+  printf("argv-frame-fuzz: passed\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
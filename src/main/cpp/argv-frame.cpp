@@ -0,0 +1,130 @@
+/* argv-frame.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <atomic>
+#include <unistd.h>
+#include "argv-frame.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+namespace argv_frame {
+
+  static const char magic[4] = { '\0', 'S', 'P', 'F' };
+
+  enum HDR_OFFSET : size_t {
+    MAGIC = 0, VERSION_NBR = 4, HDR_SIZE = 6, TOTAL_SIZE = 8, ARGC = 12,
+    CLIENT_PID = 16, CLIENT_UID = 20, REQUEST_ID = 24, V1_HDR_SIZE = 32
+  };
+  static const size_t arg_len_size = sizeof(uint32_t);
+
+  template<typename T>
+  static void put(std::string &buf, size_t offset, T val) {
+    memcpy(&buf[offset], &val, sizeof(val));
+  }
+
+  template<typename T>
+  static T get(const char *p) {
+    T val;
+    memcpy(&val, p, sizeof(val));
+    return val;
+  }
+
+  bool is_frame(string_view const msg) {
+    return msg.size() >= V1_HDR_SIZE && memcmp(msg.data(), magic, sizeof(magic)) == 0;
+  }
+
+  std::string encode(int argc, const char * const argv[]) {
+    static std::atomic<uint32_t> s_request_seq{0};
+    const auto pid = getpid();
+
+    size_t total_size = V1_HDR_SIZE;
+    for (int i = 0; i < argc; i++) {
+      total_size += arg_len_size + strlen(argv[i]) + 1;
+    }
+    std::string buf(total_size, '\0');
+    memcpy(&buf[MAGIC], magic, sizeof(magic));
+    put<uint16_t>(buf, VERSION_NBR, VERSION);
+    put<uint16_t>(buf, HDR_SIZE, V1_HDR_SIZE);
+    put<uint32_t>(buf, TOTAL_SIZE, static_cast<uint32_t>(total_size));
+    put<uint32_t>(buf, ARGC, static_cast<uint32_t>(argc));
+    put<int32_t>(buf, CLIENT_PID, pid);
+    put<uint32_t>(buf, CLIENT_UID, getuid());
+    put<uint64_t>(buf, REQUEST_ID, (static_cast<uint64_t>(pid) << 32) | ++s_request_seq);
+    size_t pos = V1_HDR_SIZE;
+    for (int i = 0; i < argc; i++) {
+      const auto len = strlen(argv[i]);
+      put<uint32_t>(buf, pos, static_cast<uint32_t>(len));
+      pos += arg_len_size;
+      memcpy(&buf[pos], argv[i], len);
+      pos += len + 1; // the terminating NUL is already there
+    }
+    assert(pos == total_size);
+    return buf;
+  }
+
+  bool decode(string_view const msg, frame_t &frame) {
+    frame.args.clear();
+    if (!is_frame(msg)) return false;
+    auto const p = msg.data();
+    const auto version = get<uint16_t>(p + VERSION_NBR);
+    const size_t hdr_size = get<uint16_t>(p + HDR_SIZE);
+    const size_t total_size = get<uint32_t>(p + TOTAL_SIZE);
+    const size_t argc = get<uint32_t>(p + ARGC);
+    if (version < 1 || hdr_size < V1_HDR_SIZE || total_size != msg.size() || hdr_size > total_size) return false;
+    // every arg takes at least its length and NUL terminator - bounds argc before reserving for it
+    if (argc > (total_size - hdr_size) / (arg_len_size + 1)) return false;
+    frame.version = version;
+    frame.client_pid = get<int32_t>(p + CLIENT_PID);
+    frame.client_uid = get<uint32_t>(p + CLIENT_UID);
+    frame.request_id = get<uint64_t>(p + REQUEST_ID);
+    frame.args.reserve(argc);
+    size_t pos = hdr_size;
+    for (size_t i = 0; i < argc; i++) {
+      if (total_size - pos < arg_len_size + 1) return false;
+      const size_t len = get<uint32_t>(p + pos);
+      pos += arg_len_size;
+      if (len > total_size - pos - 1 || p[pos + len] != '\0') return false;
+      frame.args.emplace_back(p + pos, len);
+      pos += len + 1;
+    }
+    return pos == total_size;
+  }
+
+  std::string to_cmd_line(const frame_t &frame) {
+    std::string cmd_line;
+    for (const auto &arg : frame.args) {
+      if (!cmd_line.empty()) {
+        cmd_line += ' ';
+      }
+      cmd_line += '"';
+      cmd_line.append(arg.data(), arg.size());
+      cmd_line += '"';
+    }
+    return cmd_line;
+  }
+
+  std::string printable(const std::string &msg) {
+    frame_t frame;
+    if (!decode(msg, frame)) {
+      return is_frame(msg) ? std::string("<malformed argv frame>") : msg;
+    }
+    return to_cmd_line(frame);
+  }
+}
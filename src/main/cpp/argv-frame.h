@@ -0,0 +1,78 @@
+/* argv-frame.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_ARGV_FRAME_H
+#define SPARTAN_ARGV_FRAME_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "string-view.h"
+
+/**
+ * Binary wire format of a command invocation message - the argv of the client plus metadata.
+ *
+ * Layout (host byte order - sender and receiver are always on the same host):
+ *
+ *   offset  size
+ *        0     4  magic "\0SPF" (the leading NUL never begins a text message)
+ *        4     2  version
+ *        6     2  header size (later versions may append metadata - a reader skips what it doesn't know)
+ *        8     4  total frame size
+ *       12     4  argc
+ *       16     4  client pid
+ *       20     4  client uid
+ *       24     8  request id (unique per client process - its pid and a sequence number)
+ *       32      ... argc times: 4 byte length, the UTF-8 bytes of the arg, a terminating NUL
+ *
+ * An arg is taken verbatim - quotes, spaces and newlines round-trip as is. By convention args[0]
+ * is the extended invoke option, args[1] the uds socket name and args[2] the sub-command.
+ *
+ * Decoding is zero-copy: the args are views into the message buffer (each is also NUL terminated,
+ * so it can be used as a C string for as long as the buffer lives).
+ */
+namespace argv_frame {
+
+  using bpstd::string_view;
+
+  static const uint16_t VERSION = 1;
+
+  struct frame_t {
+    uint16_t version = 0;
+    int32_t client_pid = 0;
+    uint32_t client_uid = 0;
+    uint64_t request_id = 0;
+    std::vector<string_view> args;
+  };
+
+  // is msg a binary argv frame (as opposed to a text message)
+  bool is_frame(string_view const msg);
+
+  // encodes the args along with the metadata of the calling process (its pid, uid and a new request id)
+  std::string encode(int argc, const char * const argv[]);
+
+  // decodes msg into frame - returns false if msg isn't a well formed frame
+  bool decode(string_view const msg, frame_t &frame);
+
+  // the args double quoted and space delimited (for logging, and for lifecycle notifications to Java)
+  std::string to_cmd_line(const frame_t &frame);
+  // the message itself if it's a text message, else the command line of the frame
+  std::string printable(const std::string &msg);
+}
+
+#endif //SPARTAN_ARGV_FRAME_H
@@ -0,0 +1,109 @@
+/* cmd-index-bench.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Microbenchmark of command resolution at 10, 100 and 1000 commands - a case-insensitive scan of the command
+// vector (as find_child_processor_method() did), a command set built per lookup (as get_child_processor_commands()
+// did per message) and looked up, and the perfect hash index. The commands are looked up in mixed case, and
+// one lookup in five is of a command that doesn't exist. Reports ns per lookup, and the time to build the index.
+//
+// usage: cmd-index-bench [lookups]
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <strings.h>
+#include "log.h"
+#include "cmd-index.h"
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static std::string to_lower(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+  return str;
+}
+
+template<typename F>
+static void run(const char *name, const int lookups, const std::vector<std::string> &keys, F find) {
+  long found = 0;
+  const auto start_ns = now_ns();
+  for (int i = 0; i < lookups; i++) {
+    found += find(keys[static_cast<size_t>(i) % keys.size()]) ? 1 : 0;
+  }
+  const auto elapsed_ns = now_ns() - start_ns;
+  printf("  %-22s %10.1f ns/lookup  (%ld found)\n", name, static_cast<double>(elapsed_ns) / lookups, found);
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("cmd-index-bench");
+  const int lookups = argc > 1 ? atoi(argv[1]) : 200000;
+
+  for (const int count : { 10, 100, 1000 }) {
+    std::vector<std::string> cmds;
+    for (int i = 0; i < count; i++) {
+      cmds.push_back("Command_" + std::to_string(i) + "_Name");
+    }
+    // what a client sends - mixed case, and every fifth one not a command
+    std::vector<std::string> keys;
+    for (int i = 0; i < count; i++) {
+      keys.push_back((i % 5) == 4 ? "NO_SUCH_CMD_" + std::to_string(i) : to_lower(cmds[(i * 7) % count]));
+    }
+    std::random_shuffle(keys.begin(), keys.end());
+
+    std::vector<cmd_index::string_view> names;
+    for (const auto &cmd : cmds) {
+      names.emplace_back(cmd.c_str(), cmd.size());
+    }
+    cmd_index::table_t table;
+    const auto build_start_ns = now_ns();
+    if (!cmd_index::build(names, table)) {
+      printf("%d commands: building the index failed\n", count);
+      return EXIT_FAILURE;
+    }
+    const auto build_ns = now_ns() - build_start_ns;
+    printf("%d commands (index built in %.1f us, %lu seeds):\n", count, static_cast<double>(build_ns) / 1e3,
+           table.seeds.size());
+
+    const int n = std::max(lookups / count, 1) * static_cast<int>(keys.size());
+    run("scan (icompare)", n, keys, [&cmds](const std::string &key) -> bool {
+      for (const auto &cmd : cmds) {
+        if (cmd.size() == key.size() && strcasecmp(cmd.c_str(), key.c_str()) == 0) return true;
+      }
+      return false;
+    });
+    run("set built per lookup", std::max(n / 10, 1), keys, [&cmds](const std::string &key) -> bool {
+      std::unordered_set<std::string> cmds_set;
+      for (const auto &cmd : cmds) {
+        cmds_set.emplace(to_lower(cmd));
+      }
+      return cmds_set.count(to_lower(key)) > 0;
+    });
+    const auto span = cmd_index::span_of(table);
+    run("perfect hash", n, keys, [&span, &names](const std::string &key) -> bool {
+      return cmd_index::find(span, cmd_index::string_view(key.c_str(), key.size()),
+                             [&names](size_t i) { return names[i]; }) >= 0;
+    });
+  }
+  return EXIT_SUCCESS;
+}
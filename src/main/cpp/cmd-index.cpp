@@ -0,0 +1,152 @@
+/* cmd-index.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include "log.h"
+#include "cmd-index.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace cmd_index {
+
+  // displacement seeds tried per bucket before giving up on the table
+  static const uint32_t MAX_SEED = 1u << 20;
+
+  static inline uint32_t fmix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+  }
+
+  // FNV-1a (64 bit) of the ASCII case-folded name - taken once per lookup; its high half picks the bucket
+  // and its low half, mixed with the bucket's seed, the slot
+  static uint64_t hash_of(string_view const name) {
+    uint64_t h = 14695981039346656037ull;
+    for (const char c : name) {
+      const auto uc = static_cast<unsigned char>(c);
+      h ^= (uc >= 'A' && uc <= 'Z') ? uc | 0x20u : uc;
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+  static inline uint32_t bucket_of(const uint64_t h, const uint32_t seeds_count) {
+    return fmix32(static_cast<uint32_t>(h >> 32)) % seeds_count;
+  }
+
+  static inline uint32_t slot_of(const uint64_t h, const uint32_t seed, const uint32_t slots_count) {
+    return fmix32(static_cast<uint32_t>(h) ^ (seed * 0x9e3779b9u)) % slots_count;
+  }
+
+  long candidate(const span_t &table, string_view const name) {
+    if (table.slots_count == 0 || table.seeds_count == 0) return -1;
+    const uint64_t h = hash_of(name);
+    const uint32_t seed = table.seeds[bucket_of(h, table.seeds_count)];
+    const uint32_t slot = (seed & DIRECT_SLOT) != 0 ? (seed & ~DIRECT_SLOT) % table.slots_count
+                                                    : slot_of(h, seed, table.slots_count);
+    return static_cast<long>(table.slots[slot]);
+  }
+
+  bool build(const std::vector<string_view> &names, table_t &table) {
+    table.seeds.clear();
+    table.slots.clear();
+    // the hashes of the distinct case-folded names, each with the index of its first entry
+    std::vector<std::pair<uint64_t, uint32_t>> keys;
+    keys.reserve(names.size());
+    {
+      std::unordered_map<std::string, uint32_t> seen(names.size());
+      for (uint32_t i = 0; i < names.size(); i++) {
+        std::string folded(names[i].data(), names[i].size());
+        std::transform(folded.begin(), folded.end(), folded.begin(), [](char c) {
+          return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+        });
+        if (seen.emplace(std::move(folded), i).second) {
+          keys.emplace_back(hash_of(names[i]), i);
+        }
+      }
+    }
+    if (keys.empty()) return true;
+
+    const auto n = static_cast<uint32_t>(keys.size());
+    const uint32_t seeds_count = std::max(1u, (n + 1) / 2); // two names per bucket on average
+    std::vector<std::vector<uint32_t>> buckets(seeds_count);
+    for (uint32_t k = 0; k < n; k++) {
+      buckets[bucket_of(keys[k].first, seeds_count)].push_back(k);
+    }
+    // the largest buckets are placed first, while most slots are free
+    std::vector<uint32_t> order(seeds_count);
+    for (uint32_t b = 0; b < seeds_count; b++) order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+      return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<uint32_t> seeds(seeds_count, 0);
+    std::vector<long> slots(n, -1);
+    std::vector<uint32_t> bucket_slots;
+    uint32_t next_free = 0;
+    for (const auto b : order) {
+      const auto &bucket = buckets[b];
+      if (bucket.empty()) break;
+      if (bucket.size() == 1) {
+        // a single name is placed in any free slot directly
+        while (slots[next_free] != -1) next_free++;
+        seeds[b] = DIRECT_SLOT | next_free;
+        slots[next_free] = keys[bucket.front()].second;
+        continue;
+      }
+      bool is_placed = false;
+      for (uint32_t seed = 1; seed < MAX_SEED && !is_placed; seed++) {
+        bucket_slots.clear();
+        is_placed = true;
+        for (const auto k : bucket) {
+          const uint32_t slot = slot_of(keys[k].first, seed, n);
+          if (slots[slot] != -1 || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+            is_placed = false;
+            break;
+          }
+          bucket_slots.push_back(slot);
+        }
+        if (is_placed) {
+          seeds[b] = seed;
+          for (size_t j = 0; j < bucket.size(); j++) {
+            slots[bucket_slots[j]] = keys[bucket[j]].second;
+          }
+        }
+      }
+      if (!is_placed) {
+        log(LL::WARN, "%s(): no perfect hash displacement found for %u command names", __func__, n);
+        return false;
+      }
+    }
+    table.seeds = std::move(seeds);
+    table.slots.reserve(n);
+    for (const auto slot : slots) {
+      assert(slot != -1);
+      table.slots.push_back(static_cast<uint32_t>(slot));
+    }
+    return true;
+  }
+}
@@ -0,0 +1,79 @@
+/* cmd-index.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_CMD_INDEX_H
+#define SPARTAN_CMD_INDEX_H
+
+#include <cstdint>
+#include <strings.h>
+#include <vector>
+#include "string-view.h"
+
+/**
+ * Minimal perfect hash over case-folded command names (hash and displace): a name hashes to a bucket, the
+ * bucket's seed displaces it to a slot, and the slot holds the index of the only entry the name can be.
+ * A lookup is one pass over the name and one case-insensitive compare, regardless of the number of commands.
+ *
+ * The table is built once, when the supervisor publishes its session image (ss_image::build()), and is
+ * stored in the image alongside the command table it indexes.
+ */
+namespace cmd_index {
+
+  using bpstd::string_view;
+
+  // a seed with this bit set is the slot of its (single name) bucket, rather than a displacement
+  static const uint32_t DIRECT_SLOT = 0x80000000u;
+
+  struct table_t {
+    std::vector<uint32_t> seeds; // per bucket
+    std::vector<uint32_t> slots; // per distinct name - the index of its entry
+  };
+
+  // in place view of a table (as stored in the session image, or of a table_t)
+  struct span_t {
+    const uint32_t *seeds;
+    uint32_t seeds_count;
+    const uint32_t *slots;
+    uint32_t slots_count;
+  };
+
+  inline span_t span_of(const table_t &table) {
+    return span_t{ table.seeds.data(), static_cast<uint32_t>(table.seeds.size()),
+                   table.slots.data(), static_cast<uint32_t>(table.slots.size()) };
+  }
+
+  // builds the table over names (case-insensitive; where names repeat, the first entry is the one indexed) -
+  // returns false in the unlikely event that no displacement is found, for which callers scan instead
+  bool build(const std::vector<string_view> &names, table_t &table);
+
+  // the entry index that name can be, else -1 if the table is empty (the caller compares the names)
+  long candidate(const span_t &table, string_view name);
+
+  inline bool iequals(string_view const a, string_view const b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+  }
+
+  // the entry index of name, else -1; name_at(i) is the name of entry i
+  template<typename NameAt>
+  long find(const span_t &table, string_view const name, NameAt name_at) {
+    const long i = candidate(table, name);
+    return i >= 0 && iequals(name_at(static_cast<size_t>(i)), name) ? i : -1;
+  }
+}
+
+#endif //SPARTAN_CMD_INDEX_H
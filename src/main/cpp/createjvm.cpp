@@ -17,13 +17,18 @@ limitations under the License.
 
 */
 #include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
 #include <sstream>
 #include <unordered_set>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <popt.h>
 #include "format2str.h"
 #include "log.h"
 #include "findfiles.h"
+#include "app-cds.h"
 #include "createjvm.h"
 
 using namespace logger;
@@ -63,17 +68,135 @@ static std::string get_java_classpath() {
   return jvm_classpath_optn + (is_classpath_empty ? user_classpath : classpath);
 }
 
+// JVM runtime library directories relative to JAVA_HOME, per the known JDK layouts
+// (JDK 9+ lib/server; JDK 8 jre/lib/<arch>/server; the JRE-only equivalents of each)
+static const_char_ptr_t const jvmlib_layout_dirs[] = {
+    "lib/server",
+#if defined(__x86_64__)
+    "jre/lib/amd64/server",
+    "lib/amd64/server",
+#elif defined(__aarch64__)
+    "jre/lib/aarch64/server",
+    "lib/aarch64/server",
+#elif defined(__i386__)
+    "jre/lib/i386/server",
+    "jre/lib/i386/client",
+    "lib/i386/server",
+#elif defined(__powerpc64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    "jre/lib/ppc64le/server",
+    "lib/ppc64le/server",
+#endif
+    "jre/lib/server",
+    "lib/client",
+};
+
+static bool is_regular_file(const_char_ptr_t const path) {
+  struct stat st{};
+  return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// cache of resolved libjvm.so paths - one line per JAVA_HOME: <JAVA_HOME path> TAB <JAVA_HOME mtime> TAB <libjvm.so path>
+static std::string jvmlib_cache_path() {
+  const_char_ptr_t const homedir = getenv("HOME");
+  return homedir != nullptr && homedir[0] != '\0'
+         ? format2str("%s/.cache/spartan/jvmlib-path.cache", homedir)
+         : std::string("/tmp/spartan-jvmlib-path.cache");
+}
+
+static std::string java_home_cache_key(const_char_ptr_t const java_home) {
+  struct stat st{};
+  if (stat(java_home, &st) != 0) return std::string();
+  return format2str("%s\t%ld", java_home, static_cast<long>(st.st_mtime));
+}
+
+static std::string lookup_jvmlib_cache(const std::string &cache_key) {
+  std::ifstream in(jvmlib_cache_path());
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.size() > cache_key.size() && line.compare(0, cache_key.size(), cache_key) == 0
+        && line[cache_key.size()] == '\t')
+    {
+      auto jvmlib_path = line.substr(cache_key.size() + 1);
+      return is_regular_file(jvmlib_path.c_str()) ? jvmlib_path : std::string();
+    }
+  }
+  return std::string();
+}
+
+// replaces the JAVA_HOME's cache entry (written to a temp file that is then renamed over the cache file)
+static void update_jvmlib_cache(const std::string &cache_key, const std::string &jvmlib_path) {
+  const auto cache_path = jvmlib_cache_path();
+  const auto java_home_prefix = cache_key.substr(0, cache_key.find('\t') + 1);
+  std::stringstream ss;
+  {
+    std::ifstream in(cache_path);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (!line.empty() && line.compare(0, java_home_prefix.size(), java_home_prefix) != 0) {
+        ss << line << '\n';
+      }
+    }
+  }
+  ss << cache_key << '\t' << jvmlib_path << '\n';
+  const auto cache_dir = cache_path.substr(0, cache_path.rfind(kPathSeparator));
+  const auto parent_dir = cache_dir.substr(0, cache_dir.rfind(kPathSeparator));
+  mkdir(parent_dir.c_str(), 0755);
+  mkdir(cache_dir.c_str(), 0755);
+  const auto tmp_path = format2str("%s.%d", cache_path.c_str(), getpid());
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    out << ss.str();
+    if (!out.good()) {
+      log(LL::WARN, "%s() failed writing \"%s\"", __func__, tmp_path.c_str());
+      return;
+    }
+  }
+  if (rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    log(LL::WARN, "%s() failed renaming \"%s\":\n\t%s", __func__, tmp_path.c_str(), strerror(errno));
+    unlink(tmp_path.c_str());
+  }
+}
+
 // Determine the Java JVM runtime library path via JAVA_HOME environment variable
 // (returns just the jvm library file name if fails to locate it under JAVA_HOME)
+//
+// Resolution order: probe the known JDK layouts, then the cache file (keyed by JAVA_HOME
+// path and mtime), and as a last resort walk the JAVA_HOME directory tree (caching the result)
 std::string determine_jvmlib_path() {
   log(LL::DEBUG, "Java environment variables:\n\tJAVA $JAVA_HOME=%s\n\tJAVA $CLASSPATH=%s",
       java_home_path(), java_classpath());
 
+  const auto start = std::chrono::steady_clock::now();
+  auto const log_resolved = [&start](const std::string &jvmlib_path, const_char_ptr_t const how) {
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    log(LL::DEBUG, "using Java JVM runtime located at (resolved via %s in %.3f ms):\n\t\"%s\"",
+        how, elapsed.count(), jvmlib_path.c_str());
+  };
+
   const_char_ptr_t const jvmlib_name = "libjvm.so";
+  const_char_ptr_t const java_home = java_home_path();
+
+  for (auto const layout_dir : jvmlib_layout_dirs) {
+    auto jvmlib_path = format2str("%s/%s/%s", java_home, layout_dir, jvmlib_name);
+    if (is_regular_file(jvmlib_path.c_str())) {
+      log_resolved(jvmlib_path, "JDK layout probe");
+      return jvmlib_path;
+    }
+  }
+
+  const auto cache_key = java_home_cache_key(java_home);
+  if (!cache_key.empty()) {
+    auto jvmlib_path = lookup_jvmlib_cache(cache_key);
+    if (!jvmlib_path.empty()) {
+      log_resolved(jvmlib_path, "cache file");
+      return jvmlib_path;
+    }
+  }
+
   std::string jvmlib_path(jvmlib_name);
   try {
-    if (!findfiles(java_home_path(), [jvmlib_name,&jvmlib_path](const_char_ptr_t const filepath,
-                                                                const_char_ptr_t const filename)
+    if (!findfiles(java_home, [jvmlib_name,&jvmlib_path](const_char_ptr_t const filepath,
+                                                         const_char_ptr_t const filename)
     {
       if (strcasecmp(filename, jvmlib_name) == 0) {
         jvmlib_path = std::string(filepath);
@@ -83,7 +206,10 @@ std::string determine_jvmlib_path() {
     })) {
       log(LL::ERR, "failed to find Java JVM runtime \"%s\"", jvmlib_name);
     } else {
-      log(LL::DEBUG, "using Java JVM runtime located at:\n\t\"%s\"", jvmlib_path.c_str());
+      log_resolved(jvmlib_path, "JAVA_HOME tree walk");
+      if (!cache_key.empty()) {
+        update_jvmlib_cache(cache_key, jvmlib_path);
+      }
     }
   } catch(findfiles_exception& ex) {
     log(LL::ERR, "failed to find Java JVM runtime \"%s\"\n\t%s: %s", jvmlib_name, ex.name(), ex.what());
@@ -219,8 +345,11 @@ static bool consolidate_jvm_options(int &argc, const_char_ptr_t argv[]) {
 }
 
 // Instantiates the Java JVM runtime - returns a tuple type pair of JavaVM* and JNIEnv*
-// (throws exception if fails to instantiate JVM)
-jvm_create_t create_jvm(void * const hlibjvm, const_char_ptr_t jvm_override_optns) {
+// (throws exception if fails to instantiate JVM); jvm_appended_optns are passed to the JVM as is, after
+// the consolidated options - consolidation keys on the option prefix, so would merge distinct -XX: options
+jvm_create_t create_jvm(void * const hlibjvm, const_char_ptr_t jvm_override_optns,
+                        const_char_ptr_t jvm_appended_optns)
+{
   static auto const func_name = __func__;
 
   const std::string cmd_line_args = [](const_char_ptr_t jvm_override_optns_param) -> std::string {
@@ -265,12 +394,27 @@ jvm_create_t create_jvm(void * const hlibjvm, const_char_ptr_t jvm_override_optn
   } else if (argc <= 0) {
     argv = nullptr;
   }
+
+  int appended_argc = 0;
+  const_char_ptr_t *appended_argv = nullptr;
+  if (jvm_appended_optns != nullptr && jvm_appended_optns[0] != 0) {
+    const auto rc = poptParseArgvString(jvm_appended_optns, &appended_argc, &appended_argv);
+    if (rc != 0) {
+      static const_char_ptr_t const err_msg_fmt = "%s() failed parsing appended Java JVM options:\n\t%s";
+      auto errmsg( format2str(err_msg_fmt, func_name, poptStrerror(rc)) );
+      throw create_jvm_exception(std::move(errmsg));
+    }
+    log_print_argv("append", appended_argc, appended_argv);
+  }
+  std::unique_ptr<const_char_ptr_t, decltype(cleanup)> raii_appended_argv_sp(appended_argv, cleanup);
+
   jint count = argc + base_optns;
+  const jint alloc_count = count + app_cds::MAX_OPTNS + appended_argc;
 
-  std::unique_ptr<std::string[]> optionStrsSP(new std::string[count]);
-  auto const jvm_args_options = (JavaVMOption*) alloca(sizeof(JavaVMOption) * count);
+  std::unique_ptr<std::string[]> optionStrsSP(new std::string[alloc_count]);
+  auto const jvm_args_options = (JavaVMOption*) alloca(sizeof(JavaVMOption) * alloc_count);
   // initialize stack allocated array of JavaVMOption
-  for(int i = 0; i < count; i++) {
+  for(int i = 0; i < alloc_count; i++) {
     auto &option = jvm_args_options[i];
     option.optionString = nullptr;
     option.extraInfo = nullptr;
@@ -278,6 +422,20 @@ jvm_create_t create_jvm(void * const hlibjvm, const_char_ptr_t jvm_override_optn
   // now populate with actual arguments to be passed to JVM
   count = set_JavaVMOptions(static_cast<unsigned>(argc), argv, optionStrsSP.get(), jvm_args_options);
 
+  // inject AppCDS options (use of the shared archive for this classpath, else record a training class list)
+  for (auto &cds_optn : app_cds::jvm_options(optionStrsSP[0], hlibjvm)) {
+    auto &optionStr = optionStrsSP[count];
+    optionStr = std::move(cds_optn);
+    jvm_args_options[count++].optionString = const_cast<char*>(optionStr.c_str());
+  }
+
+  // then the appended options (e.g., those starting a flight recording)
+  for (int i = 0; i < appended_argc; i++) {
+    auto &optionStr = optionStrsSP[count];
+    optionStr = appended_argv[i];
+    jvm_args_options[count++].optionString = const_cast<char*>(optionStr.c_str());
+  }
+
   JavaVMInitArgs vm_args = {0};
   vm_args.version = JNI_VERSION_1_6; //JDK version. This indicates version 1.6
   vm_args.options = jvm_args_options;
@@ -31,6 +31,7 @@ typedef std::tuple<JavaVM*,JNIEnv*> jvm_create_t;
 
 std::string determine_jvmlib_path();
 void* open_jvm_runtime_module(const char * const jvmlib_path);
-jvm_create_t create_jvm(void * const hlibjvm, const char *jvm_override_optns);
+jvm_create_t create_jvm(void * const hlibjvm, const char *jvm_override_optns,
+                        const char *jvm_appended_optns = nullptr);
 
 #endif // __CREATEJVM_H__
@@ -0,0 +1,119 @@
+/* dispatch-queue-bench.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Microbenchmark of the dispatch queue - enqueue to dequeue latency with 1, 8 and 64 producer threads
+// feeding the single consumer thread. The producers together offer messages at rate-per-sec (evenly
+// spaced); a rate of 0 has them push flat out, which measures saturated throughput instead.
+//
+// usage: dispatch-queue-bench [messages-per-run [rate-per-sec [capacity [block|reject|spill]]]]
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "log.h"
+#include "dispatch-queue.h"
+
+using namespace dispatch_queue;
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static void run(const int producers, const int messages, const int rate, const size_t capacity,
+                const Overflow policy)
+{
+  DispatchQueue queue(capacity, policy);
+  const int per_producer = messages / producers;
+  const int total = per_producer * producers;
+  std::vector<long long> latencies;
+  latencies.reserve(static_cast<size_t>(total));
+  int rejected = 0;
+
+  const auto start_ns = now_ns();
+  std::thread consumer([&queue, &latencies, total] {
+    std::string msg;
+    for (int received = 0; received < total; ) {
+      if (queue.try_pop(msg)) {
+        if (msg.empty()) break; // a producer's message was rejected - the end marker follows
+        latencies.push_back(now_ns() - std::strtoll(msg.c_str(), nullptr, 10));
+        received++;
+      } else {
+        queue.park(100, true);
+      }
+    }
+  });
+  std::vector<std::thread> producer_thrds;
+  std::vector<int> producer_rejects(static_cast<size_t>(producers), 0);
+  for (int p = 0; p < producers; p++) {
+    producer_thrds.emplace_back([&queue, &producer_rejects, p, producers, per_producer, rate, start_ns] {
+      const long long interval_ns = rate > 0 ? 1000000000LL / rate : 0;
+      char buf[64];
+      for (int i = 0; i < per_producer; i++) {
+        if (interval_ns > 0) {
+          const long long due_ns = start_ns + (static_cast<long long>(i) * producers + p) * interval_ns;
+          const timespec due{ static_cast<time_t>(due_ns / 1000000000LL), static_cast<long>(due_ns % 1000000000LL) };
+          clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, nullptr);
+        }
+        snprintf(buf, sizeof(buf), "%lld \"BENCH\" \"arg\"", now_ns());
+        if (!queue.push(std::string(buf))) {
+          producer_rejects[p]++;
+        }
+      }
+    });
+  }
+  for (auto &thrd : producer_thrds) {
+    thrd.join();
+  }
+  for (const int n : producer_rejects) {
+    rejected += n;
+  }
+  if (rejected > 0) {
+    while (!queue.push(std::string())) {} // end marker - messages were rejected so the consumer won't reach total
+  }
+  consumer.join();
+  const auto elapsed_ns = now_ns() - start_ns;
+
+  std::sort(latencies.begin(), latencies.end());
+  auto const pct = [&latencies](double p) -> double {
+    if (latencies.empty()) return 0.0;
+    return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))] / 1000.0;
+  };
+  printf("%3d producer(s): %8d msgs, %10.0f msgs/sec, latency p50 %8.1f us, p99 %8.1f us, p99.9 %8.1f us,"
+         " max %9.1f us, rejected %d\n",
+         producers, static_cast<int>(latencies.size()), latencies.size() / (elapsed_ns / 1e9),
+         pct(0.50), pct(0.99), pct(0.999), latencies.empty() ? 0.0 : latencies.back() / 1000.0, rejected);
+  printf("\t%s\n", queue.stats_str().c_str());
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("dispatch-queue-bench");
+  const int messages = argc > 1 ? std::max(atoi(argv[1]), 64) : 200000;
+  const int rate = argc > 2 ? std::max(atoi(argv[2]), 0) : 50000;
+  const size_t capacity = argc > 3 ? static_cast<size_t>(std::max(atoi(argv[3]), 1)) : 256;
+  if (argc > 4) {
+    set_overflow(argv[4]);
+  }
+  for (const int producers : { 1, 8, 64 }) {
+    run(producers, messages, rate, capacity, overflow());
+  }
+  return EXIT_SUCCESS;
+}
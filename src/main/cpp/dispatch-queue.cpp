@@ -0,0 +1,436 @@
+/* dispatch-queue.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <algorithm>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "format2str.h"
+#include "log.h"
+#include "str-split.h"
+#include "dispatch-queue.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace dispatch_queue {
+
+  const char * const CONTROL_LANE = "<control>";
+
+  static int s_capacity = 256;
+  static Overflow s_overflow = Overflow::BLOCK;
+  static std::unordered_map<std::string, int> s_weights; // lower-case command name to its weight
+
+  // messages of commands beyond this many lanes share the one overflow lane (command names are client input)
+  static const size_t max_lanes = 64;
+  static const char * const default_lane = "<default>";
+  static const char * const overflow_lane = "<other>";
+
+  // a producer awaiting space re-checks at this interval regardless (covers a token taken by another producer)
+  static const int await_space_poll_ms = 10;
+
+  void set_capacity(int capacity) { s_capacity = std::max(capacity, 1); }
+
+  void set_overflow(const char *policy) {
+    if (strcasecmp(policy, "block") == 0) {
+      s_overflow = Overflow::BLOCK;
+    } else if (strcasecmp(policy, "reject") == 0) {
+      s_overflow = Overflow::REJECT;
+    } else if (strcasecmp(policy, "spill") == 0) {
+      s_overflow = Overflow::SPILL;
+    } else {
+      log(LL::WARN, "%s(): unknown dispatch queue overflow policy \"%s\" (block, reject or spill) - using %s",
+          __func__, policy, overflow_name(s_overflow));
+    }
+  }
+
+  int capacity() { return s_capacity; }
+  Overflow overflow() { return s_overflow; }
+
+  void set_weights(const char *weights) {
+    s_weights.clear();
+    for (auto &entry : str_split(weights != nullptr ? weights : "", ',')) {
+      entry.erase(std::remove(entry.begin(), entry.end(), ' '), entry.end());
+      const auto pos = entry.find(':');
+      if (entry.empty()) continue;
+      auto name = entry.substr(0, pos);
+      std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+      const int weight = pos != std::string::npos ? atoi(entry.c_str() + pos + 1) : 0;
+      if (weight < 1) {
+        log(LL::WARN, "%s(): invalid dispatch weight \"%s\" (expected command:weight, weight >= 1) - ignored",
+            __func__, entry.c_str());
+        continue;
+      }
+      s_weights[name] = weight;
+    }
+  }
+
+  int weight_of(const std::string &lane_name) {
+    auto const it = s_weights.find(lane_name);
+    return it != s_weights.end() ? it->second : 1;
+  }
+
+  const char* overflow_name(Overflow policy) {
+    switch (policy) {
+      case Overflow::BLOCK:  return "block";
+      case Overflow::REJECT: return "reject";
+      case Overflow::SPILL:  return "spill";
+    }
+    return "?";
+  }
+
+  static uint64_t now_ns() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+  }
+
+  static size_t round_up_pow2(size_t n) {
+    size_t pow2 = 1;
+    while (pow2 < n) pow2 <<= 1;
+    return pow2;
+  }
+
+  static void update_max(std::atomic<uint64_t> &max_val, const uint64_t val) {
+    auto curr = max_val.load(std::memory_order_relaxed);
+    while (val > curr && !max_val.compare_exchange_weak(curr, val, std::memory_order_relaxed)) {}
+  }
+
+  static void drain_eventfd(const int fd) {
+    uint64_t count = 0;
+    while (read(fd, &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count))) {}
+  }
+
+  static void signal_eventfd(const int fd) {
+    const uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+      log(LL::ERR, "%s(): eventfd write failed: %s", __func__, strerror(errno));
+    }
+  }
+
+  DispatchQueue::DispatchQueue(size_t capacity, Overflow policy, lane_of_t lane_of)
+      : policy(policy), capacity_(std::max(capacity, static_cast<size_t>(1))),
+        mask(round_up_pow2(std::max(capacity, static_cast<size_t>(2))) - 1),
+        cells(new cell_t[mask + 1]),
+        wakeup_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+        space_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC | EFD_SEMAPHORE)),
+        lane_of(std::move(lane_of))
+  {
+    std::unique_ptr<lane_t> control_lane_sp(new lane_t(CONTROL_LANE, 1));
+    control_lane = control_lane_sp.get();
+    lanes.emplace(CONTROL_LANE, std::move(control_lane_sp));
+    for (size_t i = 0; i <= mask; i++) {
+      cells[i].seq.store(i, std::memory_order_relaxed);
+      cells[i].enqueue_ns = 0;
+    }
+    if (wakeup_fd == -1 || space_fd_ == -1) {
+      log(LL::ERR, "%s(): eventfd() failed: %s", __func__, strerror(errno));
+    }
+    log(LL::DEBUG, "%s(): capacity %lu, overflow policy: %s", __func__, capacity_, overflow_name(policy));
+  }
+
+  DispatchQueue::~DispatchQueue() {
+    if (wakeup_fd != -1) close(wakeup_fd);
+    if (space_fd_ != -1) close(space_fd_);
+  }
+
+  // claims the slot at the enqueue position and publishes msg into it - fails if the ring is full, or if
+  // the ring and the lanes together hold capacity messages
+  bool DispatchQueue::try_push(std::string &msg, uint64_t enqueue_ns) {
+    cell_t *cell;
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for(;;) {
+      if (is_at_capacity(pos)) return false;
+      cell = &cells[pos & mask];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const auto dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (dif == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (dif < 0) {
+        return false; // the consumer has yet to free this slot
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->msg = std::move(msg);
+    cell->enqueue_ns = enqueue_ns;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool DispatchQueue::is_at_capacity(const size_t pos) const {
+    // the lanes count is raised before a ring slot is freed, so a message moving into the lanes isn't missed
+    const size_t lanes_depth = lanes_count.load(std::memory_order_acquire);
+    return pos - dequeue_pos.load(std::memory_order_acquire) + lanes_depth >= capacity_;
+  }
+
+  bool DispatchQueue::is_full() const {
+    const size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    const size_t seq = cells[pos & mask].seq.load(std::memory_order_acquire);
+    return static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0 || is_at_capacity(pos);
+  }
+
+  bool DispatchQueue::is_ready() const {
+    const size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    return cells[pos & mask].seq.load(std::memory_order_acquire) == pos + 1 ||
+           spill_count.load(std::memory_order_relaxed) > 0 || lanes_count.load(std::memory_order_relaxed) > 0;
+  }
+
+  void DispatchQueue::wake_consumer() {
+    // pairs with the fence of park() - either the consumer sees the message or this sees the consumer parked
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (is_consumer_parked.load(std::memory_order_relaxed)) {
+      signal_eventfd(wakeup_fd);
+    }
+  }
+
+  void DispatchQueue::note_depth() {
+    update_max(max_depth, depth());
+  }
+
+  bool DispatchQueue::push(std::string &&msg) {
+    const auto enqueue_ns = now_ns();
+    // once messages have spilled, the ring is bypassed until they're dequeued - keeps the queue in FIFO order
+    bool is_in_ring = false;
+    if (policy != Overflow::SPILL || spill_count.load(std::memory_order_acquire) == 0) {
+      while (!(is_in_ring = try_push(msg, enqueue_ns))) {
+        if (policy == Overflow::REJECT) {
+          rejected++;
+          return false;
+        }
+        if (policy == Overflow::SPILL) break;
+        blocked++;
+        const auto wait_start_ns = now_ns();
+        while (begin_await_space()) {
+          pollfd pfd{space_fd_, POLLIN, 0};
+          if (poll(&pfd, 1, await_space_poll_ms) > 0) {
+            uint64_t token = 0;
+            (void) read(space_fd_, &token, sizeof(token));
+          }
+          end_await_space();
+        }
+        blocked_ns += now_ns() - wait_start_ns;
+      }
+    }
+    if (is_in_ring) {
+      pushed++;
+      note_depth();
+      wake_consumer();
+      return true;
+    }
+    {
+      std::unique_lock<std::mutex> lk(spill_mtx);
+      spill.emplace_back(enqueue_ns, std::move(msg));
+      spill_count.fetch_add(1, std::memory_order_release);
+    }
+    pushed++;
+    spilled++;
+    note_depth();
+    wake_consumer();
+    return true;
+  }
+
+  bool DispatchQueue::begin_await_space() {
+    space_waiters.fetch_add(1, std::memory_order_relaxed);
+    // pairs with the fence of try_pop() - either this sees the freed slot or the consumer sees the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!is_full()) {
+      space_waiters.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  void DispatchQueue::end_await_space() {
+    space_waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void DispatchQueue::note_dequeued(uint64_t enqueue_ns) {
+    popped++;
+    const auto queued = now_ns() - enqueue_ns;
+    queued_ns += queued;
+    update_max(max_queued_ns, queued);
+  }
+
+  // takes the next message of the intake - the ring, then the spill list - and counts it into the lanes
+  // (it moves within the queue, so makes no room for producers)
+  bool DispatchQueue::try_pop_intake(std::string &msg, uint64_t &enqueue_ns) {
+    const size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    cell_t &cell = cells[pos & mask];
+    if (cell.seq.load(std::memory_order_acquire) == pos + 1) {
+      msg = std::move(cell.msg);
+      cell.msg.clear();
+      enqueue_ns = cell.enqueue_ns;
+      lanes_count.fetch_add(1, std::memory_order_release);
+      cell.seq.store(pos + mask + 1, std::memory_order_release);
+      dequeue_pos.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+    if (spill_count.load(std::memory_order_acquire) == 0) return false;
+    std::unique_lock<std::mutex> lk(spill_mtx);
+    if (spill.empty()) return false;
+    enqueue_ns = spill.front().first;
+    msg = std::move(spill.front().second);
+    spill.pop_front();
+    lanes_count.fetch_add(1, std::memory_order_release);
+    spill_count.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  // lanes_mtx is held by the caller
+  void DispatchQueue::enqueue_lane(std::string &&msg, uint64_t enqueue_ns) {
+    auto name = lane_of ? lane_of(msg) : std::string(default_lane);
+    auto it = lanes.find(name);
+    if (it == lanes.end()) {
+      if (lanes.size() >= max_lanes) {
+        name = overflow_lane;
+        it = lanes.find(name);
+      }
+      if (it == lanes.end()) {
+        const int weight = weight_of(name);
+        it = lanes.emplace(name, std::unique_ptr<lane_t>(new lane_t(name, weight))).first;
+      }
+    }
+    lane_t * const lane = it->second.get();
+    lane->msgs.emplace_back(enqueue_ns, std::move(msg));
+    lane->max_depth = std::max(lane->max_depth, static_cast<uint64_t>(lane->msgs.size()));
+    if (!lane->is_active && lane != control_lane) {
+      lane->is_active = true;
+      active_lanes.push_back(lane);
+    }
+  }
+
+  bool DispatchQueue::try_pop(std::string &msg) {
+    std::unique_lock<std::mutex> lk(lanes_mtx);
+    // moves the intake into the lanes - producers are held to the capacity of the ring and lanes together,
+    // so only spilled messages could take the lanes beyond it (they're left on the spill list instead)
+    {
+      std::string intake_msg;
+      uint64_t enqueue_ns = 0;
+      while (lanes_count.load(std::memory_order_relaxed) < capacity_ && try_pop_intake(intake_msg, enqueue_ns)) {
+        enqueue_lane(std::move(intake_msg), enqueue_ns);
+      }
+    }
+    // the control lane goes first, otherwise deficit round-robin of the command lanes - the lane at the
+    // head of the rotation is served until it has used up its quantum (its weight) or has run dry
+    lane_t *lane = nullptr;
+    if (!control_lane->msgs.empty()) {
+      lane = control_lane;
+    } else if (!active_lanes.empty()) {
+      lane = active_lanes.front();
+      if (lane->deficit <= 0) {
+        lane->deficit = lane->weight; // the lane's turn begins
+      }
+    } else {
+      return false;
+    }
+    const auto enqueue_ns = lane->msgs.front().first;
+    msg = std::move(lane->msgs.front().second);
+    lane->msgs.pop_front();
+    lanes_count.fetch_sub(1, std::memory_order_release);
+    // pairs with the fence of begin_await_space() - either it sees the room made or this sees the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (space_waiters.load(std::memory_order_relaxed) > 0) {
+      signal_eventfd(space_fd_);
+    }
+    if (lane != control_lane) {
+      lane->deficit--;
+      if (lane->msgs.empty()) {
+        lane->deficit = 0;
+        lane->is_active = false;
+        active_lanes.pop_front();
+      } else if (lane->deficit == 0) {
+        active_lanes.pop_front();
+        active_lanes.push_back(lane);
+      }
+    }
+    const auto waited_ns = now_ns() - enqueue_ns;
+    int bucket = 0;
+    for (uint64_t limit = 100000; bucket < wait_buckets - 1 && waited_ns >= limit; limit *= 10) {
+      bucket++;
+    }
+    lane->wait_histogram[bucket]++;
+    lane->dequeued++;
+    note_dequeued(enqueue_ns);
+    return true;
+  }
+
+  void DispatchQueue::park(int timeout_ms, bool is_awaiting_msg) {
+    is_consumer_parked.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!(is_awaiting_msg && is_ready())) {
+      const auto start_ns = now_ns();
+      pollfd pfd{wakeup_fd, POLLIN, 0};
+      (void) poll(&pfd, 1, timeout_ms);
+      parked++;
+      parked_ns += now_ns() - start_ns;
+    }
+    is_consumer_parked.store(false, std::memory_order_relaxed);
+    drain_eventfd(wakeup_fd);
+  }
+
+  void DispatchQueue::notify() {
+    signal_eventfd(wakeup_fd);
+  }
+
+  size_t DispatchQueue::depth() const {
+    return enqueue_pos.load(std::memory_order_relaxed) - dequeue_pos.load(std::memory_order_relaxed) +
+           spill_count.load(std::memory_order_relaxed) + lanes_count.load(std::memory_order_relaxed);
+  }
+
+  std::string DispatchQueue::stats_str() const {
+    const auto nbr_popped = popped.load();
+    std::string lanes_str;
+    {
+      std::unique_lock<std::mutex> lk(lanes_mtx);
+      for (auto const &entry : lanes) {
+        auto const &lane = *entry.second;
+        if (lane.dequeued == 0 && lane.msgs.empty()) continue;
+        lanes_str += format2str("\n\tlane %s (weight %d) depth: %lu, max depth: %llu, dequeued: %llu, waited "
+                                "[<100us: %llu, <1ms: %llu, <10ms: %llu, <100ms: %llu, <1s: %llu, >=1s: %llu]",
+                                lane.name.c_str(), lane.weight, lane.msgs.size(),
+                                static_cast<unsigned long long>(lane.max_depth),
+                                static_cast<unsigned long long>(lane.dequeued),
+                                static_cast<unsigned long long>(lane.wait_histogram[0]),
+                                static_cast<unsigned long long>(lane.wait_histogram[1]),
+                                static_cast<unsigned long long>(lane.wait_histogram[2]),
+                                static_cast<unsigned long long>(lane.wait_histogram[3]),
+                                static_cast<unsigned long long>(lane.wait_histogram[4]),
+                                static_cast<unsigned long long>(lane.wait_histogram[5]));
+      }
+    }
+    return format2str("dispatch queue (%s, capacity %lu) depth: %lu, max depth: %llu, pushed: %llu, popped: %llu, "
+                      "rejected: %llu, spilled: %llu, blocked: %llu (%.1f ms), consumer parked: %llu (%.1f ms), "
+                      "queued time avg: %.1f us, max: %.1f us",
+                      overflow_name(policy), capacity_, depth(),
+                      static_cast<unsigned long long>(max_depth.load()),
+                      static_cast<unsigned long long>(pushed.load()),
+                      static_cast<unsigned long long>(nbr_popped),
+                      static_cast<unsigned long long>(rejected.load()),
+                      static_cast<unsigned long long>(spilled.load()),
+                      static_cast<unsigned long long>(blocked.load()), blocked_ns.load() / 1e6,
+                      static_cast<unsigned long long>(parked.load()), parked_ns.load() / 1e6,
+                      nbr_popped > 0 ? static_cast<double>(queued_ns.load()) / nbr_popped / 1000.0 : 0.0,
+                      max_queued_ns.load() / 1000.0) + lanes_str;
+  }
+}
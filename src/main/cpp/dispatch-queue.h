@@ -0,0 +1,153 @@
+/* dispatch-queue.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_DISPATCH_QUEUE_H
+#define SPARTAN_DISPATCH_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Work queue of dispatch messages - the mq messages that the launcher (or the supervisor) hands off
+ * to its dispatching thread.
+ *
+ * A bounded lock-free ring of multiple producers and a single consumer: producers claim a slot with
+ * a compare-and-swap and publish it via its sequence number, the consumer never takes a lock. The
+ * consumer parks on an eventfd; a producer only writes to the eventfd when the consumer is parked.
+ *
+ * What happens when the ring is full is the overflow policy:
+ *   BLOCK  - push() waits until the consumer has made room (producers can also poll is_full() and
+ *            await space_fd() becoming readable instead of blocking)
+ *   REJECT - push() returns false, the caller answers the message with an error
+ *   SPILL  - the message goes onto an unbounded overflow list (guarded by a mutex) and is dequeued
+ *            once the ring is drained
+ *
+ * The consumer moves messages from the ring into lanes - a lane per command - and dequeues them by
+ * deficit round-robin, each lane being served its weight of messages per round. The capacity bounds
+ * the messages of the ring and the lanes together, so the queue is full (and the overflow policy
+ * applies) at the configured capacity however the messages are split between the two. So a flood of one
+ * command's invocations doesn't starve the other commands. The control lane (lifecycle notifications
+ * in the supervisor) is served ahead of all the command lanes.
+ */
+namespace dispatch_queue {
+
+  enum class Overflow : short { BLOCK, REJECT, SPILL };
+
+  // lane name of control plane messages - served ahead of the lanes of commands
+  extern const char * const CONTROL_LANE;
+
+  // config.ini [ChildProcessSettings] DispatchQueueCapacity and DispatchQueueOverflow settings
+  void set_capacity(int capacity);
+  void set_overflow(const char *policy);
+  int capacity();
+  Overflow overflow();
+  const char* overflow_name(Overflow policy);
+  // config.ini [ChildProcessSettings] DispatchWeights setting - e.g., genetl:4,lookup:2 (default weight is 1)
+  void set_weights(const char *weights);
+  int weight_of(const std::string &lane_name);
+
+  class DispatchQueue {
+  public:
+    // yields the name of the lane that a message is scheduled in
+    using lane_of_t = std::function<std::string(const std::string &msg)>;
+  private:
+    static const int wait_buckets = 6; // <100us, <1ms, <10ms, <100ms, <1s, >=1s
+    struct cell_t {
+      std::atomic<size_t> seq;
+      uint64_t enqueue_ns;
+      std::string msg;
+    };
+    struct lane_t {
+      std::string name;
+      int weight;
+      int deficit = 0;
+      bool is_active = false; // is in the round-robin rotation
+      std::deque<std::pair<uint64_t, std::string>> msgs;
+      uint64_t max_depth = 0;
+      uint64_t dequeued = 0;
+      uint64_t wait_histogram[wait_buckets] = {};
+      lane_t(std::string name, int weight) : name(std::move(name)), weight(weight) {}
+    };
+    const Overflow policy;
+    const size_t capacity_; // bounds the messages in the ring and the lanes together
+    const size_t mask;
+    std::unique_ptr<cell_t[]> cells;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0}; // only the consumer advances it
+    std::atomic_bool is_consumer_parked{false};
+    std::atomic_int space_waiters{0};
+    int wakeup_fd;  // consumer parks on it
+    int space_fd_;  // semaphore eventfd - a token per slot freed while producers await space
+    std::mutex spill_mtx;
+    std::deque<std::pair<uint64_t, std::string>> spill;
+    std::atomic<size_t> spill_count{0};
+    // lanes - consumer side, the mutex is for the benefit of stats_str()
+    const lane_of_t lane_of;
+    mutable std::mutex lanes_mtx;
+    std::unordered_map<std::string, std::unique_ptr<lane_t>> lanes;
+    lane_t *control_lane;
+    std::deque<lane_t*> active_lanes;
+    std::atomic<size_t> lanes_count{0}; // counted from before a message's ring slot is freed
+    // counters
+    std::atomic<uint64_t> pushed{0}, rejected{0}, spilled{0}, blocked{0}, blocked_ns{0}, max_depth{0};
+    std::atomic<uint64_t> popped{0}, parked{0}, parked_ns{0}, queued_ns{0}, max_queued_ns{0};
+  private:
+    bool try_push(std::string &msg, uint64_t enqueue_ns);
+    bool is_at_capacity(size_t pos) const;
+    bool try_pop_intake(std::string &msg, uint64_t &enqueue_ns);
+    void enqueue_lane(std::string &&msg, uint64_t enqueue_ns);
+    bool is_ready() const;
+    void wake_consumer();
+    void note_depth();
+    void note_dequeued(uint64_t enqueue_ns);
+  public:
+    DispatchQueue(size_t capacity, Overflow policy, lane_of_t lane_of = nullptr);
+    DispatchQueue(const DispatchQueue &) = delete;
+    DispatchQueue& operator=(const DispatchQueue &) = delete;
+    ~DispatchQueue();
+
+    // producers - false only for the REJECT policy when the ring is full
+    bool push(std::string &&msg);
+    bool is_full() const;
+    // a producer registers to await space - returns false if there is room already (nothing to await);
+    // space_fd() then becomes readable once the consumer makes room (read a token and call end_await_space())
+    bool begin_await_space();
+    void end_await_space();
+    int space_fd() const { return space_fd_; }
+
+    // consumer - the next message per the lanes' deficit round-robin
+    bool try_pop(std::string &msg);
+    // parks the consumer until a push() or notify() - or until timeout_ms elapses; when is_awaiting_msg
+    // it returns right away if a message is already there to pop (one pushed since try_pop() came up empty)
+    void park(int timeout_ms, bool is_awaiting_msg);
+    // wakes the consumer, e.g., when the child process count has headroom again
+    void notify();
+
+    size_t depth() const;
+    // the counters (and those of each lane) as a log friendly string
+    std::string stats_str() const;
+  };
+}
+
+#endif //SPARTAN_DISPATCH_QUEUE_H
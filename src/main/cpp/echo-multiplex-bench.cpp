@@ -0,0 +1,125 @@
+/* echo-multiplex-bench.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Benchmark of the client stream echo multiplexer with a chatty child command - a forked producer process
+// writes the given number of short lines, one write(2) each, alternately to its stdout and stderr pipes,
+// pausing briefly (1 us nanosleep) every pace lines - as a child that logs as it goes does (0 is flat out).
+// This process echoes both pipes (to /dev/null) with each multi_read_on_ready() implementation in turn:
+//
+//   poll   poll(2), and a std::async task per ready fd per poll round
+//   epoll  epoll with persistent edge-triggered registrations, the reads done inline on this thread
+//
+// and reports the wall time and the CPU time (user + system, of all threads of this process) taken.
+//
+// usage: echo-multiplex-bench [lines [pace [poll|epoll]]]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "log.h"
+#include "read-multi-strm.h"
+#include "read-on-ready.h"
+
+using namespace read_on_ready;
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static long long cpu_ns() {
+  rusage ru{};
+  getrusage(RUSAGE_SELF, &ru);
+  return (static_cast<long long>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+          ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000LL;
+}
+
+static const char LINE[] = "2018-12-31T23:59:59.999 INFO  spartan_test.ChildWorker - processed record batch 42\n";
+
+static void run(const std::string &mode, const int lines, const int pace) {
+  int out_pipe[2], err_pipe[2];
+  if (pipe(out_pipe) == -1 || pipe(err_pipe) == -1) {
+    perror("pipe");
+    exit(EXIT_FAILURE);
+  }
+  const pid_t producer_pid = fork();
+  if (producer_pid == 0) {
+    close(out_pipe[0]);
+    close(err_pipe[0]);
+    for (int i = 0; i < lines; i++) {
+      if (write((i % 2) == 0 ? out_pipe[1] : err_pipe[1], LINE, sizeof(LINE) - 1) <= 0) _exit(EXIT_FAILURE);
+      if (pace > 0 && (i % pace) == pace - 1) {
+        timespec pause{0, 1000};
+        nanosleep(&pause, nullptr);
+      }
+    }
+    _exit(EXIT_SUCCESS);
+  }
+  close(out_pipe[1]);
+  close(err_pipe[1]);
+
+  FILE *const dev_null = fopen("/dev/null", "w");
+  read_multi_stream rms;
+  rms += out_pipe[0];
+  rms += err_pipe[0];
+  output_streams_context_map_t output_streams_map;
+  auto out_ctx = std::make_shared<output_stream_context_t>(dev_null);
+  auto err_ctx = std::make_shared<output_stream_context_t>(dev_null);
+  output_streams_map.insert(std::make_pair(out_pipe[0], out_ctx));
+  output_streams_map.insert(std::make_pair(err_pipe[0], err_ctx));
+
+  bool is_ctrl_z_registered = false;
+  const auto start_ns = now_ns();
+  const auto start_cpu_ns = cpu_ns();
+  if (mode == "poll") {
+    multi_read_on_ready_poll(is_ctrl_z_registered, rms, output_streams_map);
+  } else {
+    multi_read_on_ready_epoll(is_ctrl_z_registered, rms, output_streams_map);
+  }
+  const auto elapsed_ns = now_ns() - start_ns;
+  const auto elapsed_cpu_ns = cpu_ns() - start_cpu_ns;
+  int status = 0;
+  waitpid(producer_pid, &status, 0);
+  close(out_pipe[0]);
+  close(err_pipe[0]);
+  fclose(dev_null);
+
+  const auto echoed = out_ctx->bytes_written + err_ctx->bytes_written;
+  printf("  %-6s %8.1f ms wall %8.1f ms cpu  %6.0f ns cpu/line  (%llu of %llu bytes)\n", mode.c_str(),
+         static_cast<double>(elapsed_ns) / 1e6, static_cast<double>(elapsed_cpu_ns) / 1e6,
+         static_cast<double>(elapsed_cpu_ns) / lines, echoed,
+         static_cast<unsigned long long>(lines) * (sizeof(LINE) - 1));
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("echo-multiplex-bench");
+  const int lines = argc > 1 ? atoi(argv[1]) : 200000;
+  const int pace = argc > 2 ? atoi(argv[2]) : 4;
+  const std::string mode = argc > 3 ? argv[3] : "";
+
+  printf("%d lines of %lu bytes, alternately to stdout and stderr, pausing every %d lines:\n", lines,
+         sizeof(LINE) - 1, pace);
+  if (mode.empty() || mode == "poll") run("poll", lines, pace);
+  if (mode.empty() || mode == "epoll") run("epoll", lines, pace);
+  return EXIT_SUCCESS;
+}
@@ -39,8 +39,8 @@ using namespace read_on_ready;
  * The function supports the old-style, single-response stream (e.g., Spartan.invokeCommand() API)
  * and also the react-style multi-stream scenario (e.g., Spartan.invokeCommandEx() API).
  *
- * The response stream(s) are obtained via Unix datagram socket where anonymous pipe descriptor(s)
- * are marshaled per the socket from the other end-point process into the client-mode process.
+ * The response stream(s) are obtained via Unix seqpacket socket where anonymous pipe descriptor(s)
+ * are marshaled, in a single message, from the other end-point process into the client-mode process.
  *
  * Any error logging is done within the call context of this function so it only returns a code
  * indicating success or failure of outcome status.
@@ -49,11 +49,12 @@ using namespace read_on_ready;
  * but that is okay for this function is called only in Spartan client mode as the very last step
  * for processing response output to stdout, etc.
  *
- * @param uds_socket_name name of the Unix datagram socket where pipe file descriptors are obtained
+ * @param uds_socket_name name of the Unix seqpacket socket where pipe file descriptors are obtained
  *        (name is supplied for any error reporting purposes)
- * @param read_fd_sp the Unix datagram socket descriptor that is read to obtain file descriptors
+ * @param read_fd_sp the listening Unix seqpacket socket descriptor on which the other end-point connects
  * @param supervisor_pid this will be the process pid of the supervisor JVM instantiation
- * @return EXIT_SUCCESS or EXIT_FAILURE
+ * @return EXIT_SUCCESS or EXIT_FAILURE - or the status conveyed by the other end-point process (e.g.,
+ *         EXIT_REJECTED when the command was rejected)
  */
 int stdout_echo_response_stream(std::string const &uds_socket_name, fd_wrapper_sp_t &&read_fd_sp,
                                 const pid_t supervisor_pid)
@@ -78,6 +79,7 @@ int stdout_echo_response_stream(std::string const &uds_socket_name, fd_wrapper_s
   fd_wrapper_sp_t sp_rsp_fd{ std::move(std::get<1>(rslt)) };
   fd_wrapper_sp_t sp_err_fd{ std::move(std::get<2>(rslt)) };
   fd_wrapper_sp_t sp_wrt_fd{ std::move(std::get<3>(rslt)) };
+  const int rsp_status = std::get<4>(rslt); // not EXIT_SUCCESS when the command won't be carried out
 
   // if all three anonymous pipe file descriptors present then indicates is react-style
   const bool is_extended_invoke = sp_err_fd != nullptr && sp_wrt_fd != nullptr;
@@ -261,5 +263,5 @@ int stdout_echo_response_stream(std::string const &uds_socket_name, fd_wrapper_s
     log(LL::ERR, "stream connection unexpectedly interrupted: %s", msg.c_str());
   }
 
-  return rtn;
+  return rsp_status != EXIT_SUCCESS ? rsp_status : rtn;
 }
\ No newline at end of file
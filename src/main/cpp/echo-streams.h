@@ -30,8 +30,8 @@ limitations under the License.
  * The function supports the old-style, single-response stream (e.g., Spartan.invokeCommand() API)
  * and also the react-style multi-stream scenario (e.g., Spartan.invokeCommandEx() API).
  *
- * The response stream(s) are obtained via Unix datagram socket where anonymous pipe descriptor(s)
- * are marshaled per the socket from the other end-point process into the client-mode process.
+ * The response stream(s) are obtained via Unix seqpacket socket where anonymous pipe descriptor(s)
+ * are marshaled, in a single message, from the other end-point process into the client-mode process.
  *
  * Any error logging is done within the call context of this function so it only returns a code
  * indicating success or failure of outcome status.
@@ -40,9 +40,9 @@ limitations under the License.
  * but that is okay for this function is called only in Spartan client mode as the very last step
  * for processing response output to stdout, etc.
  *
- * @param uds_socket_name name of the Unix datagram socket where pipe file descriptors are obtained
+ * @param uds_socket_name name of the Unix seqpacket socket where pipe file descriptors are obtained
  *        (name is supplied for any error reporting purposes)
- * @param read_fd_sp the Unix datagram socket descriptor that is read to obtain file descriptors
+ * @param read_fd_sp the listening Unix seqpacket socket descriptor on which the other end-point connects
  * @param supervisor_pid this will be the process pid of the supervisor JVM instantiation
  * @return EXIT_SUCCESS or EXIT_FAILURE
  */
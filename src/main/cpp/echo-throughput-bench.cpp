@@ -0,0 +1,133 @@
+/* echo-throughput-bench.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Throughput benchmark of the client echo path - what `spartan childcmd | pv` measures, without the JVM.
+// A forked producer process stands in for the child command, writing the given GiB to its response pipe
+// in 1 MB writes; this process echoes the pipe to stdout as the spartan client does:
+//
+//   splice  multi_read_on_ready() - splice(2) when stdout is a pipe or a file
+//   copy    multi_read_on_ready() with the output context set to copy through its buffer
+//   legacy  the former loop - read(2)/write(2) through a PIPE_BUF stack buffer, fsync(2) after each write
+//
+// The GB/s is reported on stderr. pipe-size-kb grows the response pipe with F_SETPIPE_SZ (as the
+// PipeSizeKB setting does).
+//
+// usage: echo-throughput-bench [GiB [splice|copy|legacy [pipe-size-kb]]] | pv > /dev/null
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <climits>
+#include <array>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "log.h"
+#include "read-multi-strm.h"
+#include "read-on-ready.h"
+
+using namespace read_on_ready;
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static pid_t start_producer(const int wr_fd, const int rd_fd, const unsigned long long total) {
+  const pid_t pid = fork();
+  if (pid != 0) return pid;
+  close(rd_fd);
+  std::vector<char> buf(1024 * 1024, 'x');
+  for (size_t i = 0; i < buf.size(); i += 64) buf[i] = '\n';
+  unsigned long long written = 0;
+  while (written < total) {
+    const auto n = std::min(static_cast<unsigned long long>(buf.size()), total - written);
+    const auto nw = write(wr_fd, buf.data(), static_cast<size_t>(n));
+    if (nw <= 0) _exit(EXIT_FAILURE);
+    written += static_cast<unsigned long long>(nw);
+  }
+  _exit(EXIT_SUCCESS);
+}
+
+static unsigned long long legacy_echo(const int in_fd, const int out_fd) {
+  std::array<char, PIPE_BUF> iobuf_array{};
+  unsigned long long total = 0;
+  for (;;) {
+    const auto n = read(in_fd, iobuf_array.data(), iobuf_array.size());
+    if (n <= 0) break;
+    const auto nw = write(out_fd, iobuf_array.data(), static_cast<size_t>(n));
+    fsync(out_fd);
+    if (nw != n) break;
+    total += static_cast<unsigned long long>(n);
+  }
+  return total;
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("echo-throughput-bench");
+  const double gib = argc > 1 ? atof(argv[1]) : 4.0;
+  const std::string mode = argc > 2 ? argv[2] : "splice";
+  const int pipe_size_kb = argc > 3 ? atoi(argv[3]) : 0;
+  if (isatty(STDOUT_FILENO)) {
+    fprintf(stderr, "stdout is a terminal - pipe it, e.g.: %s %s %s | pv > /dev/null\n", argv[0], "4", mode.c_str());
+    return EXIT_FAILURE;
+  }
+  const auto total = static_cast<unsigned long long>(gib * 1024 * 1024 * 1024);
+
+  int pipe_fds[2];
+  if (pipe(pipe_fds) == -1) {
+    perror("pipe");
+    return EXIT_FAILURE;
+  }
+  if (pipe_size_kb > 0 && fcntl(pipe_fds[1], F_SETPIPE_SZ, pipe_size_kb * 1024) == -1) {
+    perror("fcntl(F_SETPIPE_SZ)");
+  }
+  const auto start_ns = now_ns();
+  const pid_t producer_pid = start_producer(pipe_fds[1], pipe_fds[0], total);
+  close(pipe_fds[1]);
+
+  unsigned long long echoed = 0;
+  if (mode == "legacy") {
+    echoed = legacy_echo(pipe_fds[0], STDOUT_FILENO);
+  } else {
+    read_multi_stream rms;
+    rms += pipe_fds[0];
+    output_streams_context_map_t output_streams_map;
+    auto output_ctx = std::make_shared<output_stream_context_t>(stdout);
+    if (mode == "copy") {
+      output_ctx->transfer = XFER::COPY;
+    }
+    output_streams_map.insert(std::make_pair(pipe_fds[0], output_ctx));
+    bool is_ctrl_z_registered = false;
+    multi_read_on_ready(is_ctrl_z_registered, rms, output_streams_map);
+    echoed = output_ctx->bytes_written;
+    fprintf(stderr, "transfer: %s\n", output_ctx->transfer == XFER::SPLICE ? "splice" : "copy");
+  }
+  const auto elapsed_ns = now_ns() - start_ns;
+  close(pipe_fds[0]);
+  int status = 0;
+  waitpid(producer_pid, &status, 0);
+
+  fprintf(stderr, "%s: %llu bytes in %.3f s - %.2f GB/s\n", mode.c_str(), echoed,
+          static_cast<double>(elapsed_ns) / 1e9, static_cast<double>(echoed) / static_cast<double>(elapsed_ns));
+  return echoed == total ? EXIT_SUCCESS : EXIT_FAILURE;
+}
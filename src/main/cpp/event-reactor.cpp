@@ -0,0 +1,187 @@
+/* event-reactor.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include "format2str.h"
+#include "log.h"
+#include "event-reactor.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace event_reactor {
+
+  static const int max_events = 16;
+
+  static uint64_t now_ns() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+  }
+
+  Reactor::Reactor() : epfd(epoll_create1(EPOLL_CLOEXEC)) {
+    if (epfd == -1) {
+      log(LL::ERR, "%s(): epoll_create1() failed: %s", __func__, strerror(errno));
+    }
+  }
+
+  Reactor::~Reactor() {
+    if (epfd != -1) {
+      close(epfd);
+    }
+  }
+
+  bool Reactor::add(int fd, uint32_t events, handler_t handler) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epfd == -1 || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+      log(LL::ERR, "%s(): could not add fd(%d) to epoll set: %s", __func__, fd, strerror(errno));
+      return false;
+    }
+    handlers[fd] = std::move(handler);
+    return true;
+  }
+
+  void Reactor::remove(int fd) {
+    if (handlers.erase(fd) > 0) {
+      epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+  }
+
+  bool Reactor::modify(int fd, uint32_t events) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+      log(LL::ERR, "%s(): could not modify fd(%d) of epoll set: %s", __func__, fd, strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  void Reactor::run(int idle_timeout_ms, const idle_handler_t &on_idle) {
+    epoll_event events[max_events];
+    for(;;) {
+      const int n = epoll_wait(epfd, events, max_events, idle_timeout_ms);
+      if (n <= 0) {
+        if (n == -1 && errno != EINTR) {
+          log(LL::ERR, "%s(): epoll_wait() failed: %s", __func__, strerror(errno));
+          return;
+        }
+        if (!on_idle()) return;
+        continue;
+      }
+      const auto start_ns = now_ns();
+      bool keep_running = true;
+      for (int i = 0; i < n; i++) {
+        auto const it = handlers.find(events[i].data.fd);
+        if (it == handlers.end()) continue; // removed by a handler called earlier in this iteration
+        const auto handler = it->second;
+        events_handled++;
+        if (!handler(events[i].events)) {
+          keep_running = false;
+        }
+      }
+      const auto latency_ns = now_ns() - start_ns;
+      iterations++;
+      total_latency_ns += latency_ns;
+      if (latency_ns > max_latency_ns) {
+        max_latency_ns = latency_ns;
+      }
+      int bucket = 0;
+      for (uint64_t limit = 10000; bucket < latency_buckets - 1 && latency_ns >= limit; limit *= 10) {
+        bucket++;
+      }
+      latency_histogram[bucket]++;
+      if (!keep_running) return;
+    }
+  }
+
+  std::string Reactor::stats_str() const {
+    const auto avg_us = iterations > 0 ? static_cast<double>(total_latency_ns) / iterations / 1000.0 : 0.0;
+    return format2str("event loop iterations: %llu, events: %llu, latency avg: %.1f us, max: %.1f us, "
+                      "histogram [<10us: %llu, <100us: %llu, <1ms: %llu, <10ms: %llu, <100ms: %llu, >=100ms: %llu]",
+                      static_cast<unsigned long long>(iterations), static_cast<unsigned long long>(events_handled),
+                      avg_us, max_latency_ns / 1000.0,
+                      static_cast<unsigned long long>(latency_histogram[0]),
+                      static_cast<unsigned long long>(latency_histogram[1]),
+                      static_cast<unsigned long long>(latency_histogram[2]),
+                      static_cast<unsigned long long>(latency_histogram[3]),
+                      static_cast<unsigned long long>(latency_histogram[4]),
+                      static_cast<unsigned long long>(latency_histogram[5]));
+  }
+
+  static sigset_t s_orig_sigmask;
+  static volatile bool s_sigmask_saved = false;
+
+  static void restore_sigmask_in_child() {
+    if (s_sigmask_saved) {
+      pthread_sigmask(SIG_SETMASK, &s_orig_sigmask, nullptr);
+    }
+  }
+
+  int open_signalfd(std::initializer_list<int> sigs) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (const int sig : sigs) {
+      sigaddset(&mask, sig);
+    }
+    sigset_t orig_mask;
+    if (pthread_sigmask(SIG_BLOCK, &mask, &orig_mask) != 0) {
+      log(LL::ERR, "%s(): could not block signals: %s", __func__, strerror(errno));
+      return -1;
+    }
+    const int sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sfd == -1) {
+      log(LL::ERR, "%s(): signalfd() failed: %s", __func__, strerror(errno));
+      pthread_sigmask(SIG_SETMASK, &orig_mask, nullptr);
+      return -1;
+    }
+    static bool is_atfork_registered = false;
+    if (!is_atfork_registered) {
+      pthread_atfork(nullptr, nullptr, restore_sigmask_in_child);
+      is_atfork_registered = true;
+    }
+    s_orig_sigmask = orig_mask;
+    s_sigmask_saved = true;
+    return sfd;
+  }
+
+  void close_signalfd(int sfd) {
+    if (sfd == -1) return;
+    signalfd_siginfo si{};
+    while (read(sfd, &si, sizeof(si)) == static_cast<ssize_t>(sizeof(si))) {
+      log(LL::DEBUG, "%s(): discarding pending signal %d", __func__, si.ssi_signo);
+    }
+    close(sfd);
+    if (s_sigmask_saved) {
+      s_sigmask_saved = false;
+      pthread_sigmask(SIG_SETMASK, &s_orig_sigmask, nullptr);
+    }
+  }
+}
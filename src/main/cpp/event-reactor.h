@@ -0,0 +1,80 @@
+/* event-reactor.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_EVENT_REACTOR_H
+#define SPARTAN_EVENT_REACTOR_H
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Single threaded epoll reactor of the launcher and supervisor processes' event loop.
+ *
+ * File descriptors (an mq queue descriptor, a signalfd, ...) are registered along with a handler
+ * that is called as soon as the descriptor becomes ready. The reactor keeps latency counters of its
+ * loop iterations - the time taken from epoll_wait() returning to its ready events having been
+ * handled - so that the responsiveness of the event loop can be observed.
+ */
+namespace event_reactor {
+
+  class Reactor {
+  public:
+    // returns false to have run() return
+    using handler_t = std::function<bool(uint32_t events)>;
+    using idle_handler_t = std::function<bool()>;
+  private:
+    static const int latency_buckets = 6; // <10us, <100us, <1ms, <10ms, <100ms, >=100ms
+    int epfd;
+    std::unordered_map<int, handler_t> handlers;
+    uint64_t iterations = 0;
+    uint64_t events_handled = 0;
+    uint64_t total_latency_ns = 0;
+    uint64_t max_latency_ns = 0;
+    uint64_t latency_histogram[latency_buckets] = {};
+  public:
+    Reactor();
+    Reactor(const Reactor &) = delete;
+    Reactor& operator=(const Reactor &) = delete;
+    ~Reactor();
+
+    bool add(int fd, uint32_t events, handler_t handler);
+    void remove(int fd);
+    // changes the events that a registered fd is waited on for (0 suspends it)
+    bool modify(int fd, uint32_t events);
+
+    // Waits on and dispatches ready events until a handler returns false. The on_idle handler is called
+    // when idle_timeout_ms elapses without any event, and when epoll_wait() is interrupted by a signal;
+    // it likewise returns false to have run() return.
+    void run(int idle_timeout_ms, const idle_handler_t &on_idle);
+
+    // the latency counters as a log friendly string
+    std::string stats_str() const;
+  };
+
+  // Blocks the signals in the calling thread (and so in threads it subsequently creates) and returns a
+  // signalfd for them (or -1 on failure). Child processes forked thereafter have the original signal
+  // mask restored in them, so a child's JVM sees the signals as usual.
+  int open_signalfd(std::initializer_list<int> sigs);
+  // Consumes any pending signals of the signalfd, closes it and restores the original signal mask.
+  void close_signalfd(int sfd);
+}
+
+#endif //SPARTAN_EVENT_REACTOR_H
@@ -0,0 +1,256 @@
+/* flow-reactor-bench.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Benchmark of draining the output of a fan-out to many child processes, as spartan.fstreams.Flow does - forked
+// producer processes stand in for the child commands, each writing its share of the data to its stdout pipe
+// (in 8 KB writes, as a child's PrintStream does) and a few lines to its stderr pipe. Both pipes of every child
+// are drained with:
+//
+//   threads  a thread per stream blocked in read(2) into a 64 KB buffer - Flow's thread pool
+//   reactor  the flow reactor - a few threads each polling the epoll set into a batch of the sizes that
+//            FlowReactor uses (BATCH_BUFFER_SIZE, BATCH_MAX_READY)
+//
+// The children are all started before any of them writes, and the peak thread count and memory (VmRSS, VmSize)
+// of this process, the wall time, the throughput and the CPU time of this process are reported. The JVM adds
+// its own per thread overhead (a 1 MB stack reservation and its thread structures) to the thread per stream
+// figures. Each run is done in a process of its own.
+//
+// usage: flow-reactor-bench [children [MiB [threads|reactor [reactor-threads]]]]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "log.h"
+#include "flow-reactor.h"
+
+using namespace flow_reactor;
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static long long cpu_ns() {
+  rusage ru{};
+  getrusage(RUSAGE_SELF, &ru);
+  return (static_cast<long long>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+          ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000LL;
+}
+
+struct proc_status_t {
+  long threads;
+  long vm_rss_kb;
+  long vm_size_kb;
+};
+
+static proc_status_t proc_status() {
+  proc_status_t ps{0, 0, 0};
+  FILE * const f = fopen("/proc/self/status", "r");
+  if (f == nullptr) return ps;
+  char line[256];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    sscanf(line, "Threads: %ld", &ps.threads);
+    sscanf(line, "VmRSS: %ld", &ps.vm_rss_kb);
+    sscanf(line, "VmSize: %ld", &ps.vm_size_kb);
+  }
+  fclose(f);
+  return ps;
+}
+
+static const char ERR_LINE[] = "2018-12-31T23:59:59.999 WARN  spartan_test.ChildWorker - slow record batch 42\n";
+static const int ERR_LINES = 16;
+
+// forks a child that, once the go pipe reads end of file, writes bytes to its stdout pipe and ERR_LINES to its
+// stderr pipe; returns the read ends
+static pid_t start_child(const int go_pipe[2], const unsigned long long bytes, int &out_fd, int &err_fd) {
+  int out_pipe[2], err_pipe[2];
+  if (pipe2(out_pipe, O_CLOEXEC) == -1 || pipe2(err_pipe, O_CLOEXEC) == -1) {
+    perror("pipe2");
+    exit(EXIT_FAILURE);
+  }
+  const pid_t pid = fork();
+  if (pid == -1) {
+    perror("fork");
+    exit(EXIT_FAILURE);
+  }
+  if (pid == 0) {
+    close(out_pipe[0]);
+    close(err_pipe[0]);
+    char buf[8192];
+    close(go_pipe[1]);
+    if (read(go_pipe[0], buf, 1) != 0) _exit(EXIT_FAILURE);
+    memset(buf, 'x', sizeof(buf));
+    for (size_t i = 63; i < sizeof(buf); i += 64) buf[i] = '\n';
+    unsigned long long written = 0;
+    int err_lines = 0;
+    while (written < bytes) {
+      const auto n = std::min(static_cast<unsigned long long>(sizeof(buf)), bytes - written);
+      const auto nw = write(out_pipe[1], buf, static_cast<size_t>(n));
+      if (nw <= 0) _exit(EXIT_FAILURE);
+      written += static_cast<unsigned long long>(nw);
+      if (err_lines < ERR_LINES && (written / sizeof(buf)) % 16 == 0) {
+        if (write(err_pipe[1], ERR_LINE, sizeof(ERR_LINE) - 1) <= 0) _exit(EXIT_FAILURE);
+        err_lines++;
+      }
+    }
+    for (; err_lines < ERR_LINES; err_lines++) {
+      if (write(err_pipe[1], ERR_LINE, sizeof(ERR_LINE) - 1) <= 0) _exit(EXIT_FAILURE);
+    }
+    _exit(EXIT_SUCCESS);
+  }
+  close(out_pipe[1]);
+  close(err_pipe[1]);
+  out_fd = out_pipe[0];
+  err_fd = err_pipe[0];
+  return pid;
+}
+
+static void run(const int children, const unsigned long long total, const std::string &mode, const int rthreads) {
+  const auto per_child = total / static_cast<unsigned long long>(children);
+  const auto expected = (per_child + ERR_LINES * (sizeof(ERR_LINE) - 1)) * static_cast<unsigned long long>(children);
+  const auto base = proc_status();
+  std::atomic<unsigned long long> drained{0};
+  std::atomic<int> streams_ended{0};
+  const int streams = children * 2;
+  std::vector<pid_t> pids;
+  std::vector<int> fds;
+  std::vector<std::thread> threads;
+  reactor r;
+  // the children are all started and their streams all drained concurrently - as a fan-out does
+  int go_pipe[2];
+  if (pipe2(go_pipe, O_CLOEXEC) == -1) {
+    perror("pipe2");
+    exit(EXIT_FAILURE);
+  }
+
+  if (mode == "reactor") {
+    if (!r.is_valid()) exit(EXIT_FAILURE);
+    for (int t = 0; t < rthreads; t++) {
+      threads.emplace_back([&r, &drained, &streams_ended, streams]() {
+        std::vector<char> buf(BATCH_BUFFER_SIZE);
+        std::vector<ready_t> ready(static_cast<size_t>(BATCH_MAX_READY));
+        batch b(r, buf.data(), buf.size(), ready.data(), BATCH_MAX_READY);
+        int n;
+        while ((n = b.wait(1000)) >= 0) {
+          unsigned long long n_bytes = 0;
+          for (int i = 0; i < n; i++) {
+            if (ready[static_cast<size_t>(i)].length > 0) {
+              n_bytes += static_cast<unsigned long long>(ready[static_cast<size_t>(i)].length);
+            } else if (++streams_ended == streams) {
+              r.close();
+            }
+          }
+          drained += n_bytes;
+        }
+      });
+    }
+  }
+  for (int c = 0; c < children; c++) {
+    int out_fd, err_fd;
+    pids.push_back(start_child(go_pipe, per_child, out_fd, err_fd));
+    fds.push_back(out_fd);
+    fds.push_back(err_fd);
+    for (const int fd : { out_fd, err_fd }) {
+      if (mode == "reactor") {
+        const int rc = r.add(fd, static_cast<int32_t>(fds.size()));
+        if (rc != 0) {
+          fprintf(stderr, "reactor add of fd(%d) failed: %s\n", fd, strerror(rc));
+          exit(EXIT_FAILURE);
+        }
+      } else {
+        threads.emplace_back([fd, &drained, &streams_ended]() {
+          std::vector<char> buf(64 * 1024);
+          ssize_t n;
+          while ((n = read(fd, buf.data(), buf.size())) > 0) {
+            drained += static_cast<unsigned long long>(n);
+          }
+          ++streams_ended;
+        });
+      }
+    }
+  }
+  close(go_pipe[0]);
+  const auto start_ns = now_ns();
+  const auto start_cpu_ns = cpu_ns();
+  close(go_pipe[1]);
+  proc_status_t peak = proc_status();
+  while (streams_ended < streams) {
+    const auto ps = proc_status();
+    peak.threads = std::max(peak.threads, ps.threads);
+    peak.vm_rss_kb = std::max(peak.vm_rss_kb, ps.vm_rss_kb);
+    peak.vm_size_kb = std::max(peak.vm_size_kb, ps.vm_size_kb);
+    usleep(10000);
+  }
+  for (auto &t : threads) t.join();
+  const auto elapsed_ns = now_ns() - start_ns;
+  const auto elapsed_cpu_ns = cpu_ns() - start_cpu_ns;
+  for (const int fd : fds) close(fd);
+  for (const pid_t pid : pids) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+  }
+
+  printf("  %4d children %-8s %5ld threads  %8.1f MB rss  %9.1f MB virt  %7.1f ms  %7.2f GB/s  %7.1f ms cpu%s\n",
+         children, mode.c_str(), peak.threads, static_cast<double>(peak.vm_rss_kb - base.vm_rss_kb) / 1024,
+         static_cast<double>(peak.vm_size_kb - base.vm_size_kb) / 1024, static_cast<double>(elapsed_ns) / 1e6,
+         static_cast<double>(drained) / static_cast<double>(elapsed_ns), static_cast<double>(elapsed_cpu_ns) / 1e6,
+         drained == expected ? "" : "  (SHORT)");
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("flow-reactor-bench");
+  const int children = argc > 1 ? atoi(argv[1]) : 0;
+  const double mib = argc > 2 ? atof(argv[2]) : 1024.0;
+  const std::string mode = argc > 3 ? argv[3] : "";
+  const int rthreads = argc > 4 ? atoi(argv[4]) : 2;
+
+  // a child holds 2 pipe read ends open here
+  rlimit rl{};
+  getrlimit(RLIMIT_NOFILE, &rl);
+  rl.rlim_cur = rl.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &rl);
+
+  const auto total = static_cast<unsigned long long>(mib * 1024 * 1024);
+  printf("%.0f MiB over each fan-out, reactor of %d threads (memory as grown over the run):\n", mib, rthreads);
+  fflush(stdout);
+  const std::vector<int> fan_outs = children > 0 ? std::vector<int>{ children } : std::vector<int>{ 10, 100, 1000 };
+  for (const int n : fan_outs) {
+    for (const char *m : { "threads", "reactor" }) {
+      if (!mode.empty() && mode != m) continue;
+      const pid_t pid = fork();
+      if (pid == 0) {
+        run(n, total, m, rthreads);
+        _exit(EXIT_SUCCESS);
+      }
+      int status = 0;
+      waitpid(pid, &status, 0);
+    }
+  }
+  return EXIT_SUCCESS;
+}
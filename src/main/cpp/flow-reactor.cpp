@@ -0,0 +1,279 @@
+/* flow-reactor.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstdarg>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <jni.h>
+#include "format2str.h"
+#include "log.h"
+#include "jni-registry.h"
+#include "spartan_fstreams_FlowReactor.h"
+#include "flow-reactor.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace flow_reactor {
+
+  // the epoll data of the wake eventfd - tokens are positive
+  static const uint64_t wake_data = ~0ULL;
+
+  static inline uint64_t data_of(const int fd, const int32_t token) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(token)) << 32) | static_cast<uint32_t>(fd);
+  }
+  static inline int fd_of(const uint64_t data) { return static_cast<int>(static_cast<uint32_t>(data)); }
+  static inline int32_t token_of(const uint64_t data) { return static_cast<int32_t>(data >> 32); }
+
+  static inline epoll_event armed_event(const uint64_t data) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.u64 = data;
+    return ev;
+  }
+
+  reactor::reactor() : epfd(epoll_create1(EPOLL_CLOEXEC)), wake_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    if (epfd == -1 || wake_fd == -1) {
+      log(LL::ERR, "%s(): epoll_create1()/eventfd() failed: %s", __func__, strerror(errno));
+      return;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN; // level-triggered, and never read - once signaled it wakes every batch
+    ev.data.u64 = wake_data;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, wake_fd, &ev) == -1) {
+      log(LL::ERR, "%s(): could not add eventfd(%d) to epoll set: %s", __func__, wake_fd, strerror(errno));
+      ::close(wake_fd);
+      wake_fd = -1;
+    }
+  }
+
+  reactor::~reactor() {
+    if (epfd != -1) {
+      ::close(epfd);
+    }
+    if (wake_fd != -1) {
+      ::close(wake_fd);
+    }
+  }
+
+  int reactor::add(int fd, int32_t token) {
+    assert(token > 0);
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || ((flags & O_NONBLOCK) == 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)) {
+      return errno;
+    }
+    auto ev = armed_event(data_of(fd, token));
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1 ? errno : 0;
+  }
+
+  void reactor::close() {
+    is_closed = true;
+    const uint64_t one = 1;
+    if (wake_fd != -1 && write(wake_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+      log(LL::ERR, "%s(): write to eventfd(%d) failed: %s", __func__, wake_fd, strerror(errno));
+    }
+  }
+
+  batch::batch(reactor &r, char *buf, size_t buf_size, ready_t *ready, int max_ready)
+      : r(r), buf(buf), buf_size(buf_size), ready(ready), max_ready(max_ready), events(max_ready)
+  {
+    assert(max_ready > 0 && buf_size >= static_cast<size_t>(max_ready));
+    rearm_events.reserve(static_cast<size_t>(max_ready));
+  }
+
+  int batch::wait(int timeout_ms) {
+    for (auto &ev : rearm_events) {
+      // ENOENT/EBADF - the stream's owner closed the fd regardless of it still being registered
+      if (epoll_ctl(r.epfd, EPOLL_CTL_MOD, fd_of(ev.data.u64), &ev) == -1 && errno != ENOENT && errno != EBADF) {
+        log(LL::ERR, "%s(): could not re-arm fd(%d) of epoll set: %s", __func__, fd_of(ev.data.u64), strerror(errno));
+      }
+    }
+    rearm_events.clear();
+    if (r.is_closed) return -1;
+
+    int n;
+    do {
+      n = epoll_wait(r.epfd, events.data(), max_ready, timeout_ms);
+    } while (n == -1 && errno == EINTR);
+    if (n == -1) {
+      log(LL::ERR, "%s(): epoll_wait() failed: %s", __func__, strerror(errno));
+      return -1;
+    }
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.u64 == wake_data) return -1;
+    }
+    if (n == 0) return 0;
+
+    // each ready fd gets an equal share of the buffer, and is read once - one busy child doesn't hold up
+    // the delivery of the others' output
+    const size_t slice_size = buf_size / static_cast<size_t>(n);
+    int count = 0;
+    size_t offset = 0;
+    for (int i = 0; i < n; i++) {
+      const uint64_t data = events[i].data.u64;
+      const int fd = fd_of(data);
+      ssize_t rc;
+      do {
+        rc = read(fd, buf + offset, slice_size);
+      } while (rc == -1 && errno == EINTR);
+      if (rc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        rearm_events.push_back(armed_event(data)); // nothing to read after all - wait on it again
+        continue;
+      }
+      auto &rdy = ready[count++];
+      rdy.token = token_of(data);
+      rdy.offset = static_cast<int32_t>(offset);
+      if (rc > 0) {
+        rdy.length = static_cast<int32_t>(rc);
+        offset += slice_size;
+        rearm_events.push_back(armed_event(data));
+      } else {
+        // end of the stream, or failed - its owner closes the fd, after it's been taken out of the epoll set
+        rdy.length = rc == 0 ? 0 : -errno;
+        epoll_ctl(r.epfd, EPOLL_CTL_DEL, fd, nullptr);
+      }
+    }
+    return count;
+  }
+}
+
+using namespace flow_reactor;
+
+static const char * const io_excptn_cls = "java/io/IOException";
+static const char * const illegal_arg_excptn_cls = "java/lang/IllegalArgumentException";
+
+static void throw_java_exception(JNIEnv *env, const char *excptn_cls, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  const std::string rslt(vformat2str(fmt, ap));
+  va_end(ap);
+  jclass const ex_cls = env->FindClass(excptn_cls);
+  assert(ex_cls != nullptr);
+  if (ex_cls != nullptr) {
+    env->ThrowNew(ex_cls, rslt.c_str());
+    env->DeleteLocalRef(ex_cls);
+  }
+}
+
+/*
+ * Class:     spartan_fstreams_FlowReactor
+ * Method:    create
+ * Signature: ()J
+ */
+extern "C" JNIEXPORT jlong JNICALL Java_spartan_fstreams_FlowReactor_create
+    (JNIEnv *env, jclass /*cls*/) {
+  auto const r = new(std::nothrow) reactor();
+  if (r == nullptr || !r->is_valid()) {
+    const int errnum = r == nullptr ? ENOMEM : errno;
+    delete r;
+    throw_java_exception(env, io_excptn_cls, "creating the native flow reactor failed: %s", strerror(errnum));
+    return 0;
+  }
+  return reinterpret_cast<jlong>(r);
+}
+
+/*
+ * Class:     spartan_fstreams_FlowReactor
+ * Method:    register
+ * Signature: (JLjava/io/FileDescriptor;I)V
+ */
+extern "C" JNIEXPORT void JNICALL Java_spartan_fstreams_FlowReactor_register
+    (JNIEnv *env, jclass /*cls*/, jlong handle, jobject fdesc, jint token) {
+  assert(handle != 0 && fdesc != nullptr);
+  auto const fdesc_fd = jni_registry::find_field(env, "java/io/FileDescriptor", "fd", "I");
+  if (fdesc_fd == nullptr) return; // NoSuchFieldError pending
+  const int fd = env->GetIntField(fdesc, fdesc_fd);
+  const int rc = fd < 0 ? EBADF : reinterpret_cast<reactor*>(handle)->add(fd, token);
+  if (rc != 0) {
+    throw_java_exception(env, io_excptn_cls, "registering fd(%d) with the native flow reactor failed: %s",
+                         fd, strerror(rc));
+  }
+}
+
+/*
+ * Class:     spartan_fstreams_FlowReactor
+ * Method:    wakeup
+ * Signature: (J)V
+ */
+extern "C" JNIEXPORT void JNICALL Java_spartan_fstreams_FlowReactor_wakeup
+    (JNIEnv * /*env*/, jclass /*cls*/, jlong handle) {
+  assert(handle != 0);
+  reinterpret_cast<reactor*>(handle)->close();
+}
+
+/*
+ * Class:     spartan_fstreams_FlowReactor
+ * Method:    release
+ * Signature: (J)V
+ */
+extern "C" JNIEXPORT void JNICALL Java_spartan_fstreams_FlowReactor_release
+    (JNIEnv * /*env*/, jclass /*cls*/, jlong handle) {
+  delete reinterpret_cast<reactor*>(handle);
+}
+
+/*
+ * Class:     spartan_fstreams_FlowReactor
+ * Method:    newBatch
+ * Signature: (JLjava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)J
+ */
+extern "C" JNIEXPORT jlong JNICALL Java_spartan_fstreams_FlowReactor_newBatch
+    (JNIEnv *env, jclass /*cls*/, jlong handle, jobject buf, jobject ready) {
+  assert(handle != 0);
+  auto const buf_addr = static_cast<char*>(env->GetDirectBufferAddress(buf));
+  auto const ready_addr = static_cast<ready_t*>(env->GetDirectBufferAddress(ready));
+  const auto buf_size = env->GetDirectBufferCapacity(buf);
+  const auto max_ready = env->GetDirectBufferCapacity(ready) / static_cast<jlong>(sizeof(ready_t));
+  if (buf_addr == nullptr || ready_addr == nullptr || max_ready <= 0 || buf_size < max_ready) {
+    throw_java_exception(env, illegal_arg_excptn_cls, "flow reactor batch buffers must be direct ByteBuffers");
+    return 0;
+  }
+  auto const b = new(std::nothrow) batch(*reinterpret_cast<reactor*>(handle), buf_addr,
+                                         static_cast<size_t>(buf_size), ready_addr, static_cast<int>(max_ready));
+  if (b == nullptr) {
+    throw_java_exception(env, io_excptn_cls, "allocating a native flow reactor batch failed");
+    return 0;
+  }
+  return reinterpret_cast<jlong>(b);
+}
+
+/*
+ * Class:     spartan_fstreams_FlowReactor
+ * Method:    poll
+ * Signature: (JI)I
+ */
+extern "C" JNIEXPORT jint JNICALL Java_spartan_fstreams_FlowReactor_poll
+    (JNIEnv * /*env*/, jclass /*cls*/, jlong batch_handle, jint timeout_ms) {
+  assert(batch_handle != 0);
+  return reinterpret_cast<batch*>(batch_handle)->wait(timeout_ms);
+}
+
+/*
+ * Class:     spartan_fstreams_FlowReactor
+ * Method:    freeBatch
+ * Signature: (J)V
+ */
+extern "C" JNIEXPORT void JNICALL Java_spartan_fstreams_FlowReactor_freeBatch
+    (JNIEnv * /*env*/, jclass /*cls*/, jlong batch_handle) {
+  delete reinterpret_cast<batch*>(batch_handle);
+}
@@ -0,0 +1,96 @@
+/* flow-reactor.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_FLOW_REACTOR_H
+#define SPARTAN_FLOW_REACTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <sys/epoll.h>
+
+/**
+ * Native I/O engine of spartan.fstreams.FlowReactor - drains the stdout/stderr pipes of invoked child
+ * processes from a few threads, in place of a thread blocked in InputStream.read() per pipe.
+ *
+ * The pipe fds are registered (non-blocking, EPOLLONESHOT) with a reactor under the token that the Java
+ * side knows the stream by. Each reactor thread owns a batch - a (direct) buffer and a ready list - and
+ * calls wait(), which waits on the epoll set and reads each ready fd once into a slice of the buffer,
+ * filling in a ready_t per slice. An fd that a batch delivered is re-armed by that batch's next wait(),
+ * i.e., only after its data was consumed, so a stream's data is delivered in order and to one thread at
+ * a time.
+ */
+namespace flow_reactor {
+
+  // a batch's buffer and ready list sizes, as FlowReactor allocates them per reactor thread - a ready stream
+  // gets at least a 64 KB share of the buffer (the default pipe capacity)
+  static const size_t BATCH_BUFFER_SIZE = 1024 * 1024;
+  static const int BATCH_MAX_READY = 16;
+
+  // an entry of a batch's ready list - length is the count of bytes read into the buffer at offset, else
+  // 0 at the end of the stream, or -errno when reading it failed (the fd is no longer registered then)
+  struct ready_t {
+    int32_t token;
+    int32_t offset;
+    int32_t length;
+  };
+
+  class batch;
+
+  class reactor {
+    friend class batch;
+  private:
+    int epfd;
+    int wake_fd; // an eventfd - signaled by close() and left so, to wake every batch
+    std::atomic_bool is_closed{false};
+  public:
+    reactor();
+    reactor(const reactor &) = delete;
+    reactor& operator=(const reactor &) = delete;
+    ~reactor();
+
+    bool is_valid() const { return epfd != -1 && wake_fd != -1; }
+    // makes fd non-blocking and registers it under token; returns 0, else the errno of the failure
+    int add(int fd, int32_t token);
+    // has every batch's wait(), current and subsequent, return -1
+    void close();
+  };
+
+  class batch {
+  private:
+    reactor &r;
+    char * const buf;
+    const size_t buf_size;
+    ready_t * const ready;
+    const int max_ready;
+    std::vector<epoll_event> events;
+    std::vector<epoll_event> rearm_events; // the fds delivered by the previous wait()
+  public:
+    batch(reactor &r, char *buf, size_t buf_size, ready_t *ready, int max_ready);
+    batch(const batch &) = delete;
+    batch& operator=(const batch &) = delete;
+
+    // Re-arms the fds delivered by the previous call, then waits up to timeout_ms (-1 is indefinitely)
+    // for ready fds and reads each once, into an equal share of the buffer. Returns the count of ready
+    // list entries filled in (0 on timeout), or -1 once the reactor is closed.
+    int wait(int timeout_ms);
+  };
+}
+
+#endif //SPARTAN_FLOW_REACTOR_H
@@ -0,0 +1,204 @@
+/* heap-history.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+#include "format2str.h"
+#include "log.h"
+#include "path-concat.h"
+#include "heap-history.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+extern const char* progname();
+
+namespace heap_history {
+
+  static const size_t max_samples = 100; // per command history file
+  static const long min_heap_mb = 16;
+  static const long heap_mb_granularity = 8;
+
+  static bool s_enabled = false;
+  static bool s_adaptive = false;
+  static int s_headroom_pct = 25;
+  static int s_min_samples = 5;
+  static std::string s_dir;
+
+  // launcher process - the command of each dispatched child process that has not been reaped yet
+  static std::mutex s_mtx;
+  static std::unordered_map<pid_t, std::string> s_tracked;
+
+  void set_enabled(bool enabled) { s_enabled = enabled; }
+  void set_adaptive(bool adaptive) { s_adaptive = adaptive; }
+  void set_headroom_pct(int headroom_pct) { s_headroom_pct = std::max(headroom_pct, 0); }
+  void set_min_samples(int min_samples) { s_min_samples = std::max(min_samples, 1); }
+  void set_dir(const char *dir) { s_dir = dir != nullptr ? dir : ""; }
+  bool is_enabled() { return s_enabled || s_adaptive; }
+
+  static const std::string& history_dir() {
+    if (s_dir.empty()) {
+      const char * const homedir = getenv("HOME");
+      s_dir = homedir != nullptr && homedir[0] != '\0'
+              ? format2str("%s/.cache/spartan/%s/heap-history", homedir, progname())
+              : format2str("/tmp/spartan-%s-heap-history", progname());
+    }
+    return s_dir;
+  }
+
+  static bool make_dirs(const std::string &path) {
+    for (size_t pos = path.find(kPathSeparator, 1); ; pos = path.find(kPathSeparator, pos + 1)) {
+      const auto partial = path.substr(0, pos);
+      if (mkdir(partial.c_str(), 0755) == -1 && errno != EEXIST) {
+        log(LL::WARN, "%s(): could not create directory \"%s\":\n\t%s", __func__, partial.c_str(), strerror(errno));
+        return false;
+      }
+      if (pos == std::string::npos) return true;
+    }
+  }
+
+  // the history file of a command - its lower-case name with any characters unsuitable for a file name replaced
+  static std::string history_file(const std::string &cmd) {
+    std::string fname(cmd);
+    std::transform(fname.begin(), fname.end(), fname.begin(), [](unsigned char c) -> char {
+      return isalnum(c) || c == '-' || c == '_' || c == '.' ? static_cast<char>(tolower(c)) : '_';
+    });
+    return path_concat(history_dir().c_str(), (fname + ".hist").c_str());
+  }
+
+  static std::string gc_count_file(pid_t pid) {
+    return format2str("%s%cgc.%d", history_dir().c_str(), kPathSeparator, pid);
+  }
+
+  void track(pid_t pid, const std::string &cmd) {
+    if (!is_enabled()) return;
+    std::unique_lock<std::mutex> lk(s_mtx);
+    s_tracked[pid] = cmd;
+  }
+
+  void record(pid_t pid, int exit_status, const struct rusage &ru) {
+    if (!is_enabled()) return;
+    std::string cmd;
+    {
+      std::unique_lock<std::mutex> lk(s_mtx);
+      auto const it = s_tracked.find(pid);
+      if (it == s_tracked.end()) return; // not a dispatched child command (or reaped before it was tracked)
+      cmd = std::move(it->second);
+      s_tracked.erase(it);
+    }
+
+    long gc_count = -1; // unknown - the child process exited before reporting it
+    const auto gc_path = gc_count_file(pid);
+    {
+      std::ifstream in(gc_path);
+      in >> gc_count;
+    }
+    unlink(gc_path.c_str());
+
+    const auto hist_path = history_file(cmd);
+    std::deque<std::string> samples;
+    {
+      std::ifstream in(hist_path);
+      std::string line;
+      while (std::getline(in, line)) {
+        if (!line.empty()) {
+          samples.emplace_back(std::move(line));
+        }
+      }
+    }
+    // sample line: <epoch seconds> <peak RSS KB> <GC count> <exit status>
+    samples.emplace_back(format2str("%ld %ld %ld %d", static_cast<long>(time(nullptr)), ru.ru_maxrss,
+                                    gc_count, exit_status));
+    while (samples.size() > max_samples) {
+      samples.pop_front();
+    }
+    if (!make_dirs(history_dir())) return;
+    const auto tmp_path = format2str("%s.%d", hist_path.c_str(), getpid());
+    {
+      std::ofstream out(tmp_path, std::ios::trunc);
+      for (auto const &sample : samples) {
+        out << sample << '\n';
+      }
+      if (!out.good()) {
+        log(LL::WARN, "%s(): failed writing \"%s\"", __func__, tmp_path.c_str());
+        return;
+      }
+    }
+    // renamed into place so that a child process reading the history never sees a partial file
+    if (rename(tmp_path.c_str(), hist_path.c_str()) != 0) {
+      log(LL::WARN, "%s(): failed renaming \"%s\":\n\t%s", __func__, tmp_path.c_str(), strerror(errno));
+      unlink(tmp_path.c_str());
+      return;
+    }
+    log(LL::DEBUG, "%s(): command '%s' pid(%d): peak RSS %ld KB, GC count %ld, exit status %d",
+        __func__, cmd.c_str(), pid, ru.ru_maxrss, gc_count, exit_status);
+  }
+
+  void report_gc_count(long gc_count) {
+    if (!is_enabled() || gc_count < 0 || !make_dirs(history_dir())) return;
+    std::ofstream(gc_count_file(getpid()), std::ios::trunc) << gc_count << '\n';
+  }
+
+  static long round_up_mb(long mb) {
+    mb = std::max(mb, min_heap_mb);
+    return ((mb + heap_mb_granularity - 1) / heap_mb_granularity) * heap_mb_granularity;
+  }
+
+  std::string with_heap_optns(const std::string &cmd, const char *jvm_optns) {
+    std::string optns(jvm_optns != nullptr ? jvm_optns : "");
+    if (!s_adaptive) return optns;
+
+    std::vector<long> peaks_kb;
+    {
+      std::ifstream in(history_file(cmd));
+      std::string line;
+      while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        long epoch = 0, maxrss_kb = 0;
+        if (ss >> epoch >> maxrss_kb && maxrss_kb > 0) {
+          peaks_kb.push_back(maxrss_kb);
+        }
+      }
+    }
+    if (peaks_kb.size() < static_cast<size_t>(s_min_samples)) return optns; // not enough history yet
+
+    std::sort(peaks_kb.begin(), peaks_kb.end());
+    auto const percentile_mb = [&peaks_kb](unsigned pct) -> long {
+      const auto idx = std::max<size_t>((peaks_kb.size() * pct + 99) / 100, 1) - 1;
+      return (peaks_kb[idx] + 1023) / 1024;
+    };
+    const long xmx_mb = round_up_mb(percentile_mb(95) * (100 + s_headroom_pct) / 100);
+    const long xms_mb = std::min(round_up_mb(percentile_mb(50)), xmx_mb);
+    const auto heap_optns = format2str("-Xms%ldm -Xmx%ldm", xms_mb, xmx_mb);
+    log(LL::DEBUG, "%s(): command '%s' adaptive heap sizing from %lu samples: %s",
+        __func__, cmd.c_str(), peaks_kb.size(), heap_optns.c_str());
+    // earlier options win when JVM options are consolidated, so the jvm_optns (jvmArgs annotation) go first
+    return optns.empty() ? heap_optns : optns + ' ' + heap_optns;
+  }
+}
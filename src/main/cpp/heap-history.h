@@ -0,0 +1,66 @@
+/* heap-history.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_HEAP_HISTORY_H
+#define SPARTAN_HEAP_HISTORY_H
+
+#include <string>
+#include <unistd.h>
+#include <sys/resource.h>
+
+/**
+ * Per child command history of resource usage, and adaptive JVM heap sizing derived from it.
+ *
+ * The launcher process tracks the command of each child process it dispatches; when the child
+ * process is reaped its peak RSS (from the rusage of waitid), GC count (reported by the child
+ * process itself just before exiting) and exit status are appended to the command's history
+ * file. The history file retains the most recent samples only.
+ *
+ * In adaptive mode, a child process about to create its JVM derives -Xms/-Xmx options from its
+ * command's history - the p95 peak RSS plus a headroom percentage for -Xmx, the median peak RSS
+ * for -Xms. JVM options given via the @ChildWorkerCommand jvmArgs annotation attribute take
+ * precedence over the derived ones, which in turn take precedence over config.ini CommandLineArgs.
+ *
+ * The peak RSS is that of the whole child process - the Java heap plus the JVM's non-heap memory
+ * (metaspace, code cache, thread stacks, GC structures, native allocations) - not the heap usage
+ * itself. The derived -Xmx therefore errs on the large side, by about the non-heap footprint of
+ * the command, which doubles as part of its headroom.
+ */
+namespace heap_history {
+
+  // config.ini [ChildProcessSettings] HeapHistory, AdaptiveHeapSizing, AdaptiveHeapHeadroomPct,
+  // AdaptiveHeapMinSamples and HeapHistoryDir settings
+  void set_enabled(bool enabled);
+  void set_adaptive(bool adaptive);
+  void set_headroom_pct(int headroom_pct);
+  void set_min_samples(int min_samples);
+  void set_dir(const char *dir);
+  bool is_enabled();
+
+  // launcher process - associates a dispatched child process with its command
+  void track(pid_t pid, const std::string &cmd);
+  // launcher process - records the sample of a reaped child process (if it was tracked)
+  void record(pid_t pid, int exit_status, const struct rusage &ru);
+
+  // child process - reports its GC count to the launcher process (picked up upon being reaped)
+  void report_gc_count(long gc_count);
+  // child process - jvm_optns followed by the heap options derived for the command (in adaptive mode)
+  std::string with_heap_optns(const std::string &cmd, const char *jvm_optns);
+}
+
+#endif //SPARTAN_HEAP_HISTORY_H
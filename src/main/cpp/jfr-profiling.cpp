@@ -0,0 +1,208 @@
+/* jfr-profiling.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "format2str.h"
+#include "log.h"
+#include "path-concat.h"
+#include "str-split.h"
+#include "jfr-profiling.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+extern const char* progname();
+
+namespace jfr_profiling {
+
+  static int s_sample_rate_pct = 100;
+  static int s_max_concurrent = 1;
+  static int s_max_recordings = 10;
+  static std::string s_recordings_dir;
+  static std::string s_settings("profile");
+  static std::string s_extra_jvm_args;
+
+  // launcher process state - guarded by s_mtx
+  static std::mutex s_mtx;
+  static std::unordered_set<std::string> s_commands; // lower-case command names
+  static std::unordered_set<pid_t> s_profiled_pids;
+  static int s_active_count = 0;  // includes slots acquired but not yet started
+  static int s_sample_accum = 0;
+
+  static std::string to_lower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    return str;
+  }
+
+  void set_commands(const char *cmds) {
+    std::unique_lock<std::mutex> lk(s_mtx);
+    s_commands.clear();
+    for (auto &cmd : str_split(cmds != nullptr ? cmds : "", ',')) {
+      cmd.erase(std::remove(cmd.begin(), cmd.end(), ' '), cmd.end());
+      if (!cmd.empty()) {
+        s_commands.emplace(to_lower(std::move(cmd)));
+      }
+    }
+  }
+  void set_sample_rate_pct(int pct) { s_sample_rate_pct = std::min(std::max(pct, 0), 100); }
+  void set_max_concurrent(int max_concurrent) { s_max_concurrent = std::max(max_concurrent, 0); }
+  void set_max_recordings(int max_recordings) { s_max_recordings = std::max(max_recordings, 1); }
+  void set_recordings_dir(const char *dir) { s_recordings_dir = dir != nullptr ? dir : ""; }
+  void set_settings(const char *settings) { s_settings = settings != nullptr && settings[0] != '\0' ? settings : "profile"; }
+  void set_extra_jvm_args(const char *jvm_args) { s_extra_jvm_args = jvm_args != nullptr ? jvm_args : ""; }
+
+  static const std::string& recordings_dir() {
+    if (s_recordings_dir.empty()) {
+      const char * const homedir = getenv("HOME");
+      s_recordings_dir = homedir != nullptr && homedir[0] != '\0'
+                         ? format2str("%s/.cache/spartan/%s/jfr", homedir, progname())
+                         : format2str("/tmp/spartan-%s-jfr", progname());
+    }
+    return s_recordings_dir;
+  }
+
+  void apply_switch(const char *args) {
+    auto parts = str_split(args != nullptr ? args : "", ' ');
+    parts.erase(std::remove(parts.begin(), parts.end(), std::string()), parts.end());
+    std::unique_lock<std::mutex> lk(s_mtx);
+    if (!parts.empty()) {
+      auto cmd = to_lower(parts[0]);
+      const bool is_on = parts.size() < 2 || strcasecmp(parts[1].c_str(), "off") != 0;
+      if (is_on) {
+        s_commands.emplace(std::move(cmd));
+      } else {
+        s_commands.erase(cmd);
+      }
+      log(LL::INFO, "%s(): JFR profiling of command '%s' switched %s", __func__, parts[0].c_str(), is_on ? "on" : "off");
+    }
+    std::string cmds;
+    for (auto const &cmd : s_commands) {
+      cmds += cmds.empty() ? cmd : ", " + cmd;
+    }
+    log(LL::INFO, "%s(): JFR profiled commands: %s (%d of max %d profiling)", __func__,
+        cmds.empty() ? "<none>" : cmds.c_str(), s_active_count, s_max_concurrent);
+  }
+
+  bool acquire(const std::string &cmd) {
+    std::unique_lock<std::mutex> lk(s_mtx);
+    if (s_commands.empty() || s_commands.count(to_lower(cmd)) == 0) return false;
+    // evenly spaced sampling - every invocation at 100%, every other one at 50%, and so on
+    s_sample_accum += s_sample_rate_pct;
+    if (s_sample_accum < 100) return false;
+    s_sample_accum -= 100;
+    if (s_active_count >= s_max_concurrent) {
+      log(LL::DEBUG, "%s(): command '%s' not profiled - %d profiled child processes already running",
+          __func__, cmd.c_str(), s_active_count);
+      return false;
+    }
+    s_active_count++;
+    return true;
+  }
+
+  void started(pid_t pid) {
+    std::unique_lock<std::mutex> lk(s_mtx);
+    s_profiled_pids.insert(pid);
+  }
+
+  void cancel() {
+    std::unique_lock<std::mutex> lk(s_mtx);
+    s_active_count--;
+    assert(s_active_count >= 0);
+  }
+
+  bool reap(pid_t pid) {
+    std::unique_lock<std::mutex> lk(s_mtx);
+    if (s_profiled_pids.erase(pid) == 0) return false;
+    s_active_count--;
+    assert(s_active_count >= 0);
+    return true;
+  }
+
+  static bool make_dirs(const std::string &path) {
+    for (size_t pos = path.find(kPathSeparator, 1); ; pos = path.find(kPathSeparator, pos + 1)) {
+      const auto partial = path.substr(0, pos);
+      if (mkdir(partial.c_str(), 0755) == -1 && errno != EEXIST) {
+        log(LL::WARN, "%s(): could not create directory \"%s\":\n\t%s", __func__, partial.c_str(), strerror(errno));
+        return false;
+      }
+      if (pos == std::string::npos) return true;
+    }
+  }
+
+  // removes all but the most recent max_recordings recording directories of the command
+  static void rotate(const std::string &cmd_dir) {
+    using dir_ptr_t = std::unique_ptr<DIR, void(*)(DIR*)>;
+    auto const open_dir = [](const std::string &path) {
+      return dir_ptr_t(opendir(path.c_str()), [](DIR *p) { if (p != nullptr) closedir(p); });
+    };
+    std::vector<std::pair<time_t, std::string>> recordings;
+    {
+      auto const dir_sp = open_dir(cmd_dir);
+      if (!dir_sp) return;
+      while (auto const entry = readdir(dir_sp.get())) {
+        if (entry->d_name[0] == '.') continue;
+        auto path = path_concat(cmd_dir.c_str(), entry->d_name);
+        struct stat st{};
+        if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+          recordings.emplace_back(st.st_mtime, std::move(path));
+        }
+      }
+    }
+    if (recordings.size() <= static_cast<size_t>(s_max_recordings)) return;
+    std::sort(recordings.begin(), recordings.end());
+    recordings.resize(recordings.size() - static_cast<size_t>(s_max_recordings)); // the oldest ones
+    for (auto const &recording : recordings) {
+      auto const dir_sp = open_dir(recording.second);
+      if (dir_sp) {
+        while (auto const entry = readdir(dir_sp.get())) {
+          if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            unlink(path_concat(recording.second.c_str(), entry->d_name).c_str());
+          }
+        }
+      }
+      rmdir(recording.second.c_str());
+    }
+  }
+
+  std::string jvm_optns(const std::string &cmd) {
+    const auto cmd_dir = path_concat(recordings_dir().c_str(), to_lower(cmd).c_str());
+    const auto recording_dir = format2str("%s%c%d", cmd_dir.c_str(), kPathSeparator, getpid());
+    if (!make_dirs(recording_dir)) return std::string();
+    rotate(cmd_dir);
+    auto optns = format2str("-XX:StartFlightRecording=name=spartan-%s,settings=%s,dumponexit=true,"
+                            "filename=%s%crecording.jfr", cmd.c_str(), s_settings.c_str(),
+                            recording_dir.c_str(), kPathSeparator);
+    if (!s_extra_jvm_args.empty()) {
+      optns = s_extra_jvm_args + ' ' + optns; // e.g., -XX:+UnlockCommercialFeatures -XX:+FlightRecorder (Java 8)
+    }
+    log(LL::INFO, "%s(): pid(%d) command '%s' flight recording to:\n\t%s",
+        __func__, getpid(), cmd.c_str(), recording_dir.c_str());
+    return optns;
+  }
+}
@@ -0,0 +1,62 @@
+/* jfr-profiling.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_JFR_PROFILING_H
+#define SPARTAN_JFR_PROFILING_H
+
+#include <string>
+#include <unistd.h>
+
+/**
+ * Per child command Java Flight Recorder profiling.
+ *
+ * Commands are selected for profiling via the config.ini [JfrProfiling] section, or at runtime via
+ * the built-in command: spartan profile <command> [on|off]. The launcher process then samples
+ * invocations of a profiled command (SampleRatePct percent of them) and, provided fewer than
+ * MaxConcurrent profiled child processes are running, forks the invocation with JFR options
+ * injected into its JVM options. A recording is written to <RecordingsDir>/<command>/<pid>/
+ * and only the most recent MaxRecordings recording directories per command are kept.
+ */
+namespace jfr_profiling {
+
+  // config.ini [JfrProfiling] settings
+  void set_commands(const char *cmds);
+  void set_sample_rate_pct(int pct);
+  void set_max_concurrent(int max_concurrent);
+  void set_max_recordings(int max_recordings);
+  void set_recordings_dir(const char *dir);
+  void set_settings(const char *settings);
+  void set_extra_jvm_args(const char *jvm_args);
+
+  // launcher process - applies a runtime switch of the form: <command> [on|off]
+  void apply_switch(const char *args);
+
+  // launcher process - returns true if this invocation of the command is to be profiled, in which
+  // case a profiling slot has been taken that must be given to started() or else to cancel() - started() is
+  // to be called before the child process can be reaped, else reap() won't know it and the slot is never released
+  bool acquire(const std::string &cmd);
+  void started(pid_t pid);
+  void cancel();
+  // launcher process - returns true if the terminated child process had been profiled (releases its slot)
+  bool reap(pid_t pid);
+
+  // child process - the JVM options that start a flight recording for the command
+  std::string jvm_optns(const std::string &cmd);
+}
+
+#endif //SPARTAN_JFR_PROFILING_H
@@ -0,0 +1,158 @@
+/* jni-registry-bench.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Microbenchmark of the JNI lookups that an upcall makes before it can call its Java method - FindClass()
+// and Get[Static]MethodID()/GetFieldID() per call (as spartan did) vs. the jni registry. The lookups are those
+// of a child process command invocation: String (for the argv array), ClassLoader.getSystemClassLoader(),
+// Thread.currentThread() and setContextClassLoader(), the FileDescriptor ctor and fd field, and the
+// FileOutputStream and PrintStream ctors. Reports nanoseconds per upcall of each.
+//
+// usage: jni-registry-bench [iterations [path-of-libjvm.so]]
+//        (libjvm.so defaults to $JAVA_HOME/lib/server/libjvm.so, else $JAVA_HOME/jre/lib/amd64/server/libjvm.so)
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <dlfcn.h>
+#include <unistd.h>
+#include "log.h"
+#include "jni-registry.h"
+
+using jni_create_jvm_t = jint (JNICALL *)(JavaVM **, void **, void *);
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static std::string libjvm_path(int argc, char **argv) {
+  if (argc > 2) return argv[2];
+  const char * const java_home = getenv("JAVA_HOME");
+  if (java_home == nullptr) return "libjvm.so";
+  std::string path(java_home);
+  path += "/lib/server/libjvm.so";
+  if (access(path.c_str(), R_OK) == 0) return path;
+  return std::string(java_home) + "/jre/lib/amd64/server/libjvm.so";
+}
+
+// the lookups per upcall, as they were made before the registry
+static bool uncached_lookups(JNIEnv *env) {
+  bool ok = true;
+  auto const cls_of = [env, &ok](const char *name) -> jclass {
+    jclass const cls = env->FindClass(name);
+    ok = ok && cls != nullptr;
+    return cls;
+  };
+  jclass const string_cls = cls_of("java/lang/String");
+  jclass const class_loader_cls = cls_of("java/lang/ClassLoader");
+  jclass const thread_cls = cls_of("java/lang/Thread");
+  jclass const fdesc_cls = cls_of("java/io/FileDescriptor");
+  jclass const file_output_strm_cls = cls_of("java/io/FileOutputStream");
+  jclass const print_strm_cls = cls_of("java/io/PrintStream");
+  if (ok) {
+    ok = env->GetStaticMethodID(class_loader_cls, "getSystemClassLoader", "()Ljava/lang/ClassLoader;") != nullptr &&
+         env->GetStaticMethodID(thread_cls, "currentThread", "()Ljava/lang/Thread;") != nullptr &&
+         env->GetMethodID(thread_cls, "setContextClassLoader", "(Ljava/lang/ClassLoader;)V") != nullptr &&
+         env->GetMethodID(fdesc_cls, "<init>", "()V") != nullptr &&
+         env->GetFieldID(fdesc_cls, "fd", "I") != nullptr &&
+         env->GetMethodID(file_output_strm_cls, "<init>", "(Ljava/io/FileDescriptor;)V") != nullptr &&
+         env->GetMethodID(print_strm_cls, "<init>", "(Ljava/io/OutputStream;)V") != nullptr;
+  }
+  for (jclass const cls : { string_cls, class_loader_cls, thread_cls, fdesc_cls, file_output_strm_cls, print_strm_cls }) {
+    if (cls != nullptr) {
+      env->DeleteLocalRef(cls);
+    }
+  }
+  return ok;
+}
+
+// the same lookups by way of the registry
+static bool registry_lookups(JNIEnv *env) {
+  auto const jdk = jni_registry::jdk();
+  return jdk != nullptr && jdk->string_cls != nullptr && jdk->get_system_class_loader != nullptr &&
+         jdk->current_thread != nullptr && jdk->set_context_class_loader != nullptr && jdk->fdesc_ctor != nullptr &&
+         jdk->fdesc_fd != nullptr && jdk->file_output_strm_ctor != nullptr && jdk->print_strm_ctor != nullptr &&
+         env != nullptr;
+}
+
+// an application entry point - resolved on first use by name, then a hash lookup
+static bool registry_find_lookups(JNIEnv *env) {
+  return jni_registry::find_method(env, "java/lang/Thread", "currentThread", "()Ljava/lang/Thread;", true).mid != nullptr;
+}
+
+template<typename F>
+static bool run(const char *name, const int iterations, JNIEnv *env, F lookups) {
+  const auto start_ns = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    if (!lookups(env)) {
+      printf("%s: lookup failed\n", name);
+      return false;
+    }
+  }
+  const auto elapsed_ns = now_ns() - start_ns;
+  printf("%-20s %10.1f ns/upcall\n", name, static_cast<double>(elapsed_ns) / iterations);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("jni-registry-bench");
+  const int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+  const auto path = libjvm_path(argc, argv);
+
+  void * const libjvm = dlopen(path.c_str(), RTLD_NOW);
+  if (libjvm == nullptr) {
+    fprintf(stderr, "dlopen(\"%s\") failed: %s\n", path.c_str(), dlerror());
+    return EXIT_FAILURE;
+  }
+  auto const create_jvm = reinterpret_cast<jni_create_jvm_t>(dlsym(libjvm, "JNI_CreateJavaVM"));
+  if (create_jvm == nullptr) {
+    fprintf(stderr, "dlsym(\"JNI_CreateJavaVM\") failed: %s\n", dlerror());
+    return EXIT_FAILURE;
+  }
+  JavaVMOption options[1]{};
+  options[0].optionString = const_cast<char*>("-Xrs");
+  JavaVMInitArgs vm_args{};
+  vm_args.version = JNI_VERSION_1_8;
+  vm_args.nOptions = 1;
+  vm_args.options = options;
+  vm_args.ignoreUnrecognized = JNI_TRUE;
+  JavaVM *jvmp = nullptr;
+  JNIEnv *env = nullptr;
+  if (create_jvm(&jvmp, reinterpret_cast<void**>(&env), &vm_args) != JNI_OK) {
+    fprintf(stderr, "JNI_CreateJavaVM() failed\n");
+    return EXIT_FAILURE;
+  }
+
+  const auto init_start_ns = now_ns();
+  if (!jni_registry::init(jvmp, env)) {
+    fprintf(stderr, "jni_registry::init() failed\n");
+    return EXIT_FAILURE;
+  }
+  printf("registry populated in %.1f us; %d upcalls each\n", static_cast<double>(now_ns() - init_start_ns) / 1e3,
+         iterations);
+
+  const bool ok = run("uncached", iterations, env, uncached_lookups) &&
+                  run("registry", iterations, env, registry_lookups) &&
+                  run("registry find", iterations, env, registry_find_lookups);
+  printf("%s\n", jni_registry::stats_str().c_str());
+
+  jni_registry::invalidate(env);
+  jvmp->DestroyJavaVM();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,228 @@
+/* jni-registry.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <unistd.h>
+#include "format2str.h"
+#include "log.h"
+#include "jni-registry.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace jni_registry {
+
+  static std::mutex s_mtx;
+  static JavaVM *s_jvmp = nullptr; // the JVM that the held references belong to
+  static std::unordered_map<std::string, jclass> s_classes;
+  static std::unordered_map<std::string, method_t> s_methods;
+  static std::unordered_map<std::string, jfieldID> s_fields;
+  static jdk_t s_jdk{};
+  static std::atomic_bool s_is_jdk_valid{false};
+  static std::atomic<uint64_t> s_hits{0}, s_misses{0};
+
+  static std::string method_key(const char *class_name, const char *method_name, const char *signature,
+                                bool is_static)
+  {
+    std::string key(class_name);
+    key.append(1, is_static ? ':' : '.').append(method_name).append(signature);
+    return key;
+  }
+
+  jclass find_class(JNIEnv *env, const char *class_name) {
+    std::string key(class_name);
+    {
+      std::lock_guard<std::mutex> lk(s_mtx);
+      auto const it = s_classes.find(key);
+      if (it != s_classes.end()) {
+        s_hits++;
+        return it->second;
+      }
+    }
+    // resolved outside of the lock - FindClass() may run static initializers that upcall back into here
+    s_misses++;
+    jclass const local_cls = env->FindClass(class_name);
+    if (local_cls == nullptr) return nullptr;
+    auto const global_cls = static_cast<jclass>(env->NewGlobalRef(local_cls));
+    env->DeleteLocalRef(local_cls);
+    if (global_cls == nullptr) return nullptr;
+    std::lock_guard<std::mutex> lk(s_mtx);
+    auto const rslt = s_classes.emplace(std::move(key), global_cls);
+    if (!rslt.second) {
+      env->DeleteGlobalRef(global_cls); // another thread resolved it meanwhile
+    }
+    return rslt.first->second;
+  }
+
+  method_t find_method(JNIEnv *env, const char *class_name, const char *method_name, const char *signature,
+                       bool is_static)
+  {
+    auto key = method_key(class_name, method_name, signature, is_static);
+    {
+      std::lock_guard<std::mutex> lk(s_mtx);
+      auto const it = s_methods.find(key);
+      if (it != s_methods.end()) {
+        s_hits++;
+        return it->second;
+      }
+    }
+    jclass const cls = find_class(env, class_name);
+    if (cls == nullptr) return method_t{ nullptr, nullptr };
+    s_misses++;
+    jmethodID const mid = is_static ? env->GetStaticMethodID(cls, method_name, signature)
+                                    : env->GetMethodID(cls, method_name, signature);
+    if (mid == nullptr) return method_t{ cls, nullptr };
+    std::lock_guard<std::mutex> lk(s_mtx);
+    return s_methods.emplace(std::move(key), method_t{ cls, mid }).first->second;
+  }
+
+  jfieldID find_field(JNIEnv *env, const char *class_name, const char *field_name, const char *signature) {
+    auto key = method_key(class_name, field_name, signature, false);
+    {
+      std::lock_guard<std::mutex> lk(s_mtx);
+      auto const it = s_fields.find(key);
+      if (it != s_fields.end()) {
+        s_hits++;
+        return it->second;
+      }
+    }
+    jclass const cls = find_class(env, class_name);
+    if (cls == nullptr) return nullptr;
+    s_misses++;
+    jfieldID const fid = env->GetFieldID(cls, field_name, signature);
+    if (fid == nullptr) return nullptr;
+    std::lock_guard<std::mutex> lk(s_mtx);
+    return s_fields.emplace(std::move(key), fid).first->second;
+  }
+
+  bool init(JavaVM *jvmp, JNIEnv *env) {
+    {
+      std::lock_guard<std::mutex> lk(s_mtx);
+      if (s_jvmp != jvmp) {
+        // any references held are of a JVM that is no more (e.g., of the parent of a forked process)
+        s_is_jdk_valid = false;
+        s_classes.clear();
+        s_methods.clear();
+        s_fields.clear();
+        s_jvmp = jvmp;
+      }
+    }
+    const char *failed = nullptr;
+    auto const cls_of = [env, &failed](const char *class_name) -> jclass {
+      jclass const cls = failed == nullptr ? find_class(env, class_name) : nullptr;
+      if (cls == nullptr && failed == nullptr) {
+        failed = class_name;
+      }
+      return cls;
+    };
+    auto const mid_of = [env, &failed](const char *class_name, const char *method_name, const char *signature,
+                                       bool is_static) -> jmethodID {
+      jmethodID const mid = failed == nullptr ? find_method(env, class_name, method_name, signature, is_static).mid
+                                              : nullptr;
+      if (mid == nullptr && failed == nullptr) {
+        failed = method_name;
+      }
+      return mid;
+    };
+    static const char * const ctor_name = "<init>";
+    jdk_t jdk{};
+    jdk.string_cls = cls_of("java/lang/String");
+    jdk.class_loader_cls = cls_of("java/lang/ClassLoader");
+    jdk.get_system_class_loader = mid_of("java/lang/ClassLoader", "getSystemClassLoader",
+                                         "()Ljava/lang/ClassLoader;", true);
+    jdk.thread_cls = cls_of("java/lang/Thread");
+    jdk.current_thread = mid_of("java/lang/Thread", "currentThread", "()Ljava/lang/Thread;", true);
+    jdk.set_context_class_loader = mid_of("java/lang/Thread", "setContextClassLoader", "(Ljava/lang/ClassLoader;)V",
+                                          false);
+    jdk.fdesc_cls = cls_of("java/io/FileDescriptor");
+    jdk.fdesc_ctor = mid_of("java/io/FileDescriptor", ctor_name, "()V", false);
+    jdk.file_input_strm_cls = cls_of("java/io/FileInputStream");
+    jdk.file_input_strm_ctor = mid_of("java/io/FileInputStream", ctor_name, "(Ljava/io/FileDescriptor;)V", false);
+    jdk.file_output_strm_cls = cls_of("java/io/FileOutputStream");
+    jdk.file_output_strm_ctor = mid_of("java/io/FileOutputStream", ctor_name, "(Ljava/io/FileDescriptor;)V", false);
+    jdk.print_strm_cls = cls_of("java/io/PrintStream");
+    jdk.print_strm_ctor = mid_of("java/io/PrintStream", ctor_name, "(Ljava/io/OutputStream;)V", false);
+    jdk.runtime_cls = cls_of("java/lang/Runtime");
+    jdk.get_runtime = mid_of("java/lang/Runtime", "getRuntime", "()Ljava/lang/Runtime;", true);
+    jdk.total_memory = mid_of("java/lang/Runtime", "totalMemory", "()J", false);
+    jdk.free_memory = mid_of("java/lang/Runtime", "freeMemory", "()J", false);
+    if (failed == nullptr) {
+      jdk.fdesc_fd = find_field(env, "java/io/FileDescriptor", "fd", "I");
+      if (jdk.fdesc_fd == nullptr) {
+        failed = "FileDescriptor.fd";
+      }
+    }
+    if (failed == nullptr) {
+      // the system class loader is a singleton - it's set on a thread as its context class loader per upcall
+      jobject const clsLdr_obj = env->CallStaticObjectMethod(jdk.class_loader_cls, jdk.get_system_class_loader);
+      if (clsLdr_obj != nullptr) {
+        jdk.system_class_loader = env->NewGlobalRef(clsLdr_obj);
+        env->DeleteLocalRef(clsLdr_obj);
+      }
+      if (jdk.system_class_loader == nullptr) {
+        failed = "getSystemClassLoader";
+      }
+    }
+    if (failed != nullptr) {
+      if (env->ExceptionCheck() != JNI_FALSE) {
+        env->ExceptionClear();
+      }
+      log(LL::ERR, "%s(): failed resolving JNI class or member '%s'", __func__, failed);
+      return false;
+    }
+    s_jdk = jdk;
+    s_is_jdk_valid = true;
+    log(LL::DEBUG, "%s(): pid(%d) %s", __func__, getpid(), stats_str().c_str());
+    return true;
+  }
+
+  const jdk_t* jdk() {
+    return s_is_jdk_valid ? &s_jdk : nullptr;
+  }
+
+  void invalidate(JNIEnv *env) {
+    s_is_jdk_valid = false;
+    std::lock_guard<std::mutex> lk(s_mtx);
+    if (env != nullptr) {
+      if (s_jdk.system_class_loader != nullptr) {
+        env->DeleteGlobalRef(s_jdk.system_class_loader);
+      }
+      for (const auto &entry : s_classes) {
+        env->DeleteGlobalRef(entry.second);
+      }
+    }
+    s_jdk = jdk_t{};
+    s_classes.clear();
+    s_methods.clear();
+    s_fields.clear();
+    s_jvmp = nullptr;
+  }
+
+  std::string stats_str() {
+    std::lock_guard<std::mutex> lk(s_mtx);
+    return format2str("jni registry: %lu classes, %lu methods, %lu fields held; %llu lookups resolved by the registry, "
+                      "%llu via JNI", s_classes.size(), s_methods.size(), s_fields.size(),
+                      static_cast<unsigned long long>(s_hits.load()),
+                      static_cast<unsigned long long>(s_misses.load()));
+  }
+}
@@ -0,0 +1,89 @@
+/* jni-registry.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_JNI_REGISTRY_H
+#define SPARTAN_JNI_REGISTRY_H
+
+#include <string>
+#include <jni.h>
+
+/**
+ * Registry of the JNI classes, method IDs and field IDs that spartan calls upon, so that an upcall
+ * into Java doesn't repeat FindClass() and Get[Static]MethodID() lookups every time.
+ *
+ * The JDK classes and members of every upcall are resolved by init() right after the JVM is created
+ * (sessionState::create_jvm()) and are held as global references. Other classes and methods - the
+ * application's entry points and the seldom used ones - are resolved on first use and then kept
+ * likewise. invalidate() releases all of it before the JVM is destroyed (sessionState::cleanup_jvm()).
+ */
+namespace jni_registry {
+
+  // the JDK classes and members of spartan's upcalls
+  struct jdk_t {
+    jclass string_cls;
+    jclass class_loader_cls;
+    jmethodID get_system_class_loader;
+    jobject system_class_loader;
+    jclass thread_cls;
+    jmethodID current_thread;
+    jmethodID set_context_class_loader;
+    jclass fdesc_cls;
+    jmethodID fdesc_ctor;
+    jfieldID fdesc_fd;
+    jclass file_input_strm_cls;
+    jmethodID file_input_strm_ctor;
+    jclass file_output_strm_cls;
+    jmethodID file_output_strm_ctor;
+    jclass print_strm_cls;
+    jmethodID print_strm_ctor;
+    jclass runtime_cls;
+    jmethodID get_runtime;
+    jmethodID total_memory;
+    jmethodID free_memory;
+  };
+
+  struct method_t {
+    jclass cls;     // global reference
+    jmethodID mid;
+  };
+
+  // resolves the JDK classes and members; returns false (and logs why) if any could not be resolved, in
+  // which case upcalls fail as they would have for want of the class or member
+  bool init(JavaVM *jvmp, JNIEnv *env);
+  // the JDK classes and members, else nullptr when init() has not succeeded (or after invalidate())
+  const jdk_t* jdk();
+
+  // returns a global reference to the class, resolving it on first use; nullptr if not found (with the
+  // Java exception pending, as per FindClass())
+  jclass find_class(JNIEnv *env, const char *class_name);
+  // returns the class and method ID of the method, resolving them on first use; mid is nullptr if not
+  // found (with the Java exception pending) - cls is nullptr too if it's the class that wasn't found
+  method_t find_method(JNIEnv *env, const char *class_name, const char *method_name, const char *signature,
+                       bool is_static);
+
+  // returns the field ID of the instance field, resolving it on first use; nullptr if not found
+  jfieldID find_field(JNIEnv *env, const char *class_name, const char *field_name, const char *signature);
+
+  // releases the global references - the JVM is about to be destroyed
+  void invalidate(JNIEnv *env);
+
+  // the counters (classes and methods held, lookups resolved from the registry vs. JNI) as a log friendly string
+  std::string stats_str();
+}
+
+#endif //SPARTAN_JNI_REGISTRY_H
@@ -24,20 +24,26 @@ limitations under the License.
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <mqueue.h>
 #include <unistd.h>
 #include <pwd.h>
 #include <sys/syscall.h>
 #include <cxxabi.h>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include "session-state.h"
 #include "process-cmd-dispatch-info.h"
 #include "path-concat.h"
 #include "format2str.h"
 #include "fifo-pipe.h"
+#include "mq-queue.h"
+#include "send-mq-msg.h"
 #include "log.h"
 #include "so-export.h"
 #include "spartan_LaunchProgram.h"
 #include "launch-program.h"
+#include "jni-registry.h"
 
 //#undef NDEBUG // uncomment this line to enable asserts in use below
 #include <cassert>
@@ -48,8 +54,8 @@ DECL_EXCEPTION(find_program_path)
 DECL_EXCEPTION(create_uds_socket)
 DECL_EXCEPTION(bind_uds_socket_name)
 DECL_EXCEPTION(obtain_rsp_stream)
-DECL_EXCEPTION(fork)
-DECL_EXCEPTION(interrupted)
+DECL_EXCEPTION(post_invoke_msg)
+DECL_EXCEPTION(invoke_rejected)
 
 static volatile bool termination_flag = false;
 
@@ -91,8 +97,14 @@ namespace launch_program {
     addr_len = sizeof(sockaddr_un) - (sizeof(addr.sun_path) - uds_sock_name.size());
   }
 
+  std::string make_uds_socket_name(const char * const progname) {
+    static std::atomic_uint uds_seq{0};
+    const auto tid = static_cast<long>(syscall(SYS_gettid));
+    return format2str("/tmp/%s_JLauncher_UDS_%d_%ld_%u", progname, getpid(), tid, uds_seq++);
+  }
+
   fd_wrapper_sp_t create_uds_socket(std::function<std::string(int)> get_errmsg) {
-    auto fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    auto fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
     if (fd < 0) {
       throw create_uds_socket_exception{ get_errmsg(errno) };
     }
@@ -105,8 +117,13 @@ namespace launch_program {
       auto dup_path = strdupa(path);
       return std::string(basename(dup_path));
     }(progpath());
+    return bind_uds_socket_name(sub_cmd, progname.c_str());
+  }
 
-    auto uds_socket_name = make_fifo_pipe_name(progname.c_str(), "JLauncher_UDS");
+  std::tuple<fd_wrapper_sp_t, std::string> bind_uds_socket_name(const char* const sub_cmd,
+                                                                const char * const progname)
+  {
+    auto uds_socket_name = make_uds_socket_name(progname);
 
     auto socket_fd_sp = create_uds_socket([sub_cmd](int err_no) -> std::string {
       const char err_msg_fmt[] = "failed creating parent uds socket for i/o to spawned program subcommand %s: %s";
@@ -118,6 +135,9 @@ namespace launch_program {
     init_sockaddr(uds_socket_name.c_str(), server_address, address_length);
 
     auto rc = bind(socket_fd_sp->fd, (const sockaddr*) &server_address, address_length);
+    if (rc == 0) {
+      rc = listen(socket_fd_sp->fd, 1); // there's just the one responding process
+    }
     if (rc < 0) {
       const char err_msg_fmt[] = "failed binding parent uds socket for i/o to spawned program subcommand %s: %s";
       auto err_msg = format2str(err_msg_fmt, sub_cmd, strerror(errno));
@@ -127,91 +147,77 @@ namespace launch_program {
     return std::make_tuple(std::move(socket_fd_sp), std::move(uds_socket_name));
   }
 
-  std::tuple<pid_t, fd_wrapper_sp_t, fd_wrapper_sp_t, fd_wrapper_sp_t> obtain_response_stream(
+  std::tuple<pid_t, fd_wrapper_sp_t, fd_wrapper_sp_t, fd_wrapper_sp_t, int> obtain_response_stream(
       string_view const uds_socket_name, fd_wrapper_sp_t socket_read_fd_sp)
   {
     static const char* const func_name = __FUNCTION__;
 
-    sockaddr_un server_address{};
-    socklen_t address_length;
-    init_sockaddr(uds_socket_name.c_str(), server_address, address_length);
-
-    pid_buffer_t pid_buffer{};
-    memset(&pid_buffer, 0, sizeof(pid_buffer));
-
     int line_nbr = __LINE__ + 1;
-    auto bytes_received = recvfrom( socket_read_fd_sp->fd,
-                                    &pid_buffer,
-                                    sizeof(pid_buffer),
-                                    0,
-                                    (sockaddr *) &server_address,
-                                    &address_length);
-    if (bytes_received < 0) {
-      const char err_msg_fmt[] = "%d: %s() -> recvfrom(): failed reading pid and fd count from uds %s socket:\n\t%s";
+    int conn_fd;
+    while ((conn_fd = accept4(socket_read_fd_sp->fd, nullptr, nullptr, SOCK_CLOEXEC)) == -1 && errno == EINTR);
+    if (conn_fd == -1) {
+      const char err_msg_fmt[] = "%d: %s() -> accept(): failed accepting responder connection on uds %s socket:\n\t%s";
       auto err_msg = format2str(err_msg_fmt, line_nbr, func_name, uds_socket_name.c_str(), strerror(errno));
       throw obtain_rsp_stream_exception{ std::move(err_msg) };
     }
-    assert(bytes_received == (long) sizeof(pid_buffer));
-    assert(pid_buffer.pid > 0 && pid_buffer.fd_rtn_count > 0);
+    fd_wrapper_sp_t conn_fd_sp{ new fd_wrapper_t{ conn_fd }, &fd_cleanup_with_delete };
+    socket_read_fd_sp.reset(); // no other connection is expected
 
-    if (pid_buffer.fd_rtn_count != 1 && pid_buffer.fd_rtn_count != 3) {
-      const char err_msg_fmt[] = "%d: %s() -> expected exactly 1 or 3 pipe fd(s) count via uds %s socket - not %d";
-      auto err_msg = format2str(err_msg_fmt, line_nbr, func_name, uds_socket_name.c_str(), pid_buffer.fd_rtn_count);
-      throw obtain_rsp_stream_exception{ std::move(err_msg) };
-    }
-
-    init_sockaddr(uds_socket_name.c_str(), server_address, address_length);
+    pid_buffer_t pid_buffer{};
+    memset(&pid_buffer, 0, sizeof(pid_buffer));
+    iovec iov{ &pid_buffer, sizeof(pid_buffer) };
 
     msghdr client_recv_msg{};
     memset(&client_recv_msg, 0, sizeof(client_recv_msg));
-    client_recv_msg.msg_name = &server_address;
-    client_recv_msg.msg_namelen = address_length;
-
-    pipe_fds_buffer_t  cmsg_payload_of_1{};
-    pipes_fds_buffer_t cmsg_payload_of_3{};
-    if (pid_buffer.fd_rtn_count == 1) {
-      memset(&cmsg_payload_of_1, 0, sizeof(cmsg_payload_of_1));
-      client_recv_msg.msg_control = &cmsg_payload_of_1;
-      client_recv_msg.msg_controllen = sizeof(cmsg_payload_of_1); // necessary for CMSG_FIRSTHDR to return correct value
-    } else {
-      memset(&cmsg_payload_of_3, 0, sizeof(cmsg_payload_of_3));
-      client_recv_msg.msg_control = &cmsg_payload_of_3;
-      client_recv_msg.msg_controllen = sizeof(cmsg_payload_of_3); // necessary for CMSG_FIRSTHDR to return correct value
-    }
+    client_recv_msg.msg_iov = &iov;
+    client_recv_msg.msg_iovlen = 1;
 
-    auto rc = recvmsg(socket_read_fd_sp->fd, &client_recv_msg, 0); line_nbr = __LINE__;
-    if (rc < 0) {
-      const char err_msg_fmt[] = "%d: %s() -> recvmsg(): no read pipe fd returned from uds %s socket:\n\t%s";
+    // room for the most fds a response conveys (3) - the cmsg length tells how many there are
+    pipes_fds_buffer_t cmsg_payload{};
+    memset(&cmsg_payload, 0, sizeof(cmsg_payload));
+    client_recv_msg.msg_control = &cmsg_payload;
+    client_recv_msg.msg_controllen = sizeof(cmsg_payload); // necessary for CMSG_FIRSTHDR to return correct value
+
+    line_nbr = __LINE__ + 1;
+    ssize_t bytes_received;
+    while ((bytes_received = recvmsg(conn_fd_sp->fd, &client_recv_msg, MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR);
+    if (bytes_received < 0) {
+      const char err_msg_fmt[] = "%d: %s() -> recvmsg(): failed reading response from uds %s socket:\n\t%s";
       auto err_msg = format2str(err_msg_fmt, line_nbr, func_name, uds_socket_name.c_str(), strerror(errno));
       throw obtain_rsp_stream_exception{ std::move(err_msg) };
     }
 
     const cmsghdr* const cmsg = CMSG_FIRSTHDR(&client_recv_msg);
-    line_nbr = __LINE__ + 1;
-    if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS) {
-      const char *const err_msg_fmt = "%d: %s() -> recvmsg(): no pipe fd(s) returned from uds %s socket:\n\t%s";
-      auto err_msg = format2str(err_msg_fmt, line_nbr, func_name, uds_socket_name.c_str(), "invalid datagram message");
-      throw obtain_rsp_stream_exception{ std::move(err_msg) };
-    }
+    const auto fds_count = cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+                           ? static_cast<int>((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int)) : 0;
 
+    // the fds are owned from here on, so are closed should the response be rejected below
     fd_wrapper_sp_t sp_child_rdr_fd{ nullptr, &fd_cleanup_with_delete };
     fd_wrapper_sp_t sp_child_err_fd{ nullptr, &fd_cleanup_with_delete };
     fd_wrapper_sp_t sp_child_wrt_fd{ nullptr, &fd_cleanup_with_delete };
+    fd_wrapper_sp_t* const fd_sps[] = { &sp_child_rdr_fd, &sp_child_err_fd, &sp_child_wrt_fd };
+    for (int i = 0; i < fds_count && i < 3; i++) {
+      fd_sps[i]->reset(new fd_wrapper_t{ cmsg_payload.p.pipe_fds[i] });
+    }
 
-    if (pid_buffer.fd_rtn_count == 1) {
-      assert(cmsg_payload_of_1.p.pipe_fds[0] > 0);
-      sp_child_rdr_fd.reset(new fd_wrapper_t{cmsg_payload_of_1.p.pipe_fds[0]});
-    } else {
-      assert(cmsg_payload_of_3.p.pipe_fds[0] > 0);
-      sp_child_rdr_fd.reset(new fd_wrapper_t{cmsg_payload_of_3.p.pipe_fds[0]});
-      assert(cmsg_payload_of_3.p.pipe_fds[1] > 0);
-      sp_child_err_fd.reset(new fd_wrapper_t{cmsg_payload_of_3.p.pipe_fds[1]});
-      assert(cmsg_payload_of_3.p.pipe_fds[2] > 0);
-      sp_child_wrt_fd.reset(new fd_wrapper_t{cmsg_payload_of_3.p.pipe_fds[2]});
+    line_nbr = __LINE__ + 1;
+    if (bytes_received != (ssize_t) sizeof(pid_buffer) || (client_recv_msg.msg_flags & MSG_CTRUNC) != 0) {
+      const char err_msg_fmt[] = "%d: %s() -> recvmsg(): invalid response message (%ld bytes) from uds %s socket";
+      auto err_msg = format2str(err_msg_fmt, line_nbr, func_name, (long) bytes_received, uds_socket_name.c_str());
+      throw obtain_rsp_stream_exception{ std::move(err_msg) };
+    }
+    assert(pid_buffer.pid > 0);
+
+    line_nbr = __LINE__ + 1;
+    if ((pid_buffer.fd_rtn_count != 1 && pid_buffer.fd_rtn_count != 3) || fds_count != pid_buffer.fd_rtn_count) {
+      const char err_msg_fmt[] = "%d: %s() -> expected exactly 1 or 3 pipe fd(s) via uds %s socket - not %d (of %d)";
+      auto err_msg = format2str(err_msg_fmt, line_nbr, func_name, uds_socket_name.c_str(), fds_count,
+                                pid_buffer.fd_rtn_count);
+      throw obtain_rsp_stream_exception{ std::move(err_msg) };
     }
 
-    return std::make_tuple(pid_buffer.pid,
-                           std::move(sp_child_rdr_fd), std::move(sp_child_err_fd), std::move(sp_child_wrt_fd));
+    return std::make_tuple(pid_buffer.pid, std::move(sp_child_rdr_fd), std::move(sp_child_err_fd),
+                           std::move(sp_child_wrt_fd), pid_buffer.status);
   }
 } // namespace launch_program
 
@@ -257,76 +263,54 @@ static std::string find_program_path(const char * const prog, const char * const
   throw find_program_path_exception(format2str(err_msg_fmt, prog, path_var_name));
 }
 
-static std::tuple<pid_t, fd_wrapper_sp_t, std::string> fork2main(
-    int argc, char **argv, const char * const prog_path, bool const isExtended)
-{
-  auto const argc_dup = argc + 1; // bump up by one for added -pipe= option
-  auto const argv_dup = (char **) alloca((argc_dup + 1) * sizeof(argv[0])); // reserve nullptr entry at array end too
-  auto const argv_zero = strdupa(prog_path); // file path of program to be spawned
-  argv_dup[0] = argv_zero;
-  argv_dup[1] = nullptr; // command line option conveys pipe file descriptors to spawned program
-  for (int i = 2, j = 1; j < argc; i++, j++) {
-    argv_dup[i] = argv[j];
-  }
-  argv_dup[argc_dup] = nullptr; // sentinel entry at end of argv array (and argv array convention)
-
-  auto uds_socket_name = make_fifo_pipe_name(progpath(), "JLauncher_UDS");
-  auto const pipe_optn = format2str("-pipe=%s", uds_socket_name.c_str());
-  auto const argv_one = strdupa(pipe_optn.c_str()); // set -pipe=... as command line arg to spawned program
-  argv_dup[1] = argv_one;
-  auto const subcmd = argv_dup[2];
-
-  fd_wrapper_sp_t read_fd_sp = create_uds_socket([subcmd, &uds_socket_name](int err_no) -> std::string {
-    const char err_msg_fmt[] = "failed creating parent unix uds %s socket for i/o to spawned program subcommand %s: %s";
-    return format2str(err_msg_fmt, uds_socket_name.c_str(), subcmd, strerror(err_no));
-  });
-
-  sockaddr_un server_address{0};
-  socklen_t address_length;
-  init_sockaddr(uds_socket_name.c_str(), server_address, address_length);
-
-  if (bind(read_fd_sp->fd, (const sockaddr *) &server_address, address_length) < 0) {
-    const char err_msg_fmt[] = "failed binding parent unix uds %s socket for i/o to spawned program subcommand %s: %s";
-    throw bind_uds_socket_name_exception(
-        format2str(err_msg_fmt, uds_socket_name.c_str(), argv_dup[2], strerror(errno)));
-  }
-
-  pid_t pid = fork();
-  if (pid == -1) {
-    const char err_msg_fmt[] = "pid(%d): fork() operation of launcher child process failed: %s";
-    throw fork_exception(format2str(err_msg_fmt, getpid(), strerror(errno)));
-  }
-  if (pid == 0) {
-    // is child process
-    auto rtn = forkable_main_entry(argc_dup, argv_dup, isExtended); // execute spartan main() through direct call stack
-    exit(rtn);
+// is cmd a child processor command of the supervisor's command dispatch info; it's fixed for the lifetime
+// of the supervisor, so its session image is mapped from shm just once per process and looked up in place
+static bool is_child_processor_command(const std::string &cmd) {
+  static std::mutex mtx;
+  static std::unique_ptr<const cmd_dsp::SessionImage> sp_shm_image;
+  {
+    std::unique_lock<std::mutex> lk(mtx);
+    if (!sp_shm_image) {
+      sp_shm_image.reset(new cmd_dsp::SessionImage());
+    }
   }
+  return sp_shm_image->view().is_child_processor_command({cmd.c_str(), cmd.size()});
+}
 
-  return std::make_tuple(pid, std::move(read_fd_sp), std::move(uds_socket_name));
+// Binds a uds socket and posts the flattened argv, along with the uds socket name, to the launcher
+// mq queue - all on the calling thread (the calling JVM process is not forked). Is thread safe.
+static std::tuple<fd_wrapper_sp_t, std::string> post_invoke_msg(int argc, char **argv, bool const isExtended) {
+  auto const subcmd = argv[1];
+  auto rslt = bind_uds_socket_name(subcmd);
+
+  auto const progname = [](const char * const path) -> std::string {
+    auto dup_path = strdupa(path);
+    return std::string(basename(dup_path));
+  }(progpath());
+  static const std::string jlauncher_queue_name = get_jlauncher_mq_queue_name(progname.c_str());
+  const auto extended_invoke_cmd = format2str("%s=%s", send_mq_msg::EXTENDED_INVOKE_CMD.c_str(), isExtended ? "true" : "false");
+  const auto &uds_socket_name = std::get<1>(rslt);
+
+  const auto rc = send_mq_msg::send_flattened_argv_mq_msg(
+      argc, argv, {extended_invoke_cmd.c_str(), extended_invoke_cmd.size()},
+      {uds_socket_name.c_str(), uds_socket_name.size()},
+      {jlauncher_queue_name.c_str(), jlauncher_queue_name.size()},
+      [](int &, char *[]) {});
+  if (rc != EXIT_SUCCESS) {
+    const char err_msg_fmt[] = "failed posting invocation of program subcommand %s to mq queue %s";
+    throw post_invoke_msg_exception(format2str(err_msg_fmt, subcmd, jlauncher_queue_name.c_str()));
+  }
+
+  return rslt;
 }
 
 static std::tuple<pid_t, fd_wrapper_sp_t, fd_wrapper_sp_t, fd_wrapper_sp_t> launch_program_helper(
-    int argc, char **argv, std::string& prog_path, bool const isExtended)
+    int argc, char **argv, bool const isExtended)
 {
-  const char * const prog_name = strdupa(prog_path.c_str()); // starts out as just program name, so copy this to retain
-  if (strchr(prog_name, '/') == nullptr && strchr(prog_name, '\\') == nullptr) {
-    prog_path = find_program_path(prog_name, "PATH"); // determine fully qualified path to the program
-  } else {
-    // verify that the specified program path exist and is a file or symbolic link
-    struct stat statbuf{};
-    if (stat(prog_name, &statbuf) == -1 || !((statbuf.st_mode & S_IFMT) == S_IFREG ||
-                                             (statbuf.st_mode & S_IFMT) == S_IFLNK))
-    {
-      const char err_msg_fmt[] = "specified program path '%s' invalid: %s";
-      throw find_program_path_exception(format2str(err_msg_fmt, prog_name, strerror(errno)));
-    }
-  }
-
-  auto rslt = fork2main(argc, argv, prog_path.c_str(), isExtended);
-  pid_t const forked_child_pid = std::get<0>(rslt);
-  std::string uds_socket_name{ std::move(std::get<2>(rslt)) };
+  auto rslt = post_invoke_msg(argc, argv, isExtended);
+  std::string uds_socket_name{ std::move(std::get<1>(rslt)) };
 
-  auto rslt2 = obtain_response_stream(uds_socket_name.c_str(), std::move(std::get<1>(rslt)));
+  auto rslt2 = obtain_response_stream(uds_socket_name.c_str(), std::move(std::get<0>(rslt)));
   pid_t const child_pid = std::get<0>(rslt2);
   fd_wrapper_sp_t sp_child_rdr_fd{ std::move(std::get<1>(rslt2)) };
   fd_wrapper_sp_t sp_child_err_fd{ std::move(std::get<2>(rslt2)) };
@@ -341,21 +325,25 @@ static std::tuple<pid_t, fd_wrapper_sp_t, fd_wrapper_sp_t, fd_wrapper_sp_t> laun
     fcntl(sp_child_wrt_fd->fd, F_SETFL, flags & ~O_NONBLOCK);
   }
 
-  {
-    int status = 0;
-    do {
-      if (waitpid(forked_child_pid, &status, 0) == -1) {
-        const char err_msg_fmt[] = "failed waiting for forked launcher child process (pid:%d): %s";
-        throw fork_exception(format2str(err_msg_fmt, forked_child_pid, strerror(errno)));
-      }
-      if (WIFSIGNALED(status) || WIFSTOPPED(status)) {
-        const char err_msg_fmt[] = "interrupted waiting for forked launcher child process (pid:%d)";
-        throw interrupted_exception(format2str(err_msg_fmt, forked_child_pid));
-      }
-    } while (!WIFEXITED(status) && !WIFSIGNALED(status));
-
-    log(LL::DEBUG, "%s(): **** forked launcher child process (pid:%d) of child program subcommand %s completed ****\n",
-        __FUNCTION__, forked_child_pid, argv[1]);
+  // the command won't be carried out (e.g., admission control rejected it) - the responding process is the
+  // supervisor, so its pid is not handed back as that of a child process; the reason is on the error stream
+  // (or on the response stream of a non-extended invocation)
+  const int rsp_status = std::get<4>(rslt2);
+  if (rsp_status != EXIT_SUCCESS) {
+    const int reason_fd = isExtended ? sp_child_err_fd->fd : sp_child_rdr_fd->fd;
+    char reason[512];
+    size_t len = 0;
+    ssize_t n;
+    while (len < sizeof(reason) - 1 &&
+           ((n = read(reason_fd, reason + len, sizeof(reason) - 1 - len)) > 0 || (n == -1 && errno == EINTR)))
+    {
+      if (n > 0) len += static_cast<size_t>(n);
+    }
+    while (len > 0 && reason[len - 1] == '\n') len--;
+    reason[len] = '\0';
+    const char err_msg_fmt[] = "program subcommand %s not carried out (exit status %d): %s";
+    throw invoke_rejected_exception(format2str(err_msg_fmt, argv[1], rsp_status,
+                                               len > 0 ? reason : "no reason given"));
   }
 
   log(LL::DEBUG, "%s(): **** spawned child program subcommand %s pid: %d ****\n", __FUNCTION__, argv[1], child_pid);
@@ -487,18 +475,13 @@ static jobject JNICALL invoke_spartan_subcommand(
   fd_wrapper_sp_t sp_child_err_fd{ nullptr, &fd_cleanup_with_delete };
   fd_wrapper_sp_t sp_child_wrt_fd{ nullptr, &fd_cleanup_with_delete };
   try {
-    auto rslt = launch_program_helper(argc + 1, (char **) c_strs, prog_path, isExtended);
+    auto rslt = launch_program_helper(argc + 1, (char **) c_strs, isExtended);
     child_pid = std::get<0>(rslt);
     sp_child_rdr_fd = std::move(std::get<1>(rslt));
     if (isExtended) {
       sp_child_err_fd = std::move(std::get<2>(rslt));
       sp_child_wrt_fd = std::move(std::get<3>(rslt));
     }
-  } catch(const interrupted_exception& ex) {
-    jclass const ex_cls = env->FindClass("java/lang/InterruptedException");
-    assert(ex_cls != nullptr);
-    env->ThrowNew(ex_cls, ex.what());
-    return nullptr;
   } catch(const spartan_exception& ex) {
     throw_java_exception(env, invkcmd_excptn_cls, spawn_failed_errmsg1_fmt, prog_path.c_str(), ex.name(), ex.what());
     return nullptr;
@@ -511,22 +494,24 @@ static jobject JNICALL invoke_spartan_subcommand(
     return nullptr;
   }
 
+  // the classes, method IDs and field IDs are held by the registry after the first invocation
   auto const find_class = [env,&prog_path](const char *cls_name) -> jclass {
-    jclass const found_cls = env->FindClass(cls_name);
+    jclass const found_cls = jni_registry::find_class(env, cls_name);
     const char * const exception_cls = "java/lang/ClassNotFoundException";
     const char * const err_msg_fmt = spawn_failed_errmsg3_fmt;
     return check_result(env, exception_cls, found_cls, err_msg_fmt, prog_path.c_str(), cls_name) ? found_cls : nullptr;
   };
 
-  auto const get_method = [env,&prog_path](jclass m_cls, const char *method_name, const char *method_sig) -> jmethodID {
-    auto const methID = env->GetMethodID(m_cls, method_name, method_sig);
+  auto const get_method = [env,&prog_path](const char *cls_name, const char *method_name,
+                                           const char *method_sig) -> jmethodID {
+    auto const methID = jni_registry::find_method(env, cls_name, method_name, method_sig, false).mid;
     const char * const err_msg_fmt = spawn_failed_errmsg4_fmt;
     return check_result(env, invkcmd_excptn_cls, methID, err_msg_fmt, prog_path.c_str(), method_name) ? methID : nullptr;
   };
 
-  auto const get_fieldid = [env,&prog_path](jclass f_cls, const char *field_name, const char *field_sig,
+  auto const get_fieldid = [env,&prog_path](const char *cls_name, const char *field_name, const char *field_sig,
                                             const char *desc) -> jfieldID {
-    auto const field_fd = env->GetFieldID(f_cls, field_name, field_sig);
+    auto const field_fd = jni_registry::find_field(env, cls_name, field_name, field_sig);
     const char * const err_msg_fmt = spawn_failed_errmsg5_fmt;
     return check_result(env, invkcmd_excptn_cls, field_fd, err_msg_fmt, prog_path.c_str(), desc) ? field_fd : nullptr;
   };
@@ -558,7 +543,7 @@ static jobject JNICALL invoke_spartan_subcommand(
   auto const fdesc_cls = find_class("java/io/FileDescriptor");
   if (fdesc_cls == nullptr) return nullptr;
 
-  auto const fdesc_ctor = get_method(fdesc_cls, ctor_name, "()V");
+  auto const fdesc_ctor = get_method("java/io/FileDescriptor", ctor_name, "()V");
   if (fdesc_ctor == nullptr) return nullptr;
 
   auto const make_and_set_fdesc = [&check_new_obj, &get_fieldid, env, fdesc_cls, fdesc_ctor]
@@ -572,7 +557,7 @@ static jobject JNICALL invoke_spartan_subcommand(
     sp_jobj_wrpr.reset(&jobj_wrpr);
 
     // poke the "fd" field with the file descriptor
-    auto const field_id = get_fieldid(fdesc_cls, "fd", "I", "on file descriptor object");
+    auto const field_id = get_fieldid("java/io/FileDescriptor", "fd", "I", "on file descriptor object");
     if (field_id == nullptr) return false;
 
     env->SetIntField(fdesc, field_id, fd);
@@ -591,7 +576,7 @@ static jobject JNICALL invoke_spartan_subcommand(
   auto const file_input_strm_cls = find_class("java/io/FileInputStream");
   if (file_input_strm_cls == nullptr) return nullptr;
 
-  auto const file_input_strm_ctor = get_method(file_input_strm_cls, ctor_name, "(Ljava/io/FileDescriptor;)V");
+  auto const file_input_strm_ctor = get_method("java/io/FileInputStream", ctor_name, "(Ljava/io/FileDescriptor;)V");
   if (file_input_strm_ctor == nullptr) return nullptr;
 
   // construct a new java.io.FileInputStream
@@ -605,7 +590,7 @@ static jobject JNICALL invoke_spartan_subcommand(
     auto const invoke_rsp_cls = find_class("spartan/Spartan$InvokeResponse");
     if (invoke_rsp_cls == nullptr) return nullptr;
 
-    auto const invoke_rsp_ctor = get_method(invoke_rsp_cls, ctor_name, "(ILjava/io/InputStream;)V");
+    auto const invoke_rsp_ctor = get_method("spartan/Spartan$InvokeResponse", ctor_name, "(ILjava/io/InputStream;)V");
     if (invoke_rsp_ctor == nullptr) return nullptr;
 
     // construct a new Spartan.InvokeResponse and populate object with return results
@@ -620,7 +605,7 @@ static jobject JNICALL invoke_spartan_subcommand(
     auto const file_output_strm_cls = find_class("java/io/FileOutputStream");
     if (file_output_strm_cls == nullptr) return nullptr;
 
-    auto const file_output_strm_ctor = get_method(file_output_strm_cls, ctor_name, "(Ljava/io/FileDescriptor;)V");
+    auto const file_output_strm_ctor = get_method("java/io/FileOutputStream", ctor_name, "(Ljava/io/FileDescriptor;)V");
     if (file_output_strm_ctor == nullptr) return nullptr;
 
     // construct a new java.io.FileOutputStream
@@ -631,7 +616,7 @@ static jobject JNICALL invoke_spartan_subcommand(
     auto const invoke_rsp_cls = find_class("spartan/Spartan$InvokeResponseEx");
     if (invoke_rsp_cls == nullptr) return nullptr;
 
-    auto const invoke_rsp_ctor = get_method(invoke_rsp_cls, ctor_name,
+    auto const invoke_rsp_ctor = get_method("spartan/Spartan$InvokeResponseEx", ctor_name,
                                             "(ILjava/io/InputStream;Ljava/io/InputStream;Ljava/io/OutputStream;)V");
     if (invoke_rsp_ctor == nullptr) return nullptr;
 
@@ -673,13 +658,9 @@ static jobject launchProgram_core_invokeCommand(
       }
     };
     std::unique_ptr<jstr_t, decltype(defer_cleanup_jstr)> sp_cmd(&first_argv_str, defer_cleanup_jstr);
-    std::string cmd(sp_cmd->c_str);
-    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+    const std::string cmd(sp_cmd->c_str);
 
-    sessionState shm_session;
-    cmd_dsp::get_cmd_dispatch_info(shm_session);
-    const auto cmds_set(cmd_dsp::get_child_processor_commands(shm_session));
-    if (cmds_set.count(cmd) <= 0) {
+    if (!is_child_processor_command(cmd)) {
       throw_java_exception(env, invkcmd_excptn_cls, invoke_child_cmd_errmsg_fmt, sp_cmd->c_str);
       return nullptr;
     }
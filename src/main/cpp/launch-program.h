@@ -46,9 +46,16 @@ namespace launch_program {
   void fd_cleanup_no_delete(fd_wrapper_t *);
   void fd_cleanup_with_delete(fd_wrapper_t *);
 
+  // exit code of a client whose command was rejected (by admission control or a full dispatch queue) - is
+  // EX_TEMPFAIL of sysexits.h, i.e., a temporary condition that a later retry of the command may not run into
+  static const int EXIT_REJECTED = 75;
+
+  // The response to an invocation is a single message over a SOCK_SEQPACKET connection to the socket
+  // name the client bound: this is its payload, and the pipe fd(s) ride along as SCM_RIGHTS ancillary data
   struct pid_buffer_t {
     pid_t pid;
     int fd_rtn_count;
+    int status; // EXIT_SUCCESS, or the exit code of a command that won't be carried out (e.g., EXIT_REJECTED)
   };
 
   union pipe_fds_buffer_t {
@@ -68,9 +75,18 @@ namespace launch_program {
   };
 
   void init_sockaddr(string_view const uds_sock_name, sockaddr_un &addr, socklen_t &addr_len);
+  // a socket name (abstract namespace) unique to the calling thread's invocation - made of the pid, the
+  // thread id and a per process counter, so concurrent invocations from the threads of a process never collide
+  std::string make_uds_socket_name(const char * const progname);
+  // creates a SOCK_SEQPACKET unix domain socket
   fd_wrapper_sp_t create_uds_socket(std::function<std::string(int)> get_errmsg);
+  // binds and listens on a unique socket name - the responding process connects to it
   std::tuple<fd_wrapper_sp_t, std::string> bind_uds_socket_name(const char* const sub_cmd);
-  std::tuple<pid_t, fd_wrapper_sp_t, fd_wrapper_sp_t, fd_wrapper_sp_t> obtain_response_stream(
+  std::tuple<fd_wrapper_sp_t, std::string> bind_uds_socket_name(const char* const sub_cmd,
+                                                                const char * const progname);
+  // accepts the connection of the responding process and receives its one message - yields the responding
+  // process pid, the response stream fd(s) and the status conveyed along with them
+  std::tuple<pid_t, fd_wrapper_sp_t, fd_wrapper_sp_t, fd_wrapper_sp_t, int> obtain_response_stream(
       string_view const uds_socket_name, fd_wrapper_sp_t socket_read_fd_sp);
 }
 
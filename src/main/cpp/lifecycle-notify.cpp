@@ -0,0 +1,178 @@
+/* lifecycle-notify.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <algorithm>
+#include <sys/timerfd.h>
+#include "format2str.h"
+#include "log.h"
+#include "lifecycle-notify.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace lifecycle_notify {
+
+  const string_view BATCH_NOTIFY_CMD{ "--CHILD_PID_BATCH_NOTIFY" };
+  const string_view STARTED{ "S" };
+  const string_view EXITED{ "E" };
+
+  static int s_batch_window_ms = 5;
+
+  void set_batch_window_ms(int window_ms) { s_batch_window_ms = std::max(window_ms, 0); }
+  int batch_window_ms() { return s_batch_window_ms; }
+
+  // the size that an arg adds to an argv frame - its length prefix, its bytes and NUL terminator
+  static size_t frame_arg_size(size_t len) { return sizeof(uint32_t) + len + 1; }
+  static const size_t frame_hdr_size = 32;
+
+  bool decode_batch(const std::string &msg, argv_frame::frame_t &frame) {
+    if (!argv_frame::decode(msg, frame) || frame.args.empty() || frame.args[0] != BATCH_NOTIFY_CMD) return false;
+    if ((frame.args.size() - 1) % 3 != 0) return false;
+    for (size_t i = 1; i < frame.args.size(); i += 3) {
+      if (frame.args[i] != STARTED && frame.args[i] != EXITED) return false;
+    }
+    return true;
+  }
+
+  bool is_batch(const std::string &msg) {
+    argv_frame::frame_t frame;
+    return argv_frame::is_frame(msg) && decode_batch(msg, frame);
+  }
+
+  static int64_t now_sec() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec);
+  }
+
+  Batcher::Batcher(send_t send, size_t max_msg_size)
+      : send(std::move(send)), max_msg_size(max_msg_size),
+        tfd(s_batch_window_ms > 0 ? timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC) : -1),
+        msg_size(0)
+  {
+    if (s_batch_window_ms > 0 && tfd == -1) {
+      log(LL::ERR, "%s(): timerfd_create() failed: %s - notifications are not batched", __func__, strerror(errno));
+    }
+  }
+
+  Batcher::~Batcher() {
+    if (tfd != -1) {
+      close(tfd);
+    }
+  }
+
+  void Batcher::add(string_view const kind, const pid_t pid, const std::string &value) {
+    auto const pid_str = std::to_string(pid);
+    const size_t event_size = frame_arg_size(kind.size()) + frame_arg_size(pid_str.size()) + frame_arg_size(value.size());
+
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!args.empty() && msg_size + event_size > max_msg_size) {
+      flush_locked(); // the event would not fit in the pending batch
+    }
+    const bool is_first = args.empty();
+    if (is_first) {
+      args.emplace_back(BATCH_NOTIFY_CMD.c_str(), BATCH_NOTIFY_CMD.size());
+      msg_size = frame_hdr_size + frame_arg_size(BATCH_NOTIFY_CMD.size());
+    }
+    args.emplace_back(kind.c_str(), kind.size());
+    args.push_back(pid_str);
+    args.push_back(value);
+    msg_size += event_size;
+
+    events++;
+    const auto sec = now_sec();
+    if (sec != curr_sec) {
+      last_sec_events = sec == curr_sec + 1 ? curr_sec_events : 0;
+      curr_sec = sec;
+      curr_sec_events = 0;
+    }
+    peak_per_sec = std::max(peak_per_sec, ++curr_sec_events);
+
+    if (tfd == -1) {
+      flush_locked();
+    } else if (is_first) {
+      // one-shot timer - the batch is sent when its window elapses
+      itimerspec its{};
+      its.it_value.tv_sec = s_batch_window_ms / 1000;
+      its.it_value.tv_nsec = static_cast<long>(s_batch_window_ms % 1000) * 1000000L;
+      if (timerfd_settime(tfd, 0, &its, nullptr) == -1) {
+        log(LL::ERR, "%s(): timerfd_settime() failed: %s", __func__, strerror(errno));
+        flush_locked();
+      }
+    }
+  }
+
+  void Batcher::flush_locked() {
+    if (args.empty()) return;
+    std::vector<const char*> argv;
+    argv.reserve(args.size());
+    for (const auto &arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    const auto msg = argv_frame::encode(static_cast<int>(argv.size()), argv.data());
+    const uint64_t batch_events = (args.size() - 1) / 3;
+    args.clear();
+    msg_size = 0;
+    batches++;
+    batched_events += batch_events;
+    largest_batch = std::max(largest_batch, batch_events);
+    if (send({msg.data(), msg.size()}) != EXIT_SUCCESS) {
+      send_failures++;
+      log(LL::ERR, "%s(): failed sending batch of %llu child process notifications",
+          __func__, static_cast<unsigned long long>(batch_events));
+    }
+  }
+
+  void Batcher::on_timer() {
+    uint64_t expirations = 0;
+    if (read(tfd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+      log(LL::ERR, "%s(): timerfd read failed: %s", __func__, strerror(errno));
+    }
+    flush();
+  }
+
+  void Batcher::started(const pid_t pid, const std::string &cmd_line) {
+    add(STARTED, pid, cmd_line);
+  }
+
+  void Batcher::exited(const pid_t pid, const int exit_status) {
+    add(EXITED, pid, std::to_string(exit_status));
+  }
+
+  void Batcher::flush() {
+    std::lock_guard<std::mutex> lk(mtx);
+    flush_locked();
+  }
+
+  std::string Batcher::stats_str() {
+    std::lock_guard<std::mutex> lk(mtx);
+    const auto sec = now_sec();
+    const uint64_t per_sec = sec == curr_sec ? last_sec_events : (sec == curr_sec + 1 ? curr_sec_events : 0);
+    return format2str("child process notifications: %llu in %llu batches (avg %.1f, max %llu per batch), "
+                      "%llu/sec in the last second, peak %llu/sec, send failures: %llu",
+                      static_cast<unsigned long long>(events), static_cast<unsigned long long>(batches),
+                      batches > 0 ? static_cast<double>(batched_events) / batches : 0.0,
+                      static_cast<unsigned long long>(largest_batch), static_cast<unsigned long long>(per_sec),
+                      static_cast<unsigned long long>(peak_per_sec), static_cast<unsigned long long>(send_failures));
+  }
+}
@@ -0,0 +1,100 @@
+/* lifecycle-notify.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_LIFECYCLE_NOTIFY_H
+#define SPARTAN_LIFECYCLE_NOTIFY_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "string-view.h"
+#include "argv-frame.h"
+
+/**
+ * Coalescing of the launcher's child process lifecycle notifications to the supervisor.
+ *
+ * Rather than an mq message per child process start and exit, the launcher collects them over a
+ * short window (config.ini [ChildProcessSettings] NotifyBatchWindowMs, default 5 ms) and then sends
+ * the supervisor a single batch message - an argv frame (see argv-frame.h) of the args:
+ *
+ *   --CHILD_PID_BATCH_NOTIFY  S <pid> <command line>  E <pid> <exit status>  ...
+ *
+ * in the order the events occurred. A batch is also sent as soon as another event would make it
+ * larger than an mq message. The supervisor hands the batch to Java in one upcall.
+ */
+namespace lifecycle_notify {
+
+  using bpstd::string_view;
+
+  // first arg of a batch message
+  extern const string_view BATCH_NOTIFY_CMD;
+  // the event kind args of a batch message
+  extern const string_view STARTED;
+  extern const string_view EXITED;
+
+  // config.ini [ChildProcessSettings] NotifyBatchWindowMs setting (0 sends each notification on its own)
+  void set_batch_window_ms(int window_ms);
+  int batch_window_ms();
+
+  // decodes msg into frame if it's a well formed batch message: args[0] is BATCH_NOTIFY_CMD,
+  // followed by an (event kind, pid, command line or exit status) triple per event
+  bool decode_batch(const std::string &msg, argv_frame::frame_t &frame);
+  bool is_batch(const std::string &msg);
+
+  class Batcher {
+  public:
+    using send_t = std::function<int(string_view msg)>;
+  private:
+    const send_t send;
+    const size_t max_msg_size;
+    const int tfd; // timerfd of the batch window - armed by the first event of a batch
+    std::mutex mtx;
+    std::vector<std::string> args;
+    size_t msg_size;
+    // counters
+    uint64_t events = 0, batches = 0, batched_events = 0, largest_batch = 0, send_failures = 0;
+    int64_t curr_sec = 0;
+    uint64_t curr_sec_events = 0, last_sec_events = 0, peak_per_sec = 0;
+  private:
+    void add(string_view kind, pid_t pid, const std::string &value);
+    void flush_locked();
+  public:
+    Batcher(send_t send, size_t max_msg_size);
+    Batcher(const Batcher &) = delete;
+    Batcher& operator=(const Batcher &) = delete;
+    ~Batcher();
+
+    // the timerfd that becomes readable when a batch window has elapsed (-1 if it couldn't be created,
+    // in which case every event is sent at once); on_timer() is to be called when it's readable
+    int timer_fd() const { return tfd; }
+    void on_timer();
+
+    void started(pid_t pid, const std::string &cmd_line);
+    void exited(pid_t pid, int exit_status);
+    // sends the pending batch now (if any)
+    void flush();
+
+    // the counters (including notifications per second) as a log friendly string
+    std::string stats_str();
+  };
+}
+
+#endif //SPARTAN_LIFECYCLE_NOTIFY_H
@@ -17,6 +17,9 @@ limitations under the License.
 
 */
 
+#include <algorithm>
+#include <fstream>
+#include <sys/resource.h>
 #include "format2str.h"
 #include "mq-queue.h"
 
@@ -34,3 +37,17 @@ std::string get_jlauncher_mq_queue_name(const char * const progname) {
 std::string get_jsupervisor_mq_queue_name(const char * const progname) {
   return get_mq_queue_name(JSUPERVISOR_QUEUE_NAME, progname);
 }
+
+long get_mq_max_msgs(long msg_size) {
+  static const long default_max_msgs = 10;
+  long max_msgs = 0;
+  std::ifstream msg_max_file("/proc/sys/fs/mqueue/msg_max");
+  if (!(msg_max_file >> max_msgs) || max_msgs <= default_max_msgs) return default_max_msgs;
+  // the per-user RLIMIT_MSGQUEUE byte limit is shared by all queues of the user - use a quarter of it at most
+  rlimit rlim{};
+  if (getrlimit(RLIMIT_MSGQUEUE, &rlim) == 0 && rlim.rlim_cur != RLIM_INFINITY) {
+    const auto budget_max_msgs = static_cast<long>(rlim.rlim_cur / 4 / static_cast<rlim_t>(msg_size + sizeof(void*)));
+    max_msgs = std::min(max_msgs, std::max(budget_max_msgs, default_max_msgs));
+  }
+  return max_msgs;
+}
@@ -25,4 +25,8 @@ std::string get_jlauncher_mq_queue_name(const char * const progname);
 
 std::string get_jsupervisor_mq_queue_name(const char * const progname);
 
+// the maximum number of messages of an mq queue - per the system's /proc/sys/fs/mqueue/msg_max limit and a
+// share of the RLIMIT_MSGQUEUE limit (but no fewer than 10)
+long get_mq_max_msgs(long msg_size);
+
 #endif /* __MQ_QUEUE_H__ */
\ No newline at end of file
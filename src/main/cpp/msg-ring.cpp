@@ -0,0 +1,322 @@
+/* msg-ring.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "format2str.h"
+#include "log.h"
+#include "msg-ring.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace msg_ring {
+
+  const string_view RING_MSG_CMD{ "--RING_MSG" };
+
+  static int s_size_kb = 1024;
+
+  static const uint32_t ring_magic = 0x53524e47; // "SRNG"
+  static const uint32_t ring_version = 1;
+  static const size_t min_size = 64 * 1024;
+  // a message sitting unreleased at the tail of the ring, whose sender has since exited, is reclaimed after this
+  static const uint64_t stale_ns = 30ULL * 1000000000ULL;
+
+  enum REC_STATE : uint32_t { READY = 1, PAD = 2, DONE = 3 };
+
+  struct rec_hdr_t {
+    std::atomic<uint32_t> state;
+    uint32_t length;   // of the message body that follows (of the padding, for a PAD record)
+    uint64_t seq;
+    uint64_t stamp_ns;
+    pid_t sender_pid;
+    uint32_t reserved;
+  };
+
+  struct ring_hdr_t {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;            // bytes of the data area that follows the header
+    pthread_mutex_t mtx;          // serializes senders - process shared and robust
+    std::atomic<uint64_t> head;   // position where the next message goes (only ever increases)
+    std::atomic<uint64_t> tail;   // position of the oldest message not yet released - advanced by the receiver
+    uint64_t next_seq;
+    std::atomic<uint64_t> posted, taken, full, reclaimed, high_water;
+  };
+
+  static const size_t data_offset = (sizeof(ring_hdr_t) + 63) & ~static_cast<size_t>(63);
+
+  void set_size_kb(int size_kb) { s_size_kb = std::max(size_kb, 0); }
+  int size_kb() { return s_size_kb; }
+
+  static uint64_t now_ns() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+  }
+
+  static std::string ring_name_of(const std::string &queue_name) {
+    return queue_name + "_ring";
+  }
+
+  static uint64_t rec_size_of(size_t msg_len) {
+    return (sizeof(rec_hdr_t) + msg_len + 7) & ~static_cast<uint64_t>(7);
+  }
+
+  static bool parse_descriptor(string_view const descriptor, uint64_t &seq, uint64_t &offset, uint64_t &length) {
+    const std::string desc_str(descriptor.data(), descriptor.size());
+    if (strncmp(desc_str.c_str(), RING_MSG_CMD.c_str(), RING_MSG_CMD.size()) != 0) return false;
+    unsigned long long seq_nbr = 0, offset_nbr = 0, length_nbr = 0;
+    if (sscanf(desc_str.c_str() + RING_MSG_CMD.size(), " %llu %llu %llu", &seq_nbr, &offset_nbr, &length_nbr) != 3) {
+      return false;
+    }
+    seq = seq_nbr;
+    offset = offset_nbr;
+    length = length_nbr;
+    return true;
+  }
+
+  MsgRing::MsgRing(std::string name, pid_t owner_pid, ring_hdr_t *hdr, size_t map_size)
+      : name(std::move(name)), owner_pid(owner_pid), hdr(hdr), map_size(map_size) {}
+
+  MsgRing::~MsgRing() {
+    munmap(hdr, map_size);
+    if (owner_pid == getpid()) {
+      shm_unlink(name.c_str());
+      log(LL::TRACE, "unlinked msg ring '%s' - process pid(%d)", name.c_str(), owner_pid);
+    }
+  }
+
+  char* MsgRing::data() const { return reinterpret_cast<char*>(hdr) + data_offset; }
+
+  std::unique_ptr<MsgRing> MsgRing::create(const std::string &queue_name, size_t size) {
+    auto name = ring_name_of(queue_name);
+    const size_t capacity = std::max(size, min_size) & ~static_cast<size_t>(7);
+    const size_t map_size = data_offset + capacity;
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd == -1 && errno == EEXIST) {
+      log(LL::WARN, "%s(): msg ring '%s' existed therefore was orphaned; unlinking it", __func__, name.c_str());
+      shm_unlink(name.c_str());
+      fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    }
+    if (fd == -1) {
+      log(LL::ERR, "%s(): shm_open('%s') failed: %s", __func__, name.c_str(), strerror(errno));
+      return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(map_size)) == -1) {
+      log(LL::ERR, "%s(): ftruncate('%s') failed: %s", __func__, name.c_str(), strerror(errno));
+      close(fd);
+      shm_unlink(name.c_str());
+      return nullptr;
+    }
+    void * const addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+      log(LL::ERR, "%s(): mmap('%s') failed: %s", __func__, name.c_str(), strerror(errno));
+      shm_unlink(name.c_str());
+      return nullptr;
+    }
+    auto const hdr = new (addr) ring_hdr_t{}; // ftruncate() zero filled the data area
+    hdr->capacity = capacity;
+    pthread_mutexattr_t mtx_attr;
+    pthread_mutexattr_init(&mtx_attr);
+    pthread_mutexattr_setpshared(&mtx_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mtx_attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&hdr->mtx, &mtx_attr);
+    pthread_mutexattr_destroy(&mtx_attr);
+    hdr->version = ring_version;
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->magic = ring_magic; // senders don't use a ring until its header is complete
+    log(LL::DEBUG, "%s(): created msg ring '%s' of %lu KB", __func__, name.c_str(), capacity / 1024);
+    return std::unique_ptr<MsgRing>(new MsgRing(std::move(name), getpid(), hdr, map_size));
+  }
+
+  std::unique_ptr<MsgRing> MsgRing::open(const std::string &queue_name) {
+    auto name = ring_name_of(queue_name);
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1) {
+      log(LL::DEBUG, "%s(): shm_open('%s') failed: %s", __func__, name.c_str(), strerror(errno));
+      return nullptr;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) <= data_offset) {
+      close(fd);
+      return nullptr;
+    }
+    const auto map_size = static_cast<size_t>(st.st_size);
+    void * const addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+      log(LL::ERR, "%s(): mmap('%s') failed: %s", __func__, name.c_str(), strerror(errno));
+      return nullptr;
+    }
+    auto const hdr = static_cast<ring_hdr_t*>(addr);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (hdr->magic != ring_magic || hdr->version != ring_version || data_offset + hdr->capacity != map_size) {
+      log(LL::WARN, "%s(): msg ring '%s' is not initialized or is of an incompatible version", __func__, name.c_str());
+      munmap(addr, map_size);
+      return nullptr;
+    }
+    return std::unique_ptr<MsgRing>(new MsgRing(std::move(name), 0, hdr, map_size));
+  }
+
+  size_t MsgRing::max_msg_size() const {
+    return hdr->capacity / 4 - sizeof(rec_hdr_t);
+  }
+
+  std::string MsgRing::post(string_view const msg) {
+    assert(msg.size() <= max_msg_size());
+    int rc = pthread_mutex_lock(&hdr->mtx);
+    if (rc == EOWNERDEAD) {
+      // a sender died holding the lock - the head wasn't advanced over anything it was writing, so carry on
+      pthread_mutex_consistent(&hdr->mtx);
+    } else if (rc != 0) {
+      log(LL::ERR, "%s(): could not lock msg ring '%s': %s", __func__, name.c_str(), strerror(rc));
+      return std::string();
+    }
+    const uint64_t capacity = hdr->capacity;
+    const uint64_t rec_size = rec_size_of(msg.size());
+    uint64_t head = hdr->head.load(std::memory_order_relaxed);
+    const uint64_t tail = hdr->tail.load(std::memory_order_acquire);
+    const uint64_t pos = head % capacity;
+    // a message is never split across the end of the ring - the remainder is padded out instead
+    const uint64_t pad = capacity - pos < rec_size ? capacity - pos : 0;
+    std::string descriptor;
+    if (head + pad + rec_size - tail > capacity) {
+      hdr->full.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      if (pad >= sizeof(rec_hdr_t)) {
+        auto const pad_rec = reinterpret_cast<rec_hdr_t*>(data() + pos);
+        pad_rec->length = static_cast<uint32_t>(pad - sizeof(rec_hdr_t));
+        pad_rec->state.store(PAD, std::memory_order_relaxed);
+      } // else a remainder too small for a record header is skipped by the receiver implicitly
+      head += pad;
+      const uint64_t offset = head % capacity;
+      auto const rec = reinterpret_cast<rec_hdr_t*>(data() + offset);
+      rec->length = static_cast<uint32_t>(msg.size());
+      rec->seq = ++hdr->next_seq;
+      rec->stamp_ns = now_ns();
+      rec->sender_pid = getpid();
+      memcpy(reinterpret_cast<char*>(rec) + sizeof(rec_hdr_t), msg.data(), msg.size());
+      rec->state.store(READY, std::memory_order_relaxed);
+      hdr->head.store(head + rec_size, std::memory_order_release);
+      hdr->posted.fetch_add(1, std::memory_order_relaxed);
+      const uint64_t used = head + rec_size - tail;
+      if (used > hdr->high_water.load(std::memory_order_relaxed)) {
+        hdr->high_water.store(used, std::memory_order_relaxed);
+      }
+      descriptor = format2str("%s %llu %llu %lu", RING_MSG_CMD.c_str(), static_cast<unsigned long long>(rec->seq),
+                              static_cast<unsigned long long>(offset), msg.size());
+    }
+    pthread_mutex_unlock(&hdr->mtx);
+    return descriptor;
+  }
+
+  void MsgRing::abandon(const std::string &descriptor) {
+    uint64_t seq = 0, offset = 0, length = 0;
+    if (!parse_descriptor(descriptor, seq, offset, length) || offset + sizeof(rec_hdr_t) > hdr->capacity) return;
+    auto const rec = reinterpret_cast<rec_hdr_t*>(data() + offset);
+    if (rec->seq == seq) {
+      uint32_t expected = READY;
+      rec->state.compare_exchange_strong(expected, DONE, std::memory_order_release);
+    }
+  }
+
+  bool MsgRing::take(string_view const descriptor, std::string &msg) {
+    uint64_t seq = 0, offset = 0, length = 0;
+    if (!parse_descriptor(descriptor, seq, offset, length) || offset % 8 != 0 ||
+        offset + sizeof(rec_hdr_t) + length > hdr->capacity)
+    {
+      log(LL::ERR, "%s(): invalid msg ring descriptor: '%.*s'", __func__,
+          static_cast<int>(descriptor.size()), descriptor.data());
+      return false;
+    }
+    auto const rec = reinterpret_cast<rec_hdr_t*>(data() + offset);
+    if (rec->state.load(std::memory_order_acquire) != READY || rec->seq != seq || rec->length != length) {
+      log(LL::ERR, "%s(): msg ring message %llu is no longer in the ring (its sender exited before it was received)",
+          __func__, static_cast<unsigned long long>(seq));
+      return false;
+    }
+    msg.assign(reinterpret_cast<const char*>(rec) + sizeof(rec_hdr_t), length);
+    rec->state.store(DONE, std::memory_order_release);
+    hdr->taken.fetch_add(1, std::memory_order_relaxed);
+    release_consumed();
+    return true;
+  }
+
+  void MsgRing::reclaim() {
+    if (hdr->tail.load(std::memory_order_relaxed) != hdr->head.load(std::memory_order_relaxed)) {
+      release_consumed();
+    }
+  }
+
+  // advances the tail over the leading run of released records - messages can be received out of order
+  // (the descriptors of concurrent senders race each other to the mq queue), so space is freed in order
+  void MsgRing::release_consumed() {
+    const uint64_t capacity = hdr->capacity;
+    const uint64_t head = hdr->head.load(std::memory_order_acquire);
+    uint64_t tail = hdr->tail.load(std::memory_order_relaxed);
+    while (tail < head) {
+      const uint64_t pos = tail % capacity;
+      if (capacity - pos < sizeof(rec_hdr_t)) {
+        tail += capacity - pos; // remainder too small for a record
+        continue;
+      }
+      auto const rec = reinterpret_cast<rec_hdr_t*>(data() + pos);
+      const auto state = rec->state.load(std::memory_order_acquire);
+      if (state == PAD) {
+        tail += capacity - pos;
+        continue;
+      }
+      if (state == READY) {
+        const bool is_stale = now_ns() - rec->stamp_ns > stale_ns && kill(rec->sender_pid, 0) == -1 && errno == ESRCH;
+        if (!is_stale) break;
+        log(LL::WARN, "%s(): reclaimed msg ring message %llu of exited sender pid(%d)",
+            __func__, static_cast<unsigned long long>(rec->seq), rec->sender_pid);
+        hdr->reclaimed.fetch_add(1, std::memory_order_relaxed);
+      } else if (state != DONE) {
+        break;
+      }
+      rec->state.store(0, std::memory_order_relaxed);
+      tail += rec_size_of(rec->length);
+    }
+    hdr->tail.store(tail, std::memory_order_release);
+  }
+
+  std::string MsgRing::stats_str() const {
+    const uint64_t used = hdr->head.load(std::memory_order_relaxed) - hdr->tail.load(std::memory_order_relaxed);
+    return format2str("msg ring (%lu KB) in use: %llu bytes, high water: %llu bytes, posted: %llu, received: %llu, "
+                      "full: %llu, reclaimed: %llu", hdr->capacity / 1024, static_cast<unsigned long long>(used),
+                      static_cast<unsigned long long>(hdr->high_water.load(std::memory_order_relaxed)),
+                      static_cast<unsigned long long>(hdr->posted.load(std::memory_order_relaxed)),
+                      static_cast<unsigned long long>(hdr->taken.load(std::memory_order_relaxed)),
+                      static_cast<unsigned long long>(hdr->full.load(std::memory_order_relaxed)),
+                      static_cast<unsigned long long>(hdr->reclaimed.load(std::memory_order_relaxed)));
+  }
+}
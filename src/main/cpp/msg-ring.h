@@ -0,0 +1,95 @@
+/* msg-ring.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_MSG_RING_H
+#define SPARTAN_MSG_RING_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include "string-view.h"
+
+/**
+ * Shared memory ring transport of messages too large for an mq queue's message size (4 KB).
+ *
+ * The launcher and supervisor processes each create a ring alongside their mq queue - a POSIX shared
+ * memory object named after the queue (e.g., /myapp_JLauncher_ring). A sender copies the message
+ * body into the ring and then sends the mq queue a small descriptor message in its stead:
+ *
+ *   --RING_MSG <sequence> <offset> <length>
+ *
+ * The receiver copies the body out of the ring and releases its space. Senders are serialized by a
+ * process shared (robust) mutex in the ring header; the receiver releases space lock-free. Messages
+ * that do fit in an mq message keep going over the mq queue as ever, as do all messages when a queue
+ * has no ring (MsgRingSizeKB=0).
+ */
+namespace msg_ring {
+
+  using bpstd::string_view;
+
+  // first token of the mq message that stands in for a message body held in the ring
+  extern const string_view RING_MSG_CMD;
+
+  // config.ini [ChildProcessSettings] MsgRingSizeKB setting (0 disables the ring)
+  void set_size_kb(int size_kb);
+  int size_kb();
+
+  struct ring_hdr_t; // the header at the start of the shared memory object
+
+  class MsgRing {
+  private:
+    const std::string name;
+    const pid_t owner_pid; // the receiving process that created the ring (0 for a sender)
+    ring_hdr_t *hdr;
+    size_t map_size;
+  private:
+    MsgRing(std::string name, pid_t owner_pid, ring_hdr_t *hdr, size_t map_size);
+    char* data() const;
+    void release_consumed();
+  public:
+    // the receiver creates the ring of its mq queue (replacing an orphaned one); nullptr on failure
+    static std::unique_ptr<MsgRing> create(const std::string &queue_name, size_t size);
+    // a sender opens the ring of an mq queue; nullptr if the queue has no ring
+    static std::unique_ptr<MsgRing> open(const std::string &queue_name);
+    MsgRing(const MsgRing &) = delete;
+    MsgRing& operator=(const MsgRing &) = delete;
+    ~MsgRing(); // unmaps the ring - and unlinks it in the process that created it
+
+    // sender - copies msg (of no more than max_msg_size()) into the ring and returns the descriptor mq message
+    // to send in its stead; returns an empty string if the ring doesn't have room for it at present
+    std::string post(string_view const msg);
+    // sender - releases the ring space of a descriptor that could not be sent
+    void abandon(const std::string &descriptor);
+
+    // receiver - copies out the message body of a descriptor mq message and releases its ring space;
+    // returns false (and logs why) if the descriptor doesn't match a message in the ring
+    bool take(string_view const descriptor, std::string &msg);
+    // receiver - housekeeping: frees the space of released messages at the tail, and of a stale one whose
+    // sender exited before its descriptor reached the mq queue (when the ring is full no descriptor arrives,
+    // so take() never gets to do it)
+    void reclaim();
+
+    // the largest message that the ring accepts
+    size_t max_msg_size() const;
+    // the counters as a log friendly string
+    std::string stats_str() const;
+  };
+}
+
+#endif //SPARTAN_MSG_RING_H
@@ -16,7 +16,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 
 */
+#include <algorithm>
 #include <memory>
+#include <fcntl.h>
 #include <unistd.h>
 #include "format2str.h"
 #include "spartan-exception.h"
@@ -36,6 +38,13 @@ DECL_EXCEPTION(open_write_pipe)
 
 enum PIPES : short { READ = 0, WRITE = 1 };
 
+namespace anon_pipes {
+  static int s_pipe_size_kb = 0;
+
+  void set_pipe_size_kb(int size_kb) { s_pipe_size_kb = std::max(size_kb, 0); }
+  int pipe_size_kb() { return s_pipe_size_kb; }
+}
+
 static std::tuple<int, int> make_anon_pipe() {
   int pipes[2] { -1, -1 };
   int line_nbr = __LINE__ + 1;
@@ -44,105 +53,102 @@ static std::tuple<int, int> make_anon_pipe() {
     const char err_msg_fmt[] = "%d: %s() -> pipe(): failed creating pipe file descriptor pair:\n\t%s";
     throw open_write_pipe_exception{ format2str(err_msg_fmt, line_nbr, __FUNCTION__, strerror(errno)) };
   }
+  const int pipe_size_kb = anon_pipes::pipe_size_kb();
+  if (pipe_size_kb > 0) {
+    // an unprivileged process can't go beyond /proc/sys/fs/pipe-max-size (EPERM) - the pipe keeps its capacity
+    if (fcntl(pipes[PIPES::WRITE], F_SETPIPE_SZ, pipe_size_kb * 1024) == -1) {
+      log(LL::DEBUG, "%s(): fcntl(F_SETPIPE_SZ, %d KB) failed on pipe fd{%d}: %s", __FUNCTION__, pipe_size_kb,
+          pipes[PIPES::WRITE], strerror(errno));
+    }
+  }
   return std::make_tuple(pipes[PIPES::READ], pipes[PIPES::WRITE]);
 }
 
-static void send_pid_and_fd_count(string_view const uds_socket_name, sockaddr_un &server_address, const int socket_fd,
-                                 const pid_t pid, const int fds_count)
+// Connects to the socket name the client bound and sends it the one response message: the pid, the fd
+// count and the status as payload, with the pipe fd(s) as SCM_RIGHTS ancillary data. The connection is
+// closed on return, as the fds in flight are the client's from the moment the message is sent.
+static void send_response(string_view const uds_socket_name, const pid_t pid, const int status,
+                          const int * const fds, const int fds_count)
 {
   static const char* const func_name = __FUNCTION__;
-  socklen_t address_length;
-  init_sockaddr(uds_socket_name, server_address, address_length);
-
-  pid_buffer_t pid_buffer{ pid, fds_count };
-
-  int line_nbr;
-  auto bytes_sent = sendto(socket_fd,
-                           &pid_buffer,
-                           sizeof(pid_buffer),
-                           0,
-                           (sockaddr*) &server_address,
-                           address_length); line_nbr = __LINE__;
-  if (bytes_sent < 0) {
-    const char err_fmt[] = "%d: %s() -> sendto(): failed sending process pid{%d} datagram via named socket %s:\n\t%s";
-    auto err_msg = format2str(err_fmt, line_nbr, func_name, pid_buffer.pid, uds_socket_name.c_str(), strerror(errno));
-    throw open_write_pipe_exception{ std::move(err_msg) };
-  }
-  assert(bytes_sent == (long) sizeof(pid_buffer));
-
-  log(LL::DEBUG, "%s(): ***** sent process pid{%d} datagram via named socket %s *****\n",
-      func_name, pid_buffer.pid, uds_socket_name.c_str());
-}
-
-fd_wrapper_sp_t open_write_anon_pipe(string_view const uds_socket_name, int &rc) {
-  static const char* const func_name = __FUNCTION__;
-  rc = EXIT_SUCCESS;
+  assert(fds_count == 1 || fds_count == 3);
 
   int line_nbr = __LINE__ + 1;
   auto socket_fd_sp = create_uds_socket([uds_socket_name, &line_nbr](int err_no) -> std::string {
-    const char err_msg_fmt[] = "%d: %s() -> create_uds_socket(): failed creating uds socket for use with name %s:\n\t%s";
+    const char err_msg_fmt[] = "%d: %s() -> create_uds_socket(): failed creating uds socket to connect to %s:\n\t%s";
     return format2str(err_msg_fmt, line_nbr, func_name, uds_socket_name.c_str(), strerror(err_no));
   });
 
-  const auto pipe_fds = make_anon_pipe();
-
-  fd_wrapper_t rdr_rd_pipe{ std::get<PIPES::READ>(pipe_fds) };
-  fd_wrapper_sp_t rdr_rd_pipe_sp{ &rdr_rd_pipe, &fd_cleanup_no_delete };
-  fd_wrapper_sp_t rdr_wr_pipe_sp{ new fd_wrapper_t{ std::get<PIPES::WRITE>(pipe_fds), uds_socket_name.c_str() },
-                                  &fd_cleanup_with_delete };
-
-  sockaddr_un server_address{0};
+  sockaddr_un server_address{};
   socklen_t address_length;
+  init_sockaddr(uds_socket_name, server_address, address_length);
 
-  send_pid_and_fd_count(uds_socket_name, server_address, socket_fd_sp->fd, rdr_wr_pipe_sp->pid, 1);
+  int rc;
+  line_nbr = __LINE__ + 1;
+  while ((rc = connect(socket_fd_sp->fd, (const sockaddr*) &server_address, address_length)) == -1 && errno == EINTR);
+  if (rc == -1) {
+    const char err_fmt[] = "%d: %s() -> connect(): failed connecting to named socket %s:\n\t%s";
+    auto err_msg = format2str(err_fmt, line_nbr, func_name, uds_socket_name.c_str(), strerror(errno));
+    throw open_write_pipe_exception{ std::move(err_msg) };
+  }
 
-  init_sockaddr(uds_socket_name, server_address, address_length);
+  pid_buffer_t pid_buffer{ pid, fds_count, status };
+  iovec iov{ &pid_buffer, sizeof(pid_buffer) };
 
-  msghdr parent_msg{nullptr};
+  msghdr parent_msg{};
   memset(&parent_msg, 0, sizeof(parent_msg));
-  parent_msg.msg_name = &server_address;
-  parent_msg.msg_namelen = address_length;
+  parent_msg.msg_iov = &iov;
+  parent_msg.msg_iovlen = 1;
 
-  pipe_fds_buffer_t cmsg_payload{}; //{ { 0, SOL_SOCKET, SCM_RIGHTS }, { rdr_rd_pipe_sp->fd } };
+  pipes_fds_buffer_t cmsg_payload{}; // { { 0, SOL_SOCKET, SCM_RIGHTS }, { fd1[, fd2, fd3] } };
   memset(&cmsg_payload, 0, sizeof(cmsg_payload));
-
-  cmsg_payload.cmsg.cmsg_len = 0;
-  cmsg_payload.cmsg.cmsg_level = SOL_SOCKET;
-  cmsg_payload.cmsg.cmsg_type = SCM_RIGHTS;
-  cmsg_payload.p.pipe_fds[0] = rdr_rd_pipe_sp->fd;
   parent_msg.msg_control = &cmsg_payload;
-  parent_msg.msg_controllen = sizeof(cmsg_payload); // necessary for CMSG_FIRSTHDR to return the correct value
+  parent_msg.msg_controllen = CMSG_SPACE(fds_count * sizeof(int));
 
   cmsghdr * const cmsg = CMSG_FIRSTHDR(&parent_msg);
   assert(cmsg != nullptr);
-  cmsg->cmsg_len = sizeof(cmsg_payload);
-
-  auto bytes_sent = sendmsg(socket_fd_sp->fd, &parent_msg, 0); line_nbr = __LINE__;
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(fds_count * sizeof(int));
+  memcpy(CMSG_DATA(cmsg), fds, fds_count * sizeof(int));
+
+  ssize_t bytes_sent;
+  line_nbr = __LINE__ + 1;
+  while ((bytes_sent = sendmsg(socket_fd_sp->fd, &parent_msg, MSG_NOSIGNAL)) == -1 && errno == EINTR);
   if (bytes_sent < 0) {
-    const char err_msg_fmt[] =
-        "%d: %s() -> sendmsg(): failed sending i/o pipe read fd{%d} datagram via named socket %s:\n\t%s";
-    auto err_msg = format2str(err_msg_fmt, line_nbr, func_name, rdr_rd_pipe_sp->fd,
-                              uds_socket_name.c_str(), strerror(errno));
+    const char err_fmt[] = "%d: %s() -> sendmsg(): failed sending pid{%d} and %d pipe fd(s) via named socket %s:\n\t%s";
+    auto err_msg = format2str(err_fmt, line_nbr, func_name, pid, fds_count, uds_socket_name.c_str(), strerror(errno));
     throw open_write_pipe_exception{ std::move(err_msg) };
   }
-  log(LL::DEBUG, "%s(): ***** sent i/o pipe read fd{%d} datagram via named socket %s *****\n",
-      func_name, cmsg_payload.p.pipe_fds[0], uds_socket_name.c_str());
+  assert(bytes_sent == (long) sizeof(pid_buffer));
+
+  log(LL::DEBUG, "%s(): ***** sent process pid{%d} and %d pipe fd(s) via named socket %s *****\n",
+      func_name, pid, fds_count, uds_socket_name.c_str());
+}
+
+fd_wrapper_sp_t open_write_anon_pipe(string_view const uds_socket_name, int &rc, const pid_t rsp_pid,
+                                     const int status)
+{
+  rc = EXIT_SUCCESS;
+
+  const auto pipe_fds = make_anon_pipe();
+
+  fd_wrapper_t rdr_rd_pipe{ std::get<PIPES::READ>(pipe_fds) };
+  fd_wrapper_sp_t rdr_rd_pipe_sp{ &rdr_rd_pipe, &fd_cleanup_no_delete };
+  fd_wrapper_sp_t rdr_wr_pipe_sp{ new fd_wrapper_t{ std::get<PIPES::WRITE>(pipe_fds), uds_socket_name.c_str() },
+                                  &fd_cleanup_with_delete };
+
+  const int fds[] = { rdr_rd_pipe_sp->fd };
+  send_response(uds_socket_name, rsp_pid != 0 ? rsp_pid : rdr_wr_pipe_sp->pid, status, fds, 1);
 
   return rdr_wr_pipe_sp; // returning i/o pipe write fd
 }
 
 std::tuple<fd_wrapper_sp_t, fd_wrapper_sp_t, fd_wrapper_sp_t> open_react_anon_pipes(
-    string_view const uds_socket_name, int &rc)
+    string_view const uds_socket_name, int &rc, const pid_t rsp_pid, const int status)
 {
-  static const char* const func_name = __FUNCTION__;
   rc = EXIT_SUCCESS;
 
-  int line_nbr = __LINE__ + 1;
-  auto socket_fd_sp = create_uds_socket([uds_socket_name, &line_nbr](int err_no) -> std::string {
-    const char err_msg_fmt[] = "%d: %s() -> create_uds_socket(): failed creating uds socket for use with name %s:\n\t%s";
-    return format2str(err_msg_fmt, line_nbr, func_name, uds_socket_name.c_str(), strerror(err_no));
-  });
-
   auto pipe_fds = make_anon_pipe();
 
   fd_wrapper_t rdr_rd_pipe{ std::get<PIPES::READ>(pipe_fds) };
@@ -164,45 +170,8 @@ std::tuple<fd_wrapper_sp_t, fd_wrapper_sp_t, fd_wrapper_sp_t> open_react_anon_pi
   fd_wrapper_t wrt_wr_pipe{ std::get<PIPES::WRITE>(pipe_fds) };
   fd_wrapper_sp_t wrt_wr_pipe_sp{ &wrt_wr_pipe, &fd_cleanup_no_delete };
 
-  sockaddr_un server_address{};
-  socklen_t address_length;
-
-  send_pid_and_fd_count(uds_socket_name, server_address, socket_fd_sp->fd, rdr_wr_pipe_sp->pid, 3);
-
-  init_sockaddr(uds_socket_name, server_address, address_length);
-
-  msghdr parent_msg{};
-  memset(&parent_msg, 0, sizeof(parent_msg));
-  parent_msg.msg_name = &server_address;
-  parent_msg.msg_namelen = address_length;
-
-  pipes_fds_buffer_t cmsg_payload{}; // { { 0, SOL_SOCKET, SCM_RIGHTS }, { fd1, fd2, fd3 } };
-  memset(&cmsg_payload, 0, sizeof(cmsg_payload));
-
-  cmsg_payload.cmsg.cmsg_len = 0;
-  cmsg_payload.cmsg.cmsg_level = SOL_SOCKET;
-  cmsg_payload.cmsg.cmsg_type = SCM_RIGHTS;
-  cmsg_payload.p.pipe_fds[0] = rdr_rd_pipe_sp->fd;
-  cmsg_payload.p.pipe_fds[1] = err_rd_pipe_sp->fd;
-  cmsg_payload.p.pipe_fds[2] = wrt_wr_pipe_sp->fd;
-  parent_msg.msg_control = &cmsg_payload;
-  parent_msg.msg_controllen = sizeof(cmsg_payload); // necessary for CMSG_FIRSTHDR to return the correct value
-
-  cmsghdr * const cmsg = CMSG_FIRSTHDR(&parent_msg);
-  assert(cmsg != nullptr);
-  cmsg->cmsg_len = sizeof(cmsg_payload);
-
-  auto bytes_sent = sendmsg(socket_fd_sp->fd, &parent_msg, 0); line_nbr = __LINE__;
-  if (bytes_sent < 0) {
-    const char err_fmt[] =
-        "%d: %s() -> sendmsg(): failed sending i/o pipes react fds{%d,%d,%d} datagram via named socket %s:\n\t%s";
-    auto err_msg = format2str(err_fmt, line_nbr, func_name, rdr_rd_pipe_sp->fd, err_rd_pipe_sp->fd, wrt_wr_pipe_sp->fd,
-                              uds_socket_name.c_str(), strerror(errno));
-    throw open_write_pipe_exception{ std::move(err_msg) };
-  }
-  log(LL::DEBUG, "%s(): ***** sent i/o pipes react fds{%d,%d,%d} datagram via named socket %s *****\n",
-      func_name, cmsg_payload.p.pipe_fds[0], cmsg_payload.p.pipe_fds[1], cmsg_payload.p.pipe_fds[2],
-      uds_socket_name.c_str());
+  const int fds[] = { rdr_rd_pipe_sp->fd, err_rd_pipe_sp->fd, wrt_wr_pipe_sp->fd };
+  send_response(uds_socket_name, rsp_pid != 0 ? rsp_pid : rdr_wr_pipe_sp->pid, status, fds, 3);
 
   return std::make_tuple( std::move(rdr_wr_pipe_sp), std::move(err_wr_pipe_sp), std::move(wrt_rd_pipe_sp));
-}
\ No newline at end of file
+}
@@ -24,8 +24,18 @@ limitations under the License.
 using launch_program::fd_wrapper_sp_t;
 using bpstd::string_view;
 
-launch_program::fd_wrapper_sp_t open_write_anon_pipe(string_view const uds_socket_name, int &rc);
+namespace anon_pipes {
+  // config.ini [ChildProcessSettings] PipeSizeKB setting - the capacity that the response pipes are grown
+  // to with F_SETPIPE_SZ (0 keeps the system default of 64 KB)
+  void set_pipe_size_kb(int size_kb);
+  int pipe_size_kb();
+}
+
+// rsp_pid is the process pid reported to the client as that of the responding process (0 for the calling process);
+// status is conveyed to the client along with the pipe(s) - the client exits with it if not EXIT_SUCCESS
+launch_program::fd_wrapper_sp_t open_write_anon_pipe(string_view const uds_socket_name, int &rc,
+                                                     const pid_t rsp_pid = 0, const int status = EXIT_SUCCESS);
 std::tuple<fd_wrapper_sp_t, fd_wrapper_sp_t, fd_wrapper_sp_t> open_react_anon_pipes(
-    string_view const uds_socket_name, int &rc);
+    string_view const uds_socket_name, int &rc, const pid_t rsp_pid = 0, const int status = EXIT_SUCCESS);
 
 #endif //SPARTAN_OPEN_ANON_PIPES_H
\ No newline at end of file
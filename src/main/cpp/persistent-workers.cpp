@@ -0,0 +1,160 @@
+/* persistent-workers.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <sys/socket.h>
+#include "log.h"
+#include "persistent-workers.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace persistent_workers {
+
+  // the lock is held across fork() by the caller - the worker process never touches this object
+  pid_t PersistentWorkers::fork_worker(const std::string &cmd, std::vector<worker_t> &cmd_workers) {
+    int sv[2] { -1, -1 };
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == -1) {
+      log(LL::ERR, "%s(): socketpair() failed for command '%s':\n\t%s", __func__, cmd.c_str(), strerror(errno));
+      return -1;
+    }
+    const pid_t pid = fork();
+    if (pid == -1) {
+      log(LL::ERR, "%s(): fork() of persistent worker for command '%s' failed:\n\t%s",
+          __func__, cmd.c_str(), strerror(errno));
+      close(sv[0]);
+      close(sv[1]);
+      return -1;
+    }
+    if (pid == 0) {
+      close(sv[0]);
+      // don't hold open the control sockets of the other workers (would mask their EOF on shutdown)
+      for (auto const &entry : workers) {
+        for (auto const &worker : entry.second) {
+          if (worker.ctl_fd != -1) {
+            close(worker.ctl_fd);
+          }
+        }
+      }
+      exit(worker_main(cmd, sv[1]));
+    }
+    close(sv[1]);
+    cmd_workers.push_back(worker_t{pid, sv[0], false});
+    log(LL::DEBUG, "%s(): forked persistent worker %d for command '%s' (%lu of %lu)",
+        __func__, pid, cmd.c_str(), cmd_workers.size(), max_workers);
+    return pid;
+  }
+
+  void PersistentWorkers::retire(worker_t &worker) {
+    if (worker.ctl_fd != -1) {
+      close(worker.ctl_fd);
+      worker.ctl_fd = -1;
+    }
+    retired.insert(worker.pid);
+  }
+
+  // feeds the command dispatch message to an idle worker of the command (forking a new worker if
+  // fewer than max_workers exist); returns the worker's pid, else -1 if all its workers are busy
+  pid_t PersistentWorkers::dispatch(const std::string &cmd, const std::string &msg) {
+    std::unique_lock<std::mutex> lk(mtx);
+    if (is_shutdown) return -1;
+
+    auto const is_retired = [](const worker_t &worker) { return worker.ctl_fd == -1; };
+    auto &cmd_workers = workers[cmd];
+
+    // harvest the completion acknowledgements of busy workers (non-blocking)
+    for (auto &worker : cmd_workers) {
+      if (!worker.busy) continue;
+      char ack = 0;
+      const auto n = recv(worker.ctl_fd, &ack, sizeof(ack), MSG_DONTWAIT);
+      if (n == 1 && ack == ACK::READY) {
+        worker.busy = false;
+      } else if (n == 0 || n == 1 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        retire(worker); // retiring, exited, or control socket failed
+      }
+    }
+    cmd_workers.erase(std::remove_if(cmd_workers.begin(), cmd_workers.end(), is_retired), cmd_workers.end());
+
+    auto const feed = [&msg, this](worker_t &worker) -> bool {
+      if (send(worker.ctl_fd, msg.c_str(), msg.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(msg.size())) {
+        worker.busy = true;
+        return true;
+      }
+      log(LL::WARN, "PersistentWorkers::dispatch(): persistent worker %d could not be fed command: %s",
+          worker.pid, strerror(errno));
+      retire(worker);
+      return false;
+    };
+
+    for (auto &worker : cmd_workers) {
+      if (!worker.busy && feed(worker)) {
+        return worker.pid;
+      }
+    }
+    cmd_workers.erase(std::remove_if(cmd_workers.begin(), cmd_workers.end(), is_retired), cmd_workers.end());
+
+    if (cmd_workers.size() < max_workers && fork_worker(cmd, cmd_workers) != -1 && feed(cmd_workers.back())) {
+      return cmd_workers.back().pid;
+    }
+    return -1;
+  }
+
+  // returns true if the terminated child process was a persistent worker
+  bool PersistentWorkers::reap(pid_t pid) {
+    std::unique_lock<std::mutex> lk(mtx);
+    if (retired.erase(pid) > 0) return true;
+    for (auto &entry : workers) {
+      auto &cmd_workers = entry.second;
+      for (auto it = cmd_workers.begin(); it != cmd_workers.end(); ++it) {
+        if (it->pid == pid) {
+          if (it->ctl_fd != -1) {
+            close(it->ctl_fd);
+          }
+          cmd_workers.erase(it);
+          log(LL::DEBUG, "%s(): persistent worker %d for command '%s' terminated", __func__, pid, entry.first.c_str());
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // closing the control sockets releases the workers, which exit upon finishing any in-progress invocation
+  void PersistentWorkers::shutdown() {
+    std::unique_lock<std::mutex> lk(mtx);
+    if (is_shutdown) return;
+    is_shutdown = true;
+    for (auto &entry : workers) {
+      for (auto &worker : entry.second) {
+        retire(worker);
+      }
+    }
+    workers.clear();
+    log(LL::TRACE, "%s(): released %lu persistent workers", __func__, retired.size());
+  }
+
+  // called in the worker process context upon completing an invocation
+  bool send_ack(int ctl_fd, ACK ack) {
+    const char ack_chr = ack;
+    return send(ctl_fd, &ack_chr, sizeof(ack_chr), MSG_NOSIGNAL) == sizeof(ack_chr);
+  }
+}
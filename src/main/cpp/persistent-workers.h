@@ -0,0 +1,88 @@
+/* persistent-workers.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_PERSISTENT_WORKERS_H
+#define SPARTAN_PERSISTENT_WORKERS_H
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <unistd.h>
+
+namespace persistent_workers {
+
+  // acknowledgement a worker sends back over its control socket upon completing an invocation
+  enum ACK : char { READY = 'A', RETIRING = 'R' };
+
+  // executes in the forked worker process context; the returned value becomes the worker's exit code
+  using worker_main_t = std::function<int(const std::string &cmd, int ctl_fd)>;
+
+  /**
+   * Long-lived child worker processes for child commands designated as persistent (either via the
+   * @ChildWorkerCommand(persistent = true) annotation attribute or the config.ini PersistentCommands
+   * setting). Up to max_workers worker processes are kept per such command, each with a fully warmed
+   * Java JVM that processes successive invocations of that command.
+   *
+   * The launcher feeds an invocation (the child command dispatch message) to an idle worker over its
+   * control socket; the worker obtains the response pipe(s) per the invocation's own Unix seqpacket
+   * socket name, exactly as a one-shot forked child process would, and then acknowledges completion.
+   * A worker retires itself (exits) once it reaches its request count or heap usage limit.
+   *
+   * When all of a command's workers are busy, dispatch() returns -1 so that the caller falls
+   * back to forking a one-shot child process.
+   *
+   * NOTE: The worker_main callback runs in the forked worker process - it must not make use of
+   * this object (its mutex may have been held by another thread at the time of fork).
+   */
+  class PersistentWorkers {
+  private:
+    struct worker_t {
+      pid_t pid;
+      int ctl_fd;
+      bool busy;
+    };
+    std::mutex mtx;
+    std::unordered_map<std::string, std::vector<worker_t>> workers; // keyed by the lower-case command name
+    std::unordered_set<pid_t> retired;
+    const size_t max_workers;
+    const worker_main_t worker_main;
+    bool is_shutdown{false};
+  private:
+    pid_t fork_worker(const std::string &cmd, std::vector<worker_t> &cmd_workers);
+    void retire(worker_t &worker);
+  public:
+    PersistentWorkers(size_t max_workers, worker_main_t worker_main) : max_workers(max_workers),
+                                                                       worker_main(std::move(worker_main)) {}
+    PersistentWorkers(const PersistentWorkers &) = delete;
+    PersistentWorkers(PersistentWorkers &&) = delete;
+    PersistentWorkers& operator=(const PersistentWorkers &) = delete;
+    PersistentWorkers& operator=(PersistentWorkers &&) = delete;
+    ~PersistentWorkers() { shutdown(); }
+  public:
+    pid_t dispatch(const std::string &cmd, const std::string &msg);
+    bool reap(pid_t pid);
+    void shutdown();
+  };
+
+  bool send_ack(int ctl_fd, ACK ack);
+}
+
+#endif //SPARTAN_PERSISTENT_WORKERS_H
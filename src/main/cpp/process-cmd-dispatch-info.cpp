@@ -22,9 +22,10 @@ limitations under the License.
 #include <sstream>
 #include <algorithm>
 #include "log.h"
+#include "format2str.h"
 #include "session-state.h"
 #include "str-split.h"
-#include "streambuf-wrapper.h"
+#include "session-image.h"
 #include "process-cmd-dispatch-info.h"
 
 //#undef NDEBUG // uncomment this line to enable asserts in use below
@@ -36,12 +37,12 @@ extern const char * progname();
 
 namespace cmd_dsp {
 
-  // forward declarations section
-  static std::vector<char> serialize_session_state_to_membuf(const sessionState &ss);
-
   // implementation section
   static const char java_string_descriptor[] = "Ljava/lang/String;";
 
+  // the session image follows the serialized dispatch info (and its size) in shared memory, 8 byte aligned
+  static inline size_t session_image_pos(size_t pos) { return (pos + 7) & ~static_cast<size_t>(7); }
+
   template<typename T>
   using defer_jobj_sp_t = std::unique_ptr<_jobject, T>;
 
@@ -103,11 +104,12 @@ namespace cmd_dsp {
     debug_dump_sessionState(ss, 'C');
 #endif
 
-    const auto ss_ser_membuf = serialize_session_state_to_membuf(ss);
+    const auto ss_image = ss_image::build(ss);
 
     const auto pg_size = sysconf(_SC_PAGE_SIZE);
     const auto byteArrayLen = env->GetArrayLength(ser_cmd_dispatch_info);
-    const auto shm_required_size = sizeof(int32_t) + byteArrayLen + sizeof(int32_t) + ss_ser_membuf.size();
+    const auto image_pos = session_image_pos(sizeof(int32_t) + byteArrayLen + sizeof(int32_t));
+    const auto shm_required_size = image_pos + ss_image.size();
     auto pgs = static_cast<int>(shm_required_size / pg_size);
     const auto rem = shm_required_size % pg_size;
     if (rem != 0) pgs++;
@@ -121,9 +123,8 @@ namespace cmd_dsp {
     byte_mem_buf_pos += sizeof(int32_t);
     env->GetByteArrayRegion(ser_cmd_dispatch_info, 0, byteArrayLen, byte_mem_buf_pos);
     byte_mem_buf_pos += byteArrayLen;
-    *reinterpret_cast<int32_t*>(byte_mem_buf_pos) = static_cast<int32_t>(ss_ser_membuf.size());
-    byte_mem_buf_pos += sizeof(int32_t);
-    memcpy(byte_mem_buf_pos, &ss_ser_membuf.front(), ss_ser_membuf.size());
+    *reinterpret_cast<int32_t*>(byte_mem_buf_pos) = static_cast<int32_t>(ss_image.size());
+    memcpy(byte_mem_buffer + image_pos, &ss_image.front(), ss_image.size());
 
 #ifdef _DEBUG
     log(LL::DEBUG, "\tpage size: %ld, pages: %d, required byte array size: %d\n"
@@ -250,8 +251,9 @@ namespace cmd_dsp {
           extract_method_cmd_info(cmd_info_cls, sp_supervisor_cmd.get(), [&command_str](std::string &command) {
             command_str = std::move(command);
           });
+          const bool is_concurrent = extract_method_concurrent_cmd_info(cmd_info_cls, sp_supervisor_cmd.get());
           methodDescriptorCmd supervisor_cmd(std::move(method_name_str), std::move(descriptor_str),
-                                             std::move(command_str), false, WM::SUPERVISOR_DO_CMD);
+                                             std::move(command_str), is_concurrent, false, WM::SUPERVISOR_DO_CMD);
           ss.spSpartanSupervisorCommands->push_back(std::move(supervisor_cmd));
         }
         class_name = cls_name_sav;
@@ -278,6 +280,7 @@ namespace cmd_dsp {
         const char * const cls_name_sav = class_name;
         class_name = "spartan/CommandDispatchInfo$ChildCmdInfo";
         std::string method_name_str, descriptor_str, command_str, jvm_optns_str;
+        bool is_persistent;
         for (int i = 0; i < array_len; i++) {
           defer_jobj_t sp_child_worker_cmd(env->GetObjectArrayElement(child_worker_cmds_array, i), defer_jobj);
           method_name_str.clear();
@@ -297,9 +300,10 @@ namespace cmd_dsp {
                                             [&jvm_optns_str](std::string &jvm_optns) {
                                               jvm_optns_str = std::move(jvm_optns);
                                             });
+          is_persistent = extract_method_persistent_cmd_info(cmd_info_cls, sp_child_worker_cmd.get());
           methodDescriptorCmd child_worker_cmd(std::move(method_name_str), std::move(descriptor_str),
                                                std::move(command_str), std::move(jvm_optns_str),
-                                               true, WM::CHILD_DO_CMD);
+                                               is_persistent, true, WM::CHILD_DO_CMD);
           ss.spSpartanChildProcessorCommands->push_back(std::move(child_worker_cmd));
         }
         class_name = cls_name_sav;
@@ -351,12 +355,14 @@ namespace cmd_dsp {
                                                                    &ss.spartanSupervisorShutdownEntryPoint,
                                                                    &ss.spartanChildNotifyEntryPoint,
                                                                    &ss.spartanChildCompletionNotifyEntryPoint,
+                                                                   &ss.spartanChildBatchNotifyEntryPoint,
                                                                    &ss.spartanSupervisorEntryPoint};
 
     const std::string entry_points_class = cls_name_str.empty() ?
                                            std::move(std::string("spartan/SpartanBase/")) : std::move(cls_name_str);
 
     for (auto pentry_method : other_spartan_entry_methods) {
+      if (pentry_method->empty()) continue; // e.g., no batch notify upcall (the notify methods were renamed)
       if (strncasecmp(pentry_method->fullMethodName.c_str(), entry_points_class.c_str(),
                       entry_points_class.length()) != 0) {
         auto parts = str_split(pentry_method->fullMethodName.c_str(), '/');
@@ -492,14 +498,26 @@ namespace cmd_dsp {
     }
   }
 
-  static std::vector<char> serialize_session_state_to_membuf(const sessionState &ss) {
-    std::stringstream strm(std::ios_base::in | std::ios_base::out);
-    strm << ss;
-    const auto length = strm.tellp();
-    std::vector<char> membuf(static_cast<size_t >(length));
-    strm.seekg(0, strm.beg);
-    strm.read(&membuf.front(), length);
-    return membuf; // rely on return value optimization (compiler will select move semantics)
+  bool CmdDispatchInfoProcessor::extract_method_persistent_cmd_info(jclass cmd_info_cls, jobject method_cmd_info) {
+    const auto field_id = env->GetFieldID(cmd_info_cls, "persistent", "Z");
+#ifdef NDEBUG
+    if (field_id == nullptr) throw -1;
+#else
+    assert(field_id != nullptr);
+#endif
+
+    return env->GetBooleanField(method_cmd_info, field_id) != JNI_FALSE;
+  }
+
+  bool CmdDispatchInfoProcessor::extract_method_concurrent_cmd_info(jclass cmd_info_cls, jobject method_cmd_info) {
+    const auto field_id = env->GetFieldID(cmd_info_cls, "concurrent", "Z");
+#ifdef NDEBUG
+    if (field_id == nullptr) throw -1;
+#else
+    assert(field_id != nullptr);
+#endif
+
+    return env->GetBooleanField(method_cmd_info, field_id) != JNI_FALSE;
   }
 
   static void unmap_shm_client(void *p, size_t shm_size) {
@@ -509,63 +527,54 @@ namespace cmd_dsp {
     }
   }
 
-  static std::tuple<const char*, int32_t> get_session_state_buf_info(void *shm_base) {
-    auto byte_mem_buf_pos = reinterpret_cast<const char*>(shm_base);
-    auto block_size = *reinterpret_cast<const int32_t*>(byte_mem_buf_pos);
-    byte_mem_buf_pos += sizeof(block_size) + block_size;
-    block_size = *reinterpret_cast<const int32_t*>(byte_mem_buf_pos);
-    byte_mem_buf_pos += sizeof(block_size);
-    return std::make_tuple(byte_mem_buf_pos, block_size);
+  static std::tuple<const char*, size_t> get_session_state_buf_info(void *shm_base, size_t shm_size) {
+    auto const base = reinterpret_cast<const char*>(shm_base);
+    int32_t block_size = 0;
+    if (shm_size >= sizeof(block_size)) {
+      memcpy(&block_size, base, sizeof(block_size));
+    }
+    const auto size_pos = sizeof(block_size) + static_cast<size_t>(std::max(block_size, 0));
+    if (block_size < 0 || size_pos + sizeof(block_size) > shm_size) {
+      throw ss_image::session_image_exception(format2str("shared memory \"/%s\" of size %lu holds no session image",
+                                                         progname(), shm_size));
+    }
+    memcpy(&block_size, base + size_pos, sizeof(block_size));
+    const auto image_pos = session_image_pos(size_pos + sizeof(block_size));
+    const auto image_size = std::min(static_cast<size_t>(std::max(block_size, 0)),
+                                     shm_size > image_pos ? shm_size - image_pos : 0);
+    return std::make_tuple(base + image_pos, image_size);
   }
 
-  void get_cmd_dispatch_info(sessionState &ss) {
+  SessionImage::SessionImage() {
     const auto rtn = shm::read_access(); // get client access of shared memory (throws shared_mem_exception if fails)
-    auto const shm_base = std::get<0>(rtn);
-    const auto shm_size = std::get<1>(rtn);
-    using shm_t = std::remove_pointer<decltype(shm_base)>::type;
-    auto const cleanup_shm_client = [shm_size](shm_t *p) { unmap_shm_client(p, shm_size); };
-    std::unique_ptr<shm_t, decltype(cleanup_shm_client)> sp_shm_data_tmp(shm_base, cleanup_shm_client);
+    shm_base = std::get<0>(rtn);
+    shm_size = std::get<1>(rtn);
 #ifdef _DEBUG
-    log(LL::DEBUG, "pid(%d): client shm base: %p of size %lu", getpid(), sp_shm_data_tmp.get(), shm_size);
+    log(LL::DEBUG, "pid(%d): client shm base: %p of size %lu", getpid(), shm_base, shm_size);
 #endif
-    // get the sessionState shared memory buffer
-    const auto ss_buf_info = get_session_state_buf_info(sp_shm_data_tmp.get());
+    try {
+      const auto ss_buf_info = get_session_state_buf_info(shm_base, shm_size);
+      image = ss_image::view(std::get<0>(ss_buf_info), std::get<1>(ss_buf_info));
+    } catch(...) {
+      unmap_shm_client(shm_base, shm_size);
+      throw;
+    }
+  }
 
-    // instantiate the custom streambuf with the pre-existing char buffer
-    streambufWrapper buf(std::get<0>(ss_buf_info), static_cast<size_t>(std::get<1>(ss_buf_info)));
-    // instantiate an istream for reading from the custom streambuf
-    std::istream is(&buf);
+  SessionImage::~SessionImage() {
+    try {
+      unmap_shm_client(shm_base, shm_size);
+    } catch (const shm::shared_mem_exception &ex) {
+      log(LL::WARN, "%s", ex.what());
+    }
+  }
 
-    // deserialize sessionState object from shared memory buffer
-    is >> ss;
+  void get_cmd_dispatch_info(sessionState &ss) {
+    const SessionImage shm_image;
+    shm_image.view().to_session_state(ss);
 
 #ifdef _DEBUG
     debug_dump_sessionState(ss, 'D');
 #endif
   }
-
-  std::unordered_set<std::string> get_child_processor_commands(const sessionState &ss) {
-    std::unordered_set<std::string> cmds_set(29);
-    if (!ss.spartanChildProcessorCommands.empty()) {
-      std::string cmds(ss.spartanChildProcessorCommands.c_str());
-      std::transform(cmds.begin(), cmds.end(), cmds.begin(), ::tolower);
-      auto cmds_dup = strdupa(cmds.c_str());
-      static const char *const delim = ",";
-      char *save = nullptr;
-      cmds_set.emplace(strtok_r(cmds_dup, delim, &save));
-      const char *cmd_tok = nullptr;
-      while ((cmd_tok = strtok_r(nullptr, delim, &save)) != nullptr) {
-        std::string cmd_tok_str(cmd_tok);
-        cmds_set.emplace(std::move(cmd_tok_str));
-      }
-    }
-    if (ss.spSpartanChildProcessorCommands) {
-      for(auto &methDesc : *ss.spSpartanChildProcessorCommands) {
-        std::string cmd_tok_str(methDesc.cmd_cstr());
-        std::transform(cmd_tok_str.begin(), cmd_tok_str.end(), cmd_tok_str.begin(), ::tolower);
-        cmds_set.emplace(std::move(cmd_tok_str));
-      }
-    }
-    return cmds_set;
-  }
 } // namespace cmd_dsp
@@ -20,9 +20,9 @@ limitations under the License.
 #define SPARTAN_PROCESS_CMD_DISPATCH_INFO_H
 
 #include <functional>
-#include <unordered_set>
 #include <jni.h>
 #include "shm.h"
+#include "session-image.h"
 
 // forward declarations (dependency types for method signature declarations)
 struct sessionState;
@@ -51,10 +51,27 @@ namespace cmd_dsp {
                                  const std::function<void(std::string &)> &action);
     void extract_method_jvm_optns_cmd_info(jclass cmd_info_cls, jobject method_cmd_info,
                                            const std::function<void(std::string &)> &action);
+    bool extract_method_persistent_cmd_info(jclass cmd_info_cls, jobject method_cmd_info);
+    bool extract_method_concurrent_cmd_info(jclass cmd_info_cls, jobject method_cmd_info);
   };
 
+  // read-only mapping of the supervisor's session image in shared memory - used in place for as long as
+  // this object lives (throws shared_mem_exception or session_image_exception if it can't be mapped)
+  class SessionImage {
+  private:
+    void *shm_base{nullptr};
+    size_t shm_size{0};
+    ss_image::view image;
+  public:
+    SessionImage();
+    SessionImage(const SessionImage &) = delete;
+    SessionImage& operator=(const SessionImage &) = delete;
+    ~SessionImage();
+    const ss_image::view& view() const { return image; }
+  };
+
+  // copies the session image onto ss
   void get_cmd_dispatch_info(sessionState &ss);
-  std::unordered_set<std::string> get_child_processor_commands(const sessionState &ss);
 }
 
 #endif //SPARTAN_PROCESS_CMD_DISPATCH_INFO_H
\ No newline at end of file
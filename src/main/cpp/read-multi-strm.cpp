@@ -20,6 +20,7 @@ limitations under the License.
 */
 #include <unistd.h>
 #include <cstring>
+#include <algorithm>
 #include <future>
 #include <poll.h>
 #include "log.h"
@@ -122,8 +123,49 @@ read_multi_stream& read_multi_stream::operator +=(int fd) {
   return *this;
 }
 
+read_multi_stream& read_multi_stream::operator=(read_multi_stream &&rms) noexcept {
+  fd_map = std::move(rms.fd_map);
+  std::swap(epoll_fd, rms.epoll_fd); // is closed by whichever destructs with it
+  epoll_registered_fds = std::move(rms.epoll_registered_fds);
+  always_ready_fds = std::move(rms.always_ready_fds);
+  return *this;
+}
+
 read_multi_stream::~read_multi_stream() {
   log(LL::DEBUG, "<< (%p)->%s()", this, __FUNCTION__);
+  if (epoll_fd != -1) {
+    close(epoll_fd);
+  }
+}
+
+bool read_multi_stream::remove(int fd) {
+  if (epoll_registered_fds.erase(fd) > 0) {
+    // the registration is of the open file description, which outlives this fd's stream_ctx dup
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  }
+  always_ready_fds.erase(std::remove(always_ready_fds.begin(), always_ready_fds.end(), fd), always_ready_fds.end());
+  return fd_map.erase(fd) > 0;
+}
+
+void read_multi_stream::epoll_register_fds() {
+  for(const auto &entry : fd_map) {
+    const int fd = entry.first;
+    if (epoll_registered_fds.count(fd) > 0 ||
+        std::find(always_ready_fds.begin(), always_ready_fds.end(), fd) != always_ready_fds.end()) continue;
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = fd;
+    int line_nbr = __LINE__ + 1;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+      epoll_registered_fds.insert(fd);
+    } else if (errno == EPERM) {
+      always_ready_fds.push_back(fd); // a regular file (or the like) - never blocks, so is always ready
+    } else {
+      log(LL::ERR, "%d: %s() -> epoll_ctl(fd{%d}): %s", line_nbr, __FUNCTION__, fd, strerror(errno));
+      __assert("epoll_ctl() returned catastrophic error code condition", __FILE__, line_nbr);
+    }
+  }
+  epoll_events.resize(std::max<size_t>(epoll_registered_fds.size(), 1));
 }
 
 int read_multi_stream::poll_for_io(std::vector<pollfd_result> &active_fds) {
@@ -183,4 +225,53 @@ int read_multi_stream::poll_for_io(std::vector<pollfd_result> &active_fds) {
   }
 
   return 0;
-}
\ No newline at end of file
+}
+
+int read_multi_stream::epoll_for_io(std::vector<pollfd_result> &active_fds) {
+  active_fds.clear();
+  const int time_out = 5 * 1000; // milliseconds
+
+  if (fd_map.empty()) return -1; // no file descriptors remaining to poll on
+
+  if (epoll_fd == -1) {
+    int line_nbr = __LINE__ + 1;
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+      log(LL::ERR, "%d: %s() -> epoll_create1(): %s", line_nbr, __FUNCTION__, strerror(errno));
+      __assert("epoll_create1() returned catastrophic error code condition", __FILE__, line_nbr);
+    }
+  }
+  if (fd_map.size() != epoll_registered_fds.size() + always_ready_fds.size()) {
+    epoll_register_fds(); // fds added since the last call
+  }
+
+  while(!signal_handling::interrupted()) {
+    int line_nbr = __LINE__ + 1;
+    auto ret_val = epoll_wait(epoll_fd, epoll_events.data(), static_cast<int>(epoll_events.size()),
+                              always_ready_fds.empty() ? time_out : 0);
+    if (ret_val == -1) {
+      const auto ec = errno;
+      if (ec == EINTR) {
+        return ec; // signal interruption detected so bail out immediately
+      }
+      log(LL::ERR, "%d: %s() -> epoll_wait(): %s", line_nbr, __FUNCTION__, strerror(ec));
+      __assert("epoll_wait() returned catastrophic error code condition", __FILE__, line_nbr);
+    }
+
+    for(int i = 0; i < ret_val; i++) {
+      const auto &ev = epoll_events[static_cast<size_t>(i)];
+      // the EPOLLIN, EPOLLERR and EPOLLHUP bits are those of POLLIN, POLLERR and POLLHUP
+      const auto revents = static_cast<short int>(ev.events & (EPOLLIN|EPOLLERR|EPOLLHUP));
+      active_fds.push_back({.fd = ev.data.fd, .revents = revents});
+    }
+    for(const auto fd : always_ready_fds) {
+      active_fds.push_back({.fd = fd, .revents = POLLIN});
+    }
+    if (!active_fds.empty()) {
+      logm(LL::TRACE, "Data is available now:");
+      break;
+    }
+  }
+
+  return 0;
+}
@@ -24,6 +24,8 @@ limitations under the License.
 #include <tuple>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <sys/epoll.h>
 #include "stream-ctx.h"
 
 struct react_io_ctx {
@@ -57,6 +59,12 @@ struct pollfd_result {
 class read_multi_stream final {
 private:
   std::unordered_map<int, std::shared_ptr<react_io_ctx>> fd_map{};
+  // epoll_for_io() state - the fds are registered (edge-triggered) on first use and stay registered until
+  // removed; fds that epoll refuses (regular files, /dev/null) are always ready, as poll(2) has them
+  int epoll_fd{-1};
+  std::unordered_set<int> epoll_registered_fds{};
+  std::vector<int> always_ready_fds{};
+  std::vector<epoll_event> epoll_events{};
   friend class stream_ctx;
 public:
   read_multi_stream() = default;
@@ -65,15 +73,19 @@ public:
   read_multi_stream& operator +=(std::tuple<int, int, int> &&react_fds);
   read_multi_stream& operator +=(int fd);
   read_multi_stream(read_multi_stream &&rms) noexcept { this->operator=(std::move(rms)); }
-  read_multi_stream& operator=(read_multi_stream &&rms) = default;
+  read_multi_stream& operator=(read_multi_stream &&rms) noexcept;
   ~read_multi_stream();
   int poll_for_io(std::vector<pollfd_result> &active_fds); // mutable reference to a vector of fds (returns any active)
+  // as poll_for_io(), but via epoll - an fd is reported when it becomes readable (edge-triggered), so whoever
+  // reads it must do so until it would block
+  int epoll_for_io(std::vector<pollfd_result> &active_fds);
   size_t size() const { return fd_map.size(); }
   const react_io_ctx* get_react_io_ctx(int fd) const { return lookup_react_io_ctx(fd); }
   stream_ctx* get_mutable_stream_ctx(int fd) { return lookup_mutable_stream_ctx(fd); }
   const stream_ctx* get_stream_ctx(int fd) const { return lookup_mutable_stream_ctx(fd); }
-  bool remove(int fd) { return fd_map.erase(fd) > 0; }
+  bool remove(int fd);
 private:
+  void epoll_register_fds();
   const react_io_ctx* lookup_react_io_ctx(int fd) const;
   stream_ctx* lookup_mutable_stream_ctx(int fd) const;
   void verify_added_elem(const react_io_ctx &elem, int stdout_fd, int stderr_fd, int stdin_fd);
@@ -20,9 +20,10 @@ limitations under the License.
 #include <cstring>
 #include <vector>
 #include <future>
+#include <fcntl.h>
 #include <unistd.h>
-#include <climits>
 #include <poll.h>
+#include <sys/stat.h>
 #include "read-multi-strm.h"
 #include "signal-handling.h"
 #include "format2str.h"
@@ -31,12 +32,19 @@ limitations under the License.
 
 #define USE_EXTRA_BROKEPIPE_DETECTION 0
 
+// multi_read_on_ready() is the single-threaded epoll multiplexer, else poll(2) with a std::async task per
+// ready fd (the build can choose, e.g. -DUSE_EPOLL_ECHO=0)
+#ifndef USE_EPOLL_ECHO
+#define USE_EPOLL_ECHO 1
+#endif
+
 //#undef NDEBUG // uncomment this line to enable asserts in use below
 #include <cassert>
 
 using namespace logger;
 using read_on_ready::write_result_t;
 using read_on_ready::read_multi_result_t;
+using read_on_ready::XFER;
 
 string_view read_on_ready::write_result_str(WRITE_RESULT rslt) {
   switch (rslt) {
@@ -55,24 +63,38 @@ string_view read_on_ready::write_result_str(WRITE_RESULT rslt) {
   }
 }
 
-write_result_t read_on_ready::write_to_output_stream(const pollfd_result &pollfd, FILE *const output_stream,
-                                                     ullint &n_read, ullint &n_writ)
+// the most a splice(2) call is asked to move, and the size of the buffer of a COPY transfer
+static const size_t SPLICE_LEN = 1024 * 1024;
+static const size_t IOBUF_SIZE = 128 * 1024;
+
+// splice(2) requires one end to be a pipe; of the other, pipes, regular files and sockets are spliced
+// (an fd of these that splice still refuses, e.g. an O_APPEND file, is detected on first use - see below)
+static read_on_ready::XFER transfer_of(const int in_fd, const int out_fd) {
+  struct stat in_stat{}, out_stat{};
+  if (fstat(in_fd, &in_stat) == -1 || fstat(out_fd, &out_stat) == -1) return XFER::COPY;
+  auto const is_spliceable = [](const mode_t mode) {
+    return S_ISFIFO(mode) || S_ISREG(mode) || S_ISSOCK(mode);
+  };
+  const bool is_splice = (S_ISFIFO(in_stat.st_mode) && is_spliceable(out_stat.st_mode)) ||
+                         (S_ISFIFO(out_stat.st_mode) && is_spliceable(in_stat.st_mode));
+  return is_splice ? XFER::SPLICE : XFER::COPY;
+}
+
+// waits until out_fd can be written - returns false if it already could be (the input is what blocked)
+static bool wait_writable(const int out_fd) {
+  struct pollfd pfd{ out_fd, POLLOUT, 0 };
+  if (poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLOUT) != 0) return false;
+  pfd.revents = 0;
+  poll(&pfd, 1, -1); // returns early on a signal - the caller's loop checks for interruption
+  return true;
+}
+
+write_result_t read_on_ready::write_to_output_stream(const pollfd_result &pollfd, output_stream_context_t &output_ctx,
+                                                     ullint &n_read)
 {
   static const char* const func_name = __FUNCTION__;
 
-  // POSIX API documentation (http://man7.org/linux/man-pages/man2/pipe.2.html):
-  //
-  //   If a read(2) specifies a buffer size that is smaller than
-  //   the next packet, then the requested number of bytes are
-  //   read, and the excess bytes in the packet are discarded.
-  //   Specifying a buffer size of PIPE_BUF will be sufficient to
-  //   read the largest possible packets (see the previous point).
-  //
-  std::array<char, PIPE_BUF> iobuf_array{}; // read/write buffer
-  auto const iobuf = iobuf_array.data();
-  const auto iobuf_size = iobuf_array.size();
   ullint read_total{0};
-  WRITE_RESULT wr{WR::NO_OP};
   std::string errmsg{};
   int line_nbr{};
 
@@ -80,6 +102,7 @@ write_result_t read_on_ready::write_to_output_stream(const pollfd_result &pollfd
     errmsg = format2str("line %d: %s(): failure reading pipe fd{%d}: %s", line_nbr, func_name, fd, strerror(err_no));
   };
 
+  FILE *const output_stream = output_ctx.output_stream;
   fflush(output_stream);
   line_nbr = __LINE__ + 1;
   const auto output_fd = fileno(output_stream);
@@ -88,93 +111,83 @@ write_result_t read_on_ready::write_to_output_stream(const pollfd_result &pollfd
     return std::make_tuple(pollfd.fd, WR::FAILURE, std::move(errmsg));
   }
 
-  auto const write_output = [iobuf, &read_total, &n_read, &n_writ, &line_nbr, &handle_fd_error]
-      (const int in_fd, const int out_fd, const long n) -> WRITE_RESULT
+  if (output_ctx.transfer == XFER::UNDETERMINED) {
+    output_ctx.transfer = transfer_of(pollfd.fd, output_fd);
+  }
+
+  // writes all n bytes of the io buffer to out_fd (which may be non-blocking)
+  auto const write_output = [&output_ctx, &line_nbr, &handle_fd_error](const int in_fd, const int out_fd,
+                                                                       const long n) -> WRITE_RESULT
   {
-    read_total += n;
-    n_read += n;
-    line_nbr = __LINE__ + 1;
-    const auto nw = write(out_fd, iobuf, (size_t) n);
-    fsync(out_fd);
-    if (nw > 0) {
-      n_writ += nw;
-    }
-    if (nw != n) {
-      handle_fd_error(in_fd, errno);
-      return WR::FAILURE;
+    const char *p = output_ctx.iobuf.data();
+    long remaining = n;
+    while (remaining > 0) {
+      line_nbr = __LINE__ + 1;
+      const auto nw = write(out_fd, p, (size_t) remaining);
+      if (nw == -1) {
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          wait_writable(out_fd);
+          continue;
+        }
+        handle_fd_error(in_fd, errno);
+        return WR::FAILURE;
+      }
+      p += nw;
+      remaining -= nw;
+      output_ctx.bytes_written += nw;
     }
     return WR::SUCCESS;
   };
 
-  line_nbr = __LINE__ + 1;
-  if ((pollfd.revents & (POLLERR|POLLHUP|POLLNVAL)) != 0) {
-    const auto n = read(pollfd.fd, iobuf, sizeof(ullint));
-    if (n > 0) {
-      // despite fd being indicated as being in an error condition, a read() returned some data
-      wr = write_output(pollfd.fd, output_fd, n);
-      switch (wr) {
-        // can continue
-        case WR::NO_OP:
-        case WR::SUCCESS:
-          break;
-        // can't continue
-        default:
-          return std::make_tuple(pollfd.fd, wr, std::move(errmsg));
-      }
-    } else {
-      if (n == -1) {
-        const auto err_no = errno;
-        //
-        // POSIX API documentation (http://man7.org/linux/man-pages/man2/read.2.html)
-        //
-        // EAGAIN The file descriptor fd refers to a file other than a socket
-        //        and has been marked nonblocking (O_NONBLOCK), and the read
-        //        would block.  See open(2) for further details on the
-        //        O_NONBLOCK flag.
-        //
-        // POSIX API documentation (http://man7.org/linux/man-pages/man3/errno.3.html):
-        //
-        // All the error names specified by POSIX.1 must have distinct values,
-        // with the exception of EAGAIN and EWOULDBLOCK, which may be the same.
-        //
-        // EAGAIN       Resource temporarily unavailable (may be the same
-        //              value as EWOULDBLOCK) (POSIX.1-2001).
-        //
-        // EWOULDBLOCK  Operation would block (may be same value as EAGAIN)
-        //              (POSIX.1-2001).
-        //
-        ///////////////////////////////////////////////////////////////////////////////
-        // My inference:
-        //
-        // If first read(2) attempt (made after poll(2) ready-data event)
-        // returns error condition of either EAGAIN (or EWOULDBLOCK), then
-        // indicates a broken pipe connection.
-        //
-        wr = (err_no == EAGAIN || err_no == EWOULDBLOCK) ? WR::PIPE_CONN_BROKEN : WR::FAILURE;
-        errmsg = format2str("line %d: %s(): failure reading pipe - error on: fd{%d}", line_nbr, func_name, pollfd.fd);
-      } else /* n == 0 */ {
-        wr = WR::END_OF_FILE;
-      }
-      return std::make_tuple(pollfd.fd, wr, std::move(errmsg));
-    }
-  }
-
-  // lambda that reads from specified fd device and writes (echoes) to specified output
-  // - reads from file descriptor input until it would block or is closed (or an error)
-  auto const echo = [iobuf, iobuf_size, &read_total, &line_nbr, &handle_fd_error, &write_output](
+  // reads (or splices) from the input fd and writes (echoes) to the output fd until the input would block
+  // or is closed (or an error); a poll(2) POLLHUP|POLLERR can still have data to be read, so it's the same
+  //
+  // POSIX API documentation (http://man7.org/linux/man-pages/man2/read.2.html)
+  //
+  // EAGAIN The file descriptor fd refers to a file other than a socket
+  //        and has been marked nonblocking (O_NONBLOCK), and the read
+  //        would block.  See open(2) for further details on the
+  //        O_NONBLOCK flag.
+  //
+  // If the first read(2) (or splice(2)) attempt made after a poll(2) ready-data event returns EAGAIN
+  // (or EWOULDBLOCK), then that indicates a broken pipe connection.
+  //
+  auto const echo = [&output_ctx, &read_total, &n_read, &line_nbr, &handle_fd_error, &write_output](
       const int in_fd, const int out_fd) -> WRITE_RESULT
   {
     bool sig_intr;
     while (!(sig_intr = signal_handling::interrupted())) {
-      line_nbr = __LINE__ + 1;
-      const auto n = read(in_fd, iobuf, iobuf_size);
+      long n;
+      int err_no = 0;
+      if (output_ctx.transfer == XFER::SPLICE) {
+        // the input fd is O_NONBLOCK, which makes the whole splice non-blocking - an EAGAIN can be
+        // a full output pipe rather than an empty input one
+        line_nbr = __LINE__ + 1;
+        n = splice(in_fd, nullptr, out_fd, nullptr, SPLICE_LEN, SPLICE_F_MOVE);
+        if (n == -1) {
+          err_no = errno;
+          if (err_no == EINVAL || err_no == ENOSYS) {
+            output_ctx.transfer = XFER::COPY; // the fds can't be spliced after all - copy from here on
+            continue;
+          }
+          if ((err_no == EAGAIN || err_no == EWOULDBLOCK) && wait_writable(out_fd)) continue;
+        } else if (n > 0) {
+          output_ctx.bytes_written += n;
+        }
+      } else {
+        if (output_ctx.iobuf.empty()) {
+          output_ctx.iobuf.resize(IOBUF_SIZE);
+        }
+        line_nbr = __LINE__ + 1;
+        n = read(in_fd, output_ctx.iobuf.data(), output_ctx.iobuf.size());
+        if (n == -1) {
+          err_no = errno;
+        }
+      }
       if (n == -1) {
-        const auto err_no = errno;
+        if (err_no == EINTR) continue;
         if (err_no == EAGAIN || err_no == EWOULDBLOCK) {
-          // if read(2) attempt made with zero bytes read so far,
-          // then that indicates a broken pipe connection as the
-          // poll(2) call may indicate file descriptor was ready
-          // to be read but read() call returns EAGAIN|EWOULDBLOCK
           if (read_total > 0) {
             return WR::NO_OP;
           }
@@ -184,24 +197,23 @@ write_result_t read_on_ready::write_to_output_stream(const pollfd_result &pollfd
         handle_fd_error(in_fd, err_no);
         return WR::FAILURE;
       }
-      if (n <= 0) {
-        fsync(out_fd);
+      if (n == 0) {
         return WR::END_OF_FILE;
       }
-      // is data in io buffer to be written to output
-      auto rtn = write_output(in_fd, out_fd, n);
-      switch (rtn) {
-        case WR::NO_OP:
-        case WR::SUCCESS:
-          continue;
-        default:
-          return rtn; // an error condition (or end-of-file)
+      read_total += n;
+      n_read += n;
+      if (output_ctx.transfer == XFER::COPY) {
+        // is data in io buffer to be written to output
+        const auto rtn = write_output(in_fd, out_fd, n);
+        if (rtn != WR::SUCCESS) {
+          return rtn; // an error condition
+        }
       }
     }
     return sig_intr ? WR::INTERRUPTED : WR::SUCCESS;
   };
 
-  wr = echo(pollfd.fd, output_fd); // will echo read pipe data to stdout
+  const auto wr = echo(pollfd.fd, output_fd); // will echo read pipe data to the output stream
 
   return std::make_tuple(pollfd.fd, wr, std::move(errmsg));
 }
@@ -215,8 +227,81 @@ static bool is_write_pipe_broken(const int fd) {
 }
 #endif
 
+// registers the Ctrl-Z handler (once) when the first valid stream is ready to be read
+static void register_ctrl_z_handler(bool &is_ctrl_z_registered) {
+  if (!is_ctrl_z_registered) { // a one-time-only initialization
+    is_ctrl_z_registered = true;
+    const auto curr_thrd = pthread_self();
+    signal_handling::register_ctrl_z_handler([curr_thrd](int sig) {
+      log(LL::DEBUG, "<< signal_interrupt_thread(sig: %d)", sig);
+      pthread_kill(curr_thrd, sig);
+    });
+  }
+}
+
+// acts on the outcome of a write_to_output_stream() - a can't continue condition removes the stream's
+// input and output contexts (and those of its related react-style streams)
+static void handle_write_result(write_result_t &&rtn, read_multi_stream &rms,
+                                read_on_ready::output_streams_context_map_t &output_streams_map,
+                                read_on_ready::WRITE_RESULT &wr, int &ec)
+{
+  using read_on_ready::WR;
+  const auto fd  = std::get<0>(rtn);
+  auto wr2 = std::get<1>(rtn);
+  switch (wr2) {
+    // can continue conditions
+    case WR::NO_OP:
+    case WR::SUCCESS:
+      break;
+    // can't continue conditions
+    default: {
+      const react_io_ctx* const reactIoCtx = rms.get_react_io_ctx(fd);
+      if (reactIoCtx != nullptr) {
+        std::array<int,3> fd_s{reactIoCtx->get_stdout_fd(), reactIoCtx->get_stderr_fd(), reactIoCtx->get_stdin_fd()};
+#if USE_EXTRA_BROKEPIPE_DETECTION
+        if (wr2 == WR::END_OF_FILE && fd_s[2] != -1) {
+          auto search = output_streams_map.find(fd_s[2]);
+          if (search != output_streams_map.end()) {
+            auto wrt_stream_ctx = search->second;
+            const auto out_fd = fileno(wrt_stream_ctx->output_stream);
+            if (is_write_pipe_broken(out_fd)) {
+              wr2 = WR::PIPE_CONN_BROKEN;
+            }
+          }
+        }
+#endif
+        // remove de-reference keys for react streaming output context per this file descriptor (and related fds)
+        for(const auto fd_tmp : fd_s) {
+          if (fd_tmp == -1) continue;
+          rms.remove(fd_tmp);
+          output_streams_map.erase(fd_tmp);
+        }
+      }
+      if (wr == WR::NO_OP) {
+        wr = wr2;
+      }
+      if (wr2 != WR::END_OF_FILE) {
+        ec = EXIT_FAILURE;
+        const std::string errmsg{std::move(std::get<2>(rtn))};
+        log(LL::ERR, errmsg.c_str());
+      }
+      break;
+    }
+  }
+}
+
 read_multi_result_t read_on_ready::multi_read_on_ready(bool &is_ctrl_z_registered, read_multi_stream &rms,
                                                        output_streams_context_map_t &output_streams_map)
+{
+#if USE_EPOLL_ECHO
+  return multi_read_on_ready_epoll(is_ctrl_z_registered, rms, output_streams_map);
+#else
+  return multi_read_on_ready_poll(is_ctrl_z_registered, rms, output_streams_map);
+#endif
+}
+
+read_multi_result_t read_on_ready::multi_read_on_ready_poll(bool &is_ctrl_z_registered, read_multi_stream &rms,
+                                                            output_streams_context_map_t &output_streams_map)
 {
   static const char* const func_name = __FUNCTION__;
 
@@ -235,14 +320,7 @@ read_multi_result_t read_on_ready::multi_read_on_ready(bool &is_ctrl_z_registere
       assert(prbc != nullptr); // lookup should never derefence to a null pointer
       if (prbc == nullptr) continue;
       if (prbc->is_valid_init()) {
-        if (!is_ctrl_z_registered) { // a one-time-only initialization
-          is_ctrl_z_registered = true;
-          const auto curr_thrd = pthread_self();
-          signal_handling::register_ctrl_z_handler([curr_thrd](int sig) {
-            log(LL::DEBUG, "<< signal_interrupt_thread(sig: %d)", sig);
-            pthread_kill(curr_thrd, sig);
-          });
-        }
+        register_ctrl_z_handler(is_ctrl_z_registered);
         int line_nbr = __LINE__ + 1;
         auto search = output_streams_map.find(pollfd.fd); // look up the file descriptor to find its output stream context
         if (search == output_streams_map.end()) {
@@ -258,8 +336,7 @@ read_multi_result_t read_on_ready::multi_read_on_ready(bool &is_ctrl_z_registere
                        [pollfd, output_stream_ctx]
                        {
                          ullint n_read{0};
-                         return write_to_output_stream(pollfd/*input*/, output_stream_ctx->output_stream/*output*/,
-                                                       n_read, output_stream_ctx->bytes_written);
+                         return write_to_output_stream(pollfd/*input*/, *output_stream_ctx/*output*/, n_read);
                        }));
       } else {
         // Should never reach here - indicates corrupted runtime state
@@ -275,51 +352,54 @@ read_multi_result_t read_on_ready::multi_read_on_ready(bool &is_ctrl_z_registere
     }
     // obtain results from all the async futures
     for(auto &fut : futures) {
-      auto rtn = fut.get();
-      const auto fd  = std::get<0>(rtn);
-      auto wr2 = std::get<1>(rtn);
-      switch (wr2) {
-        // can continue conditions
-        case WR::NO_OP:
-        case WR::SUCCESS:
-          break;
-        // can't continue conditions
-        default: {
-          const react_io_ctx* const reactIoCtx = rms.get_react_io_ctx(fd);
-          if (reactIoCtx != nullptr) {
-            std::array<int,3> fd_s{reactIoCtx->get_stdout_fd(), reactIoCtx->get_stderr_fd(), reactIoCtx->get_stdin_fd()};
-#if USE_EXTRA_BROKEPIPE_DETECTION
-            if (wr2 == WR::END_OF_FILE && fd_s[2] != -1) {
-              auto search = output_streams_map.find(fd_s[2]);
-              if (search != output_streams_map.end()) {
-                auto wrt_stream_ctx = search->second;
-                const auto out_fd = fileno(wrt_stream_ctx->output_stream);
-                if (is_write_pipe_broken(out_fd)) {
-                  wr2 = WR::PIPE_CONN_BROKEN;
-                }
-              }
-            }
-#endif
-            // remove de-reference keys for react streaming output context per this file descriptor (and related fds)
-            for(const auto fd_tmp : fd_s) {
-              if (fd_tmp == -1) continue;
-              rms.remove(fd_tmp);
-              output_streams_map.erase(fd_tmp);
-            }
-          }
-          if (wr == WR::NO_OP) {
-            wr = wr2;
-          }
-          if (wr2 != WR::END_OF_FILE) {
-            ec = EXIT_FAILURE;
-            const std::string errmsg{std::move(std::get<2>(rtn))};
-            log(LL::ERR, errmsg.c_str());
-          }
-          break;
+      handle_write_result(fut.get(), rms, output_streams_map, wr, ec);
+    }
+  }
+
+  return std::make_tuple(ec, wr);
+}
+
+read_multi_result_t read_on_ready::multi_read_on_ready_epoll(bool &is_ctrl_z_registered, read_multi_stream &rms,
+                                                             output_streams_context_map_t &output_streams_map)
+{
+  static const char* const func_name = __FUNCTION__;
+
+  int ec = EXIT_SUCCESS;
+  std::vector<pollfd_result> pollfds{};
+  WRITE_RESULT wr{WR::NO_OP};
+  int rc{0};
+
+  while (rms.size() > 0 && !signal_handling::interrupted() && ((rc = rms.epoll_for_io(pollfds)) == 0 || rc == EINTR)) {
+    if (rc == EINTR) continue;
+    wr = WR::NO_OP;
+    for(const auto pollfd : pollfds) {
+      auto const prbc = rms.get_mutable_stream_ctx(pollfd.fd);
+      if (prbc == nullptr) continue; // removed by the outcome of a related react-style stream this round
+      if (prbc->is_valid_init()) {
+        register_ctrl_z_handler(is_ctrl_z_registered);
+        int line_nbr = __LINE__ + 1;
+        auto search = output_streams_map.find(pollfd.fd); // look up the file descriptor to find its output stream context
+        if (search == output_streams_map.end()) {
+          log(LL::WARN, "line %d: %s(): ready-to-read file descriptor failed to de-ref an output context - skipping",
+              line_nbr, func_name);
+          continue;
         }
+        // the write to the output stream context is done right here, on this thread - it reads the fd until it
+        // would block, as its edge-triggered registration requires
+        ullint n_read{0};
+        handle_write_result(write_to_output_stream(pollfd/*input*/, *search->second/*output*/, n_read),
+                            rms, output_streams_map, wr, ec);
+      } else {
+        // Should never reach here - indicates corrupted runtime state
+        rms.remove(pollfd.fd); // input context
+        output_streams_map.erase(pollfd.fd); // output context
+        log(LL::FATAL, "line %d: %s(): stream_ctx object initialization failure per fd{%d}",
+            __LINE__, func_name, pollfd.fd);
+        rc = EXIT_FAILURE;
+        break;
       }
     }
   }
 
   return std::make_tuple(ec, wr);
-}
\ No newline at end of file
+}
@@ -23,6 +23,7 @@ limitations under the License.
 #include <tuple>
 #include <unordered_map>
 #include <memory>
+#include <vector>
 #include "string-view.h"
 
 struct pollfd_result;
@@ -32,6 +33,9 @@ using bpstd::string_view;
 namespace read_on_ready {
 
   using WR = enum class WRITE_RESULT : char { NO_OP = 0, SUCCESS, FAILURE, INTERRUPTED, END_OF_FILE, PIPE_CONN_BROKEN };
+  // how input is moved to an output stream - splice(2) in the kernel when one end is a pipe (and the other
+  // a pipe, file or socket), else copied through the output stream context's buffer
+  using XFER = enum class TRANSFER : char { UNDETERMINED = 0, SPLICE, COPY };
   using write_result_t = std::tuple<int, WRITE_RESULT, std::string>;
   using read_multi_result_t = std::tuple<int, WRITE_RESULT>;
   using output_stream_context_t = struct output_stream_context;
@@ -40,14 +44,22 @@ namespace read_on_ready {
 
   string_view write_result_str(WRITE_RESULT rslt);
 
-  write_result_t write_to_output_stream(const pollfd_result &pollfd, FILE *const output_stream,
-                                        ullint &n_read, ullint &n_writ);
+  write_result_t write_to_output_stream(const pollfd_result &pollfd, output_stream_context_t &output_ctx,
+                                        ullint &n_read);
   read_multi_result_t multi_read_on_ready(bool &is_ctrl_z_registered, read_multi_stream &rms,
                                           output_streams_context_map_t &output_streams_map);
+  // the implementations that multi_read_on_ready() chooses between at build time (USE_EPOLL_ECHO): poll(2)
+  // with a std::async task per ready fd, or epoll with the reads done inline on the calling thread
+  read_multi_result_t multi_read_on_ready_poll(bool &is_ctrl_z_registered, read_multi_stream &rms,
+                                               output_streams_context_map_t &output_streams_map);
+  read_multi_result_t multi_read_on_ready_epoll(bool &is_ctrl_z_registered, read_multi_stream &rms,
+                                                output_streams_context_map_t &output_streams_map);
 
   struct output_stream_context {
     FILE *const output_stream{nullptr};
     ullint bytes_written{0};
+    XFER transfer{XFER::UNDETERMINED};
+    std::vector<char> iobuf{}; // allocated on first use by a COPY transfer, then reused
     explicit output_stream_context(FILE *stream) noexcept : output_stream{stream} {}
     output_stream_context() = delete;
     output_stream_context(output_stream_context &&) = delete;
@@ -20,8 +20,14 @@ limitations under the License.
 #include <mqueue.h>
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unistd.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include "log.h"
+#include "msg-ring.h"
+#include "argv-frame.h"
 #include "send-mq-msg.h"
 
 //#undef NDEBUG // uncomment this line to enable asserts in use below
@@ -78,21 +84,56 @@ namespace send_mq_msg {
   }
 #endif
 
+  // descriptors of the queues that are kept open (see keep_open())
+  static std::mutex s_kept_open_mtx;
+  static std::unordered_map<std::string, mqd_t> s_kept_open;
+
+  void keep_open(string_view const queue_name) {
+    static std::once_flag s_atfork_once;
+    std::call_once(s_atfork_once, [] {
+      // a child process forked while another thread holds the lock would otherwise inherit it locked
+      pthread_atfork([] { s_kept_open_mtx.lock(); }, [] { s_kept_open_mtx.unlock(); },
+                     [] { s_kept_open_mtx.unlock(); });
+    });
+    std::lock_guard<std::mutex> lk(s_kept_open_mtx);
+    s_kept_open.emplace(std::string(queue_name.c_str(), queue_name.size()), (mqd_t) -1); // opened on first use
+  }
+
+  static mqd_t find_kept_open(string_view const queue_name) {
+    std::lock_guard<std::mutex> lk(s_kept_open_mtx);
+    if (s_kept_open.empty()) return -1;
+    auto const it = s_kept_open.find(std::string(queue_name.c_str(), queue_name.size()));
+    if (it == s_kept_open.end()) return -1;
+    if (it->second == -1) {
+      // the queue may not have been created yet - if so, is tried again on the next send
+      it->second = send_mq_msg::mq_open_ex(queue_name.c_str(), O_WRONLY, 0662, nullptr);
+    }
+    return it->second;
+  }
+
   /**
    * The core function for sending a message to a specified mq queue; does appropriate
    * return code error checking, prints errors to stderr output if detected, returns
    * EXIT_SUCCESS on success or otherwise EXIT_FAILURE.
    *
+   * A message larger than the queue's message size is placed in the queue's msg ring
+   * (shared memory) and a descriptor of it is sent in its stead.
+   *
    * @param msg message text to be sent
    * @param queue_name name of target queue to publish to
+   * @param msg_prio priority class of the message
    * @return a result of zero indicates message was successfully published to target queue
    */
-  int send_mq_msg(string_view const msg, string_view const queue_name) {
-    log(LL::DEBUG, "%s() called:\n\tmsg: %s\n\tque: %s", __func__, msg.c_str(), queue_name.c_str());
+  int send_mq_msg(string_view const msg, string_view const queue_name, const unsigned msg_prio) {
+    log(LL::DEBUG, "%s() called:\n\tmsg: %s\n\tque: %s", __func__,
+        argv_frame::is_frame(msg) ? "<argv frame>" : msg.c_str(), queue_name.c_str());
+    const mqd_t kept_mqd = find_kept_open(queue_name);
+    const bool is_kept_open = kept_mqd != -1;
     struct {
       const mqd_t mqd;
     }
-        wrp_mqd = { send_mq_msg::mq_open_ex(queue_name.c_str(), O_WRONLY, 0662, nullptr) };
+        wrp_mqd = { is_kept_open ? kept_mqd
+                                 : send_mq_msg::mq_open_ex(queue_name.c_str(), O_WRONLY, 0662, nullptr) };
     using wrp_mqd_t = decltype(wrp_mqd);
     if (wrp_mqd.mqd == -1) {
       const auto rc = errno;
@@ -104,13 +145,46 @@ namespace send_mq_msg {
 #endif
       return EXIT_FAILURE;
     }
-    auto const close_mqd = [](wrp_mqd_t *p) {
-      if (p != nullptr) {
+    auto const close_mqd = [is_kept_open](wrp_mqd_t *p) {
+      if (p != nullptr && !is_kept_open) {
         mq_close(p->mqd);
       }
     };
     std::unique_ptr<decltype(wrp_mqd), decltype(close_mqd)> mqd_sp(&wrp_mqd, close_mqd);
-    if (mq_send(mqd_sp->mqd, msg.c_str(), msg.size(), 0) != 0) {
+    mq_attr attr{};
+    if (mq_getattr(mqd_sp->mqd, &attr) == 0 && static_cast<long>(msg.size()) > attr.mq_msgsize) {
+      // too large for the mq queue - the message body goes into the queue's msg ring, its descriptor into the queue
+      auto const msg_ring_sp = msg_ring::MsgRing::open(queue_name.c_str());
+      if (!msg_ring_sp) {
+        log(LL::ERR, "message of %lu bytes exceeds the %ld bytes message size of queue \"%s\" (which has no msg ring)",
+            msg.size(), attr.mq_msgsize, queue_name.c_str());
+        return EXIT_FAILURE;
+      }
+      if (msg.size() > msg_ring_sp->max_msg_size()) {
+        log(LL::ERR, "message of %lu bytes exceeds the %lu bytes maximum of the msg ring of queue \"%s\"",
+            msg.size(), msg_ring_sp->max_msg_size(), queue_name.c_str());
+        return EXIT_FAILURE;
+      }
+      // a full ring is waited on for a while - much as mq_send() blocks on a full mq queue
+      static const int ring_full_wait_ms = 5000;
+      std::string descriptor = msg_ring_sp->post(msg);
+      for (int waited_ms = 0; descriptor.empty() && waited_ms < ring_full_wait_ms; waited_ms++) {
+        usleep(1000);
+        descriptor = msg_ring_sp->post(msg);
+      }
+      if (descriptor.empty()) {
+        log(LL::ERR, "msg ring of queue \"%s\" has had no room for a message of %lu bytes for %d ms",
+            queue_name.c_str(), msg.size(), ring_full_wait_ms);
+        return EXIT_FAILURE;
+      }
+      if (mq_send(mqd_sp->mqd, descriptor.c_str(), descriptor.size(), msg_prio) != 0) {
+        log(LL::ERR, "mq_send() on queue \"%s\" failed: %s", queue_name.c_str(), strerror(errno));
+        msg_ring_sp->abandon(descriptor);
+        return EXIT_FAILURE;
+      }
+      return EXIT_SUCCESS;
+    }
+    if (mq_send(mqd_sp->mqd, msg.c_str(), msg.size(), msg_prio) != 0) {
       log(LL::ERR, "mq_send() on queue \"%s\" failed: %s", queue_name.c_str(), strerror(errno));
       return EXIT_FAILURE;
     }
@@ -118,7 +192,7 @@ namespace send_mq_msg {
   }
 
   /**
-   * Put the argv args into a flattened string - double quote each arg then send
+   * Put the argv args into a binary argv frame (see argv-frame.h) then send it
    * as a message to a target queue (supervisor or child process launcher).
    *
    * The extended_invoke_cmd parameter becomes the second argv argument (index zero).
@@ -129,9 +203,9 @@ namespace send_mq_msg {
    * @param argv array of string arguments - the last entry in the array is a null entry, indexed directly by argc
    * @param extended_invoke_cmd a command option that informs (true or false) if is an extended style of invoke command
    * @param uds_socket_name name of the unix datagram to be used to marshal anonymous pipe(s) back to the caller
-   * @param queue_name name of the message queue to publish flattened string to (supervisor or child)
+   * @param queue_name name of the message queue to publish the argv frame to (supervisor or child)
    * @param filter a call-back that can filter out any command line arguments that should not be present
-   * @return a result of zero indicates the flattened string was successfully published to the named queue
+   * @return a result of zero indicates the argv frame was successfully published to the named queue
    */
   int send_flattened_argv_mq_msg(int argc, char **argv, string_view const extended_invoke_cmd,
                                  string_view const uds_socket_name, string_view const queue_name,
@@ -152,45 +226,17 @@ namespace send_mq_msg {
 
     filter(argc, argv_dup); // invoke callback filter to remove unwanted argv arguments
 
-    // calculate a buffer to hold the flattened out string of argv arguments
-    const auto quote_overhead = strlen("\"\" ");
-    static const auto quote_ch = '"';
-    static const auto space_ch = ' ';
-    static const auto null_ch = '\0';
-    auto const argv_sizes = (size_t*) alloca(argc * sizeof(size_t));
-    argv_sizes[0] = extended_invoke_cmd.size();
-    argv_sizes[1] = uds_socket_name.size();
-    size_t buf_size = (argv_sizes[0] + argv_sizes[1] + quote_overhead * 2);
-    for (int i = 2; i < argc; i++) {
-      const auto arg_str_len = argv_sizes[i] = strlen(argv_dup[i]);
-      buf_size += (arg_str_len + quote_overhead);
-    }
+    // encode the argv arguments as a binary argv frame - each argument is length prefixed, so it
+    // goes across as is (no quoting) and the receiver doesn't have to re-tokenize a command line
+    const auto frame = argv_frame::encode(argc, argv_dup);
 
-    // stack allocate buffer for holding the flattened out string of argv arguments
-    auto const buf = (char*) alloca(++buf_size);
-    buf[0] = null_ch;  // null terminate buffer starting out as an empty C string
-    auto bufpos = buf; // initialize buf ptr to be used for pointer arithmetic
-
-    // now run through the argv_dup array, copy each arg into string buffer and put
-    // double quotes around it; a space character delimiter separates each argument
-    size_t sum = 0;
-    for (int i = 0; i < argc; i++) {
-      const auto n = argv_sizes[i];
-      if (n == 0) continue; // skip empty string argv arguments
-      assert(buf_size >= (sum + n + quote_overhead));
-      *bufpos++ = quote_ch;
-      strncpy(bufpos, argv_dup[i], n);
-      bufpos += n;
-      *bufpos++ = quote_ch;
-      *bufpos++ = space_ch;
-      sum += (n + quote_overhead);
+    if (is_debug_level() || is_trace_level()) {
+      argv_frame::frame_t decoded;
+      argv_frame::decode(frame, decoded);
+      log(LL::DEBUG, "%s(): inform service at queue \'%s\' to process:\n\t\'%s\'", __func__, queue_name.c_str(),
+          argv_frame::to_cmd_line(decoded).c_str());
     }
-    *(--bufpos) = null_ch; // replace last space char with null C string termination character
-    assert((bufpos - buf) == static_cast<long int>(sum - 1));
-    assert(buf_size >= sum);
-
-    log(LL::DEBUG, "%s(): inform service at queue \'%s\' to process:\n\t\'%s\'", __func__, queue_name.c_str(), buf);
-    // now send the string buffer to the parent supervisor process
-    return send_mq_msg::send_mq_msg({buf, sum - 1}, queue_name);
+    // now send the argv frame to the parent supervisor process
+    return send_mq_msg::send_mq_msg({frame.data(), frame.size()}, queue_name);
   }
 } // namespace send_mq_msg
\ No newline at end of file
@@ -26,6 +26,13 @@ namespace send_mq_msg {
 
   using bpstd::string_view;
 
+  // the first argument of a flattened argv message - suffixed with =true or =false
+  static const string_view EXTENDED_INVOKE_CMD{ "--EXTENDED_INVOKE" };
+
+  // mq message priority classes - mq_receive() yields the messages of a higher priority first, so
+  // control plane messages (stop, status, ...) don't wait behind a backlog of command invocations
+  enum MSG_PRIO : unsigned { PRIO_COMMAND = 0, PRIO_NOTIFY = 1, PRIO_CONTROL = 2 };
+
   /**
    * Wraps call to OS API of mq_open() - sets umask prior to call and then restores umask.
    *
@@ -54,16 +61,30 @@ namespace send_mq_msg {
    * return code error checking, prints errors to stderr output if detected, returns
    * EXIT_SUCCESS on success or otherwise EXIT_FAILURE.
    *
+   * A message larger than the queue's message size is placed in the queue's msg ring
+   * (shared memory) and a descriptor of it is sent in its stead.
+   *
    * @param msg message text to be sent
    * @param queue_name name of target queue to publish to
+   * @param msg_prio priority class of the message
    * @return a result of zero indicates message was successfully published to target queue
    */
-  int send_mq_msg(string_view const msg, string_view const queue_name);
+  int send_mq_msg(string_view const msg, string_view const queue_name, const unsigned msg_prio = PRIO_COMMAND);
+
+  /**
+   * Has send_mq_msg() keep the descriptor of the named queue open for the remainder of the
+   * process (and of the child processes it forks) instead of opening and closing the queue
+   * per message sent. Only for queues that outlive the process - a queue that is unlinked
+   * and created anew would not be seen.
+   *
+   * @param queue_name name of the queue to keep open
+   */
+  void keep_open(string_view const queue_name);
 
   typedef std::function<void(int&,char*[])> str_array_filter_cb_t;
 
   /**
-   * Put the argv args into a flattened string - double quote each arg then send
+   * Put the argv args into a binary argv frame (see argv-frame.h) then send it
    * as a message to a target queue (supervisor or child process launcher).
    *
    * The extended_invoke_cmd parameter becomes the second argv argument (index zero).
@@ -74,9 +95,9 @@ namespace send_mq_msg {
    * @param argv array of string arguments - the last entry in the array is a null entry, indexed directly by argc
    * @param extended_invoke_cmd a command option that informs (true or false) if is an extended style of invoke command
    * @param uds_socket_name name of the unix datagram to be used to marshal anonymous pipe(s) back to the caller
-   * @param queue_name name of the message queue to publish flattened string to (supervisor or child)
+   * @param queue_name name of the message queue to publish the argv frame to (supervisor or child)
    * @param filter a call-back that can filter out any command line arguments that should not be present
-   * @return a result of zero indicates the flattened string was successfully published to the named queue
+   * @return a result of zero indicates the argv frame was successfully published to the named queue
    */
   int send_flattened_argv_mq_msg(int argc, char **argv, string_view const extended_invoke_cmd,
                                  string_view const uds_socket_name, string_view const queue_name,
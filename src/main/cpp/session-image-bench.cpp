@@ -0,0 +1,157 @@
+/* session-image-bench.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Microbenchmark of a client's time-to-first-dispatch - what the spartan client does with the supervisor's
+// session state before it posts a command: its logging level, whether the command is a child processor
+// command, and the supervisor pid. Compares the iostream text serialization (istream >> sessionState and
+// the child command set) with the binary session image used in place, and with the image copied onto a
+// sessionState (as a child process does). The session state is synthetic - commands, system properties
+// and a class path of the given sizes - and is read from memory, so the shm_open()/mmap() that both pay
+// is left out.
+//
+// usage: session-image-bench [iterations [commands [system-properties]]]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "log.h"
+#include "session-state.h"
+#include "session-image.h"
+#include "streambuf-wrapper.h"
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static void make_session_state(sessionState &ss, const int cmds, const int props) {
+  ss.supervisor_pid = 4242;
+  ss.child_process_max_count = 32;
+  ss.spartanLoggingLevel = "INFO";
+  ss.jvmlib_path = "/usr/lib/jvm/java-8-openjdk/jre/lib/amd64/server/libjvm.so";
+  ss.spartanMainEntryPoint = methodDescriptor("spartan_test/App/main", "([Ljava/lang/String;)V", true, WM::MAIN);
+  ss.spartanChildProcessorEntryPoint = methodDescriptor("spartan/SpartanBase/childProcessorMain",
+                                                        "([Ljava/lang/String;)V", true, WM::CHILD_DO_CMD);
+  ss.spartanChildProcessorCommands = "cfg_cmd1,cfg_cmd2";
+  ss.spSpartanSupervisorCommands = std::make_shared<std::vector<methodDescriptorCmd>>();
+  ss.spSpartanChildProcessorCommands = std::make_shared<std::vector<methodDescriptorCmd>>();
+  for (int i = 0; i < cmds; i++) {
+    const auto n = std::to_string(i);
+    ss.spSpartanSupervisorCommands->emplace_back("spartan_test/App/supervisorCmd" + n,
+                                                 "([Ljava/lang/String;Ljava/io/PrintStream;)V", "SUPERVISOR_CMD" + n,
+                                                 (i % 2) == 0, false, WM::SUPERVISOR_DO_CMD);
+    ss.spSpartanChildProcessorCommands->emplace_back("spartan_test/App/childCmd" + n,
+                                                     "([Ljava/lang/String;Ljava/io/PrintStream;)V", "CHILD_CMD" + n,
+                                                     std::string("-Xmx" + n + "m"), (i % 3) == 0, true,
+                                                     WM::CHILD_DO_CMD);
+  }
+  ss.spSerializedSystemProperties = std::make_shared<std::vector<std::string>>();
+  for (int i = 0; i < props; i++) {
+    ss.spSerializedSystemProperties->push_back("property.name." + std::to_string(i) + "=some property value");
+    if (!ss.systemClassPath.empty()) ss.systemClassPath += ':';
+    ss.systemClassPath += "/opt/app/lib/library-" + std::to_string(i) + ".jar";
+  }
+}
+
+// the child command set that the client built from the text session state (before the session image and the
+// command index replaced it) - the baseline being measured
+static std::unordered_set<std::string> get_child_processor_commands(const sessionState &ss) {
+  std::unordered_set<std::string> cmds_set(29);
+  if (!ss.spartanChildProcessorCommands.empty()) {
+    std::string cmds(ss.spartanChildProcessorCommands.c_str());
+    std::transform(cmds.begin(), cmds.end(), cmds.begin(), ::tolower);
+    auto cmds_dup = strdupa(cmds.c_str());
+    static const char *const delim = ",";
+    char *save = nullptr;
+    cmds_set.emplace(strtok_r(cmds_dup, delim, &save));
+    const char *cmd_tok = nullptr;
+    while ((cmd_tok = strtok_r(nullptr, delim, &save)) != nullptr) {
+      std::string cmd_tok_str(cmd_tok);
+      cmds_set.emplace(std::move(cmd_tok_str));
+    }
+  }
+  if (ss.spSpartanChildProcessorCommands) {
+    for(auto &methDesc : *ss.spSpartanChildProcessorCommands) {
+      std::string cmd_tok_str(methDesc.cmd_cstr());
+      std::transform(cmd_tok_str.begin(), cmd_tok_str.end(), cmd_tok_str.begin(), ::tolower);
+      cmds_set.emplace(std::move(cmd_tok_str));
+    }
+  }
+  return cmds_set;
+}
+
+template<typename F>
+static bool run(const char *name, const int iterations, F dispatch) {
+  const auto start_ns = now_ns();
+  for (int i = 0; i < iterations; i++) {
+    if (!dispatch()) {
+      printf("%s: dispatch lookup failed\n", name);
+      return false;
+    }
+  }
+  const auto elapsed_ns = now_ns() - start_ns;
+  printf("%-24s %10.2f us/dispatch\n", name, static_cast<double>(elapsed_ns) / iterations / 1e3);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("session-image-bench");
+  const int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+  const int cmds = argc > 2 ? atoi(argv[2]) : 20;
+  const int props = argc > 3 ? atoi(argv[3]) : 60;
+
+  sessionState ss;
+  make_session_state(ss, cmds, props);
+  const std::string cmd = "child_cmd" + std::to_string(cmds / 2);
+
+  std::stringstream strm;
+  strm << ss;
+  const std::string text = strm.str();
+  const auto image = ss_image::build(ss);
+  printf("%d supervisor and %d child commands, %d system properties: text %lu bytes, image %lu bytes\n",
+         cmds, cmds, props, text.size(), image.size());
+
+  const bool ok =
+      run("text (istream >>)", iterations, [&text, &cmd]() -> bool {
+        streambufWrapper buf(text.data(), text.size());
+        std::istream is(&buf);
+        sessionState shm_session;
+        is >> shm_session;
+        const auto cmds_set = get_child_processor_commands(shm_session);
+        return cmds_set.count(cmd) > 0 && shm_session.supervisor_pid != 0 && !shm_session.spartanLoggingLevel.empty();
+      }) &&
+      run("image (in place)", iterations, [&image, &cmd]() -> bool {
+        const ss_image::view ss_img(image.data(), image.size());
+        return ss_img.is_child_processor_command({cmd.c_str(), cmd.size()}) && ss_img.supervisor_pid() != 0 &&
+               !ss_img.logging_level().empty();
+      }) &&
+      run("image to sessionState", iterations, [&image, &cmd]() -> bool {
+        const ss_image::view ss_img(image.data(), image.size());
+        sessionState shm_session;
+        ss_img.to_session_state(shm_session);
+        return ss_img.find_child_cmd({cmd.c_str(), cmd.size()}) != nullptr && shm_session.supervisor_pid != 0;
+      });
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
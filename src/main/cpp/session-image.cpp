@@ -0,0 +1,432 @@
+/* session-image.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include "format2str.h"
+#include "log.h"
+#include "session-state.h"
+#include "session-image.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace ss_image {
+
+  static const char MAGIC[8] = { '\0', 'S', 'P', 'S', 'S', 'I', 'M', 'G' };
+  // the checksum covers everything that follows it
+  static const size_t CHECKSUM_END = offsetof(header_t, checksum) + sizeof(header_t::checksum);
+
+  static_assert(sizeof(header_t) % 8 == 0, "header_t is expected to keep the arrays that follow it aligned");
+  static_assert(sizeof(method_rec_t) % 4 == 0, "method_rec_t is expected to keep the arrays that follow it aligned");
+
+  // FNV-1a taken a 32 bit word at a time (the image size is a multiple of 4 bytes)
+  static uint32_t checksum_of(const char *p, size_t n) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i + sizeof(uint32_t) <= n; i += sizeof(uint32_t)) {
+      uint32_t word;
+      memcpy(&word, p + i, sizeof(word));
+      hash = (hash ^ word) * 16777619u;
+    }
+    return hash;
+  }
+
+  static inline size_t align4(size_t n) { return (n + 3) & ~static_cast<size_t>(3); }
+
+  static std::string to_lower(const char *str) {
+    std::string lc(str);
+    std::transform(lc.begin(), lc.end(), lc.begin(), ::tolower);
+    return lc;
+  }
+
+  static std::string to_string(string_view const sv) { return std::string(sv.data(), sv.size()); }
+
+  // interns the strings of an image into its string table, which is placed at strings_offset
+  class string_table_t {
+  private:
+    const size_t strings_offset;
+    std::vector<char> strtab;
+    std::unordered_map<std::string, str_ref_t> interned;
+  public:
+    explicit string_table_t(size_t strings_offset) : strings_offset(strings_offset) {}
+    str_ref_t intern(const std::string &str) {
+      if (str.empty()) return 0;
+      auto const it = interned.find(str);
+      if (it != interned.end()) return it->second;
+      auto const ref = static_cast<str_ref_t>(strings_offset + strtab.size());
+      const auto len = static_cast<uint32_t>(str.size());
+      const auto pos = strtab.size();
+      strtab.resize(align4(pos + sizeof(len) + str.size() + 1), '\0');
+      memcpy(&strtab[pos], &len, sizeof(len));
+      memcpy(&strtab[pos + sizeof(len)], str.data(), str.size());
+      interned.emplace(str, ref);
+      return ref;
+    }
+    str_ref_t intern(const char *str) { return *str == '\0' ? 0 : intern(std::string(str)); }
+    const std::vector<char>& table() const { return strtab; }
+  };
+
+  static method_rec_t make_method_rec(string_table_t &strs, const methodDescriptorBase &md, bool is_concurrent) {
+    method_rec_t rec{};
+    rec.full_method_name = strs.intern(md.c_str());
+    rec.descriptor = strs.intern(md.desc_str());
+    rec.command = strs.intern(md.cmd_cstr());
+    rec.jvm_optns = strs.intern(md.jvm_optns_str());
+    rec.which_method = static_cast<int16_t>(md.which_method());
+    rec.flags = static_cast<uint8_t>((md.isStatic() ? STATIC_FLAG : 0) | (md.is_persistent() ? PERSISTENT_FLAG : 0) |
+                                     (is_concurrent ? CONCURRENT_FLAG : 0));
+    return rec;
+  }
+
+  std::vector<char> build(const sessionState &ss) {
+    static const std::vector<methodDescriptorCmd> no_cmds;
+    static const std::vector<std::string> no_strs;
+    const auto &supervisor_cmds = ss.spSpartanSupervisorCommands ? *ss.spSpartanSupervisorCommands : no_cmds;
+    const auto &child_cmds = ss.spSpartanChildProcessorCommands ? *ss.spSpartanChildProcessorCommands : no_cmds;
+    const auto &sys_props = ss.spSerializedSystemProperties ? *ss.spSerializedSystemProperties : no_strs;
+
+    // the names a client checks a command against - config.ini ChildProcessorCommands plus the annotated ones
+    std::set<std::string> child_cmd_names;
+    {
+      const auto cmds = to_lower(ss.spartanChildProcessorCommands.c_str());
+      size_t pos = 0;
+      while (pos <= cmds.size()) {
+        auto end = cmds.find(',', pos);
+        if (end == std::string::npos) end = cmds.size();
+        if (end > pos) {
+          child_cmd_names.emplace(cmds.substr(pos, end - pos));
+        }
+        pos = end + 1;
+      }
+      for (const auto &cmd : child_cmds) {
+        if (!cmd.cmd_str().empty()) {
+          child_cmd_names.emplace(to_lower(cmd.cmd_cstr()));
+        }
+      }
+    }
+
+    // the perfect hash indexes of the command tables - built here, once, for every reader of the image
+    auto const index_of = [](const std::vector<string_view> &names) -> cmd_index::table_t {
+      cmd_index::table_t table;
+      cmd_index::build(names, table); // left empty if it fails - readers then scan
+      return table;
+    };
+    auto const cmd_names_of = [](const std::vector<methodDescriptorCmd> &cmds) -> std::vector<string_view> {
+      std::vector<string_view> names;
+      names.reserve(cmds.size());
+      for (const auto &cmd : cmds) {
+        names.emplace_back(cmd.cmd_str().data(), cmd.cmd_str().size());
+      }
+      return names;
+    };
+    const auto supervisor_cmd_index = index_of(cmd_names_of(supervisor_cmds));
+    const auto child_cmd_index = index_of(cmd_names_of(child_cmds));
+    const auto child_cmd_names_index = index_of([&child_cmd_names]() {
+      std::vector<string_view> names;
+      names.reserve(child_cmd_names.size());
+      for (const auto &name : child_cmd_names) {
+        names.emplace_back(name.data(), name.size());
+      }
+      return names;
+    }());
+
+    header_t hdr{};
+    memcpy(hdr.magic, MAGIC, sizeof(MAGIC));
+    hdr.version = VERSION;
+    hdr.header_size = static_cast<uint16_t>(sizeof(header_t));
+    size_t offset = sizeof(header_t);
+    auto const place = [&offset](array_ref_t &arr, size_t count, size_t elem_size) {
+      arr.offset = static_cast<uint32_t>(offset);
+      arr.count = static_cast<uint32_t>(count);
+      offset += count * elem_size;
+    };
+    place(hdr.supervisor_cmds, supervisor_cmds.size(), sizeof(method_rec_t));
+    place(hdr.child_cmds, child_cmds.size(), sizeof(method_rec_t));
+    place(hdr.system_properties, sys_props.size(), sizeof(str_ref_t));
+    place(hdr.child_cmd_names, child_cmd_names.size(), sizeof(str_ref_t));
+    const std::pair<index_ref_t*, const cmd_index::table_t*> indexes[] = {
+        { &hdr.supervisor_cmd_index, &supervisor_cmd_index }, { &hdr.child_cmd_index, &child_cmd_index },
+        { &hdr.child_cmd_names_index, &child_cmd_names_index } };
+    for (const auto &idx : indexes) {
+      place(idx.first->seeds, idx.second->seeds.size(), sizeof(uint32_t));
+      place(idx.first->slots, idx.second->slots.size(), sizeof(uint32_t));
+    }
+
+    string_table_t strs(offset);
+    hdr.supervisor_pid = ss.supervisor_pid;
+    hdr.child_process_max_count = ss.child_process_max_count;
+    hdr.warm_pool_size = ss.warm_pool_size;
+    hdr.persistent_worker_count = ss.persistent_worker_count;
+    hdr.persistent_worker_max_requests = ss.persistent_worker_max_requests;
+    hdr.persistent_worker_max_heap_mb = ss.persistent_worker_max_heap_mb;
+    const methodDescriptor * const entry_points[ENTRY_POINTS_COUNT] = {
+        &ss.spartanMainEntryPoint, &ss.spartanGetStatusEntryPoint, &ss.spartanSupervisorShutdownEntryPoint,
+        &ss.spartanChildNotifyEntryPoint, &ss.spartanChildCompletionNotifyEntryPoint,
+        &ss.spartanChildBatchNotifyEntryPoint, &ss.spartanSupervisorEntryPoint, &ss.spartanChildProcessorEntryPoint };
+    for (int i = 0; i < ENTRY_POINTS_COUNT; i++) {
+      hdr.entry_points[i] = make_method_rec(strs, *entry_points[i], false);
+    }
+    hdr.child_processor_commands = strs.intern(ss.spartanChildProcessorCommands);
+    hdr.persistent_child_commands = strs.intern(ss.persistentChildCommands);
+    hdr.system_class_path = strs.intern(ss.systemClassPath);
+    hdr.logging_level = strs.intern(ss.spartanLoggingLevel);
+    hdr.jvmlib_path = strs.intern(ss.jvmlib_path);
+
+    std::vector<char> image(offset, '\0');
+    auto const put = [&image](size_t pos, const void *src, size_t n) { memcpy(&image[pos], src, n); };
+    size_t pos = hdr.supervisor_cmds.offset;
+    for (const auto &cmd : supervisor_cmds) {
+      const auto rec = make_method_rec(strs, cmd, cmd.is_concurrent());
+      put(pos, &rec, sizeof(rec));
+      pos += sizeof(rec);
+    }
+    for (const auto &cmd : child_cmds) {
+      const auto rec = make_method_rec(strs, cmd, cmd.is_concurrent());
+      put(pos, &rec, sizeof(rec));
+      pos += sizeof(rec);
+    }
+    for (const auto &prop : sys_props) {
+      const auto ref = strs.intern(prop);
+      put(pos, &ref, sizeof(ref));
+      pos += sizeof(ref);
+    }
+    for (const auto &name : child_cmd_names) {
+      const auto ref = strs.intern(name);
+      put(pos, &ref, sizeof(ref));
+      pos += sizeof(ref);
+    }
+    for (const auto &idx : indexes) {
+      for (const auto *arr : { &idx.second->seeds, &idx.second->slots }) {
+        if (!arr->empty()) {
+          put(pos, arr->data(), arr->size() * sizeof(uint32_t));
+          pos += arr->size() * sizeof(uint32_t);
+        }
+      }
+    }
+    assert(pos == offset);
+
+    const auto &strtab = strs.table();
+    image.insert(image.end(), strtab.begin(), strtab.end());
+    if (image.size() > UINT32_MAX) {
+      throw session_image_exception(format2str("session image of %lu bytes exceeds the 4 GiB limit", image.size()));
+    }
+    hdr.strings.offset = static_cast<uint32_t>(offset);
+    hdr.strings.count = static_cast<uint32_t>(strtab.size());
+    hdr.image_size = static_cast<uint32_t>(image.size());
+    assert(image.size() % 4 == 0);
+    put(0, &hdr, sizeof(hdr));
+    hdr.checksum = checksum_of(&image[CHECKSUM_END], image.size() - CHECKSUM_END);
+    put(0, &hdr, sizeof(hdr));
+    log(LL::DEBUG, "%s(): session image of %lu bytes: %lu supervisor commands, %lu child commands, %lu strings bytes",
+        __func__, image.size(), supervisor_cmds.size(), child_cmds.size(), strtab.size());
+    return image;
+  }
+
+  view::view(const void * const image, size_t const size) {
+    auto const p = static_cast<const char*>(image);
+    auto const invalid = [size](const char * const what) -> session_image_exception {
+      return session_image_exception(format2str("not a valid session image (%lu bytes): %s", size, what));
+    };
+    if (p == nullptr || size < sizeof(header_t)) throw invalid("too small");
+    if (reinterpret_cast<uintptr_t>(p) % 8 != 0) throw invalid("not 8 byte aligned");
+    auto const h = reinterpret_cast<const header_t*>(p);
+    if (memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0) throw invalid("bad magic");
+    if (h->version != VERSION) {
+      throw session_image_exception(format2str("session image version %u is not the expected version %u",
+                                               h->version, VERSION));
+    }
+    if (h->header_size != sizeof(header_t) || h->image_size < sizeof(header_t) || h->image_size > size ||
+        h->image_size % 4 != 0)
+    {
+      throw invalid("bad header or image size");
+    }
+    if (checksum_of(p + CHECKSUM_END, h->image_size - CHECKSUM_END) != h->checksum) throw invalid("checksum mismatch");
+
+    const uint64_t image_size = h->image_size;
+    auto const in_bounds = [image_size](const array_ref_t &arr, uint64_t elem_size) -> bool {
+      return arr.offset >= sizeof(header_t) && arr.offset % 4 == 0 && arr.offset + arr.count * elem_size <= image_size;
+    };
+    if (!in_bounds(h->strings, 1) || !in_bounds(h->supervisor_cmds, sizeof(method_rec_t)) ||
+        !in_bounds(h->child_cmds, sizeof(method_rec_t)) || !in_bounds(h->system_properties, sizeof(str_ref_t)) ||
+        !in_bounds(h->child_cmd_names, sizeof(str_ref_t)))
+    {
+      throw invalid("array out of bounds");
+    }
+    // an index slot is the index of an entry of the table it indexes
+    const std::pair<const index_ref_t*, uint32_t> indexes[] = {
+        { &h->supervisor_cmd_index, h->supervisor_cmds.count }, { &h->child_cmd_index, h->child_cmds.count },
+        { &h->child_cmd_names_index, h->child_cmd_names.count } };
+    for (const auto &idx : indexes) {
+      if (!in_bounds(idx.first->seeds, sizeof(uint32_t)) || !in_bounds(idx.first->slots, sizeof(uint32_t))) {
+        throw invalid("index out of bounds");
+      }
+      auto const slots = reinterpret_cast<const uint32_t*>(p + idx.first->slots.offset);
+      for (uint32_t i = 0; i < idx.first->slots.count; i++) {
+        if (slots[i] >= idx.second) throw invalid("index slot out of bounds");
+      }
+    }
+    // every string is checked here so that str() needn't be
+    const uint64_t strs_begin = h->strings.offset, strs_end = strs_begin + h->strings.count;
+    auto const check_str = [p, strs_begin, strs_end, &invalid](const str_ref_t ref) {
+      if (ref == 0) return;
+      if (ref < strs_begin || ref % 4 != 0 || ref + sizeof(uint32_t) > strs_end) throw invalid("string out of bounds");
+      uint32_t len;
+      memcpy(&len, p + ref, sizeof(len));
+      const uint64_t nul_pos = static_cast<uint64_t>(ref) + sizeof(len) + len;
+      if (nul_pos >= strs_end || p[nul_pos] != '\0') throw invalid("string out of bounds");
+    };
+    auto const check_rec = [&check_str](const method_rec_t &rec) {
+      check_str(rec.full_method_name);
+      check_str(rec.descriptor);
+      check_str(rec.command);
+      check_str(rec.jvm_optns);
+    };
+    for (const auto &rec : h->entry_points) {
+      check_rec(rec);
+    }
+    for (const auto ref : { h->child_processor_commands, h->persistent_child_commands, h->system_class_path,
+                            h->logging_level, h->jvmlib_path }) {
+      check_str(ref);
+    }
+    for (const auto *arr : { &h->supervisor_cmds, &h->child_cmds }) {
+      auto const recs = reinterpret_cast<const method_rec_t*>(p + arr->offset);
+      for (uint32_t i = 0; i < arr->count; i++) {
+        check_rec(recs[i]);
+      }
+    }
+    for (const auto *arr : { &h->system_properties, &h->child_cmd_names }) {
+      auto const refs = reinterpret_cast<const str_ref_t*>(p + arr->offset);
+      for (uint32_t i = 0; i < arr->count; i++) {
+        check_str(refs[i]);
+      }
+    }
+    base = p;
+    hdr = h;
+  }
+
+  string_view view::str(const str_ref_t ref) const {
+    if (ref == 0) return string_view("", 0);
+    uint32_t len;
+    memcpy(&len, base + ref, sizeof(len));
+    return string_view(base + ref + sizeof(len), len);
+  }
+
+  bool view::is_child_processor_command(string_view const cmd) const {
+    auto const names = refs(hdr->child_cmd_names);
+    auto const name_at = [this, names](size_t i) -> string_view { return str(names[i]); };
+    if (hdr->child_cmd_names_index.slots.count > 0) {
+      return cmd_index::find(index(hdr->child_cmd_names_index), cmd, name_at) >= 0;
+    }
+    for (uint32_t i = 0; i < hdr->child_cmd_names.count; i++) { // no index - scan
+      if (cmd_index::iequals(name_at(i), cmd)) return true;
+    }
+    return false;
+  }
+
+  const method_rec_t* view::find_cmd(const array_ref_t &cmds, const index_ref_t &idx, string_view const cmd) const {
+    auto const first = recs(cmds);
+    auto const name_at = [this, first](size_t i) -> string_view { return str(first[i].command); };
+    if (idx.slots.count > 0) {
+      const long i = cmd_index::find(index(idx), cmd, name_at);
+      return i >= 0 ? first + i : nullptr;
+    }
+    for (uint32_t i = 0; i < cmds.count; i++) { // no index - scan
+      if (cmd_index::iequals(name_at(i), cmd)) return first + i;
+    }
+    return nullptr;
+  }
+
+  const method_rec_t* view::find_child_cmd(string_view const cmd) const {
+    return find_cmd(hdr->child_cmds, hdr->child_cmd_index, cmd);
+  }
+
+  const method_rec_t* view::find_supervisor_cmd(string_view const cmd) const {
+    return find_cmd(hdr->supervisor_cmds, hdr->supervisor_cmd_index, cmd);
+  }
+
+  void view::to_session_state(sessionState &ss) const {
+    auto const method_of = [this](const method_rec_t &rec) -> methodDescriptor {
+      return methodDescriptor(to_string(str(rec.full_method_name)), to_string(str(rec.descriptor)),
+                              (rec.flags & STATIC_FLAG) != 0, static_cast<WhichMethod>(rec.which_method));
+    };
+    auto const cmds_of = [this](const array_ref_t &arr) -> std::shared_ptr<std::vector<methodDescriptorCmd>> {
+      if (arr.count == 0) return nullptr;
+      auto const recs = reinterpret_cast<const method_rec_t*>(base + arr.offset);
+      auto const pvec = std::make_shared<std::vector<methodDescriptorCmd>>();
+      pvec->reserve(arr.count);
+      for (uint32_t i = 0; i < arr.count; i++) {
+        const auto &rec = recs[i];
+        methodDescriptorCmd cmd(to_string(str(rec.full_method_name)), to_string(str(rec.descriptor)),
+                                to_string(str(rec.command)), to_string(str(rec.jvm_optns)),
+                                (rec.flags & PERSISTENT_FLAG) != 0, (rec.flags & STATIC_FLAG) != 0,
+                                static_cast<WhichMethod>(rec.which_method));
+        cmd.isConcurrent = (rec.flags & CONCURRENT_FLAG) != 0;
+        pvec->push_back(std::move(cmd));
+      }
+      return pvec;
+    };
+    auto const table_of = [this](const index_ref_t &idx) -> std::shared_ptr<const cmd_index::table_t> {
+      if (idx.slots.count == 0) return nullptr;
+      auto const table = std::make_shared<cmd_index::table_t>();
+      table->seeds.assign(refs(idx.seeds), refs(idx.seeds) + idx.seeds.count);
+      table->slots.assign(refs(idx.slots), refs(idx.slots) + idx.slots.count);
+      return table;
+    };
+    ss.supervisor_pid = hdr->supervisor_pid;
+    ss.child_process_max_count = hdr->child_process_max_count;
+    ss.warm_pool_size = hdr->warm_pool_size;
+    ss.persistent_worker_count = hdr->persistent_worker_count;
+    ss.persistent_worker_max_requests = hdr->persistent_worker_max_requests;
+    ss.persistent_worker_max_heap_mb = hdr->persistent_worker_max_heap_mb;
+    ss.spartanMainEntryPoint = method_of(hdr->entry_points[MAIN]);
+    ss.spartanGetStatusEntryPoint = method_of(hdr->entry_points[GET_STATUS]);
+    ss.spartanSupervisorShutdownEntryPoint = method_of(hdr->entry_points[SUPERVISOR_SHUTDOWN]);
+    ss.spartanChildNotifyEntryPoint = method_of(hdr->entry_points[CHILD_NOTIFY]);
+    ss.spartanChildCompletionNotifyEntryPoint = method_of(hdr->entry_points[CHILD_COMPLETION_NOTIFY]);
+    ss.spartanChildBatchNotifyEntryPoint = method_of(hdr->entry_points[CHILD_BATCH_NOTIFY]);
+    ss.spartanSupervisorEntryPoint = method_of(hdr->entry_points[SUPERVISOR]);
+    ss.spartanChildProcessorEntryPoint = method_of(hdr->entry_points[CHILD_PROCESSOR]);
+    ss.spartanChildProcessorCommands = to_string(str(hdr->child_processor_commands));
+    ss.persistentChildCommands = to_string(str(hdr->persistent_child_commands));
+    ss.systemClassPath = to_string(str(hdr->system_class_path));
+    ss.spSpartanSupervisorCommands = cmds_of(hdr->supervisor_cmds);
+    ss.spSpartanChildProcessorCommands = cmds_of(hdr->child_cmds);
+    ss.spSupervisorCmdIndex = table_of(hdr->supervisor_cmd_index);
+    ss.spChildProcessorCmdIndex = table_of(hdr->child_cmd_index);
+    if (hdr->system_properties.count > 0) {
+      auto const props = refs(hdr->system_properties);
+      auto const pvec = std::make_shared<std::vector<std::string>>();
+      pvec->reserve(hdr->system_properties.count);
+      for (uint32_t i = 0; i < hdr->system_properties.count; i++) {
+        pvec->push_back(to_string(str(props[i])));
+      }
+      ss.spSerializedSystemProperties = pvec;
+    } else {
+      ss.spSerializedSystemProperties.reset();
+    }
+    ss.spartanLoggingLevel = to_string(str(hdr->logging_level));
+    ss.jvmlib_path = to_string(str(hdr->jvmlib_path));
+  }
+}
@@ -0,0 +1,163 @@
+/* session-image.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_SESSION_IMAGE_H
+#define SPARTAN_SESSION_IMAGE_H
+
+#include <cstdint>
+#include <vector>
+#include <sys/types.h>
+#include "spartan-exception.h"
+#include "string-view.h"
+#include "cmd-index.h"
+
+// forward declarations (dependency types for method signature declarations)
+struct sessionState;
+
+/**
+ * Flat binary image of the supervisor's sessionState, as placed in shared memory for the clients and
+ * child processes. A reader validates the image once and then uses it in place - nothing is parsed or
+ * allocated to look up a command.
+ *
+ * Layout (host byte order - writer and readers are always on the same host; every offset is from the
+ * start of the image, which is 8 byte aligned, and there are no pointers):
+ *
+ *   header_t       magic "\0SPSSIMG", version, header size, image size and a checksum (FNV-1a, by 32 bit
+ *                  word) of all that follows the checksum; then the scalar settings, the entry point
+ *                  methods and the offset/count of each array
+ *   method_rec_t[] the supervisor commands, then the child processor commands
+ *   str_ref_t[]    the system properties, then the sorted lowercase names of the child processor
+ *                  commands (both annotated and config.ini ChildProcessorCommands)
+ *   uint32_t[]     the perfect hash indexes (cmd_index) of the supervisor commands, the child processor
+ *                  commands and the child processor command names - each its seeds, then its slots
+ *   string table   per string: 4 byte length, the UTF-8 bytes, a terminating NUL, padding to 4 bytes
+ *
+ * A str_ref_t is the offset of a string in the string table (0 is the empty string).
+ */
+namespace ss_image {
+
+  using bpstd::string_view;
+
+  // declare session_image_exception
+  DECL_EXCEPTION(session_image)
+
+  static const uint16_t VERSION = 2;
+
+  using str_ref_t = uint32_t;
+
+  enum : uint8_t { STATIC_FLAG = 0x01, PERSISTENT_FLAG = 0x02, CONCURRENT_FLAG = 0x04 };
+
+  struct method_rec_t {
+    str_ref_t full_method_name;
+    str_ref_t descriptor;
+    str_ref_t command;
+    str_ref_t jvm_optns;
+    int16_t which_method;
+    uint8_t flags;
+    uint8_t reserved;
+  };
+
+  struct array_ref_t {
+    uint32_t offset;
+    uint32_t count;
+  };
+
+  // a cmd_index table - both arrays are of uint32_t
+  struct index_ref_t {
+    array_ref_t seeds;
+    array_ref_t slots;
+  };
+
+  // the entry point methods of header_t::entry_points, in the order of sessionState's members
+  enum : int { MAIN, GET_STATUS, SUPERVISOR_SHUTDOWN, CHILD_NOTIFY, CHILD_COMPLETION_NOTIFY, CHILD_BATCH_NOTIFY,
+               SUPERVISOR, CHILD_PROCESSOR, ENTRY_POINTS_COUNT };
+
+  struct header_t {
+    char magic[8];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t image_size;
+    uint32_t checksum;
+    uint32_t reserved;
+    array_ref_t strings; // offset and byte size of the string table
+    int32_t supervisor_pid;
+    int16_t child_process_max_count;
+    int16_t warm_pool_size;
+    int16_t persistent_worker_count;
+    int16_t reserved2;
+    int32_t persistent_worker_max_requests;
+    int32_t persistent_worker_max_heap_mb;
+    method_rec_t entry_points[ENTRY_POINTS_COUNT];
+    str_ref_t child_processor_commands;
+    str_ref_t persistent_child_commands;
+    str_ref_t system_class_path;
+    str_ref_t logging_level;
+    str_ref_t jvmlib_path;
+    array_ref_t supervisor_cmds;   // method_rec_t
+    array_ref_t child_cmds;        // method_rec_t
+    array_ref_t system_properties; // str_ref_t
+    array_ref_t child_cmd_names;   // str_ref_t
+    index_ref_t supervisor_cmd_index;
+    index_ref_t child_cmd_index;
+    index_ref_t child_cmd_names_index;
+  };
+
+  // builds the image of the information part of ss
+  std::vector<char> build(const sessionState &ss);
+
+  // read-only view of an image - valid for as long as the memory of the image is
+  class view {
+  private:
+    const char *base{nullptr};
+    const header_t *hdr{nullptr};
+  public:
+    view() = default;
+    // validates the image (magic, version, size, checksum, every offset and string in bounds);
+    // throws session_image_exception if it's not a well formed image
+    view(const void *image, size_t size);
+  public:
+    const header_t& header() const { return *hdr; }
+    // the string is NUL terminated (so its data() can be used as a C string)
+    string_view str(str_ref_t ref) const;
+    const method_rec_t* supervisor_cmds() const { return recs(hdr->supervisor_cmds); }
+    const method_rec_t* child_cmds() const { return recs(hdr->child_cmds); }
+    pid_t supervisor_pid() const { return static_cast<pid_t>(hdr->supervisor_pid); }
+    string_view logging_level() const { return str(hdr->logging_level); }
+    // is cmd a child processor command (case insensitive)
+    bool is_child_processor_command(string_view cmd) const;
+    // the annotated child processor command (case insensitive), else nullptr
+    const method_rec_t* find_child_cmd(string_view cmd) const;
+    // the supervisor command (case insensitive), else nullptr
+    const method_rec_t* find_supervisor_cmd(string_view cmd) const;
+    // copies the image onto the information part of ss - for code that holds on to methodDescriptor objects
+    void to_session_state(sessionState &ss) const;
+  private:
+    const method_rec_t* recs(const array_ref_t &arr) const {
+      return reinterpret_cast<const method_rec_t*>(base + arr.offset);
+    }
+    const str_ref_t* refs(const array_ref_t &arr) const {
+      return reinterpret_cast<const str_ref_t*>(base + arr.offset);
+    }
+    cmd_index::span_t index(const index_ref_t &idx) const {
+      return cmd_index::span_t{ refs(idx.seeds), idx.seeds.count, refs(idx.slots), idx.slots.count };
+    }
+    const method_rec_t* find_cmd(const array_ref_t &cmds, const index_ref_t &idx, string_view cmd) const;
+  };
+}
+
+#endif //SPARTAN_SESSION_IMAGE_H
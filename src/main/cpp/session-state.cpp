@@ -33,6 +33,17 @@ limitations under the License.
 #include "cfgparse.h"
 #include "createjvm.h"
 #include "launch-program.h"
+#include "app-cds.h"
+#include "heap-history.h"
+#include "jfr-profiling.h"
+#include "timeline-trace.h"
+#include "dispatch-queue.h"
+#include "admission.h"
+#include "msg-ring.h"
+#include "open-anon-pipes.h"
+#include "lifecycle-notify.h"
+#include "supervisor-executor.h"
+#include "jni-registry.h"
 #include "session-state.h"
 
 //#undef NDEBUG // uncomment this line to enable asserts in use below
@@ -74,6 +85,8 @@ void sessionState::cleanup_jvm(JavaVM *jvmp) {
   const auto pid = getpid();
   log(LL::TRACE, ">> %s(jvmp) - pid(%d)", __func__, pid);
   if (jvmp != nullptr) {
+    JNIEnv *envp = nullptr;
+    jni_registry::invalidate(jvmp->GetEnv((void**)&envp, JNI_VERSION_1_6) == JNI_OK ? envp : nullptr);
     log(LL::TRACE, "about to destroy the Java JVM runtime instance - pid(%d)", pid);
     jvmp->DestroyJavaVM();
     log(LL::DEBUG, "destroyed the Java JVM runtime instance - pid(%d)", pid);
@@ -105,6 +118,8 @@ methodDescriptorCmd & methodDescriptorCmd::operator=(methodDescriptorCmd && md)
   methodDescriptor::operator=(std::move(md));
   command = std::move(md.command);
   jvmOptionsCommandLine = std::move(md.jvmOptionsCommandLine);
+  isPersistent = md.isPersistent;
+  isConcurrent = md.isConcurrent;
   return *this;
 }
 
@@ -120,6 +135,8 @@ methodDescriptorCmd & methodDescriptorCmd::operator=(const methodDescriptorCmd &
   methodDescriptor::operator=(md);
   command = md.command;
   jvmOptionsCommandLine = md.jvmOptionsCommandLine;
+  isPersistent = md.isPersistent;
+  isConcurrent = md.isConcurrent;
   return *this;
 }
 
@@ -139,6 +156,8 @@ std::ostream& operator << (std::ostream &os, const methodDescriptorCmd &self) {
   os << static_cast<const methodDescriptor&>(self);
   os << self.command << '\n';
   os << self.jvmOptionsCommandLine << '\n';
+  os << self.isPersistent << '\n';
+  os << self.isConcurrent << '\n';
   return os;
 }
 
@@ -163,6 +182,11 @@ std::istream& operator >> (std::istream &is, methodDescriptorCmd &self) {
   is >> static_cast<methodDescriptor&>(self);
   std::getline(is, self.command, '\n');
   std::getline(is, self.jvmOptionsCommandLine, '\n');
+  is >> self.isPersistent;
+  char newline;
+  is.getline(&newline, 1);
+  is >> self.isConcurrent;
+  is.getline(&newline, 1);
   return is;
 }
 
@@ -231,6 +255,21 @@ void debug_dump_sessionState(const sessionState& ss, const char edition) {
 }
 #endif
 
+// parses a numeric config.ini setting value; logs a warning and returns default_value if the value is not valid
+static int parse_int_setting(const char * const name, const char * const value_cstr, const int default_value) {
+  auto const handle_exception = [name](const char * const e_what, const int default_val) {
+    log(LL::WARN, "invalid value for setting %s - %s\n\tdefaulting to %d", name, e_what, default_val);
+  };
+  try {
+    return std::stoi(value_cstr);
+  } catch(const std::invalid_argument& e) {
+    handle_exception(e.what(), default_value);
+  } catch(const std::out_of_range& e) {
+    handle_exception(e.what(), default_value);
+  }
+  return default_value;
+}
+
 enum class WhichInitError : int { UNKNOWN, MISSING_CFG, CFG_PARSING_ERR, MISSING_COMMANDS };
 using WIE = WhichInitError;
 
@@ -269,6 +308,12 @@ sessionState::sessionState(const char * const cfg_file, const char * const jvmli
       if (strcasecmp(section, "JvmSettings") == 0) {
         if (strcasecmp(name, "CommandLineArgs") == 0) {
           s_jvm_cmd_line_args = strdup(prepend_to_java_library_path(value_cstr).c_str());
+        } else if (strcasecmp(name, "AppCDS") == 0) {
+          app_cds::set_enabled(strcasecmp(value_cstr, "true") == 0);
+        } else if (strcasecmp(name, "AppCDSCacheDir") == 0) {
+          app_cds::set_cache_dir(value_cstr);
+        } else if (strcasecmp(name, "AppCDSDumpArgs") == 0) {
+          app_cds::set_dump_args(value_cstr);
         }
       } else if (strcasecmp(section, "SupervisorProcessSettings") == 0) {
         if (strcasecmp(name, "MainEntryPoint") == 0) {
@@ -313,6 +358,15 @@ sessionState::sessionState(const char * const cfg_file, const char * const jvmli
                                                false, WM::CHILD_COMPLETION_NOTIFY);
             spartanChildCompletionNotifyEntryPoint = std::move(method_descriptor);
           }
+        } else if (strcasecmp(name, "ChildBatchNotifyEntryPoint") == 0) {
+          value = value_cstr;
+          if (!value.empty()) {
+            std::replace(value.begin(), value.end(), '.', '/');
+            descriptor = "([I[Ljava/lang/String;[I)V";
+            methodDescriptor method_descriptor(std::move(value), std::move(descriptor),
+                                               false, WM::CHILD_BATCH_NOTIFY);
+            spartanChildBatchNotifyEntryPoint = std::move(method_descriptor);
+          }
         } else if (strcasecmp(name, "SupervisorEntryPoint") == 0) {
           if (!value.empty()) {
             value = value_cstr;
@@ -336,6 +390,47 @@ sessionState::sessionState(const char * const cfg_file, const char * const jvmli
           } catch(const std::out_of_range& e) {
             handle_exception(e.what(), child_process_max_count);
           }
+        } else if (strcasecmp(name, "DispatchQueueCapacity") == 0) {
+          dispatch_queue::set_capacity(parse_int_setting(name, value_cstr, 256));
+        } else if (strcasecmp(name, "DispatchQueueOverflow") == 0) {
+          dispatch_queue::set_overflow(value_cstr);
+        } else if (strcasecmp(name, "DispatchWeights") == 0) {
+          dispatch_queue::set_weights(value_cstr);
+        } else if (strcasecmp(name, "MaxConcurrent") == 0) {
+          admission::set_max_concurrent(value_cstr);
+        } else if (strcasecmp(name, "MaxQueued") == 0) {
+          admission::set_max_queued(value_cstr);
+        } else if (strcasecmp(name, "SupervisorThreads") == 0) {
+          supervisor_executor::set_pool_size(parse_int_setting(name, value_cstr, 4));
+        } else if (strcasecmp(name, "NotifyBatchWindowMs") == 0) {
+          lifecycle_notify::set_batch_window_ms(parse_int_setting(name, value_cstr, 5));
+        } else if (strcasecmp(name, "MsgRingSizeKB") == 0) {
+          msg_ring::set_size_kb(parse_int_setting(name, value_cstr, 1024));
+        } else if (strcasecmp(name, "PipeSizeKB") == 0) {
+          anon_pipes::set_pipe_size_kb(parse_int_setting(name, value_cstr, 0));
+        } else if (strcasecmp(name, "AdmissionQueueTimeout") == 0) {
+          admission::set_queue_timeout(parse_int_setting(name, value_cstr, 30000));
+        } else if (strcasecmp(name, "WarmPoolSize") == 0) {
+          warm_pool_size = static_cast<short int>(std::max(parse_int_setting(name, value_cstr, 0), 0));
+        } else if (strcasecmp(name, "PersistentCommands") == 0) {
+          value = value_cstr;
+          persistentChildCommands = std::move(value);
+        } else if (strcasecmp(name, "PersistentWorkerCount") == 0) {
+          persistent_worker_count = static_cast<short int>(std::max(parse_int_setting(name, value_cstr, 1), 1));
+        } else if (strcasecmp(name, "PersistentWorkerMaxRequests") == 0) {
+          persistent_worker_max_requests = std::max(parse_int_setting(name, value_cstr, 1000), 0);
+        } else if (strcasecmp(name, "PersistentWorkerMaxHeapMB") == 0) {
+          persistent_worker_max_heap_mb = std::max(parse_int_setting(name, value_cstr, 0), 0);
+        } else if (strcasecmp(name, "HeapHistory") == 0) {
+          heap_history::set_enabled(strcasecmp(value_cstr, "true") == 0);
+        } else if (strcasecmp(name, "AdaptiveHeapSizing") == 0) {
+          heap_history::set_adaptive(strcasecmp(value_cstr, "true") == 0);
+        } else if (strcasecmp(name, "AdaptiveHeapHeadroomPct") == 0) {
+          heap_history::set_headroom_pct(parse_int_setting(name, value_cstr, 25));
+        } else if (strcasecmp(name, "AdaptiveHeapMinSamples") == 0) {
+          heap_history::set_min_samples(parse_int_setting(name, value_cstr, 5));
+        } else if (strcasecmp(name, "HeapHistoryDir") == 0) {
+          heap_history::set_dir(value_cstr);
         } else if (strcasecmp(name, "ChildProcessorEntryPoint") == 0) {
           value = value_cstr;
           if (!value.empty()) {
@@ -348,12 +443,30 @@ sessionState::sessionState(const char * const cfg_file, const char * const jvmli
           value = value_cstr;
           spartanChildProcessorCommands = std::move(value);
         }
+      } else if (strcasecmp(section, "JfrProfiling") == 0) {
+        if (strcasecmp(name, "Commands") == 0) {
+          jfr_profiling::set_commands(value_cstr);
+        } else if (strcasecmp(name, "SampleRatePct") == 0) {
+          jfr_profiling::set_sample_rate_pct(parse_int_setting(name, value_cstr, 100));
+        } else if (strcasecmp(name, "MaxConcurrent") == 0) {
+          jfr_profiling::set_max_concurrent(parse_int_setting(name, value_cstr, 1));
+        } else if (strcasecmp(name, "MaxRecordings") == 0) {
+          jfr_profiling::set_max_recordings(parse_int_setting(name, value_cstr, 10));
+        } else if (strcasecmp(name, "RecordingsDir") == 0) {
+          jfr_profiling::set_recordings_dir(value_cstr);
+        } else if (strcasecmp(name, "Settings") == 0) {
+          jfr_profiling::set_settings(value_cstr);
+        } else if (strcasecmp(name, "ExtraJvmArgs") == 0) {
+          jfr_profiling::set_extra_jvm_args(value_cstr);
+        }
       } else if (strcasecmp(section, "LoggingSettings") == 0) {
         if (strcasecmp(name, "LoggingLevel") == 0) {
           const auto logging_level = logger::str_to_level(value_cstr);
           logger::set_level(logging_level);
           value = value_cstr;
           spartanLoggingLevel = std::move(value);
+        } else if (strcasecmp(name, "TraceFile") == 0) {
+          timeline_trace::set_trace_file(value_cstr);
         }
       }
       return 1;
@@ -405,6 +518,10 @@ sessionState::sessionState(const char * const cfg_file, const char * const jvmli
       methodDescriptor method_descriptor(std::move(method_name), std::move(descriptor), false, WM::SUPERVISOR_SHUTDOWN);
       spartanSupervisorShutdownEntryPoint = std::move(method_descriptor);
     }
+    // the default batch upcall hands each notification on to childProcessNotify()/childProcessCompletionNotify()
+    // of the Spartan class - where these have been renamed, batches are delivered one notification per upcall
+    const bool is_notify_renamed = !spartanChildNotifyEntryPoint.empty() ||
+                                   !spartanChildCompletionNotifyEntryPoint.empty();
     if (spartanChildNotifyEntryPoint.empty()) {
       method_name = class_name + "/childProcessNotify";
       descriptor = "(ILjava/lang/String;)V";
@@ -418,6 +535,13 @@ sessionState::sessionState(const char * const cfg_file, const char * const jvmli
                                          false, WM::CHILD_COMPLETION_NOTIFY);
       spartanChildCompletionNotifyEntryPoint = std::move(method_descriptor);
     }
+    if (spartanChildBatchNotifyEntryPoint.empty() && !is_notify_renamed) {
+      method_name = class_name + "/childProcessBatchNotify";
+      descriptor = "([I[Ljava/lang/String;[I)V";
+      methodDescriptor method_descriptor(std::move(method_name), std::move(descriptor),
+                                         false, WM::CHILD_BATCH_NOTIFY);
+      spartanChildBatchNotifyEntryPoint = std::move(method_descriptor);
+    }
     if (spartanSupervisorEntryPoint.empty()) {
       method_name = class_name + "/supervisorDoCommand";
       descriptor = "([Ljava/lang/String;Ljava/io/PrintStream;)V";
@@ -448,17 +572,25 @@ sessionState::sessionState(const char * const cfg_file, const char * const jvmli
 sessionState & sessionState::clone_info_part(const sessionState &ss) noexcept {
   supervisor_pid = ss.supervisor_pid;
   child_process_max_count = ss.child_process_max_count;
+  warm_pool_size = ss.warm_pool_size;
+  persistent_worker_count = ss.persistent_worker_count;
+  persistent_worker_max_requests = ss.persistent_worker_max_requests;
+  persistent_worker_max_heap_mb = ss.persistent_worker_max_heap_mb;
   spartanMainEntryPoint = ss.spartanMainEntryPoint;
   spartanGetStatusEntryPoint = ss.spartanGetStatusEntryPoint;
   spartanSupervisorShutdownEntryPoint = ss.spartanSupervisorShutdownEntryPoint;
   spartanChildNotifyEntryPoint = ss.spartanChildNotifyEntryPoint;
   spartanChildCompletionNotifyEntryPoint = ss.spartanChildCompletionNotifyEntryPoint;
+  spartanChildBatchNotifyEntryPoint = ss.spartanChildBatchNotifyEntryPoint;
   spartanSupervisorEntryPoint = ss.spartanSupervisorEntryPoint;
   spartanChildProcessorEntryPoint = ss.spartanChildProcessorEntryPoint;
   spartanChildProcessorCommands = ss.spartanChildProcessorCommands;
+  persistentChildCommands = ss.persistentChildCommands;
   systemClassPath = ss.systemClassPath;
   spSpartanSupervisorCommands = ss.spSpartanSupervisorCommands;
   spSpartanChildProcessorCommands = ss.spSpartanChildProcessorCommands;
+  spSupervisorCmdIndex = ss.spSupervisorCmdIndex;
+  spChildProcessorCmdIndex = ss.spChildProcessorCmdIndex;
   spSerializedSystemProperties = ss.spSerializedSystemProperties;
   spartanLoggingLevel = ss.spartanLoggingLevel;
   jvmlib_path = ss.jvmlib_path;
@@ -479,10 +611,12 @@ sessionState & sessionState::operator=(sessionState && ss) noexcept {
   return *this;
 }
 
-void sessionState::create_jvm(const char *jvm_override_optns) {
-  const jvm_create_t jvm_rt = ::create_jvm(libjvm_sp.get(), jvm_override_optns);
+void sessionState::create_jvm(const char *jvm_override_optns, const char *jvm_appended_optns) {
+  const timeline_trace::scope trace_create_jvm("create_jvm");
+  const jvm_create_t jvm_rt = ::create_jvm(libjvm_sp.get(), jvm_override_optns, jvm_appended_optns);
   jvm_sp.reset(std::get<0>(jvm_rt));
   env_sp.reset(std::get<1>(jvm_rt));
+  jni_registry::init(jvm_sp.get(), env_sp.get()); // on failure (logged) the upcalls fail for want of the JDK classes
 }
 
 template <typename T>
@@ -543,14 +677,20 @@ std::ostream& operator << (std::ostream &os, const sessionState &self) {
   os << typeid(self_t).name() << '\n';
   os << self.supervisor_pid << '\n';
   os << self.child_process_max_count << '\n';
+  os << self.warm_pool_size << '\n';
+  os << self.persistent_worker_count << '\n';
+  os << self.persistent_worker_max_requests << '\n';
+  os << self.persistent_worker_max_heap_mb << '\n';
   os << self.spartanMainEntryPoint << '\n';
   os << self.spartanGetStatusEntryPoint << '\n';
   os << self.spartanSupervisorShutdownEntryPoint << '\n';
   os << self.spartanChildNotifyEntryPoint << '\n';
   os << self.spartanChildCompletionNotifyEntryPoint << '\n';
+  os << self.spartanChildBatchNotifyEntryPoint << '\n';
   os << self.spartanSupervisorEntryPoint << '\n';
   os << self.spartanChildProcessorEntryPoint << '\n';
   os << self.spartanChildProcessorCommands << '\n';
+  os << self.persistentChildCommands << '\n';
   os << self.systemClassPath << '\n';
   stream_vec_out(os, self.spSpartanSupervisorCommands) << '\n';
   stream_vec_out(os, self.spSpartanChildProcessorCommands) << '\n';
@@ -568,6 +708,14 @@ std::istream& operator >> (std::istream &is, sessionState &self) {
   is.getline(&newline, 1);
   is >> self.child_process_max_count;
   is.getline(&newline, 1);
+  is >> self.warm_pool_size;
+  is.getline(&newline, 1);
+  is >> self.persistent_worker_count;
+  is.getline(&newline, 1);
+  is >> self.persistent_worker_max_requests;
+  is.getline(&newline, 1);
+  is >> self.persistent_worker_max_heap_mb;
+  is.getline(&newline, 1);
   is >> self.spartanMainEntryPoint;
   is.getline(&newline, 1);
   is >> self.spartanGetStatusEntryPoint;
@@ -578,11 +726,14 @@ std::istream& operator >> (std::istream &is, sessionState &self) {
   is.getline(&newline, 1);
   is >> self.spartanChildCompletionNotifyEntryPoint;
   is.getline(&newline, 1);
+  is >> self.spartanChildBatchNotifyEntryPoint;
+  is.getline(&newline, 1);
   is >> self.spartanSupervisorEntryPoint;
   is.getline(&newline, 1);
   is >> self.spartanChildProcessorEntryPoint;
   is.getline(&newline, 1);
   std::getline(is, self.spartanChildProcessorCommands, '\n');
+  std::getline(is, self.persistentChildCommands, '\n');
   std::getline(is, self.systemClassPath, '\n');
   stream_vec_in(is, self.spSpartanSupervisorCommands);
   is.getline(&newline, 1);
@@ -37,8 +37,16 @@ namespace cmd_dsp {
   class CmdDispatchInfoProcessor;
 }
 
+namespace ss_image {
+  class view;
+}
+
+namespace cmd_index {
+  struct table_t;
+}
+
 enum class WhichMethod : short { NONE = 0, MAIN, GET_STATUS, SUPERVISOR_SHUTDOWN, CHILD_NOTIFY, CHILD_COMPLETION_NOTIFY,
-                                 SUPERVISOR_DO_CMD, CHILD_DO_CMD, GET_CMD_DISPATCH_INFO };
+                                 SUPERVISOR_DO_CMD, CHILD_DO_CMD, GET_CMD_DISPATCH_INFO, CHILD_BATCH_NOTIFY };
 using WM = WhichMethod;
 
 // class and struct declarations
@@ -64,6 +72,7 @@ public:
   virtual const char* desc_str() const = 0;
   virtual const char* cmd_cstr() const = 0;
   virtual const char* jvm_optns_str() const = 0;
+  virtual bool is_persistent() const = 0;
 };
 
 class methodDescriptor: public methodDescriptorBase {
@@ -91,6 +100,7 @@ public:
   const char* desc_str() const override { return descriptor.c_str(); }
   const char* cmd_cstr() const override { return ""; }
   const char* jvm_optns_str() const override { return ""; }
+  bool is_persistent() const override { return false; }
 
   friend std::ostream& operator << (std::ostream &os, const methodDescriptor &self);
   friend std::istream& operator >> (std::istream &is, methodDescriptor &self);
@@ -101,6 +111,8 @@ class methodDescriptorCmd: public methodDescriptor {
 protected:
   std::string command{};
   std::string jvmOptionsCommandLine{};
+  bool isPersistent{false};
+  bool isConcurrent{false};
 
 public:
   methodDescriptorCmd() = default;
@@ -119,6 +131,14 @@ public:
                                std::string && jvm_optns, bool is_static_method, WhichMethod which)
       : methodDescriptor(std::move(full_method_name), std::move(descriptor), is_static_method, which),
         command(std::move(cmd)), jvmOptionsCommandLine(std::move(jvm_optns)) {}
+  explicit methodDescriptorCmd(std::string && full_method_name, std::string && descriptor, std::string && cmd,
+                               std::string && jvm_optns, bool is_persistent, bool is_static_method, WhichMethod which)
+      : methodDescriptor(std::move(full_method_name), std::move(descriptor), is_static_method, which),
+        command(std::move(cmd)), jvmOptionsCommandLine(std::move(jvm_optns)), isPersistent(is_persistent) {}
+  explicit methodDescriptorCmd(std::string && full_method_name, std::string && descriptor, std::string && cmd,
+                               bool is_concurrent, bool is_static_method, WhichMethod which)
+      : methodDescriptor(std::move(full_method_name), std::move(descriptor), is_static_method, which),
+        command(std::move(cmd)), isConcurrent(is_concurrent) {}
   methodDescriptorCmd(const methodDescriptorCmd &md) { this->operator=(md); }
   methodDescriptorCmd(methodDescriptorCmd &&md) noexcept { *this = std::move(md); }
   methodDescriptorCmd & operator=(const methodDescriptorCmd &md);
@@ -128,9 +148,12 @@ public:
   const char* cmd_cstr() const override { return command.c_str(); }
   const std::string& cmd_str() const { return command; }
   const char* jvm_optns_str() const override { return jvmOptionsCommandLine.c_str(); }
+  bool is_persistent() const override { return isPersistent; }
+  bool is_concurrent() const { return isConcurrent; }
 
   friend std::ostream& operator << (std::ostream &os, const methodDescriptorCmd &self);
   friend std::istream& operator >> (std::istream &is, methodDescriptorCmd &self);
+  friend class ss_image::view;
 };
 
 struct sessionState {
@@ -142,17 +165,26 @@ private:
 public:
   pid_t supervisor_pid{0};
   short int child_process_max_count{0};
+  short int warm_pool_size{0};
+  short int persistent_worker_count{1};
+  int persistent_worker_max_requests{1000};
+  int persistent_worker_max_heap_mb{0};
   methodDescriptor spartanMainEntryPoint;
   methodDescriptor spartanGetStatusEntryPoint;
   methodDescriptor spartanSupervisorShutdownEntryPoint;
   methodDescriptor spartanChildNotifyEntryPoint;
   methodDescriptor spartanChildCompletionNotifyEntryPoint;
+  methodDescriptor spartanChildBatchNotifyEntryPoint;
   methodDescriptor spartanSupervisorEntryPoint;
   methodDescriptor spartanChildProcessorEntryPoint;
   std::string spartanChildProcessorCommands;
+  std::string persistentChildCommands;
   std::string systemClassPath;
   std::shared_ptr<std::vector<methodDescriptorCmd>> spSpartanSupervisorCommands;
   std::shared_ptr<std::vector<methodDescriptorCmd>> spSpartanChildProcessorCommands;
+  // perfect hash indexes of the command vectors (as published in the session image), else null
+  std::shared_ptr<const cmd_index::table_t> spSupervisorCmdIndex;
+  std::shared_ptr<const cmd_index::table_t> spChildProcessorCmdIndex;
   std::shared_ptr<std::vector<std::string>> spSerializedSystemProperties;
   std::string spartanLoggingLevel;
   std::string jvmlib_path;
@@ -169,7 +201,7 @@ public:
   sessionState & operator=(sessionState && ss) noexcept;
   ~sessionState() = default;
 
-  void create_jvm(const char *jvm_override_optns = "");
+  void create_jvm(const char *jvm_override_optns = "", const char *jvm_appended_optns = nullptr);
 
   friend std::ostream& operator << (std::ostream &os, const sessionState &self);
   friend std::istream& operator >> (std::istream &is, sessionState &self);
@@ -23,11 +23,17 @@ limitations under the License.
 #include <unistd.h>
 #include <csignal>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
 #include <alloca.h>
 #include <memory>
+#include <functional>
 #include <future>
-#include <queue>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <algorithm>
 #include <mqueue.h>
 #include <libgen.h>
@@ -47,6 +53,23 @@ limitations under the License.
 #include "open-anon-pipes.h"
 #include "read-on-ready.h"
 #include "echo-streams.h"
+#include "warm-pool.h"
+#include "persistent-workers.h"
+#include "str-split.h"
+#include "format2str.h"
+#include "app-cds.h"
+#include "heap-history.h"
+#include "jfr-profiling.h"
+#include "timeline-trace.h"
+#include "event-reactor.h"
+#include "dispatch-queue.h"
+#include "admission.h"
+#include "msg-ring.h"
+#include "argv-frame.h"
+#include "lifecycle-notify.h"
+#include "supervisor-executor.h"
+#include "jni-registry.h"
+#include "cmd-index.h"
 
 //#undef NDEBUG // uncomment this line to enable asserts in use below
 #include <cassert>
@@ -59,9 +82,10 @@ static const size_t MSG_BUF_SZ = 4096;
 static const string_view STOP_CMD{ "--STOP" };
 static const string_view SHUTDOWN_CMD{ "--SHUTDOWN" };
 static const string_view STATUS_CMD{ "--STATUS" };
+static const string_view PROFILE_CMD{ "--PROFILE" };
 static const string_view CHILD_PID_NOTIFY_CMD{ "--CHILD_PID_NOTIFY" };
 static const string_view CHILD_PID_COMPLETION_NOTIFY_CMD{ "--CHILD_PID_COMPLETION_NOTIFY" };
-static const string_view EXTENDED_INVOKE_CMD{ "--EXTENDED_INVOKE" };
+using send_mq_msg::EXTENDED_INVOKE_CMD;
 static const string_view std_invoke_descriptor{ "([Ljava/lang/String;Ljava/io/PrintStream;)V" };
 static const string_view react_invoke_descriptor{
   "([Ljava/lang/String;Ljava/io/PrintStream;Ljava/io/PrintStream;Ljava/io/InputStream;)V" };
@@ -165,16 +189,26 @@ inline int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
 static int  supervisor(int argc, char **argv, sessionState& session);
 static void supervisor_child_processor_notify(const pid_t child_pid, const char * const command_line);
 static void supervisor_child_processor_completion_notify(const siginfo_t& info);
+static void supervisor_child_processor_completion_notify(const pid_t child_pid);
+static long java_heap_used_mb(JavaVM *const jvmp);
+static long java_gc_count(JavaVM *const jvmp);
 static int  invoke_java_child_processor_notify(const char * const child_pid, const char * const command_line,
                                                JavaVM * const jvmp, const methodDescriptor &method_descriptor);
 static int  invoke_java_child_processor_completion_notify(const char * const child_pid,
                                                         JavaVM * const jvmp, const methodDescriptor &method_descriptor);
-static int  invoke_java_supervisor_command(int /*argc*/, char **/*argv*/, const char *const msg_arg, JavaVM *const jvmp,
+static void supervisor_child_processor_batch_notify(const argv_frame::frame_t &batch, sessionState &shm_session);
+static int  invoke_java_supervisor_command(int /*argc*/, char **/*argv*/, const std::string &msg_arg, JavaVM *const jvmp,
                                            const methodDescriptor &method_descriptor);
 static int  invoke_child_process_action(sessionState& session_mut, const char *jvm_override_optns,
-                                        const action_cb_t &action);
-static int  invoke_child_processor_command(int argc, char **argv, const char *const msg_arg,
+                                        const action_cb_t &action, const char *jvm_appended_optns = nullptr);
+static std::string get_dispatch_msg_cmd(const std::string &msg);
+static void reject_dispatch_msg(const std::string &msg, const pid_t rsp_pid, const char * const reason);
+static const methodDescriptor* find_child_processor_method(const sessionState &ss, const std::string &cmd);
+static const methodDescriptorCmd* find_supervisor_command(const sessionState &ss, const std::string &cmd);
+static int  invoke_child_processor_command(int argc, char **argv, const std::string &msg_arg,
                                            JavaVM *const jvmp, const methodDescriptor &method_descriptor);
+static int  direct_invoke_child_command(int argc, char **argv, const char *const cfg_file,
+                                        sessionState &shm_session, const std::string &cmd);
 
 static void (* const shm_allocator_cleanup)(shm::ShmAllocator*) = [](shm::ShmAllocator *p) {
   if (p != nullptr) {
@@ -186,8 +220,15 @@ static void (* const shm_allocator_cleanup)(shm::ShmAllocator*) = [](shm::ShmAll
 };
 using shm_allocator_sp_t = std::unique_ptr<shm::ShmAllocator, decltype(shm_allocator_cleanup)>;
 static shm_allocator_sp_t s_shm_allocator_sp(nullptr, shm_allocator_cleanup);
-
-static int(*send_supervisor_mq_msg)(const char*) = [](const char*/*msg*/) -> int { return EXIT_SUCCESS; };
+static std::unique_ptr<warm_pool::WarmPool> s_warm_pool_sp; // only ever populated in the launcher process
+static std::unique_ptr<persistent_workers::PersistentWorkers> s_persistent_workers_sp; // likewise
+static std::unique_ptr<lifecycle_notify::Batcher> s_notify_batcher_sp; // likewise
+static std::unique_ptr<supervisor_executor::Executor> s_supervisor_executor_sp; // only ever populated in the supervisor
+static bool s_is_persistent_worker = false; // set in a persistent worker child process - it outlives each invocation
+
+static int(*send_supervisor_mq_msg)(string_view, unsigned) = [](string_view/*msg*/, unsigned/*msg_prio*/) -> int {
+  return EXIT_SUCCESS;
+};
 static std::function<void(int)> quit_launcher_on_term_code{ [](int status_code){ _exit(status_code); } };
 static std::function<void(int)> quit_supervisor_on_term_code{ [](int/*status_code*/){} };
 
@@ -256,27 +297,28 @@ extern "C" SO_EXPORT int one_time_init_main(int argc, char **argv)
   return forkable_main_entry(argc, argv, false);
 }
 
-enum class Operation : short { NONE, SERVICE, INVOKED_COMMAND, STATUS, STOP, COMMAND };
+enum class Operation : short { NONE, SERVICE, INVOKED_COMMAND, STATUS, STOP, PROFILE, COMMAND };
 using OP = Operation;
 
 extern "C" SO_EXPORT int forkable_main_entry(int argc, char **argv, const bool is_extended_invoke) {
   volatile int exit_code = EXIT_SUCCESS;
 
+  // the launcher is only sent control plane messages this way (stop, profile)
   static auto const send_launcher_mq_msg = [](const char * const msg) -> int {
     if (flag != 0) return EXIT_SUCCESS; // flag when non-zero indicates was signaled to terminate
-    return send_mq_msg::send_mq_msg(msg, s_jlauncher_queue_name.c_str());
+    return send_mq_msg::send_mq_msg(msg, s_jlauncher_queue_name.c_str(), send_mq_msg::PRIO_CONTROL);
   };
 
-  send_supervisor_mq_msg = [](const char * const msg) -> int {
+  send_supervisor_mq_msg = [](string_view const msg, unsigned msg_prio) -> int {
     if (flag != 0) return EXIT_SUCCESS; // flag when non-zero indicates was signaled to terminate
-    return send_mq_msg::send_mq_msg(msg, s_jsupervisor_queue_name.c_str());
+    return send_mq_msg::send_mq_msg(msg, s_jsupervisor_queue_name.c_str(), msg_prio);
   };
 
   // static lambda (with closure) that is now defined to send
   // the stop message and cause the supervisor program to exit
   quit_supervisor_on_term_code = [&exit_code](int term_code) {
     exit_code = term_code;
-    send_supervisor_mq_msg(STOP_CMD.c_str());
+    send_supervisor_mq_msg(STOP_CMD.c_str(), send_mq_msg::PRIO_CONTROL);
   };
 
   // static lambda (with closure) that is now defined to send
@@ -304,9 +346,12 @@ extern "C" SO_EXPORT int forkable_main_entry(int argc, char **argv, const bool i
       static const string_view pipe_optn{ "pipe=" };
       static const string_view status_cmd{ "status" };
       static const string_view stop_cmd{ "stop" };
+      static const string_view profile_cmd{ "profile" };
+      static const string_view direct_optn{ "direct" };
       std::string pipe_option{}, command{};
       std::string uds_socket_name_arg{};
       Operation operation = OP::NONE;
+      bool is_direct = false; // run a child processor command in this process instead of dispatching it
 
       // Iterate through command line arguments and set the operation that needs to be performed.
       // (The first encountered, recognized operation, is the one that is selected to be done;
@@ -323,6 +368,8 @@ extern "C" SO_EXPORT int forkable_main_entry(int argc, char **argv, const bool i
               operation = OP::INVOKED_COMMAND;
               pipe_option = argv[i];
             }
+          } else if (strcasecmp(optn, direct_optn.c_str()) == 0) {
+            is_direct = true;
           }
         } else {
           const char * const optn = argv[i];
@@ -336,6 +383,12 @@ extern "C" SO_EXPORT int forkable_main_entry(int argc, char **argv, const bool i
               operation = OP::STOP;
               command = stop_cmd.c_str();
             }
+          } else if (operation == OP::NONE && strcasecmp(optn, profile_cmd.c_str()) == 0) {
+            operation = OP::PROFILE;
+            command = PROFILE_CMD.c_str();
+          } else if (operation == OP::PROFILE) {
+            command += ' ';
+            command += optn; // the command to profile and then on or off
           } else {
             if (operation == OP::NONE) {
               operation = OP::COMMAND;
@@ -354,12 +407,19 @@ extern "C" SO_EXPORT int forkable_main_entry(int argc, char **argv, const bool i
         switch (operation) {
           case OP::SERVICE: {
             log(LL::INFO, "started as a service");
+            timeline_trace::begin();
+            auto start_us = timeline_trace::now_us();
             const std::string jvmlib_path = determine_jvmlib_path();
+            timeline_trace::complete("determine_jvmlib_path", start_us);
+            start_us = timeline_trace::now_us();
             sessionState session(cfg_file.c_str(), jvmlib_path.c_str());
+            timeline_trace::complete("sessionState config", start_us);
+            timeline_trace::config_done();
             const auto rtn_code = supervisor(argc, argv, session);
             if (exit_code == 0) {
               exit_code = rtn_code;
             }
+            timeline_trace::end();
             break;
           }
           case OP::INVOKED_COMMAND: {
@@ -378,7 +438,10 @@ extern "C" SO_EXPORT int forkable_main_entry(int argc, char **argv, const bool i
           case OP::STATUS: { ;
             // request a status as output to a response stream
             auto rslt = bind_uds_socket_name(command.c_str());
-            exit_code = client_status_request(std::get<1>(rslt), std::move(std::get<0>(rslt)), send_supervisor_mq_msg);
+            exit_code = client_status_request(std::get<1>(rslt), std::move(std::get<0>(rslt)),
+                                              [](const char * const msg) -> int {
+                                                return send_supervisor_mq_msg(msg, send_mq_msg::PRIO_CONTROL);
+                                              });
             break;
           }
           case OP::STOP: { ;
@@ -387,39 +450,53 @@ extern "C" SO_EXPORT int forkable_main_entry(int argc, char **argv, const bool i
             exit_code = send_launcher_mq_msg(STOP_CMD.c_str());
             break;
           }
+          case OP::PROFILE: {
+            // issue a message to the launcher that switches JFR profiling of a child command on or off
+            exit_code = send_launcher_mq_msg(command.c_str());
+            break;
+          }
           case OP::COMMAND: {
             do_loop = false; /***** fall out of the loop after processing the subcommand *****/
 
             using cmd_t = decltype(command);
             std::transform(command.begin(), command.end(), command.begin(), ::tolower);
 
-            sessionState shm_session;
-            cmd_dsp::get_cmd_dispatch_info(shm_session);
-            if (!shm_session.spartanLoggingLevel.empty()) {
-              auto const logging_level = logger::str_to_level(shm_session.spartanLoggingLevel.c_str());
+            // the session image in shared memory is used in place - there's nothing to parse to dispatch
+            const cmd_dsp::SessionImage shm_image;
+            const ss_image::view &ss_img = shm_image.view();
+            if (!ss_img.logging_level().empty()) {
+              auto const logging_level = logger::str_to_level(ss_img.logging_level().data());
               logger::set_level(logging_level);
             }
-            auto const cmds_set(cmd_dsp::get_child_processor_commands(shm_session));
-            using cmds_set_t = decltype(cmds_set);
-            if (is_trace_level()) {
-              for (auto const &e: cmds_set) {
-                log(LL::TRACE, "set item: \"%s\"", e.c_str());
+            const bool is_child_cmd = ss_img.is_child_processor_command({command.c_str(), command.size()});
+            const pid_t supervisor_pid = ss_img.supervisor_pid();
+
+            // a child processor command in -direct mode is run in this process, on a JVM that it creates
+            // itself, with the real stdout/stderr/stdin (not when invoked via Spartan.invokeCommand())
+            if (is_direct && uds_socket_name_arg.empty()) {
+              if (is_child_cmd) {
+                sessionState shm_session;
+                ss_img.to_session_state(shm_session);
+                exit_code = direct_invoke_child_command(argc, argv, cfg_file.c_str(), shm_session, command);
+                break;
               }
+              log(LL::WARN, "-direct applies to child processor commands only; dispatching supervisor command: %s",
+                  command.c_str());
             }
 
             // Obtain the appropriate mq queue name - is either the jlauncher queue or is the jsupervisor queue
-            auto const mq_queue_name = [](cmds_set_t const &cs, cmd_t const &c) -> string_view {
-              if (cs.count(c) > 0) {
+            auto const mq_queue_name = [](const bool is_child, cmd_t const &c) -> string_view {
+              if (is_child) {
                 log(LL::DEBUG, "running child processor command: %s", c.c_str());
                 return s_jlauncher_queue_name;
               }
               log(LL::DEBUG, "running supervisor command: %s", c.c_str());
               return s_jsupervisor_queue_name;
-            }(cmds_set, command);
+            }(is_child_cmd, command);
 
             // All other command line options ("option_name ...") will
             // be assumed to be a subcommand that writes a result back to
-            // an output stream, so a unix datagram bind name is provided
+            // an output stream, so a unix seqpacket bind name is provided
             // as the first argument in the message sent, followed by
             // the rest of the command line; will filter out the option
             // '-pipe=%s' if it was present.
@@ -454,7 +531,7 @@ extern "C" SO_EXPORT int forkable_main_entry(int argc, char **argv, const bool i
             if (exit_code == EXIT_SUCCESS && uds_socket_name_arg.empty()) {
               // there is no caller of Spartan.InvokeCommand() APIs so handle response stream right here
               exit_code = stdout_echo_response_stream(uds_socket_name, std::move(socket_read_fd_sp),
-                                                      shm_session.supervisor_pid);
+                                                      supervisor_pid);
             }
             break;
           }
@@ -495,7 +572,7 @@ static void supervisor_status_response(std::string uds_socket_name, JavaVM *cons
                                        const methodDescriptor meth_desc)
 {
   int rc;
-  log(LL::DEBUG, "%s(): open unix-datagram-socket %s for conveying pipe fd for writing",
+  log(LL::DEBUG, "%s(): connect unix-seqpacket-socket %s for conveying pipe fd for writing",
       __func__, uds_socket_name.c_str());
 
   auto fd_sp = open_write_anon_pipe({uds_socket_name.c_str(), uds_socket_name.size()}, rc);
@@ -533,8 +610,20 @@ static int client_status_request(std::string const &uds_socket_name, fd_wrapper_
   return rtn == EXIT_SUCCESS ? stdout_echo_response_stream(uds_socket_name, std::move(socket_fd_sp)) : rtn;
 }
 
+// set on the threads of the supervisor executor, which are attached to the JVM once for their lifetime
+static thread_local bool t_is_jvm_attached = false;
+
+// a thread attached for its lifetime never returns to Java, so its local references would pile up - an
+// invocation on it is instead bracketed by a local reference frame that jni_detach_thread() then pops
 inline JNIEnv* jni_attach_thread(JavaVM * const jvmp) {
   JNIEnv *envp = nullptr;
+  if (t_is_jvm_attached) {
+    if (jvmp->GetEnv((void**)&envp, JNI_VERSION_1_6) == JNI_OK && envp->PushLocalFrame(64) == JNI_OK) {
+      return envp;
+    }
+    log(LL::ERR, "%s(): attached thread failed obtaining its JNIEnv or a local reference frame", __func__);
+    return nullptr;
+  }
   jvmp->AttachCurrentThreadAsDaemon((void**)&envp, nullptr);
   return envp;
 }
@@ -546,9 +635,25 @@ inline int jni_detach_thread(JavaVM * const jvmp, JNIEnv * const envp) {
     const auto excptn_str = StdOutCapture::capture_stdout_stderr([envp](){ envp->ExceptionDescribe(); });
     log(LL::ERR, excptn_str.c_str());
   }
+  if (t_is_jvm_attached) {
+    if (envp != nullptr) {
+      envp->PopLocalFrame(nullptr);
+    }
+    return ret; // stays attached for the next invocation
+  }
   return jvmp->DetachCurrentThread() != JNI_OK ? EXIT_FAILURE : ret;
 }
 
+// the JDK classes and members of upcalls, as resolved by jni_registry::init() when the JVM was created
+static const jni_registry::jdk_t& upcall_jdk(const char *&class_name) {
+  auto const jdk = jni_registry::jdk();
+  if (jdk == nullptr) {
+    class_name = "java/lang/Object{JDK classes of the JNI registry}";
+    throw 3;
+  }
+  return *jdk;
+}
+
 // utility function that invokes a Java method
 static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &method_descriptor,
                               std::array<fd_wrapper_sp_t, 3> &&fds_array,
@@ -593,12 +698,13 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
 
     defer_jobj_t spJargs_array(nullptr, defer_jobj);
 
+    const jni_registry::jdk_t &jdk = upcall_jdk(class_name);
+
     jobjectArray jargs = nullptr;
-    if (argv != nullptr) {
+    if (argv != nullptr && method_descriptor.which_method() != WM::CHILD_BATCH_NOTIFY) {
       // create Java array of strings corresponding to the main(argc,argv) strings (minus the first arg)
       log(LL::DEBUG, "%s() create jobjectArray", __func__);
-      auto const jstr_cls = env->FindClass("java/lang/String");
-      auto const jargs_tmp = env->NewObjectArray(argc - 1, jstr_cls, nullptr);
+      auto const jargs_tmp = env->NewObjectArray(argc - 1, jdk.string_cls, nullptr);
       if (jargs_tmp == nullptr) throw 2;
       spJargs_array.reset(jargs_tmp);
       for(int i = 1, j = 0; i < argc; i++) {
@@ -609,11 +715,11 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
       jargs = jargs_tmp;
     }
 
-    jclass const cls = env->FindClass(class_name);
+    // get the entry point method (resolved on its first invocation and then held by the registry)
+    const auto entry_method = jni_registry::find_method(env, class_name, method_name, method_signature, invokeAsStatic);
+    jclass const cls = entry_method.cls;
     if (cls == nullptr) throw 3;
-    // get the entry point method
-    jmethodID const mid = invokeAsStatic ?  env->GetStaticMethodID(cls, method_name, method_signature) :
-                                            env->GetMethodID(cls, method_name, method_signature);
+    jmethodID const mid = entry_method.mid;
     if (mid == nullptr) throw 4;
 
     if (!invokeAsStatic) {
@@ -647,40 +753,11 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
 
     // set system class loader on current thread context
     {
-      // save state of these local variables (may be referenced in caught exception handling code below)
-      const char * const class_name_sav  = class_name;
-      const char * const method_name_sav = method_name;
-
-      class_name = "java/lang/ClassLoader";
-      jclass const clsLdr_cls = env->FindClass(class_name);
-      if (clsLdr_cls == nullptr) throw 3;
-      method_name = "getSystemClassLoader";
-      jmethodID const getSysClsLdr = env->GetStaticMethodID(clsLdr_cls, method_name, "()Ljava/lang/ClassLoader;");
-      if (getSysClsLdr == nullptr) throw 4;
-
-      // get system class loader
-      defer_jobj_t spClsLdrObj(env->CallStaticObjectMethod(clsLdr_cls, getSysClsLdr), defer_jobj);
-
-      class_name = "java/lang/Thread";
-      jclass const thrd_cls = env->FindClass(class_name);
-      if (thrd_cls == nullptr) throw 3;
-      method_name = "currentThread";
-      jmethodID const currThrd = env->GetStaticMethodID(thrd_cls, method_name, "()Ljava/lang/Thread;");
-      if (currThrd == nullptr) throw 4;
-
       // get current thread object
-      defer_jobj_t spCurrThrdObj(env->CallStaticObjectMethod(thrd_cls, currThrd), defer_jobj);
-
-      method_name = "setContextClassLoader";
-      jmethodID const setCntxClsLdr = env->GetMethodID(thrd_cls, method_name, "(Ljava/lang/ClassLoader;)V");
-      if (setCntxClsLdr == nullptr) throw 4;
+      defer_jobj_t spCurrThrdObj(env->CallStaticObjectMethod(jdk.thread_cls, jdk.current_thread), defer_jobj);
 
       // now set the system class loader on the current thread object as the thread's context class loader
-      env->CallVoidMethod(spCurrThrdObj.get(), setCntxClsLdr, spClsLdrObj.get());
-
-      // restore state of these local variables
-      class_name  = class_name_sav;
-      method_name = method_name_sav;
+      env->CallVoidMethod(spCurrThrdObj.get(), jdk.set_context_class_loader, jdk.system_class_loader);
     }
 
     try {
@@ -689,11 +766,8 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
 
       const auto which_method = method_descriptor.which_method();
       if (which_method == WM::GET_CMD_DISPATCH_INFO) {
-        jclass const jcls = env->FindClass(class_name);
-        if (jcls == nullptr) throw 3;
-
-        jmethodID const get_cmd_dispatch_info = env->GetStaticMethodID(jcls, method_name, method_descriptor.desc_str());
-        if (get_cmd_dispatch_info == nullptr) throw 4;
+        jclass const jcls = cls;
+        jmethodID const get_cmd_dispatch_info = mid;
 
         sessionState ss;
         assert(pss != nullptr); // for this code logic flow, pss should not be null
@@ -702,22 +776,27 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
         }
 
         log(LL::DEBUG, "%s() invoking static method \"%s\"", __func__, fullMethodName);
+        auto start_us = timeline_trace::now_us();
         auto const ser_cmd_dispatch_info = env->CallStaticObjectMethod(jcls, get_cmd_dispatch_info);
         was_exception_raised = env->ExceptionCheck() != JNI_FALSE;
+        timeline_trace::complete("annotation scan (JNI)", start_us);
 
         if (!was_exception_raised) {
+          start_us = timeline_trace::now_us();
           cmd_dsp::CmdDispatchInfoProcessor processCDI(env, class_name, method_name, jcls, ss);
           auto pshm = processCDI.process_initial_cmd_dispatch_info(reinterpret_cast<jbyteArray>(ser_cmd_dispatch_info));
           s_shm_allocator_sp.reset(pshm);
+          timeline_trace::complete("shm publish of command dispatch info", start_us);
         }
       } else if (which_method == WM::MAIN) {
         // invoke the static method main() entry point
         const char *const class_name_sav = class_name;
         class_name = "spartan/SpartanBase";
-        jclass const spartanbase_cls = env->FindClass(class_name);
+        const auto spartanbase_main_method = jni_registry::find_method(env, class_name, method_name,
+            "(Ljava/lang/String;ILjava/lang/reflect/Method;[Ljava/lang/String;)V", true);
+        jclass const spartanbase_cls = spartanbase_main_method.cls;
         if (spartanbase_cls == nullptr) throw 3;
-        jmethodID const spartanbase_main = env->GetStaticMethodID(spartanbase_cls, method_name,
-                                                                  "(Ljava/lang/String;ILjava/lang/reflect/Method;[Ljava/lang/String;)V");
+        jmethodID const spartanbase_main = spartanbase_main_method.mid;
         if (spartanbase_main == nullptr) throw 4;
         defer_jobj_t spMain_meth(env->ToReflectedMethod(cls, mid, JNI_TRUE), defer_jobj);
         class_name = class_name_sav;
@@ -739,75 +818,51 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
           case WM::SUPERVISOR_DO_CMD: {
             log(LL::DEBUG, "%s() prepare to invoke method taking response stream argument...", __func__);
 
-            auto const make_and_set_fdesc = [env, &class_name, &method_name, &defer_jobj]
-                () -> std::function<defer_jobj_t(int)>
-            {
-              static const char *const fdesc_cls_name = "java/io/FileDescriptor";
-              auto const cls_fdesc = env->FindClass(fdesc_cls_name);
-              if (cls_fdesc == nullptr) {
-                class_name = fdesc_cls_name;
-                throw 3;
-              }
+            // the FileDescriptor objects handed to the Java method (see invalidate_fdescs below)
+            std::vector<defer_jobj_t> fdescs;
 
-              auto const ctor_fdesc = env->GetMethodID(cls_fdesc, ctor_name, "()V");
-              if (ctor_fdesc == nullptr) {
+            auto const make_and_set_fdesc = [env, &jdk, &class_name, &defer_jobj, &fdescs](const int fd) -> defer_jobj_t {
+              static const char *const fdesc_cls_name = "java/io/FileDescriptor";
+              // construct a new FileDescriptor
+              defer_jobj_t sp_fdesc_jobj(env->NewObject(jdk.fdesc_cls, jdk.fdesc_ctor), defer_jobj);
+              if (!sp_fdesc_jobj) {
                 class_name = fdesc_cls_name;
-                method_name = ctor_name;
-                throw 4;
+                throw 5;
               }
 
-              return [env, &class_name, cls_fdesc, ctor_fdesc, &defer_jobj](const int fd) -> defer_jobj_t
-              {
-                // construct a new FileDescriptor
-                defer_jobj_t sp_fdesc_jobj(env->NewObject(cls_fdesc, ctor_fdesc), defer_jobj);
-                if (!sp_fdesc_jobj) {
-                  class_name = fdesc_cls_name;
-                  throw 5;
-                }
+              // poke the "fd" field with the file descriptor
+              env->SetIntField(sp_fdesc_jobj.get(), jdk.fdesc_fd, fd);
+              fdescs.emplace_back(env->NewLocalRef(sp_fdesc_jobj.get()), defer_jobj);
 
-                // poke the "fd" field with the file descriptor
-                auto const field_fd = env->GetFieldID(cls_fdesc, "fd", "I");
-                assert(field_fd != nullptr);
-                if (field_fd == nullptr) throw -1;
-                env->SetIntField(sp_fdesc_jobj.get(), field_fd, fd);
+              return sp_fdesc_jobj;
+            };
 
-                return sp_fdesc_jobj;
-              };
-            }();
+            // in a forked child process the streams a Java method leaves open are closed by the process exit; a
+            // persistent worker goes on to its next invocation, so it closes them here - else the fds leak and the
+            // client waits forever on their end of file. The FileDescriptor is set to -1 first so that Java can't go
+            // on to close the fd number once it has been reused.
+            auto const invalidate_fdescs = [env, &jdk, &fdescs, &defer_jobj]() {
+              if (!s_is_persistent_worker) return;
+              defer_jobj_t sp_pending_excptn(env->ExceptionOccurred(), defer_jobj);
+              env->ExceptionClear();
+              for (auto const &sp_fdesc : fdescs) {
+                const int fd = env->GetIntField(sp_fdesc.get(), jdk.fdesc_fd);
+                if (fd != -1) {
+                  env->SetIntField(sp_fdesc.get(), jdk.fdesc_fd, -1);
+                  close(fd);
+                }
+              }
+              if (sp_pending_excptn) {
+                env->Throw(static_cast<jthrowable>(sp_pending_excptn.get()));
+              }
+            };
 
-            auto const make_printstream = [env, &class_name, &method_name, &defer_jobj]
+            auto const make_printstream = [env, &jdk, &class_name, &defer_jobj]
                 (defer_jobj_t &&sp_fdesc_jobj) -> defer_jobj_t
             {
               static const char *const prtstrm_cls_name = "java/io/PrintStream";
-              auto const cls_prtstrm = env->FindClass(prtstrm_cls_name);
-              if (cls_prtstrm == nullptr) {
-                class_name = prtstrm_cls_name;
-                throw 3;
-              }
-
-              auto const ctor_prtstrm = env->GetMethodID(cls_prtstrm, ctor_name, "(Ljava/io/OutputStream;)V");
-              if (ctor_prtstrm == nullptr) {
-                class_name = prtstrm_cls_name;
-                method_name = ctor_name;
-                throw 4;
-              }
-
               static const char *const file_output_strm_cls_name = "java/io/FileOutputStream";
-              auto const cls_file_output_strm = env->FindClass(file_output_strm_cls_name);
-              if (cls_file_output_strm == nullptr) {
-                class_name = file_output_strm_cls_name;
-                throw 3;
-              }
-
-              auto const ctor_file_output_strm = env->GetMethodID(cls_file_output_strm, ctor_name,
-                                                                  "(Ljava/io/FileDescriptor;)V");
-              if (ctor_file_output_strm == nullptr) {
-                class_name = file_output_strm_cls_name;
-                method_name = ctor_name;
-                throw 4;
-              }
-
-              auto const f_output_strm = env->NewObject(cls_file_output_strm, ctor_file_output_strm,
+              auto const f_output_strm = env->NewObject(jdk.file_output_strm_cls, jdk.file_output_strm_ctor,
                                                         sp_fdesc_jobj.get());
               if (f_output_strm == nullptr) {
                 class_name = file_output_strm_cls_name;
@@ -816,7 +871,8 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
               defer_jobj_t spObj_file_output_strm{f_output_strm, defer_jobj};
 
               // instantiate and construct a new PrintStream object
-              auto const obj_prt_strm = env->NewObject(cls_prtstrm, ctor_prtstrm, spObj_file_output_strm.get());
+              auto const obj_prt_strm = env->NewObject(jdk.print_strm_cls, jdk.print_strm_ctor,
+                                                       spObj_file_output_strm.get());
               if (obj_prt_strm == nullptr) {
                 class_name = prtstrm_cls_name;
                 throw 5;
@@ -825,26 +881,12 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
               return {obj_prt_strm, defer_jobj};
             };
 
-            auto const make_inputstream = [env, &class_name, &method_name, &defer_jobj]
+            auto const make_inputstream = [env, &jdk, &class_name, &defer_jobj]
                 (defer_jobj_t &&sp_fdesc_jobj) -> defer_jobj_t
             {
               static const char *const file_input_strm_cls_name = "java/io/FileInputStream";
-              auto const cls_file_input_strm = env->FindClass(file_input_strm_cls_name);
-              if (cls_file_input_strm == nullptr) {
-                class_name = file_input_strm_cls_name;
-                throw 3;
-              }
-
-              auto const ctor_file_input_strm = env->GetMethodID(cls_file_input_strm, ctor_name,
-                                                                 "(Ljava/io/FileDescriptor;)V");
-              if (ctor_file_input_strm == nullptr) {
-                class_name = file_input_strm_cls_name;
-                method_name = ctor_name;
-                throw 4;
-              }
-
               // instantiate and construct a new FileInputStream object
-              auto const obj_input_strm = env->NewObject(cls_file_input_strm, ctor_file_input_strm,
+              auto const obj_input_strm = env->NewObject(jdk.file_input_strm_cls, jdk.file_input_strm_ctor,
                                                          sp_fdesc_jobj.get());
               if (obj_input_strm == nullptr) {
                 class_name = file_input_strm_cls_name;
@@ -883,6 +925,7 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
                 // invoke a child process sub-command with three react streams (static method entry point)
                 env->CallStaticVoidMethod(cls, mid, jargs, spRsp_strm.get(), spErrOut_strm.get(), spInput_strm.get());
               }
+              invalidate_fdescs();
               break; // disregard checking for Java exceptions thrown by spawned child process
             }
             if (which_method == WM::GET_STATUS) {
@@ -910,6 +953,7 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
                 env->CallVoidMethod(mObj, mid, jargs, spRsp_strm.get(), spErrOut_strm.get(), spInput_strm.get());
               }
             }
+            invalidate_fdescs();
             if (env->ExceptionCheck() != JNI_FALSE) {
               const auto excptn_str = StdOutCapture::capture_stdout_stderr([env]() { env->ExceptionDescribe(); });
               auto const excptn_cstr = excptn_str.c_str();
@@ -940,6 +984,39 @@ static int invoke_java_method(JavaVM *const jvmp, const methodDescriptorBase &me
             env->CallVoidMethod(mObj, mid, pid);
             break;
           }
+          case WM::CHILD_BATCH_NOTIFY: {
+            log(LL::DEBUG, "%s() invoking method \"%s\"", __func__, fullMethodName);
+            // argv[0] is the batch command, followed by a (kind, pid, command line or exit status) triple per event
+            const auto count = static_cast<jsize>((argc - 1) / 3);
+            std::vector<jint> pids(static_cast<size_t>(count)), exit_statuses(static_cast<size_t>(count));
+            static const char * const arrays_desc = "int[]/java/lang/String[]{\"child process notifications\"}";
+            defer_jobj_t spPids(env->NewIntArray(count), defer_jobj);
+            defer_jobj_t spExit_statuses(env->NewIntArray(count), defer_jobj);
+            defer_jobj_t spCmd_lines(env->NewObjectArray(count, jdk.string_cls, nullptr), defer_jobj);
+            if (!spPids || !spExit_statuses || !spCmd_lines) {
+              class_name = arrays_desc;
+              throw 5;
+            }
+            for (jsize i = 0; i < count; i++) {
+              char * const * const event = &argv[1 + i * 3];
+              pids[i] = static_cast<jint>(strtol(event[1], nullptr, 10));
+              if (lifecycle_notify::STARTED == event[0]) {
+                // a start notification has its command line (and no exit status)
+                defer_jstr_t spUtf_str(env->NewStringUTF(event[2]), defer_jstr);
+                if (!spUtf_str) {
+                  class_name = "java/lang/String{\"child process command line arguments\"}";
+                  throw 5;
+                }
+                env->SetObjectArrayElement(static_cast<jobjectArray>(spCmd_lines.get()), i, spUtf_str.get());
+              } else {
+                exit_statuses[i] = static_cast<jint>(strtol(event[2], nullptr, 10));
+              }
+            }
+            env->SetIntArrayRegion(static_cast<jintArray>(spPids.get()), 0, count, pids.data());
+            env->SetIntArrayRegion(static_cast<jintArray>(spExit_statuses.get()), 0, count, exit_statuses.data());
+            env->CallVoidMethod(mObj, mid, spPids.get(), spCmd_lines.get(), spExit_statuses.get());
+            break;
+          }
           default: // do nothing
             log(LL::WARN, "%s() not valid or known method \"%s\"", __func__, fullMethodName);
             break;
@@ -1016,15 +1093,47 @@ static int supervisor(int argc, char **argv, sessionState& session) {
   std::atomic_int child_process_count = {1}; // account for the JVM main() method process
   sessionState shm_session;
 
-  auto const waitid_on_forked_children = [](std::function<bool()> child_process_completion_proc) {
+  // the dispatching thread holds it from the start of a child process through to its registration, so the
+  // event loop thread can't process the reaping of a child process (one that exits at once) before the launcher
+  // has recorded it as started
+  static std::mutex child_registration_mutex;
+
+  // handles a forked child process that waitid() reaped; returns true if no more child processes are to be waited on
+  auto const on_child_reaped = [](const siginfo_t &info, const struct rusage &ru,
+                                  const std::function<bool()> &child_process_completion_proc) -> bool {
+    std::lock_guard<std::mutex> lk(child_registration_mutex);
+    if (info.si_code == CLD_EXITED || info.si_code == CLD_KILLED || info.si_code == CLD_DUMPED) {
+      heap_history::record(info.si_pid, info.si_code == CLD_EXITED ? info.si_status : 128 + info.si_status, ru);
+      jfr_profiling::reap(info.si_pid);
+    }
+    if (app_cds::reap(info.si_pid, info.si_code == CLD_EXITED ? info.si_status : -1)) {
+      return false; // was a background AppCDS archive dump process
+    }
+    if (s_warm_pool_sp && s_warm_pool_sp->reap(info.si_pid)) {
+      return false; // was an idle warm pool child process - was never accounted for as a dispatched command
+    }
+    if (s_persistent_workers_sp && s_persistent_workers_sp->reap(info.si_pid)) {
+      if (!jvm_shutting_down) {
+        supervisor_child_processor_completion_notify(info); // in case exited during an invocation
+      }
+      return false; // invocations of a persistent worker are not held against the child process count
+    }
+    admission::reap(info.si_pid);
+    const bool done = child_process_completion_proc();
+    if (!jvm_shutting_down) {
+      supervisor_child_processor_completion_notify(info);
+    }
+    return done;
+  };
+
+  auto const waitid_on_forked_children = [&on_child_reaped](std::function<bool()> child_process_completion_proc) {
     bool done = false;
     siginfo_t info {0};
+    struct rusage ru {};
     do {
-      if (waitid(P_ALL, 0, &info, WEXITED|WSTOPPED) == 0) {
-        done = child_process_completion_proc();
-        if (!jvm_shutting_down) {
-          supervisor_child_processor_completion_notify(info);
-        }
+      // the raw waitid system call also yields the rusage of the reaped child process (its peak RSS)
+      if (syscall(SYS_waitid, P_ALL, 0, &info, WEXITED|WSTOPPED, &ru) == 0) {
+        done = on_child_reaped(info, ru, child_process_completion_proc);
       } else {
         const auto rc = errno;
         switch(rc) {
@@ -1044,6 +1153,25 @@ static int supervisor(int argc, char **argv, sessionState& session) {
     } while (!done);
   };
 
+  // non-blocking counterpart of waitid_on_forked_children() - reaps every child process that has already
+  // terminated; the launcher event loop calls it upon SIGCHLD (which coalesces when several children exit)
+  auto const reap_forked_children = [&on_child_reaped](const std::function<bool()> &child_process_completion_proc) {
+    for(;;) {
+      siginfo_t info {0};
+      struct rusage ru {};
+      if (syscall(SYS_waitid, P_ALL, 0, &info, WEXITED|WSTOPPED|WNOHANG, &ru) != 0) {
+        const auto rc = errno;
+        if (rc == EINTR) continue;
+        if (rc != ECHILD) {
+          log(LL::ERR, "waitid() returned on error: %s", strerror(rc));
+        }
+        return;
+      }
+      if (info.si_pid == 0) return; // no more terminated child processes
+      on_child_reaped(info, ru, child_process_completion_proc);
+    }
+  };
+
   struct {
     pid_t pid;
     std::thread jvm_thrd;
@@ -1062,7 +1190,14 @@ static int supervisor(int argc, char **argv, sessionState& session) {
             shutting_down = true;
             set_exit_flag_true();
             const auto jsupervisor_queue_name = get_jsupervisor_mq_queue_name(progname());
-            exit_code = send_mq_msg::send_mq_msg(SHUTDOWN_CMD.c_str(), jsupervisor_queue_name.c_str());
+            exit_code = send_mq_msg::send_mq_msg(SHUTDOWN_CMD.c_str(), jsupervisor_queue_name.c_str(),
+                                                 send_mq_msg::PRIO_CONTROL);
+            if (s_warm_pool_sp) {
+              s_warm_pool_sp->shutdown(); // release idle warm pool child processes so that they exit
+            }
+            if (s_persistent_workers_sp) {
+              s_persistent_workers_sp->shutdown(); // likewise release the persistent workers
+            }
             // waitid on all forked child processes - including the supervisor JVM process
             waitid_on_forked_children(std::function<bool()>([&child_process_count]() -> bool {
               return (child_process_count--) <= 0;
@@ -1092,15 +1227,19 @@ static int supervisor(int argc, char **argv, sessionState& session) {
                                                                                   std::thread &jvm_thrd) -> int
   {
     int fork_exit_code = EXIT_SUCCESS;
+    const auto fork_start_us = timeline_trace::now_us();
     pid = fork();
     if (pid == -1) {
       fork_exit_code = EXIT_FAILURE; // fork failed so harvest the result code and return that to caller and then terminate
       log(LL::ERR, "pid(%d): fork() of Java main() entry point failed: %s", getpid(), strerror(errno));
     } else if (pid != 0) {
+      timeline_trace::complete("fork supervisor", fork_start_us);
       mq_queue_name = get_jlauncher_mq_queue_name(progname());
       log(LL::TRACE, "jlauncher pid(%d): successfully forked Java main() entry point child process %d", getpid(), pid);
     } else {
       is_launcher_process = false;
+      timeline_trace::process_name("supervisor");
+      timeline_trace::complete("forked", fork_start_us);
       signal(SIGINT, SIG_IGN);
       mq_queue_name = get_jsupervisor_mq_queue_name(progname());
       session.supervisor_pid = getpid();
@@ -1174,7 +1313,7 @@ static int supervisor(int argc, char **argv, sessionState& session) {
   int try_attempts = 2;
 try_again:
   // open mq queue and place into smart pointer for RAII
-  mq_attr attr = { 0, 10, MSG_BUF_SZ, 0 };
+  mq_attr attr = { 0, get_mq_max_msgs(MSG_BUF_SZ), MSG_BUF_SZ, 0 };
   const auto mqd = send_mq_msg::mq_open_ex(mq_queue_name.c_str(), O_CREAT | O_EXCL | O_RDONLY, 0662, &attr);
   struct wrp_mqd_t {
     const mqd_t _mqd{-1};
@@ -1212,144 +1351,385 @@ try_again:
   log(LL::TRACE, "mq_flags %ld, max_msgs %ld, msg_size %ld, curr_msgs %ld\n\t\t mq queue name '%s'",
       attr.mq_flags, attr.mq_maxmsg, attr.mq_msgsize, attr.mq_curmsgs, mq_queue_name.c_str());
 
-  // state variables for the C++11 msg work queue - the msg will be the
-  // command line args of a forked child process Java method invocation
-  // or a Java method invocation on the supervisor
-//  static std::mutex m;
-  static std::condition_variable cv;
-  static std::timed_mutex qm;
-  static std::condition_variable_any qcv;
+  // messages too large for the mq queue arrive via its msg ring (shared memory) - see send_mq_msg::send_mq_msg()
+  std::unique_ptr<msg_ring::MsgRing> msg_ring_sp;
+  if (msg_ring::size_kb() > 0) {
+    msg_ring_sp = msg_ring::MsgRing::create(mq_queue_name, static_cast<size_t>(msg_ring::size_kb()) * 1024);
+  }
+
+  // the launcher's child process lifecycle notifications to the supervisor are coalesced into batches, which
+  // are sent on a supervisor queue descriptor that stays open (rather than an mq_open()/mq_close() per message)
+  if (is_launcher_process) {
+    send_mq_msg::keep_open(s_jsupervisor_queue_name);
+    s_notify_batcher_sp.reset(new lifecycle_notify::Batcher([](string_view const msg) -> int {
+      return send_supervisor_mq_msg(msg, send_mq_msg::PRIO_NOTIFY);
+    }, MSG_BUF_SZ));
+  } else {
+    // the supervisor's Java method invocations run on a pool of threads that are attached to the JVM up front
+    JavaVM * const jvmp = shm_session.jvm_sp.get();
+    s_supervisor_executor_sp.reset(new supervisor_executor::Executor(
+        static_cast<size_t>(supervisor_executor::pool_size()),
+        [jvmp]() {
+          JNIEnv *envp = nullptr;
+          if (jvmp->AttachCurrentThreadAsDaemon((void**)&envp, nullptr) == JNI_OK) {
+            t_is_jvm_attached = true;
+          } else {
+            log(LL::ERR, "pid(%d): supervisor thread failed attaching to the JVM - attaches per invocation instead",
+                getpid());
+          }
+        },
+        [jvmp]() {
+          if (t_is_jvm_attached) {
+            t_is_jvm_attached = false;
+            jvmp->DetachCurrentThread();
+          }
+        }));
+  }
 
+  // the msg work queue - the msg will be the command line args of a forked child process Java
+  // method invocation or a Java method invocation on the supervisor; the supervisor's queue spills
+  // rather than blocks or rejects, as lifecycle notifications from the launcher must not be lost
   const int child_process_max_count = is_launcher_process ? session.child_process_max_count : 100;
-  std::atomic_bool qready { false };
-  std::queue<std::string> dispatch_msg_queue;
+  // msgs are scheduled in a lane per command - the supervisor's lifecycle notifications in the control lane
+  auto const dispatch_lane_of = [](const std::string &msg) -> std::string {
+    static const string_view child_pid_cmd_prefix{ "--CHILD_PID_" };
+    if (!is_launcher_process && (strncmp(msg.c_str(), child_pid_cmd_prefix.c_str(), child_pid_cmd_prefix.size()) == 0 ||
+                                 lifecycle_notify::is_batch(msg)))
+    {
+      return dispatch_queue::CONTROL_LANE;
+    }
+    std::string cmd = get_dispatch_msg_cmd(msg);
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+    return cmd;
+  };
+  dispatch_queue::DispatchQueue dispatch_msg_queue(
+      static_cast<size_t>(dispatch_queue::capacity()),
+      is_launcher_process ? dispatch_queue::overflow() : dispatch_queue::Overflow::SPILL,
+      dispatch_lane_of);
+  const bool is_block_on_full = is_launcher_process && dispatch_queue::overflow() == dispatch_queue::Overflow::BLOCK;
   // map collection of child process groups - first child process of a command starts a group
   std::unordered_map<std::string,pid_t> prcs_grps;
 
   // lambda is a completion routine invoked when a forked child process terminates
-  auto const child_process_completion = [&, child_process_max_count]() -> bool {
-    std::unique_lock<std::timed_mutex> lk(qm, std::defer_lock);
-    if (lk.try_lock()) {
-      if ((child_process_count--) < child_process_max_count && !dispatch_msg_queue.empty()) {
-        qready.store(true);
-        qcv.notify_one();
-      }
-    } else {
-      child_process_count--; // if can't get lock, at least do atomic decrement of the child process count
+  auto const child_process_completion = [&]() -> bool {
+    child_process_count--;
+    if (dispatch_msg_queue.depth() > 0 || admission::held_count() > 0) {
+      dispatch_msg_queue.notify(); // there's headroom for the dispatching thread to dequeue another msg
     }
     return shutting_down;
   };
 
-  // lambda executes on a dedicated thread that does waitid() on forked child processes; when
-  // detects child process termination, invokes supervisor_child_processor_completion_notify()
-  if (is_launcher_process) {
-    std::promise<void> prom;
-    auto sf = prom.get_future().share();
+  // the launcher process blocks SIGINT, SIGTERM, SIGCHLD and SIGUSR1 (before forking any more child processes
+  // or creating any threads) and handles them on its event loop via a signalfd instead: SIGCHLD has terminated
+  // child processes reaped and then supervisor_child_processor_completion_notify() invoked for each one, SIGUSR1
+  // logs the event loop latency counters; forked child processes get the original signal mask restored
+  const int sfd = is_launcher_process ? event_reactor::open_signalfd({SIGINT, SIGTERM, SIGCHLD, SIGUSR1}) : -1;
+  auto const close_sfd = [](const int *p) { event_reactor::close_signalfd(*p); };
+  std::unique_ptr<const int, decltype(close_sfd)> sfd_sp(&sfd, close_sfd);
+
+  using handle_dispatch_msg_t = std::function<void(const std::string&)>;
+
+  // populate the warm pool (if configured) with pre-forked child processes that create their Java JVM
+  // ahead of time and then await being handed a child command dispatch message from the launcher
+  if (is_launcher_process && session.warm_pool_size > 0) {
+    auto const warm_child_main = [argc, argv, &session, &mqd_sp](int ctl_fd) -> int {
+      static const char func_name[] = "warm_child_main";
+      (void) mqd_sp.release();        // don't want a forked child process to unlink the mq queue
+      (void) s_warm_pool_sp.release(); // nor to cleanup the launcher's warm pool object
+      (void) s_notify_batcher_sp.release(); // notifications of a child process are its own to send
+      (void) s_persistent_workers_sp.release();
+      timeline_trace::process_name("warm pool child");
+
+      auto const action = [argc, argv, ctl_fd](sessionState &/*session_param*/, JavaVM *const jvm) -> int {
+        const std::string msg_str = warm_pool::await_work(ctl_fd, MSG_BUF_SZ);
+        close(ctl_fd);
+        if (msg_str.empty()) {
+          log(LL::TRACE, "%s(): pid(%d) released from warm pool without being handed a command", func_name, getpid());
+          return EXIT_SUCCESS;
+        }
 
-    std::thread waitid_on_forked_children_thrd{
-        std::function<void()>([&child_process_completion, &waitid_on_forked_children, sf] {
-          sf.wait(); // Waits for calling thread to send notification to proceed
-          waitid_on_forked_children(std::function<bool()>(child_process_completion));
-        })};
+        sessionState shm_session_st;
+        cmd_dsp::get_cmd_dispatch_info(shm_session_st);
 
-    waitid_on_forked_children_thrd.detach();
+        auto const pMethDesc = find_child_processor_method(shm_session_st, get_dispatch_msg_cmd(msg_str));
+        if (!pMethDesc->empty()) {
+          // call the standard entry point for child commands
+          const timeline_trace::scope trace_invoke("invoke command method");
+          return invoke_child_processor_command(argc, argv, msg_str, jvm, *pMethDesc);
+        }
+        log(LL::ERR, "%s(): no Java method defined to handle command line:\n\t'%s'",
+            func_name, argv_frame::printable(msg_str).c_str());
+        return EXIT_FAILURE;
+      };
 
-    // Send notification to async waitid_on_forked_children() lambda to proceed
-    prom.set_value();
+      // creates the Java JVM with the pool's option set and then blocks in action awaiting a command
+      const auto exit_rtn_code = invoke_child_process_action(session, warm_pool::POOL_JVM_OPTNS, action);
+      log(LL::DEBUG, "<< %s() - exiting process pid(%d)", func_name, getpid());
+      return exit_rtn_code;
+    };
+
+    s_warm_pool_sp.reset(new warm_pool::WarmPool(static_cast<size_t>(session.warm_pool_size), warm_child_main));
+    s_warm_pool_sp->refill();
   }
 
-  using handle_dispatch_msg_t = std::function<void(const char * const)>;
+  // persistent workers are forked on demand, per child command that is designated as persistent; each
+  // processes successive invocations of its command until retired per its request count or heap limit
+  if (is_launcher_process) {
+    auto const persistent_worker_main = [argc, argv, &session, &mqd_sp](const std::string &cmd, int ctl_fd) -> int {
+      static const char func_name[] = "persistent_worker_main";
+      s_is_persistent_worker = true;
+      (void) mqd_sp.release(); // don't want a forked child process to unlink the mq queue
+      (void) s_warm_pool_sp.release();
+      (void) s_notify_batcher_sp.release();
+      (void) s_persistent_workers_sp.release();
+      timeline_trace::process_name("persistent worker " + cmd);
+
+      const int max_requests = session.persistent_worker_max_requests;
+      const long max_heap_mb = session.persistent_worker_max_heap_mb;
+
+      sessionState shm_session_st;
+      try {
+        cmd_dsp::get_cmd_dispatch_info(shm_session_st);
+      } catch (const spartan_exception &e) {
+        log(LL::ERR, "%s(): pid(%d) terminating due to:\n\t%s: %s", func_name, getpid(), e.name(), e.what());
+        return EXIT_FAILURE;
+      }
+      shm_session_st.libjvm_sp = std::move(session.libjvm_sp);
+
+      auto const pMethDesc = find_child_processor_method(shm_session_st, cmd);
+
+      auto const action = [argc, argv, ctl_fd, pMethDesc, max_requests, max_heap_mb]
+          (sessionState &/*session_param*/, JavaVM *const jvm) -> int
+      {
+        int rc = EXIT_SUCCESS;
+        for (int served = 1;; served++) {
+          const std::string msg_str = warm_pool::await_work(ctl_fd, MSG_BUF_SZ);
+          if (msg_str.empty()) break; // the launcher released this worker
+          if (!pMethDesc->empty()) {
+            // call the standard entry point for child commands
+            const timeline_trace::scope trace_invoke("invoke command method");
+            rc = invoke_child_processor_command(argc, argv, msg_str, jvm, *pMethDesc);
+          } else {
+            log(LL::ERR, "%s(): no Java method defined to handle command line:\n\t'%s'",
+                func_name, argv_frame::printable(msg_str).c_str());
+            rc = EXIT_FAILURE;
+          }
+          // the worker remains alive so the supervisor is told of the invocation's completion here
+          supervisor_child_processor_completion_notify(getpid());
+          const bool is_retiring = (max_requests > 0 && served >= max_requests) ||
+                                   (max_heap_mb > 0 && java_heap_used_mb(jvm) >= max_heap_mb);
+          if (!persistent_workers::send_ack(ctl_fd, is_retiring ? persistent_workers::RETIRING
+                                                                : persistent_workers::READY) || is_retiring) {
+            log(LL::DEBUG, "%s(): pid(%d) retiring after %d invocations", func_name, getpid(), served);
+            break;
+          }
+        }
+        return rc;
+      };
+
+      const auto jvm_override_optns = heap_history::with_heap_optns(cmd, pMethDesc->jvm_optns_str());
+      const auto exit_rtn_code = invoke_child_process_action(shm_session_st, jvm_override_optns.c_str(), action);
+      log(LL::DEBUG, "<< %s() - exiting process pid(%d)", func_name, getpid());
+      return exit_rtn_code;
+    };
+
+    s_persistent_workers_sp.reset(new persistent_workers::PersistentWorkers(
+        static_cast<size_t>(session.persistent_worker_count), persistent_worker_main));
+  }
 
   // lambda that does the work of forking a child process from launcher process context
-  handle_dispatch_msg_t const handle_launcher_msg = [argc, argv, &session, &mqd_sp, &prcs_grps](const char *const msg) {
+  handle_dispatch_msg_t const handle_launcher_msg =
+      [argc, argv, &session, &shm_session, &mqd_sp, &prcs_grps, &child_process_count, &supervisor_jvm_context]
+      (const std::string &msg_str)
+  {
     static const char func_name[] = "handle_launcher_msg";
 
     get_rnd_nbr(1, 99); // jiggle the random number seed value (each forked child gets different seed)
 
-    const std::string msg_str(msg);
-    std::string cmd = [](const char * const msg_cstr) -> std::string {
-      auto const msg_dup = strdupa(msg_cstr);
-      static const char * const delim = " ";
-      char *save = nullptr;
-      strtok_r(msg_dup, delim, &save); // 1st arg - extended-invoke-command (skipping it)
-      strtok_r(nullptr, delim, &save); // 2nd arg - unix datagram name (skipping it)
-      std::string cmd_str(strtok_r(nullptr, delim, &save)); // 3rd arg is sub-command token
-      cmd_str.erase(std::remove(cmd_str.begin(), cmd_str.end(), '"'), cmd_str.end());
-      return cmd_str;
-    }(msg);
+    std::string cmd = get_dispatch_msg_cmd(msg_str);
 
-    // does an async fork to produce a child worker process
-    const pid_t pid = fork();
-    if (pid == -1) {
-      log(LL::ERR, "pid(%d): fork() operation of child process failed: %s\n\tfor command line: '%s'",
-          getpid(), strerror(errno), msg_str.c_str());
-    } else if (pid != 0) {
-      log(LL::DEBUG, "child process (pid:%d) command string is: '%s'", pid, cmd.c_str());
-      auto search = prcs_grps.find(cmd);
+    // lambda that registers a child process (executing the command) in the launcher process context
+    auto const register_child_process = [&prcs_grps, &msg_str](const pid_t pid, std::string &&cmd_str) {
+      log(LL::DEBUG, "child process (pid:%d) command string is: '%s'", pid, cmd_str.c_str());
+      heap_history::track(pid, cmd_str);
+      auto search = prcs_grps.find(cmd_str);
       if (search == prcs_grps.end()) {
         // not found so make new entry
         setpgid(pid, pid); // establishes new process group for this command
-        prcs_grps.emplace(std::move(cmd), pid); // associate command to its process group pgid
+        prcs_grps.emplace(std::move(cmd_str), pid); // associate command to its process group pgid
       } else {
         // set the new child process to process group of this command
         const pid_t pgid = search->second;
         setpgid(pid, pgid);
       }
       // will inform Java main() program of forked child process
-      supervisor_child_processor_notify(pid, msg_str.c_str());
+      supervisor_child_processor_notify(pid, argv_frame::printable(msg_str).c_str());
+    };
+
+    // lambda returns the Java method that will handle the command (nullptr if dispatch info is unavailable)
+    auto const lookup_child_method = [&shm_session](const std::string &cmd_str) -> const methodDescriptor* {
+      static bool has_dispatch_info = false;
+      if (!has_dispatch_info) {
+        try {
+          cmd_dsp::get_cmd_dispatch_info(shm_session); // launcher obtains it once, on first command dispatch
+          has_dispatch_info = true;
+        } catch (const spartan_exception &e) {
+          log(LL::WARN, "%s(): unable to obtain command dispatch info - using cold path:\n\t%s: %s",
+              func_name, e.name(), e.what());
+          return nullptr;
+        }
+      }
+      return find_child_processor_method(shm_session, cmd_str);
+    };
+
+    const methodDescriptor *pMethDesc = nullptr;
+    if (s_warm_pool_sp || s_persistent_workers_sp) {
+      pMethDesc = lookup_child_method(cmd);
+    }
+
+    // commands designated as persistent via config.ini (supplements the @ChildWorkerCommand annotation attribute)
+    static const std::unordered_set<std::string> cfg_persistent_cmds = [&session]() {
+      std::unordered_set<std::string> cmds_set;
+      std::string cmds(session.persistentChildCommands);
+      std::transform(cmds.begin(), cmds.end(), cmds.begin(), ::tolower);
+      for (auto &cmd_tok : str_split(cmds.c_str(), ',')) {
+        if (!cmd_tok.empty()) {
+          cmds_set.emplace(std::move(cmd_tok));
+        }
+      }
+      return cmds_set;
+    }();
+
+    // a profiled invocation is cold forked so that its JVM is created with the JFR options
+    const bool is_profiled = jfr_profiling::acquire(cmd);
+    // as is a msg (received via the msg ring) too large for the control socket of a pre-forked child process
+    const bool is_cold_fork_only = is_profiled || msg_str.size() > MSG_BUF_SZ;
+
+    // held through to the registration of the child process (admission::started(), jfr_profiling::started(),
+    // heap_history::track()) - else a child process reaped first would never release its admission slot or its
+    // profiling slot, and its heap history sample would be lost
+    std::unique_lock<std::mutex> registration_lk(child_registration_mutex);
+
+    if (s_persistent_workers_sp && pMethDesc != nullptr && !is_cold_fork_only) {
+      std::string cmd_key(cmd);
+      std::transform(cmd_key.begin(), cmd_key.end(), cmd_key.begin(), ::tolower);
+      if (pMethDesc->is_persistent() || cfg_persistent_cmds.count(cmd_key) > 0) {
+        const pid_t pid = s_persistent_workers_sp->dispatch(cmd_key, msg_str);
+        if (pid != -1) {
+          register_child_process(pid, std::move(cmd));
+          // the worker outlives the invocation, so it isn't held against the child process count
+          child_process_count--;
+          return;
+        }
+        log(LL::DEBUG, "%s(): persistent workers for command '%s' are all busy - forking one-shot child process",
+            func_name, cmd.c_str());
+      }
+    }
+
+    // the command's MaxConcurrent limit - a msg beyond it is held (dispatched again once admitted) or rejected
+    const auto verdict = admission::admit(cmd, msg_str);
+    if (verdict != admission::Verdict::ADMIT) {
+      child_process_count--; // no child process is started for it (for now)
+      if (is_profiled) {
+        jfr_profiling::cancel();
+      }
+      if (verdict == admission::Verdict::REJECT) {
+        reject_dispatch_msg(msg_str, supervisor_jvm_context.pid, "the command is at its MaxConcurrent limit");
+      }
+      return;
+    }
+
+    // a command that runs with the warm pool's JVM options can be handed to an idle pre-forked child process
+    if (s_warm_pool_sp && pMethDesc != nullptr && !is_cold_fork_only &&
+        strcmp(pMethDesc->jvm_optns_str(), warm_pool::POOL_JVM_OPTNS) == 0)
+    {
+      const pid_t pid = s_warm_pool_sp->hand_off(msg_str);
+      if (pid != -1) {
+        admission::started(pid, cmd);
+        register_child_process(pid, std::move(cmd));
+        // forks the replacement pool member; its JVM creation proceeds in that child process concurrently
+        s_warm_pool_sp->refill();
+        return;
+      }
+      log(LL::DEBUG, "%s(): no idle warm pool child process - cold forking command '%s'", func_name, cmd.c_str());
+    }
+
+    // does an async fork to produce a child worker process
+    const auto fork_start_us = timeline_trace::now_us();
+    const pid_t pid = fork();
+    if (pid == -1) {
+      log(LL::ERR, "pid(%d): fork() operation of child process failed: %s\n\tfor command line: '%s'",
+          getpid(), strerror(errno), argv_frame::printable(msg_str).c_str());
+      admission::cancel(cmd);
+      if (is_profiled) {
+        jfr_profiling::cancel();
+      }
+    } else if (pid != 0) {
+      if (is_profiled) {
+        jfr_profiling::started(pid);
+      }
+      admission::started(pid, cmd);
+      timeline_trace::complete("fork child", fork_start_us);
+      register_child_process(pid, std::move(cmd));
     } else {
+      const auto trace_name = "child " + cmd;
+      timeline_trace::process_name(trace_name);
       (void) mqd_sp.release(); // don't want a forked child process to unlink the mq queue
+      (void) s_warm_pool_sp.release();
+      (void) s_notify_batcher_sp.release();
+      (void) s_persistent_workers_sp.release();
+      (void) registration_lk.release(); // the launcher's lock - not this process's to release
 
       sessionState shm_session_st;
       cmd_dsp::get_cmd_dispatch_info(shm_session_st);
       shm_session_st.libjvm_sp = std::move(session.libjvm_sp);
 
-      auto pMethDesc = &shm_session_st.spartanChildProcessorEntryPoint; // default child processor command entry point
+      // check for matching annotated child command method entry, else is default child processor command entry point
+      auto const pMethDesc = find_child_processor_method(shm_session_st, cmd);
 
-      if (shm_session_st.spSpartanChildProcessorCommands) { // check for matching annotated child command method entry
-        log(LL::TRACE, "@@@@ pid(%d): retrieved shm_session_st to invoke child process command: %s\n"
-                       "\tchild cmd vec size: %lu",
-            getpid(), cmd.c_str(), shm_session_st.spSpartanChildProcessorCommands->size());
-        for (auto &methDesc : *shm_session_st.spSpartanChildProcessorCommands) {
-          if (icompare(methDesc.cmd_str(), cmd)) {
-            pMethDesc = &methDesc;
-            break;
-          }
-        }
-      }
-
-      auto const jvm_override_optns = pMethDesc != nullptr ? pMethDesc->jvm_optns_str() : "";
+      const auto jvm_override_optns = heap_history::with_heap_optns(cmd, pMethDesc->jvm_optns_str());
+      // appended past the consolidation of the JVM options, which would merge them with the other -XX: options
+      const auto jfr_optns = is_profiled ? jfr_profiling::jvm_optns(cmd) : std::string();
 
       auto const action = [argc, argv, pMethDesc, &msg_str](sessionState &session_param, JavaVM *const jvm) -> int {
-        auto const cmsg = msg_str.c_str();
-        if (pMethDesc != nullptr && !pMethDesc->empty()) {
+        if (!pMethDesc->empty()) {
           // call the standard entry point for child commands
-          return invoke_child_processor_command(argc, argv, cmsg, jvm, *pMethDesc);
+          const timeline_trace::scope trace_invoke("invoke command method");
+          return invoke_child_processor_command(argc, argv, msg_str, jvm, *pMethDesc);
         }
-        log(LL::ERR, "%s(): no Java method defined to handle command line:\n\t'%s'", func_name, cmsg);
+        log(LL::ERR, "%s(): no Java method defined to handle command line:\n\t'%s'",
+            func_name, argv_frame::printable(msg_str).c_str());
         return EXIT_FAILURE;
       };
 
       // invoke the processing logic of the forked child process and return its exit code
-      const auto exit_rtn_code = invoke_child_process_action(shm_session_st, jvm_override_optns, action);
+      const auto exit_rtn_code = invoke_child_process_action(shm_session_st, jvm_override_optns.c_str(), action,
+                                                             jfr_optns.c_str());
+      timeline_trace::complete(trace_name.c_str(), fork_start_us); // fork through to exit
       log(LL::DEBUG, "<< %s() - exiting process pid(%d)", func_name, getpid());
       exit(exit_rtn_code);
     }
   };
 
-  // lambda that does the work of invoking a supervisor method
-  handle_dispatch_msg_t const handle_supervisor_msg =
-      [&child_process_count, &shm_session, argc, argv](const char * const msg)
-  {
-    static const char func_name[] = "handle_supervisor_msg";
-    child_process_count--;
-    auto const msg_dup = strdupa(msg); // create a local copy of string that can be mutated
+  // lambda that does the work of invoking a supervisor method (is executed on a supervisor executor thread)
+  auto const invoke_supervisor_msg = [&shm_session, argc, argv](const std::string &msg) {
+    static const char func_name[] = "invoke_supervisor_msg";
+    argv_frame::frame_t batch;
+    if (lifecycle_notify::decode_batch(msg, batch)) {
+      supervisor_child_processor_batch_notify(batch, shm_session);
+      return;
+    }
+    // a binary argv frame is always a command invocation - only text msgs can be lifecycle notifications
+    const bool is_frame = argv_frame::is_frame(msg);
+    // a local copy of the msg that can be mutated - on the heap, as a msg delivered via the msg ring can be megabytes
+    std::string msg_str(is_frame ? "" : msg.c_str());
+    char * const msg_dup = &msg_str[0];
 
     static const char * const delim = " "; // space character
     char *save = nullptr;
     const char * const cmd = strtok_r(msg_dup, delim, &save); // 1st arg
 
-    if (strncmp(cmd, CHILD_PID_NOTIFY_CMD.c_str(), CHILD_PID_NOTIFY_CMD.size()) == 0) {
+    if (cmd != nullptr && strncmp(cmd, CHILD_PID_NOTIFY_CMD.c_str(), CHILD_PID_NOTIFY_CMD.size()) == 0) {
       // notify supervisor of a child process that was forked
       const char * const pid = strtok_r(nullptr, delim, &save);
       assert(pid != nullptr);
@@ -1370,7 +1750,7 @@ try_again:
         log(LL::WARN, "%s(): no Java method defined to handle command:\n\t%s %s '%s'",
             func_name, cmd, pid, cmd_line);
       }
-    } else if (strncmp(cmd, CHILD_PID_COMPLETION_NOTIFY_CMD.c_str(), CHILD_PID_COMPLETION_NOTIFY_CMD.size()) == 0) {
+    } else if (cmd != nullptr && strncmp(cmd, CHILD_PID_COMPLETION_NOTIFY_CMD.c_str(), CHILD_PID_COMPLETION_NOTIFY_CMD.size()) == 0) {
       const char * const pid = strtok_r(nullptr, delim, &save);
       assert(pid != nullptr);
       if (!shm_session.spartanChildCompletionNotifyEntryPoint.empty()) {
@@ -1385,42 +1765,55 @@ try_again:
         log(LL::WARN, "%s(): no Java method defined to handle command:\n\t%s %s", func_name, cmd, pid);
       }
     } else {
-      log(LL::DEBUG, "%s(): '%s'", func_name, msg);
-      strtok_r(nullptr, delim, &save);                          // 2nd arg - unix datagram name (skip it)
-      const char *cmd_token = strtok_r(nullptr, delim, &save);  // 3rd arg - sub-command name
-      std::string cmd_str{};
-      if (cmd_token != nullptr) {
-        cmd_str = cmd_token;
-        cmd_str.erase(std::remove(cmd_str.begin(), cmd_str.end(), '"'), cmd_str.end());
-        cmd_token = cmd_str.c_str();
-      }
+      log(LL::DEBUG, "%s(): '%s'", func_name, argv_frame::printable(msg).c_str());
+      const std::string cmd_str = get_dispatch_msg_cmd(msg); // 3rd arg - sub-command name
+      const char * const cmd_token = cmd_str.empty() ? nullptr : cmd_str.c_str();
       auto const check_errcode = [cmd_token](int errcode) {
         if (errcode != EXIT_SUCCESS) {
           log(LL::ERR, "invoke_java_supervisor_command() did not complete command %s successfully", cmd_token);
         }
       };
       int ec;
-      if (cmd_token != nullptr && shm_session.spSpartanSupervisorCommands) {
-        log(LL::TRACE, "@@@@ pid(%d): use shm_session to invoke supervisor command: %s\n\tsupervisor cmd vec size: %lu",
-               getpid(), cmd_str.c_str(), shm_session.spSpartanSupervisorCommands->size());
-        for (auto &methDesc : *(shm_session.spSpartanSupervisorCommands)) {
-          if (icompare(methDesc.cmd_str(), cmd_str)) {
-            ec = invoke_java_supervisor_command(argc, argv, msg, shm_session.jvm_sp.get(), methDesc);
-            check_errcode(ec);
-            return;
-          }
-        }
+      auto const pCmdMethDesc = cmd_token != nullptr ? find_supervisor_command(shm_session, cmd_str) : nullptr;
+      if (pCmdMethDesc != nullptr) {
+        ec = invoke_java_supervisor_command(argc, argv, msg, shm_session.jvm_sp.get(), *pCmdMethDesc);
+        check_errcode(ec);
+        return;
       }
       auto &methDesc = shm_session.spartanSupervisorEntryPoint;
       if (!methDesc.empty()) {
         ec = invoke_java_supervisor_command(argc, argv, msg, shm_session.jvm_sp.get(), methDesc);
         check_errcode(ec);
       } else {
-        log(LL::WARN, "%s(): no Java method defined to handle command line:\n\t'%s'", func_name, msg);
+        log(LL::WARN, "%s(): no Java method defined to handle command line:\n\t'%s'",
+            func_name, argv_frame::printable(msg).c_str());
       }
     }
   };
 
+  // lambda that hands a supervisor msg off to the supervisor executor - lifecycle notifications are invoked in
+  // the order sent, @SupervisorCommand(concurrent = true) methods concurrently, all other commands one at a time
+  handle_dispatch_msg_t const handle_supervisor_msg =
+      [&child_process_count, &shm_session, invoke_supervisor_msg](const std::string &msg)
+  {
+    child_process_count--;
+    static const string_view child_pid_cmd_prefix{ "--CHILD_PID_" };
+    auto task = std::bind(invoke_supervisor_msg, msg);
+    if (strncmp(msg.c_str(), child_pid_cmd_prefix.c_str(), child_pid_cmd_prefix.size()) == 0 ||
+        lifecycle_notify::is_batch(msg))
+    {
+      s_supervisor_executor_sp->submit(supervisor_executor::NOTIFICATIONS_KEY, std::move(task));
+      return;
+    }
+    const std::string cmd_str = get_dispatch_msg_cmd(msg);
+    auto const pCmdMethDesc = cmd_str.empty() ? nullptr : find_supervisor_command(shm_session, cmd_str);
+    if (pCmdMethDesc != nullptr && pCmdMethDesc->is_concurrent()) {
+      s_supervisor_executor_sp->submit(std::move(task));
+    } else {
+      s_supervisor_executor_sp->submit(supervisor_executor::SERIAL_COMMANDS_KEY, std::move(task));
+    }
+  };
+
   handle_dispatch_msg_t const handle_dispatch_msg = is_launcher_process ? handle_launcher_msg : handle_supervisor_msg;
 
   // lambda dedicated to processing the msg C++11 work queue; a popped msg will
@@ -1432,39 +1825,35 @@ try_again:
 
     std::thread de_queue_dispatch_msg_thrd { std::function<void()>([&,sf,child_process_max_count] {
       sf.wait(); // Waits on calling thread to send notification to proceed
+      static const int park_timeout_ms = 1000;
+      const bool is_admission_control = is_launcher_process && admission::is_enabled();
+      std::string msg;
       for(;;) {
-        std::unique_ptr<std::string[]> msg_array_sp;
-        volatile int de_queue_count = 0;
-        {
-          msg_array_sp.reset(nullptr);
-          volatile int count_headroom = 0;
-          std::unique_lock<std::timed_mutex> lk(qm, std::defer_lock);
-          if (lk.try_lock_for(std::chrono::seconds(3))) {
-            qcv.wait_for(lk, std::chrono::seconds(2), [&,child_process_max_count] {
-              count_headroom = child_process_max_count - child_process_count.load();
-              return qready.load() && count_headroom > 0;
-            });
-            qready.store(false);
-            const int queue_count = (int) dispatch_msg_queue.size();
-            de_queue_count = queue_count > count_headroom ? count_headroom : queue_count;
-            if (de_queue_count > 0) {
-              msg_array_sp.reset(new std::string[de_queue_count]);
-              for(int i = 0; i < de_queue_count; i++) {
-                msg_array_sp[i] = dispatch_msg_queue.front();
-                dispatch_msg_queue.pop();
-              }
-              child_process_count += de_queue_count;
-            }
+        const bool has_headroom = child_process_count.load() < child_process_max_count;
+        if (is_admission_control) {
+          for (auto const &expired_msg : admission::take_expired()) {
+            reject_dispatch_msg(expired_msg, supervisor_jvm_context.pid,
+                                "timed out awaiting admission (the command is at its MaxConcurrent limit)");
           }
-        }
-        if (msg_array_sp && de_queue_count > 0) {
-          for(int i = 0; i < de_queue_count; i++) {
-            // flag when non-zero indicates was signaled to terminate
+          // held msgs whose command has a free slot again go ahead of newly dequeued msgs
+          if (has_headroom && admission::take_admissible(msg)) {
+            child_process_count++;
             if (!jvm_shutting_down) {
-              handle_dispatch_msg(msg_array_sp[i].c_str());
+              handle_dispatch_msg(msg);
             }
+            continue;
           }
         }
+        if (has_headroom && dispatch_msg_queue.try_pop(msg)) {
+          child_process_count++;
+          if (!jvm_shutting_down) {
+            handle_dispatch_msg(msg);
+          }
+          continue;
+        }
+        // parks until a msg is enqueued - or, when at the child process count limit, until a child completes
+        dispatch_msg_queue.park(is_admission_control ? admission::ms_until_expiry(park_timeout_ms) : park_timeout_ms,
+                                has_headroom);
       }
     }) };
 
@@ -1476,16 +1865,14 @@ try_again:
 
   /* lambda that enqueues an mq popped message onto a C++11 work queue; a queued msg will be the */
   /* command line args to a Java method invoked on the supervisor or on a forked child process   */
-  auto const en_queue_dispatch_msg = [&dispatch_msg_queue, &qready](const char* const msg) -> processor_result_t {
-    std::unique_lock<std::timed_mutex> lk(qm, std::defer_lock);
-    if (lk.try_lock_for(std::chrono::seconds(5))) {
-      dispatch_msg_queue.emplace(std::string(msg));
-      qready.store(true);
-      qcv.notify_one();
-      return processor_result_t(true, EXIT_SUCCESS); // continue processing mq messages
+  auto const en_queue_dispatch_msg = [&dispatch_msg_queue, &supervisor_jvm_context](std::string &&msg)
+      -> processor_result_t
+  {
+    if (!dispatch_msg_queue.push(std::move(msg))) { // msg is left intact when not accepted
+      // reject overflow policy - the client is answered with an error instead
+      reject_dispatch_msg(msg, supervisor_jvm_context.pid, "the dispatch queue is full");
     }
-    log(LL::ERR, "failed to acquire lock to enqueue mq msg '%s'", msg);
-    return processor_result_t(false, EXIT_FAILURE); // cease processing mq messages and terminate program
+    return processor_result_t(true, EXIT_SUCCESS); // continue processing mq messages
   };
 
   using msg_dispatch_t = std::function<processor_result_t(char [], const int)>;
@@ -1494,15 +1881,24 @@ try_again:
   msg_dispatch_t const msg_dispatch_for_launcher = [&en_queue_dispatch_msg]
       (const char* const buffer, const int msg_size) -> processor_result_t
   {
-    const char * const msg_dup = strndupa(buffer, (size_t) msg_size);
+    if (argv_frame::is_frame({buffer, (size_t) msg_size})) {
+      return en_queue_dispatch_msg(std::string(buffer, (size_t) msg_size)); // a binary argv frame (has embedded NULs)
+    }
+    // on the heap - a msg delivered via the msg ring can be far larger than is fit for the stack
+    std::string msg_str(buffer, strnlen(buffer, (size_t) msg_size));
+    const char * const msg_dup = msg_str.c_str();
 
     if (strcmp(msg_dup, STOP_CMD.c_str()) == 0) {
       return processor_result_t(false, EXIT_SUCCESS); // initiate exiting activity of parent supervisor process
     }
+    if (strncmp(msg_dup, PROFILE_CMD.c_str(), PROFILE_CMD.size()) == 0) {
+      jfr_profiling::apply_switch(msg_dup + PROFILE_CMD.size());
+      return processor_result_t(true, EXIT_SUCCESS); // continue processing mq messages
+    }
 
     // All other mq messages to be processed on a
     // forked child process context dealt with here
-    return en_queue_dispatch_msg(msg_dup);
+    return en_queue_dispatch_msg(std::move(msg_str));
   };
 
   // lambda (with closure) that processes an mq message for supervisor process - typically a dispatch to a handler
@@ -1510,7 +1906,12 @@ try_again:
       (const char* const buffer, const int msg_size) -> processor_result_t
   {
     static const char func_name[] = "msg_dispatch_for_supervisor";
-    const char * const msg_dup = strndupa(buffer, (size_t) msg_size);
+    if (argv_frame::is_frame({buffer, (size_t) msg_size})) {
+      return en_queue_dispatch_msg(std::string(buffer, (size_t) msg_size)); // a binary argv frame (has embedded NULs)
+    }
+    // on the heap - a msg delivered via the msg ring can be far larger than is fit for the stack
+    std::string msg_str(buffer, strnlen(buffer, (size_t) msg_size));
+    char * const msg_dup = &msg_str[0];
 
     if (strcmp(msg_dup, SHUTDOWN_CMD.c_str()) == 0) {
       jvm_shutting_down = true;
@@ -1525,64 +1926,173 @@ try_again:
         log(LL::INFO, "received: \"%s\"", msg_dup);
         static const char *const delim = " ";
         char *save = nullptr;
-        strtok_r(const_cast<char *>(msg_dup), delim, &save);
+        strtok_r(msg_dup, delim, &save);
         const char *const uds_socket_name(strtok_r(nullptr, delim, &save));
-        std::packaged_task<decltype(supervisor_status_response)> async_get_status{supervisor_status_response};
-        std::thread thrd{std::move(async_get_status), std::string(uds_socket_name), shm_session.jvm_sp.get(),
-                         shm_session.spartanGetStatusEntryPoint};
-        thrd.detach(); // launch on a thread
+        // status requests run in the executor's priority lane (they're not held up by long running commands)
+        s_supervisor_executor_sp->submit_priority(std::bind(supervisor_status_response, std::string(uds_socket_name),
+                                                            shm_session.jvm_sp.get(),
+                                                            shm_session.spartanGetStatusEntryPoint));
       }
       return processor_result_t(true, EXIT_SUCCESS); // continue processing mq messages
     }
 
     // All other mq messages to be processed on the
     // supervisor process context dealt with here
-    return en_queue_dispatch_msg(msg_dup);
+    return en_queue_dispatch_msg(std::move(msg_str));
   };
 
   msg_dispatch_t const msg_dispatch = is_launcher_process ? msg_dispatch_for_launcher : msg_dispatch_for_supervisor;
 
   char buffer[MSG_BUF_SZ]; // buffer for received message from mq queue
-  const int timeout_interval = 5; // seconds
-  timespec timeout{};
-  clock_gettime(CLOCK_REALTIME, &timeout);
-  timeout.tv_sec += timeout_interval;
-
-  // enter loop to read messages from mq queue; calls msg_dispatch() to deal with them
-  bool loop_continue = true;
-  do {
-    unsigned msg_prio = 0;
-    const int msg_sz = (int) mq_timedreceive(mqd_sp->_mqd, buffer, sizeof(buffer), &msg_prio, &timeout);
-    const int ern = msg_sz < 0 ? errno : 0;
-    if (ern == ETIMEDOUT) {
-      if (flag != 0) {// check to see if signaled to terminate
+  std::string ring_msg;    // a message received via the msg ring
+  const int idle_timeout_ms = 5000; // housekeeping interval - events themselves are handled as they occur
+
+  // the mq queue descriptor is non-blocking so that it can be drained of all its messages per epoll wake up
+  mq_attr nonblock_attr{};
+  nonblock_attr.mq_flags = O_NONBLOCK;
+  mq_setattr(mqd_sp->_mqd, &nonblock_attr, nullptr);
+
+  event_reactor::Reactor reactor;
+  bool is_mq_paused = false;
+
+  // reads messages from the mq queue until drained; calls msg_dispatch() to deal with them
+  reactor.add(mqd_sp->_mqd, EPOLLIN, [&](uint32_t) -> bool {
+    for(;;) {
+      if (is_block_on_full && dispatch_msg_queue.is_full() && dispatch_msg_queue.begin_await_space()) {
+        // block overflow policy - quits reading the mq queue until the dispatch queue has room again, so
+        // that clients are held up in mq_send() while this event loop carries on (reaping child processes)
+        log(LL::DEBUG, "dispatch queue is full - pausing receipt of mq messages");
+        reactor.modify(mqd_sp->_mqd, 0);
+        is_mq_paused = true;
         break;
       }
-      clock_gettime(CLOCK_REALTIME, &timeout);
-      timeout.tv_sec += timeout_interval;
-      continue;
+      unsigned msg_prio = 0;
+      const int msg_sz = (int) mq_receive(mqd_sp->_mqd, buffer, sizeof(buffer), &msg_prio);
+      const int ern = msg_sz < 0 ? errno : 0;
+      if (ern == EAGAIN) break;
+      if (ern == EINTR) continue;
+      if (ern != 0) {
+        log(LL::ERR, "mq_receive returned error: %s", strerror(ern));
+        mqd_sp.reset(nullptr);
+        exit_code = EXIT_FAILURE;
+        return false;
+      }
+      if (msg_sz == 0) continue;
+      char *msg_buf = buffer;
+      int msg_len = msg_sz;
+      if (msg_ring_sp && static_cast<size_t>(msg_sz) > msg_ring::RING_MSG_CMD.size() &&
+          strncmp(buffer, msg_ring::RING_MSG_CMD.c_str(), msg_ring::RING_MSG_CMD.size()) == 0)
+      {
+        // a descriptor of a message placed in the msg ring - the message itself is copied out of the ring
+        if (!msg_ring_sp->take({buffer, static_cast<size_t>(msg_sz)}, ring_msg)) continue;
+        msg_buf = &ring_msg[0];
+        msg_len = static_cast<int>(ring_msg.size());
+      }
+      log(LL::DEBUG, "message size(%d) received", msg_len);
+      auto dispatch_rslt = msg_dispatch(msg_buf, msg_len);
+      log(LL::DEBUG, "returned from message dispatching of message size(%d)", msg_sz);
+      exit_code = std::get<1>(dispatch_rslt);
+      if (!std::get<0>(dispatch_rslt) || flag != 0) return false; // flag non-zero indicates signaled to terminate
     }
-    if (ern != 0) {
-      log(LL::ERR, "mq_receive returned error: %s", strerror(ern));
-      mqd_sp.reset(nullptr);
-      auto prcsr_rslt = processor_result_t(false, EXIT_FAILURE);
-      loop_continue = std::get<0>(prcsr_rslt);
-      exit_code = std::get<1>(prcsr_rslt);
-    } else if (msg_sz == 0 && flag == 0) { // also confirms flag is not indicating signal to terminate
-      continue;
-    }
-    log(LL::DEBUG, "message size(%d) received", msg_sz);
-    auto dispatch_rslt = msg_dispatch(buffer, msg_sz);
-    log(LL::DEBUG, "returned from message dispatching of message size(%d)", msg_sz);
-    loop_continue = std::get<0>(dispatch_rslt);
-    exit_code = std::get<1>(dispatch_rslt);
-  } while(loop_continue && flag == 0); // also confirms flag is not indicating signal to terminate
+    if (msg_ring_sp) {
+      msg_ring_sp->reclaim(); // as per the idle timeout - a busy receiver may never hit it
+    }
+    if (is_launcher_process) {
+      app_cds::build_pending_archives(); // throttled - a busy launcher may never hit the idle timeout
+    }
+    return true;
+  });
+
+  if (is_block_on_full) {
+    reactor.add(dispatch_msg_queue.space_fd(), EPOLLIN, [&](uint32_t) -> bool {
+      uint64_t token = 0;
+      (void) read(dispatch_msg_queue.space_fd(), &token, sizeof(token));
+      if (is_mq_paused) {
+        dispatch_msg_queue.end_await_space();
+        is_mq_paused = false;
+        reactor.modify(mqd_sp->_mqd, EPOLLIN); // level-triggered, so any queued mq messages are signaled now
+        log(LL::DEBUG, "dispatch queue has room - resuming receipt of mq messages");
+      }
+      return true;
+    });
+  }
+
+  if (s_notify_batcher_sp && s_notify_batcher_sp->timer_fd() != -1) {
+    reactor.add(s_notify_batcher_sp->timer_fd(), EPOLLIN, [](uint32_t) -> bool {
+      s_notify_batcher_sp->on_timer(); // a batch window has elapsed - send the batch
+      return true;
+    });
+  }
+
+  if (sfd != -1) {
+    reactor.add(sfd, EPOLLIN, [&](uint32_t) -> bool {
+      bool is_child_terminated = false;
+      signalfd_siginfo si{};
+      while (read(sfd, &si, sizeof(si)) == static_cast<ssize_t>(sizeof(si))) {
+        switch (si.ssi_signo) {
+          case SIGCHLD:
+            is_child_terminated = true;
+            break;
+          case SIGUSR1:
+            log(LL::INFO, "pid(%d) %s", getpid(), reactor.stats_str().c_str());
+            log(LL::INFO, "pid(%d) %s", getpid(), dispatch_msg_queue.stats_str().c_str());
+            if (admission::is_enabled()) {
+              log(LL::INFO, "pid(%d) %s", getpid(), admission::stats_str().c_str());
+            }
+            if (msg_ring_sp) {
+              log(LL::INFO, "pid(%d) %s", getpid(), msg_ring_sp->stats_str().c_str());
+            }
+            if (s_notify_batcher_sp) {
+              log(LL::INFO, "pid(%d) %s", getpid(), s_notify_batcher_sp->stats_str().c_str());
+            }
+            break;
+          default:
+            log(LL::INFO, "pid(%d) signaled to terminate: %s", getpid(), strsignal(static_cast<int>(si.ssi_signo)));
+            set_exit_flag_true();
+        }
+      }
+      if (is_child_terminated) {
+        reap_forked_children(child_process_completion);
+      }
+      return flag == 0;
+    });
+  }
+
+  // enter the event loop - it runs until signaled to terminate or a dispatched message ends it
+  timeline_trace::instant("mq loop start");
+  reactor.run(idle_timeout_ms, [&]() -> bool {
+    if (flag != 0) { // check to see if signaled to terminate
+      return false;
+    }
+    if (msg_ring_sp) {
+      msg_ring_sp->reclaim(); // a message of a sender that died before sending its descriptor would pin the ring
+    }
+    if (is_launcher_process) {
+      reap_forked_children(child_process_completion); // catches any child process that exited before the signalfd
+      app_cds::build_pending_archives();
+    }
+    return true;
+  });
+  log(LL::DEBUG, "pid(%d) %s", getpid(), reactor.stats_str().c_str());
+  log(LL::DEBUG, "pid(%d) %s", getpid(), dispatch_msg_queue.stats_str().c_str());
+  if (s_notify_batcher_sp) {
+    s_notify_batcher_sp->flush();
+    log(LL::DEBUG, "pid(%d) %s", getpid(), s_notify_batcher_sp->stats_str().c_str());
+  }
+  if (s_supervisor_executor_sp) {
+    s_supervisor_executor_sp->stop(); // before the JVM is destroyed along with shm_session
+    log(LL::DEBUG, "pid(%d) %s", getpid(), s_supervisor_executor_sp->stats_str().c_str());
+  }
 
   return exit_code;
 }
 
 static void supervisor_child_processor_notify(const pid_t child_pid, const char * const command_line) {
   log(LL::TRACE, "forked child process %d for command line:\n\t'%s'", child_pid, command_line);
+  if (s_notify_batcher_sp) {
+    s_notify_batcher_sp->started(child_pid, command_line); // the launcher sends it as part of a batch
+    return;
+  }
   int strbuf_size = 256;
   char *strbuf = (char*) alloca(strbuf_size);
   int n = strbuf_size;
@@ -1594,7 +2104,7 @@ static void supervisor_child_processor_notify(const pid_t child_pid, const char
       goto do_str_fmt; // try again
     }    
   }
-  send_supervisor_mq_msg(strbuf);
+  send_supervisor_mq_msg(strbuf, send_mq_msg::PRIO_NOTIFY);
 }
 
 static void supervisor_child_processor_completion_notify(const siginfo_t &info) {
@@ -1611,18 +2121,27 @@ static void supervisor_child_processor_completion_notify(const siginfo_t &info)
         log(LL::TRACE, "child process %d did not terminate normally", info.si_pid);
     }
   }
+  if (s_notify_batcher_sp) {
+    // the launcher sends it as part of a batch - along with the exit status (128 + signal if terminated by one)
+    s_notify_batcher_sp->exited(info.si_pid, info.si_code == CLD_EXITED ? info.si_status : 128 + info.si_status);
+    return;
+  }
+  supervisor_child_processor_completion_notify(info.si_pid);
+}
+
+static void supervisor_child_processor_completion_notify(const pid_t child_pid) {
   int strbuf_size = 64;
   char *strbuf = (char*) alloca(strbuf_size);
   int n = strbuf_size;
   do_str_fmt: {
-    n = snprintf(strbuf, (size_t) n, "%s %d", CHILD_PID_COMPLETION_NOTIFY_CMD.c_str(), info.si_pid);
+    n = snprintf(strbuf, (size_t) n, "%s %d", CHILD_PID_COMPLETION_NOTIFY_CMD.c_str(), child_pid);
     assert(n > 0);
     if (n >= strbuf_size) {
       strbuf = (char*) alloca(strbuf_size = ++n);
       goto do_str_fmt; // try again
     }    
   }
-  send_supervisor_mq_msg(strbuf);
+  send_supervisor_mq_msg(strbuf, send_mq_msg::PRIO_NOTIFY);
 }
 
 static int invoke_java_child_processor_notify(const char *const child_pid, const char *const command_line,
@@ -1639,8 +2158,101 @@ static int invoke_java_child_processor_completion_notify(const char *const child
   return invoke_java_method(jvmp, method_descriptor, argv.size() - 1, argv.data()); // argc, argv parameters
 }
 
+// hands a batch of child process lifecycle notifications to Java - in one upcall, unless the application
+// renamed the individual notification methods (then is an upcall per notification, in the batch's order)
+static void supervisor_child_processor_batch_notify(const argv_frame::frame_t &batch, sessionState &shm_session) {
+  static const char func_name[] = "supervisor_child_processor_batch_notify";
+  log(LL::DEBUG, "%s(): %lu notifications", func_name, (batch.args.size() - 1) / 3);
+  // the args of a batch are each NUL terminated - are passed on as C strings
+  std::vector<char*> argv;
+  argv.reserve(batch.args.size() + 1);
+  for (const auto &arg : batch.args) {
+    argv.push_back(const_cast<char*>(arg.data()));
+  }
+  argv.push_back(nullptr);
+  auto &batch_method = shm_session.spartanChildBatchNotifyEntryPoint;
+  if (!batch_method.empty()) {
+    const auto ec = invoke_java_method(shm_session.jvm_sp.get(), batch_method, static_cast<int>(argv.size() - 1),
+                                       argv.data());
+    if (ec != EXIT_SUCCESS) {
+      log(LL::ERR, "%s(): batch of notifications did not complete successfully", func_name);
+    }
+    return;
+  }
+  for (size_t i = 1; i + 2 < argv.size(); i += 3) {
+    const bool is_started = lifecycle_notify::STARTED == argv[i];
+    auto &method = is_started ? shm_session.spartanChildNotifyEntryPoint
+                              : shm_session.spartanChildCompletionNotifyEntryPoint;
+    if (method.empty()) continue;
+    const auto ec = is_started ? invoke_java_child_processor_notify(argv[i + 1], argv[i + 2],
+                                                                    shm_session.jvm_sp.get(), method)
+                               : invoke_java_child_processor_completion_notify(argv[i + 1],
+                                                                               shm_session.jvm_sp.get(), method);
+    if (ec != EXIT_SUCCESS) {
+      log(LL::ERR, "%s(): notification of child process %s did not complete successfully", func_name, argv[i + 1]);
+    }
+  }
+}
+
+// returns the Java heap presently in use by the JVM (in megabytes)
+static long java_heap_used_mb(JavaVM *const jvmp) {
+  long used_mb = 0;
+  auto const detach_thread = [jvmp](JNIEnv *envp) { jni_detach_thread(jvmp, envp); };
+  std::unique_ptr<JNIEnv, decltype(detach_thread)> env_sp(jni_attach_thread(jvmp), detach_thread);
+  JNIEnv * const env = env_sp.get();
+  auto const jdk = jni_registry::jdk();
+  if (env != nullptr && jdk != nullptr) {
+    jobject const runtime = env->CallStaticObjectMethod(jdk->runtime_cls, jdk->get_runtime);
+    if (runtime != nullptr) {
+      const jlong used = env->CallLongMethod(runtime, jdk->total_memory) - env->CallLongMethod(runtime, jdk->free_memory);
+      used_mb = static_cast<long>(used / (1024 * 1024));
+      env->DeleteLocalRef(runtime);
+    }
+  }
+  return used_mb;
+}
+
+// sums the collection counts of the JVM's garbage collectors; returns -1 if they could not be obtained
+static long java_gc_count(JavaVM *const jvmp) {
+  long gc_count = -1;
+  auto const detach_thread = [jvmp](JNIEnv *envp) { jni_detach_thread(jvmp, envp); };
+  std::unique_ptr<JNIEnv, decltype(detach_thread)> env_sp(jni_attach_thread(jvmp), detach_thread);
+  JNIEnv * const env = env_sp.get();
+  // resolved on first use (rather than by jni_registry::init()) - loading the management classes isn't free
+  const auto get_gc_beans = jni_registry::find_method(env, "java/lang/management/ManagementFactory",
+                                                      "getGarbageCollectorMXBeans", "()Ljava/util/List;", true);
+  const auto list_size = jni_registry::find_method(env, "java/util/List", "size", "()I", false);
+  const auto list_get = jni_registry::find_method(env, "java/util/List", "get", "(I)Ljava/lang/Object;", false);
+  const auto get_count = jni_registry::find_method(env, "java/lang/management/GarbageCollectorMXBean",
+                                                   "getCollectionCount", "()J", false);
+  {
+    if (get_gc_beans.mid != nullptr && list_size.mid != nullptr && list_get.mid != nullptr &&
+        get_count.mid != nullptr)
+    {
+      jobject const gc_beans = env->CallStaticObjectMethod(get_gc_beans.cls, get_gc_beans.mid);
+      if (gc_beans != nullptr) {
+        gc_count = 0;
+        const jint n = env->CallIntMethod(gc_beans, list_size.mid);
+        for (jint i = 0; i < n; i++) {
+          jobject const gc_bean = env->CallObjectMethod(gc_beans, list_get.mid, i);
+          if (gc_bean != nullptr) {
+            gc_count += std::max<jlong>(env->CallLongMethod(gc_bean, get_count.mid), 0);
+            env->DeleteLocalRef(gc_bean);
+          }
+        }
+        env->DeleteLocalRef(gc_beans);
+      }
+    }
+  }
+  if (env->ExceptionCheck()) {
+    env->ExceptionClear();
+    gc_count = -1;
+  }
+  return gc_count;
+}
+
 static int invoke_child_process_action(sessionState &session_mut, const char *jvm_override_optns,
-                                       const action_cb_t &action)
+                                       const action_cb_t &action, const char *jvm_appended_optns)
 {
   int exit_code = EXIT_FAILURE; // assume will exit the forked child process with failure exit code
   try {
@@ -1648,7 +2260,7 @@ static int invoke_child_process_action(sessionState &session_mut, const char *jv
       // invoke the processing logic of the forked child process and return its exit code
       exit_code = action(session_mut, session_mut.jvm_sp.get());
     } else {
-      session_mut.create_jvm(jvm_override_optns);
+      session_mut.create_jvm(jvm_override_optns, jvm_appended_optns);
       // don't want a forked child process to cleanup the Java JVM
       auto const env = session_mut.env_sp.release();
       auto const jvm = session_mut.jvm_sp.release();
@@ -1656,6 +2268,9 @@ static int invoke_child_process_action(sessionState &session_mut, const char *jv
       (void) session_mut.libjvm_sp.release();
       // invoke the processing logic of the forked child process and return its exit code
       exit_code = action(session_mut, jvm);
+      if (heap_history::is_enabled()) {
+        heap_history::report_gc_count(java_gc_count(jvm));
+      }
     }
   } catch (const spartan_exception &e) {
     log(LL::ERR, "child process %d terminating due to:\n\t%s: %s", getpid(), e.name(), e.what());
@@ -1669,14 +2284,86 @@ static int invoke_child_process_action(sessionState &session_mut, const char *jv
   return exit_code;
 }
 
+// extracts the sub-command token from a child command dispatch message
+static std::string get_dispatch_msg_cmd(const std::string &msg) {
+  if (argv_frame::is_frame(msg)) {
+    argv_frame::frame_t frame;
+    if (!argv_frame::decode(msg, frame) || frame.args.size() < 3) return std::string();
+    return std::string(frame.args[2].data(), frame.args[2].size()); // 3rd arg is sub-command (taken verbatim)
+  }
+  auto const msg_dup = strdupa(msg.c_str());
+  static const char * const delim = " ";
+  char *save = nullptr;
+  strtok_r(msg_dup, delim, &save); // 1st arg - extended-invoke-command (skipping it)
+  strtok_r(nullptr, delim, &save); // 2nd arg - unix socket name (skipping it)
+  const char * const cmd_tok = strtok_r(nullptr, delim, &save); // 3rd arg is sub-command token
+  std::string cmd_str(cmd_tok != nullptr ? cmd_tok : "");
+  cmd_str.erase(std::remove(cmd_str.begin(), cmd_str.end(), '"'), cmd_str.end());
+  return cmd_str;
+}
+
+// returns the command of cmds matching cmd (case insensitive), else nullptr - found by the perfect hash index
+// published with the session image, else (no index) by a scan
+static const methodDescriptorCmd* find_command(const std::shared_ptr<std::vector<methodDescriptorCmd>> &sp_cmds,
+                                               const std::shared_ptr<const cmd_index::table_t> &sp_index,
+                                               const std::string &cmd)
+{
+  if (!sp_cmds) return nullptr;
+  const auto &cmds = *sp_cmds;
+  if (sp_index) {
+    auto const name_at = [&cmds](size_t i) -> string_view {
+      return string_view(cmds[i].cmd_str().c_str(), cmds[i].cmd_str().size());
+    };
+    const long i = cmd_index::find(cmd_index::span_of(*sp_index), string_view(cmd.c_str(), cmd.size()), name_at);
+    return i >= 0 ? &cmds[static_cast<size_t>(i)] : nullptr;
+  }
+  for (auto &methDesc : cmds) {
+    if (icompare(methDesc.cmd_str(), cmd)) {
+      return &methDesc;
+    }
+  }
+  return nullptr;
+}
+
+// returns the annotated child command method matching cmd, else the default child processor command entry point
+static const methodDescriptor* find_child_processor_method(const sessionState &ss, const std::string &cmd) {
+  auto const pMethDesc = find_command(ss.spSpartanChildProcessorCommands, ss.spChildProcessorCmdIndex, cmd);
+  log(LL::TRACE, "@@@@ pid(%d): child process command %s is %s", getpid(), cmd.c_str(),
+      pMethDesc != nullptr ? pMethDesc->c_str() : "the default child processor entry point");
+  return pMethDesc != nullptr ? pMethDesc : &ss.spartanChildProcessorEntryPoint;
+}
+
+// returns the @SupervisorCommand method of the command, else nullptr
+static const methodDescriptorCmd* find_supervisor_command(const sessionState &ss, const std::string &cmd) {
+  return find_command(ss.spSpartanSupervisorCommands, ss.spSupervisorCmdIndex, cmd);
+}
+
 using raii_argv_sp_t = std::unique_ptr<const char*, std::function<void(const char**)>>;
 
-static raii_argv_sp_t parse_cmd_line(const char *const cmd_line, const char *const desc, int &argc_cmd_line, int &rc) {
+// an argv frame dispatch message is decoded in place - the argv array points into msg (so must not outlive it);
+// a text dispatch message is parsed by popt (into storage that the argv array owns)
+static raii_argv_sp_t parse_cmd_line(const std::string &msg, const char *const desc, int &argc_cmd_line, int &rc) {
   static const char *const func_name = __FUNCTION__;
   rc = EXIT_SUCCESS;
   argc_cmd_line = 0;
   const char**argv_cmd_line = nullptr;
-  auto rtn = poptParseArgvString(cmd_line, &argc_cmd_line, &argv_cmd_line);
+  int rtn = 0;
+  if (argv_frame::is_frame(msg)) {
+    argv_frame::frame_t frame;
+    if (argv_frame::decode(msg, frame)) {
+      argc_cmd_line = static_cast<int>(frame.args.size());
+      argv_cmd_line = static_cast<const char**>(std::malloc((frame.args.size() + 1) * sizeof(const char*)));
+      for (size_t i = 0; i < frame.args.size(); i++) {
+        argv_cmd_line[i] = frame.args[i].data(); // each arg of a frame is NUL terminated
+      }
+      argv_cmd_line[frame.args.size()] = nullptr;
+    } else {
+      log(LL::ERR, "%s() %s %d Failed decoding malformed argv frame of %lu bytes", func_name, desc, getpid(), msg.size());
+      rc = EXIT_FAILURE;
+    }
+  } else {
+    rtn = poptParseArgvString(msg.c_str(), &argc_cmd_line, &argv_cmd_line);
+  }
   if (is_trace_level()) {
     log(LL::TRACE, "%s() %s %d rtn: %d, argc: %d", func_name, desc, getpid(), rtn, argc_cmd_line);
     if (rtn == 0) {
@@ -1709,12 +2396,43 @@ static bool parse_extended_invoke_option(string_view const extended_invoke_cmd)
   return false;
 }
 
-static int core_invoke_command(int /*argc*/, char **/*argv*/, const char *const msg_arg,
+// answers a dispatch message that won't be carried out - the client receives the reason on its response stream
+// and exits with the EXIT_REJECTED code
+// (rsp_pid is reported to the client as the responding process, i.e., the supervisor, so a Ctrl-C of the client
+// doesn't go on to signal the launcher)
+static void reject_dispatch_msg(const std::string &msg, const pid_t rsp_pid, const char * const reason) {
+  static const char func_name[] = "reject_dispatch_msg";
+  int rc;
+  int argc_cmd_line;
+  auto raii_argv_sp = parse_cmd_line(msg, "rejected", argc_cmd_line, rc);
+  if (rc != EXIT_SUCCESS || argc_cmd_line < 3) return;
+  auto const argv_cmd_line = raii_argv_sp.get();
+  const auto errmsg = format2str("%s: command '%s' rejected - %s\n", progname(), argv_cmd_line[2], reason);
+  log(LL::WARN, "%s(): command '%s' rejected - %s", func_name, argv_cmd_line[2], reason);
+  try {
+    if (parse_extended_invoke_option(argv_cmd_line[0])) {
+      auto rslt = open_react_anon_pipes(argv_cmd_line[1], rc, rsp_pid, EXIT_REJECTED);
+      if (rc == EXIT_SUCCESS && write(std::get<1>(rslt)->fd, errmsg.c_str(), errmsg.size()) == -1) {
+        log(LL::DEBUG, "%s(): error stream write failed: %s", func_name, strerror(errno));
+      }
+    } else {
+      auto fd_sp = open_write_anon_pipe(argv_cmd_line[1], rc, rsp_pid, EXIT_REJECTED);
+      if (rc == EXIT_SUCCESS && write(fd_sp->fd, errmsg.c_str(), errmsg.size()) == -1) {
+        log(LL::DEBUG, "%s(): response stream write failed: %s", func_name, strerror(errno));
+      }
+    }
+  } catch (const spartan_exception &e) {
+    log(LL::ERR, "%s(): could not answer client of rejected command '%s':\n\t%s: %s",
+        func_name, argv_cmd_line[2], e.name(), e.what());
+  }
+}
+
+static int core_invoke_command(int /*argc*/, char **/*argv*/, const std::string &msg_arg,
                                JavaVM *const jvmp, const methodDescriptor &method_descriptor,
                                const char *const func_name, const char *const desc)
 {
   const auto pid = getpid();
-  log(LL::INFO, "%s() %s %d processing:\n\t\'%s\'", func_name, desc, pid, msg_arg);
+  log(LL::INFO, "%s() %s %d processing:\n\t\'%s\'", func_name, desc, pid, argv_frame::printable(msg_arg).c_str());
 
   int rc;
   int argc_cmd_line;
@@ -1724,7 +2442,7 @@ static int core_invoke_command(int /*argc*/, char **/*argv*/, const char *const
     auto const argv_cmd_line = raii_argv_sp.get();
     if (argc_cmd_line < 3) {
       log(LL::ERR, "%s() %s %d unexpected error - invalid command line - insufficient arguments:\n\t'%s'",
-          func_name, desc, getpid(), msg_arg);
+          func_name, desc, getpid(), argv_frame::printable(msg_arg).c_str());
       rc = EXIT_FAILURE;
     } else {
       auto const extd_invoke_cmd = argv_cmd_line[0]; // by convention first arg must be extended-invoke-command
@@ -1760,15 +2478,70 @@ static int core_invoke_command(int /*argc*/, char **/*argv*/, const char *const
   return rc;
 }
 
-static int invoke_java_supervisor_command(int argc, char **argv, const char* const msg_arg, JavaVM* const jvmp,
+static int invoke_java_supervisor_command(int argc, char **argv, const std::string &msg_arg, JavaVM* const jvmp,
                                           const methodDescriptor &method_descriptor)
 {
   return core_invoke_command(argc, argv, msg_arg, jvmp, method_descriptor, __func__, "supervisor process");
 }
 
 // function where primary processing logic of forked child process initiates
-static int invoke_child_processor_command(int argc, char **argv, const char* const msg_arg, JavaVM* const jvmp,
+static int invoke_child_processor_command(int argc, char **argv, const std::string &msg_arg, JavaVM* const jvmp,
                                           const methodDescriptor &method_descriptor)
 {
   return core_invoke_command(argc, argv, msg_arg, jvmp, method_descriptor, __func__, "child process");
 }
+
+// Runs a child processor command in the calling (client) process - there is no launcher fork, and the
+// output goes straight to the process' own stdout/stderr rather than through anon pipes echoed by the
+// client. The command table comes from the supervisor's shm, while the JVM settings are those of the
+// config.ini (as is the case for a forked child process). The supervisor is notified of this process
+// as though it were a forked child process, so that its status stays accurate.
+static int direct_invoke_child_command(int argc, char **argv, const char *const cfg_file,
+                                       sessionState &shm_session, const std::string &cmd)
+{
+  static const char func_name[] = "direct_invoke_child_command";
+  log(LL::DEBUG, "running child processor command in -direct mode: %s", cmd.c_str());
+
+  // the config.ini settings apply to the JVM created here as they would to a launcher forked child process
+  sessionState cfg_session(cfg_file, shm_session.jvmlib_path.c_str());
+  shm_session.libjvm_sp = std::move(cfg_session.libjvm_sp);
+
+  auto const pMethDesc = find_child_processor_method(shm_session, cmd);
+  const auto jvm_override_optns = heap_history::with_heap_optns(cmd, pMethDesc->jvm_optns_str());
+
+  // the Java method's args are those of the command line less the -direct option (argv[0] is skipped)
+  std::vector<char*> cmd_argv;
+  std::string cmd_line = format2str("\"%s=false\" \"-direct\"", EXTENDED_INVOKE_CMD.c_str());
+  for (int i = 0; i < argc; i++) {
+    if (i > 0 && *(argv[i]) == '-' && strcasecmp(argv[i] + 1, "direct") == 0) continue;
+    cmd_argv.push_back(argv[i]);
+    if (i > 0) {
+      cmd_line += format2str(" \"%s\"", argv[i]);
+    }
+  }
+  cmd_argv.push_back(nullptr);
+
+  auto const action = [pMethDesc, &cmd_argv, &cmd_line](sessionState &/*session_param*/, JavaVM *const jvm) -> int {
+    if (pMethDesc->empty()) {
+      log(LL::ERR, "%s(): no Java method defined to handle command line:\n\t'%s'", func_name, cmd_line.c_str());
+      return EXIT_FAILURE;
+    }
+    // the Java streams take ownership of (and close) the file descriptors, so they're given duplicates
+    auto const dup_fd = [](int fd) -> fd_wrapper_sp_t {
+      return fd_wrapper_sp_t{ new fd_wrapper_t{ dup(fd) }, &launch_program::fd_cleanup_with_delete };
+    };
+    std::array<fd_wrapper_sp_t, 3> fds_array {{ dup_fd(STDOUT_FILENO), dup_fd(STDERR_FILENO), dup_fd(STDIN_FILENO) }};
+    if (fds_array[0]->fd == -1 || fds_array[1]->fd == -1 || fds_array[2]->fd == -1) {
+      log(LL::ERR, "%s(): dup() of standard file descriptors failed: %s", func_name, strerror(errno));
+      return EXIT_FAILURE;
+    }
+    const auto pid = getpid();
+    supervisor_child_processor_notify(pid, cmd_line.c_str());
+    const auto rc = invoke_java_method(jvm, *pMethDesc, std::move(fds_array),
+                                       static_cast<int>(cmd_argv.size()) - 1, cmd_argv.data());
+    supervisor_child_processor_completion_notify(pid);
+    return rc;
+  };
+
+  return invoke_child_process_action(shm_session, jvm_override_optns.c_str(), action);
+}
@@ -0,0 +1,120 @@
+/* supervisor-executor-bench.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Microbenchmark of how the supervisor runs a burst of concurrent -status requests - a detached thread
+// started (and attached to the JVM) per request vs. the supervisor executor, whose threads attach once.
+// The JVM isn't involved: the attach cost and the work of a request are simulated by spinning the CPU
+// for attach-us and work-us. Reports requests per second and the worst request latency of each.
+//
+// usage: supervisor-executor-bench [requests [work-us [attach-us [pool-size]]]]
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "log.h"
+#include "supervisor-executor.h"
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static void spin_us(const int us) {
+  const auto until_ns = now_ns() + static_cast<long long>(us) * 1000LL;
+  while (now_ns() < until_ns) {}
+}
+
+// counts down completed requests and tracks the worst latency
+struct completion_t {
+  std::mutex mtx;
+  std::condition_variable cv;
+  int remaining;
+  long long max_latency_ns = 0;
+  explicit completion_t(int requests) : remaining(requests) {}
+  void done(const long long submit_ns) {
+    const auto latency_ns = now_ns() - submit_ns;
+    std::lock_guard<std::mutex> lk(mtx);
+    max_latency_ns = std::max(max_latency_ns, latency_ns);
+    if (--remaining == 0) {
+      cv.notify_one();
+    }
+  }
+  void wait() {
+    std::unique_lock<std::mutex> lk(mtx);
+    cv.wait(lk, [this] { return remaining == 0; });
+  }
+};
+
+static void report(const char *name, const int requests, const long long elapsed_ns, const completion_t &completion) {
+  const double secs = static_cast<double>(elapsed_ns) / 1e9;
+  printf("%-18s %10.0f requests/sec %10.2f ms elapsed %10.2f ms worst latency\n", name, requests / secs,
+         static_cast<double>(elapsed_ns) / 1e6, static_cast<double>(completion.max_latency_ns) / 1e6);
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("supervisor-executor-bench");
+  const int requests = argc > 1 ? atoi(argv[1]) : 1000;
+  const int work_us = argc > 2 ? atoi(argv[2]) : 500;
+  const int attach_us = argc > 3 ? atoi(argv[3]) : 100;
+  const int pool_size = argc > 4 ? atoi(argv[4]) : supervisor_executor::pool_size();
+  printf("%d concurrent requests of %d us each, %d us thread attach, pool of %d threads\n",
+         requests, work_us, attach_us, pool_size);
+
+  {
+    completion_t completion(requests);
+    const auto start_ns = now_ns();
+    for (int i = 0; i < requests; i++) {
+      const auto submit_ns = now_ns();
+      std::thread([&completion, submit_ns, work_us, attach_us] {
+        spin_us(attach_us); // attach
+        spin_us(work_us);
+        completion.done(submit_ns);
+      }).detach();
+    }
+    completion.wait();
+    report("thread-per-request", requests, now_ns() - start_ns, completion);
+  }
+
+  {
+    std::atomic<int> attached{0};
+    supervisor_executor::Executor executor(static_cast<size_t>(std::max(pool_size, 1)),
+                                           [&attached, attach_us] { spin_us(attach_us); attached++; }, nullptr);
+    while (attached.load() < pool_size) {
+      std::this_thread::yield(); // the pool threads attach at startup - not per request
+    }
+    completion_t completion(requests);
+    const auto start_ns = now_ns();
+    for (int i = 0; i < requests; i++) {
+      const auto submit_ns = now_ns();
+      executor.submit([&completion, submit_ns, work_us] {
+        spin_us(work_us);
+        completion.done(submit_ns);
+      });
+    }
+    completion.wait();
+    report("executor", requests, now_ns() - start_ns, completion);
+    executor.stop();
+    printf("%s\n", executor.stats_str().c_str());
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,246 @@
+/* supervisor-executor.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include "format2str.h"
+#include "log.h"
+#include "supervisor-executor.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace supervisor_executor {
+
+  const string_view SERIAL_COMMANDS_KEY{ "--SERIAL_COMMANDS" };
+  const string_view NOTIFICATIONS_KEY{ "--CHILD_PID_NOTIFY" };
+
+  static int s_pool_size = 4;
+
+  void set_pool_size(int pool_size) { s_pool_size = std::max(pool_size, 1); }
+  int pool_size() { return s_pool_size; }
+
+  struct job_t {
+    Executor::task_t task;
+    std::string serial_key;
+    bool is_serial;
+  };
+
+  struct state_t {
+    const Executor::thread_hook_t on_start;
+    const Executor::thread_hook_t on_exit;
+    std::mutex mtx;
+    std::condition_variable work_cv;
+    std::condition_variable reserved_cv; // the reserved thread waits on priority tasks only
+    std::condition_variable exit_cv;
+    std::deque<job_t> ready;
+    std::deque<job_t> priority; // the lane of priority tasks - served by the reserved thread too
+    // a serial key is present while a task of it is ready or running - its later tasks wait their turn here
+    std::unordered_map<std::string, std::deque<Executor::task_t>> serial;
+    bool is_stopping = false;
+    size_t threads = 0, live_threads = 0;
+    // counters
+    uint64_t submitted = 0, completed = 0, deferred = 0, discarded = 0, queued = 0, peak_queued = 0;
+    uint64_t busy = 0, peak_busy = 0;
+
+    state_t(Executor::thread_hook_t on_start, Executor::thread_hook_t on_exit)
+        : on_start(std::move(on_start)), on_exit(std::move(on_exit)) {}
+  };
+
+  // the next task of the serial key (if any) becomes ready now that its predecessor has completed
+  static void advance_serial_locked(state_t &st, const std::string &serial_key) {
+    auto const it = st.serial.find(serial_key);
+    if (it == st.serial.end()) return; // stop() discarded it
+    if (it->second.empty()) {
+      st.serial.erase(it);
+      return;
+    }
+    st.ready.push_back(job_t{ std::move(it->second.front()), serial_key, true });
+    it->second.pop_front();
+    st.work_cv.notify_one();
+  }
+
+  static void run_task(const Executor::task_t &task) {
+    try {
+      task();
+    } catch (const std::exception &ex) {
+      log(LL::ERR, "supervisor executor task failed with exception: %s", ex.what());
+    } catch (...) {
+      log(LL::ERR, "supervisor executor task failed with unknown exception");
+    }
+  }
+
+  // the reserved thread only runs priority tasks - it's free for them whatever the pool threads are busy with
+  static void run_pool_thread(const std::shared_ptr<state_t> st, const bool is_reserved) {
+    if (st->on_start) {
+      st->on_start();
+    }
+    std::unique_lock<std::mutex> lk(st->mtx);
+    for(;;) {
+      (is_reserved ? st->reserved_cv : st->work_cv).wait(lk, [&st, is_reserved] {
+        return st->is_stopping || !st->priority.empty() || (!is_reserved && !st->ready.empty());
+      });
+      if (st->is_stopping) break;
+      auto &lane = st->priority.empty() ? st->ready : st->priority;
+      job_t job = std::move(lane.front());
+      lane.pop_front();
+      st->queued--;
+      st->peak_busy = std::max(st->peak_busy, ++st->busy);
+      lk.unlock();
+      run_task(job.task);
+      lk.lock();
+      st->busy--;
+      st->completed++;
+      if (job.is_serial) {
+        advance_serial_locked(*st, job.serial_key);
+      }
+    }
+    lk.unlock();
+    if (st->on_exit) {
+      st->on_exit();
+    }
+    lk.lock();
+    st->live_threads--;
+    st->exit_cv.notify_all();
+  }
+
+  Executor::Executor(size_t pool_size, thread_hook_t on_start, thread_hook_t on_exit)
+      : state(std::make_shared<state_t>(std::move(on_start), std::move(on_exit)))
+  {
+    std::lock_guard<std::mutex> lk(state->mtx);
+    // the pool threads, then the reserved thread of priority tasks
+    for (size_t i = 0; i <= pool_size; i++) {
+      try {
+        std::thread(run_pool_thread, state, i == pool_size).detach();
+        state->threads++;
+        state->live_threads++;
+      } catch (const std::system_error &ex) {
+        log(LL::ERR, "%s(): could only start %lu of %lu supervisor threads: %s", __func__, i, pool_size + 1, ex.what());
+        break;
+      }
+    }
+    if (state->threads == 0) {
+      log(LL::ERR, "%s(): no supervisor threads - tasks are run on the submitting thread", __func__);
+    }
+  }
+
+  Executor::~Executor() {
+    stop(0);
+  }
+
+  void Executor::submit(task_t task) {
+    std::unique_lock<std::mutex> lk(state->mtx);
+    if (state->is_stopping) {
+      state->discarded++;
+      return;
+    }
+    state->submitted++;
+    if (state->threads == 0) {
+      lk.unlock();
+      run_task(task);
+      return;
+    }
+    state->ready.push_back(job_t{ std::move(task), std::string(), false });
+    state->peak_queued = std::max(state->peak_queued, ++state->queued);
+    state->work_cv.notify_one();
+  }
+
+  void Executor::submit(string_view const serial_key, task_t task) {
+    std::unique_lock<std::mutex> lk(state->mtx);
+    if (state->is_stopping) {
+      state->discarded++;
+      return;
+    }
+    state->submitted++;
+    if (state->threads == 0) {
+      lk.unlock();
+      run_task(task); // the submitting thread runs them one at a time anyway
+      return;
+    }
+    std::string key(serial_key.c_str(), serial_key.size());
+    auto const it = state->serial.find(key);
+    if (it != state->serial.end()) {
+      it->second.push_back(std::move(task)); // a task of the key is ready or running - wait for it
+      state->deferred++;
+    } else {
+      state->serial.emplace(key, std::deque<task_t>());
+      state->ready.push_back(job_t{ std::move(task), std::move(key), true });
+      state->work_cv.notify_one();
+    }
+    state->peak_queued = std::max(state->peak_queued, ++state->queued);
+  }
+
+  void Executor::submit_priority(task_t task) {
+    std::unique_lock<std::mutex> lk(state->mtx);
+    if (state->is_stopping) {
+      state->discarded++;
+      return;
+    }
+    state->submitted++;
+    if (state->threads == 0) {
+      lk.unlock();
+      run_task(task);
+      return;
+    }
+    state->priority.push_back(job_t{ std::move(task), std::string(), false });
+    state->peak_queued = std::max(state->peak_queued, ++state->queued);
+    state->reserved_cv.notify_one();
+    state->work_cv.notify_one();
+  }
+
+  void Executor::stop(const int timeout_ms) {
+    std::unique_lock<std::mutex> lk(state->mtx);
+    if (!state->is_stopping) {
+      state->is_stopping = true;
+      state->discarded += state->queued;
+      state->queued = 0;
+      state->ready.clear();
+      state->priority.clear();
+      state->serial.clear();
+      state->work_cv.notify_all();
+      state->reserved_cv.notify_all();
+    }
+    if (!state->exit_cv.wait_for(lk, std::chrono::milliseconds(std::max(timeout_ms, 0)),
+                                 [this] { return state->live_threads == 0; }) && timeout_ms > 0)
+    {
+      log(LL::WARN, "%s(): %lu supervisor threads are still busy with a task", __func__, state->live_threads);
+    }
+  }
+
+  std::string Executor::stats_str() const {
+    std::lock_guard<std::mutex> lk(state->mtx);
+    return format2str("supervisor executor: %lu threads, %llu tasks submitted, %llu completed (%llu waited on a "
+                      "serial predecessor), peak %llu queued, peak %llu running, %llu discarded",
+                      state->threads, static_cast<unsigned long long>(state->submitted),
+                      static_cast<unsigned long long>(state->completed),
+                      static_cast<unsigned long long>(state->deferred),
+                      static_cast<unsigned long long>(state->peak_queued),
+                      static_cast<unsigned long long>(state->peak_busy),
+                      static_cast<unsigned long long>(state->discarded));
+  }
+}
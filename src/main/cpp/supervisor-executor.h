@@ -0,0 +1,83 @@
+/* supervisor-executor.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_SUPERVISOR_EXECUTOR_H
+#define SPARTAN_SUPERVISOR_EXECUTOR_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "string-view.h"
+
+/**
+ * Fixed-size thread pool on which the supervisor runs its Java method invocations - @SupervisorCommand
+ * methods, -status requests and child process lifecycle notifications.
+ *
+ * The pool threads are started once (config.ini [ChildProcessSettings] SupervisorThreads, default 4) and
+ * their on_start hook attaches them to the JVM for their lifetime, so an invocation no longer pays for
+ * attaching and detaching a thread. A task submitted with a serial key runs only after the previously
+ * submitted tasks of that key have completed (FIFO); a task without one runs on whichever thread is free.
+ * Priority tasks (-status requests) have a lane of their own: besides the pool threads, which take them
+ * ahead of the other ready tasks, a reserved thread runs nothing else, so they're never held up by long
+ * running commands occupying the pool.
+ */
+namespace supervisor_executor {
+
+  using bpstd::string_view;
+
+  // the serial key of @SupervisorCommand methods not annotated as concurrent - they run one at a time
+  extern const string_view SERIAL_COMMANDS_KEY;
+  // the serial key of child process lifecycle notifications - they're delivered in the order sent
+  extern const string_view NOTIFICATIONS_KEY;
+
+  // config.ini [ChildProcessSettings] SupervisorThreads setting
+  void set_pool_size(int pool_size);
+  int pool_size();
+
+  struct state_t;
+
+  class Executor {
+  public:
+    using task_t = std::function<void()>;
+    using thread_hook_t = std::function<void()>;
+  private:
+    // shared with the pool threads, which may outlive the executor when stop() gives up waiting on them
+    std::shared_ptr<state_t> state;
+  public:
+    Executor(size_t pool_size, thread_hook_t on_start, thread_hook_t on_exit);
+    Executor(const Executor &) = delete;
+    Executor& operator=(const Executor &) = delete;
+    ~Executor();
+
+    // runs the task on any free pool thread
+    void submit(task_t task);
+    // runs the task after all previously submitted tasks of the serial key have completed
+    void submit(string_view serial_key, task_t task);
+    // runs the task on the reserved thread, or on a free pool thread ahead of the other ready tasks
+    void submit_priority(task_t task);
+
+    // discards tasks not yet started, then waits up to timeout_ms for the pool threads to finish their
+    // current task and exit; tasks submitted afterwards are discarded
+    void stop(int timeout_ms = 5000);
+
+    // the counters (tasks run, peak queue depth, busiest concurrency) as a log friendly string
+    std::string stats_str() const;
+  };
+}
+
+#endif //SPARTAN_SUPERVISOR_EXECUTOR_H
@@ -0,0 +1,174 @@
+/* timeline-trace.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "format2str.h"
+#include "log.h"
+#include "timeline-trace.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace timeline_trace {
+
+  enum class State : short { DISABLED, PENDING, ENABLED };
+
+  static const char * const trace_file_env_var = "SPARTAN_TRACE_FILE";
+
+  static State s_state = State::DISABLED;
+  static int s_fd = -1;
+  static pid_t s_owner_pid = -1;          // the launcher process - the one that truncated the trace file
+  static std::string s_cfg_path;
+  static std::vector<std::string> s_pending; // events recorded prior to config.ini having been processed
+
+  bool is_enabled() { return s_state != State::DISABLED; }
+
+  long long now_us() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<long long>(ts.tv_sec) * 1000000LL + ts.tv_nsec / 1000;
+  }
+
+  static std::string json_escape(const std::string &str) {
+    std::string escaped;
+    escaped.reserve(str.size());
+    for (const char c : str) {
+      if (c == '"' || c == '\\') {
+        escaped += '\\';
+        escaped += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        escaped += format2str("\\u%04x", c);
+      } else {
+        escaped += c;
+      }
+    }
+    return escaped;
+  }
+
+  static void emit(std::string event) {
+    if (s_state == State::PENDING) {
+      s_pending.emplace_back(std::move(event));
+      return;
+    }
+    event += ",\n";
+    // a single write to an O_APPEND file descriptor - events of concurrent processes won't interleave
+    if (write(s_fd, event.c_str(), event.size()) == -1) {
+      log(LL::DEBUG, "%s(): pid(%d) trace event write failed: %s", __func__, getpid(), strerror(errno));
+    }
+  }
+
+  static bool open_trace_file(const char *path) {
+    s_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (s_fd == -1) {
+      log(LL::WARN, "%s(): could not open trace file \"%s\":\n\t%s", __func__, path, strerror(errno));
+      return false;
+    }
+    static const char array_start[] = "[\n";
+    if (write(s_fd, array_start, sizeof(array_start) - 1) == -1) {
+      log(LL::WARN, "%s(): could not write trace file \"%s\":\n\t%s", __func__, path, strerror(errno));
+      close(s_fd);
+      s_fd = -1;
+      return false;
+    }
+    log(LL::INFO, "startup and dispatch timeline trace file: \"%s\"", path);
+    return true;
+  }
+
+  static void enable(const char *path) {
+    if (!open_trace_file(path)) {
+      s_state = State::DISABLED;
+      s_pending.clear();
+      return;
+    }
+    s_state = State::ENABLED;
+    for (auto &event : s_pending) {
+      emit(std::move(event));
+    }
+    s_pending.clear();
+  }
+
+  void begin() {
+    s_owner_pid = getpid();
+    s_state = State::PENDING;
+    const char * const env_path = getenv(trace_file_env_var);
+    if (env_path != nullptr && env_path[0] != '\0') {
+      enable(env_path);
+    }
+    process_name("launcher");
+  }
+
+  void set_trace_file(const char *path) {
+    s_cfg_path = path != nullptr ? path : "";
+  }
+
+  void config_done() {
+    if (s_state != State::PENDING) return; // the environment variable takes precedence over config.ini
+    if (s_cfg_path.empty()) {
+      s_state = State::DISABLED;
+      s_pending.clear();
+      return;
+    }
+    enable(s_cfg_path.c_str());
+  }
+
+  void end() {
+    if (s_state != State::ENABLED || getpid() != s_owner_pid) return;
+    // the final event has no trailing comma so that the closed out array is strictly valid JSON
+    const auto event = format2str("{\"name\":\"trace end\",\"cat\":\"spartan\",\"ph\":\"i\",\"s\":\"g\","
+                                  "\"ts\":%lld,\"pid\":%d,\"tid\":%ld}\n]\n",
+                                  now_us(), getpid(), syscall(SYS_gettid));
+    if (write(s_fd, event.c_str(), event.size()) == -1) {
+      log(LL::DEBUG, "%s(): trace file write failed: %s", __func__, strerror(errno));
+    }
+    close(s_fd);
+    s_fd = -1;
+    s_state = State::DISABLED;
+  }
+
+  void process_name(const std::string &name) {
+    if (!is_enabled()) return;
+    const auto pid = getpid();
+    const auto tid = syscall(SYS_gettid);
+    const auto escaped_name = json_escape(name);
+    emit(format2str("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+                    pid, tid, escaped_name.c_str()));
+    emit(format2str("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+                    pid, tid, escaped_name.c_str()));
+  }
+
+  void complete(const char *name, long long start_us) {
+    if (!is_enabled()) return;
+    const long long end_us = now_us();
+    emit(format2str("{\"name\":\"%s\",\"cat\":\"spartan\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%ld}",
+                    json_escape(name).c_str(), start_us, end_us - start_us, getpid(), syscall(SYS_gettid)));
+  }
+
+  void instant(const char *name) {
+    if (!is_enabled()) return;
+    emit(format2str("{\"name\":\"%s\",\"cat\":\"spartan\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%lld,\"pid\":%d,\"tid\":%ld}",
+                    json_escape(name).c_str(), now_us(), getpid(), syscall(SYS_gettid)));
+  }
+}
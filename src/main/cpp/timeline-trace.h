@@ -0,0 +1,72 @@
+/* timeline-trace.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_TIMELINE_TRACE_H
+#define SPARTAN_TIMELINE_TRACE_H
+
+#include <string>
+
+/**
+ * Startup and dispatch timeline tracer that writes a Chrome/Perfetto trace (JSON array format).
+ *
+ * Enabled by the SPARTAN_TRACE_FILE environment variable or the config.ini [LoggingSettings]
+ * TraceFile setting, either of which names the trace file. The service launcher process truncates
+ * the trace file upon start; it and every process forked from it (the supervisor and the child
+ * processes) then append events to it, timestamped via CLOCK_MONOTONIC so that the events of all
+ * the processes fall on the same timeline. Each event is a single O_APPEND write, so events of
+ * concurrently running processes don't interleave. The launcher process closes out the JSON array
+ * as it exits; the file of a service that was killed is still loadable by the trace viewers.
+ */
+namespace timeline_trace {
+
+  // service launcher process - starts the trace if the SPARTAN_TRACE_FILE environment variable is set,
+  // otherwise events are held until the config.ini settings determine whether tracing is enabled
+  void begin();
+  // config.ini [LoggingSettings] TraceFile setting
+  void set_trace_file(const char *path);
+  // service launcher process - config.ini has been processed so held events are written or discarded
+  void config_done();
+  // service launcher process - closes out the trace file
+  void end();
+
+  bool is_enabled();
+  // microseconds of CLOCK_MONOTONIC - the timeline of all the traced processes
+  long long now_us();
+
+  // names the current process (and its thread) in the trace viewer
+  void process_name(const std::string &name);
+  // a complete event - a phase that began at start_us and ends now
+  void complete(const char *name, long long start_us);
+  // an instant event
+  void instant(const char *name);
+
+  // a complete event spanning the lifetime of the scope object
+  class scope {
+  private:
+    const char * const name;
+    const long long start_us;
+  public:
+    explicit scope(const char *name) : name(name), start_us(now_us()) {}
+    scope(const char *name, long long start_us) : name(name), start_us(start_us) {}
+    scope(const scope &) = delete;
+    scope& operator=(const scope &) = delete;
+    ~scope() { complete(name, start_us); }
+  };
+}
+
+#endif //SPARTAN_TIMELINE_TRACE_H
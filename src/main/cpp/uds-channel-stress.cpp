@@ -0,0 +1,200 @@
+/* uds-channel-stress.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+// Stress test of the response channel - concurrent invocations from the threads of one process, as
+// Spartan.invokeCommand() callers do. Each invocation thread binds its socket name (bind_uds_socket_name())
+// and hands it to a pool of responder threads, which stand in for the supervisor and the child processes:
+// a responder conveys 1 or 3 pipe fds (open_write_anon_pipe() / open_react_anon_pipes()), with a per
+// invocation pid and status, then writes the socket name down the pipe(s). The invocation thread takes
+// the response (obtain_response_stream()) and checks that the pid, status and fd count are its own and
+// that its pipe(s) yield its own socket name - i.e., that no two invocations ever shared a socket name
+// or were handed each other's response.
+//
+// usage: uds-channel-stress [invocations [responder-threads]]
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "log.h"
+#include "launch-program.h"
+#include "open-anon-pipes.h"
+#include "spartan-exception.h"
+
+using namespace launch_program;
+
+static long long now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+struct invocation_t {
+  int i;
+  std::string uds_socket_name;
+};
+
+static pid_t rsp_pid_of(const int i) { return 100000 + i; }
+static int status_of(const int i) { return (i % 3) == 0 ? EXIT_REJECTED : EXIT_SUCCESS; }
+static int fds_count_of(const int i) { return (i % 2) == 0 ? 1 : 3; }
+
+static std::string read_all(const int fd) {
+  std::string str;
+  char buf[256];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    str.append(buf, static_cast<size_t>(n));
+  }
+  return str;
+}
+
+static bool write_all(const int fd, const std::string &str) {
+  return write(fd, str.data(), str.size()) == static_cast<ssize_t>(str.size());
+}
+
+int main(int argc, char **argv) {
+  logger::set_progname("uds-channel-stress");
+  const int invocations = argc > 1 ? atoi(argv[1]) : 1000;
+  const int responders = argc > 2 ? atoi(argv[2]) : 8;
+
+  // an invocation in flight holds up to 5 fds (its listening and connected sockets, and 3 pipe fds)
+  rlimit rl{};
+  getrlimit(RLIMIT_NOFILE, &rl);
+  rl.rlim_cur = rl.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &rl);
+  getrlimit(RLIMIT_NOFILE, &rl);
+  const auto fds_limit = static_cast<long>(rl.rlim_cur);
+  if (fds_limit < 5L * invocations + 64) {
+    printf("fd limit %ld is too low for %d concurrent invocations\n", fds_limit, invocations);
+    return EXIT_FAILURE;
+  }
+
+  std::mutex mtx;
+  std::condition_variable start_cv, queue_cv;
+  bool is_started = false, is_done = false;
+  std::deque<invocation_t> queue;
+  std::set<std::string> names;
+  std::vector<std::string> errors;
+  std::vector<long long> rtt_ns(static_cast<size_t>(invocations), 0);
+
+  const auto add_error = [&mtx, &errors](std::string msg) {
+    std::unique_lock<std::mutex> lk(mtx);
+    errors.push_back(std::move(msg));
+  };
+
+  std::vector<std::thread> responder_threads;
+  for (int r = 0; r < responders; r++) {
+    responder_threads.emplace_back([&]() {
+      for (;;) {
+        invocation_t inv;
+        {
+          std::unique_lock<std::mutex> lk(mtx);
+          queue_cv.wait(lk, [&]() { return is_done || !queue.empty(); });
+          if (queue.empty()) return;
+          inv = std::move(queue.front());
+          queue.pop_front();
+        }
+        try {
+          int rc;
+          string_view const name(inv.uds_socket_name.c_str(), inv.uds_socket_name.size());
+          if (fds_count_of(inv.i) == 1) {
+            auto fd_sp = open_write_anon_pipe(name, rc, rsp_pid_of(inv.i), status_of(inv.i));
+            write_all(fd_sp->fd, inv.uds_socket_name);
+          } else {
+            auto rslt = open_react_anon_pipes(name, rc, rsp_pid_of(inv.i), status_of(inv.i));
+            write_all(std::get<0>(rslt)->fd, inv.uds_socket_name);
+            write_all(std::get<1>(rslt)->fd, inv.uds_socket_name);
+          }
+        } catch (const spartan_exception &ex) {
+          add_error(std::string(ex.name()) + ": " + ex.what());
+        }
+      }
+    });
+  }
+
+  std::vector<std::thread> invocation_threads;
+  for (int i = 0; i < invocations; i++) {
+    invocation_threads.emplace_back([&, i]() {
+      {
+        std::unique_lock<std::mutex> lk(mtx);
+        start_cv.wait(lk, [&is_started]() { return is_started; });
+      }
+      try {
+        const auto start_ns = now_ns();
+        auto rslt = bind_uds_socket_name("stress", "uds-channel-stress");
+        const std::string uds_socket_name = std::get<1>(rslt);
+        {
+          std::unique_lock<std::mutex> lk(mtx);
+          names.insert(uds_socket_name);
+          queue.push_back(invocation_t{ i, uds_socket_name });
+        }
+        queue_cv.notify_one();
+        auto rsp = obtain_response_stream({uds_socket_name.c_str(), uds_socket_name.size()},
+                                          std::move(std::get<0>(rslt)));
+        rtt_ns[static_cast<size_t>(i)] = now_ns() - start_ns;
+        const int fds_count = std::get<2>(rsp) ? 3 : 1;
+        if (std::get<0>(rsp) != rsp_pid_of(i) || std::get<4>(rsp) != status_of(i) || fds_count != fds_count_of(i)) {
+          add_error("invocation " + std::to_string(i) + ": response of another invocation");
+          return;
+        }
+        if (read_all(std::get<1>(rsp)->fd) != uds_socket_name ||
+            (fds_count == 3 && read_all(std::get<2>(rsp)->fd) != uds_socket_name)) {
+          add_error("invocation " + std::to_string(i) + ": pipe(s) of another invocation");
+        }
+      } catch (const spartan_exception &ex) {
+        add_error(std::string(ex.name()) + ": " + ex.what());
+      }
+    });
+  }
+
+  const auto start_ns = now_ns();
+  {
+    std::unique_lock<std::mutex> lk(mtx);
+    is_started = true;
+  }
+  start_cv.notify_all();
+  for (auto &t : invocation_threads) t.join();
+  const auto elapsed_ns = now_ns() - start_ns;
+  {
+    std::unique_lock<std::mutex> lk(mtx);
+    is_done = true;
+  }
+  queue_cv.notify_all();
+  for (auto &t : responder_threads) t.join();
+
+  std::sort(rtt_ns.begin(), rtt_ns.end());
+  printf("%d concurrent invocations, %d responders: %.1f ms, %lu distinct socket names\n",
+         invocations, responders, static_cast<double>(elapsed_ns) / 1e6, names.size());
+  printf("  bind to response  p50 %.1f us  p99 %.1f us\n",
+         static_cast<double>(rtt_ns[rtt_ns.size() / 2]) / 1e3,
+         static_cast<double>(rtt_ns[rtt_ns.size() * 99 / 100]) / 1e3);
+  for (const auto &err : errors) {
+    printf("  FAILED %s\n", err.c_str());
+  }
+  const bool is_ok = errors.empty() && names.size() == static_cast<size_t>(invocations);
+  printf("%s\n", is_ok ? "OK" : "FAILED");
+  return is_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,139 @@
+/* warm-pool.cpp
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include <cstring>
+#include <cerrno>
+#include <memory>
+#include <vector>
+#include <sys/socket.h>
+#include "log.h"
+#include "warm-pool.h"
+
+//#undef NDEBUG // uncomment this line to enable asserts in use below
+#include <cassert>
+
+using namespace logger;
+
+namespace warm_pool {
+
+  const char * const POOL_JVM_OPTNS = "";
+
+  // forks child processes until the pool holds its target count of idle members; the JVM
+  // creation cost is paid in the forked child so this returns as soon as the forks are done
+  void WarmPool::refill() {
+    // the lock is held across fork() - the child process never touches the pool object
+    std::unique_lock<std::mutex> lk(mtx);
+    while (!is_shutdown && idle.size() < target_size) {
+      int sv[2] { -1, -1 };
+      if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == -1) {
+        log(LL::ERR, "%s(): socketpair() failed - warm pool not refilled:\n\t%s", __func__, strerror(errno));
+        return;
+      }
+      const pid_t pid = fork();
+      if (pid == -1) {
+        log(LL::ERR, "%s(): fork() of warm pool child process failed:\n\t%s", __func__, strerror(errno));
+        close(sv[0]);
+        close(sv[1]);
+        return;
+      }
+      if (pid == 0) {
+        close(sv[0]);
+        // don't hold open the control sockets of sibling pool members (would mask their EOF on shutdown)
+        for (auto const &child : idle) {
+          close(child.ctl_fd);
+        }
+        exit(child_main(sv[1]));
+      }
+      close(sv[1]);
+      idle.push_back(pooled_child_t{pid, sv[0]});
+      log(LL::TRACE, "%s(): forked warm pool child process %d (%lu of %lu idle)",
+          __func__, pid, idle.size(), target_size);
+    }
+  }
+
+  // hands the command dispatch message off to an idle pool member; returns
+  // the pid of the child process now running the command, else -1 if the
+  // pool had no idle member to take it (caller falls back to the cold path)
+  pid_t WarmPool::hand_off(const std::string &msg) {
+    std::unique_lock<std::mutex> lk(mtx);
+    while (!idle.empty()) {
+      const pooled_child_t child = idle.front();
+      idle.pop_front();
+      const auto n = send(child.ctl_fd, msg.c_str(), msg.size(), MSG_NOSIGNAL);
+      const int ern = n == -1 ? errno : 0;
+      close(child.ctl_fd);
+      if (n == static_cast<ssize_t>(msg.size())) {
+        log(LL::DEBUG, "%s(): warm pool child process %d handed command (%lu idle remaining)",
+            __func__, child.pid, idle.size());
+        return child.pid;
+      }
+      // the pool member went away without having been given work - remember it so that reap() discounts it
+      discarded.insert(child.pid);
+      log(LL::WARN, "%s(): warm pool child process %d could not be handed command: %s",
+          __func__, child.pid, ern != 0 ? strerror(ern) : "short send");
+    }
+    return -1;
+  }
+
+  // returns true if the terminated child process was a pool member that never received
+  // work - such a child process was never accounted for as a dispatched child command
+  bool WarmPool::reap(pid_t pid) {
+    std::unique_lock<std::mutex> lk(mtx);
+    if (discarded.erase(pid) > 0) return true;
+    for (auto it = idle.begin(); it != idle.end(); ++it) {
+      if (it->pid == pid) {
+        if (it->ctl_fd != -1) {
+          close(it->ctl_fd);
+        }
+        idle.erase(it);
+        log(LL::WARN, "%s(): idle warm pool child process %d terminated", __func__, pid);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // closing the control sockets releases the idle pool members, which then exit; they are retained
+  // in the idle collection (sans socket) so that reap() still recognizes them when they terminate
+  void WarmPool::shutdown() {
+    std::unique_lock<std::mutex> lk(mtx);
+    if (is_shutdown) return;
+    is_shutdown = true;
+    for (auto &child : idle) {
+      if (child.ctl_fd != -1) {
+        close(child.ctl_fd);
+        child.ctl_fd = -1;
+      }
+    }
+    log(LL::TRACE, "%s(): released %lu idle warm pool child processes", __func__, idle.size());
+  }
+
+  // called in the pool child process context - blocks until handed a command dispatch message;
+  // returns an empty string if the control socket was closed before any work arrived
+  std::string await_work(int ctl_fd, size_t max_msg_size) {
+    std::unique_ptr<char[]> buf_sp(new char[max_msg_size]);
+    ssize_t n;
+    do {
+      n = recv(ctl_fd, buf_sp.get(), max_msg_size, 0);
+    } while (n == -1 && errno == EINTR);
+    if (n == -1) {
+      log(LL::ERR, "%s(): recv() on control socket failed:\n\t%s", __func__, strerror(errno));
+    }
+    return n > 0 ? std::string(buf_sp.get(), static_cast<size_t>(n)) : std::string();
+  }
+}
@@ -0,0 +1,80 @@
+/* warm-pool.h
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef SPARTAN_WARM_POOL_H
+#define SPARTAN_WARM_POOL_H
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <unistd.h>
+
+namespace warm_pool {
+
+  // JVM options that pooled child processes create their JVM with (i.e., the config.ini defaults);
+  // a child command whose jvm_optns_str() differs from this must be dispatched via the cold path
+  extern const char * const POOL_JVM_OPTNS;
+
+  // executes in the forked child process context; the returned value becomes the child's exit code
+  using child_main_t = std::function<int(int ctl_fd)>;
+
+  /**
+   * A pool of pre-forked child processes that have each already created their Java JVM and
+   * are parked on a control socket waiting to be handed a command dispatch message.
+   *
+   * Pool members are forked from the launcher process. The launcher hands the next child
+   * command message (the same text that is otherwise passed to a cold forked child process)
+   * to an idle pool member and then refills the pool. A pool member that never received work
+   * exits when its control socket is closed (pool shutdown or launcher process exit).
+   *
+   * NOTE: The child_main callback runs in the forked child process - it must not make use of
+   * the pool object (its mutex may have been held by another thread at the time of fork).
+   */
+  class WarmPool {
+  private:
+    struct pooled_child_t {
+      pid_t pid;
+      int ctl_fd;
+    };
+    std::mutex mtx;
+    std::deque<pooled_child_t> idle;
+    std::unordered_set<pid_t> discarded;
+    const size_t target_size;
+    const child_main_t child_main;
+    bool is_shutdown{false};
+  public:
+    WarmPool(size_t target_size, child_main_t child_main) : target_size(target_size),
+                                                            child_main(std::move(child_main)) {}
+    WarmPool(const WarmPool &) = delete;
+    WarmPool(WarmPool &&) = delete;
+    WarmPool& operator=(const WarmPool &) = delete;
+    WarmPool& operator=(WarmPool &&) = delete;
+    ~WarmPool() { shutdown(); }
+  public:
+    void refill();
+    pid_t hand_off(const std::string &msg);
+    bool reap(pid_t pid);
+    void shutdown();
+  };
+
+  std::string await_work(int ctl_fd, size_t max_msg_size);
+}
+
+#endif //SPARTAN_WARM_POOL_H
@@ -0,0 +1,191 @@
+/* AnnotationIndexProcessor.java
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+package spartan;
+
+import static java.nio.charset.StandardCharsets.UTF_8;
+
+import java.io.IOException;
+import java.io.OutputStreamWriter;
+import java.io.Writer;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+
+import javax.annotation.processing.AbstractProcessor;
+import javax.annotation.processing.RoundEnvironment;
+import javax.lang.model.SourceVersion;
+import javax.lang.model.element.AnnotationMirror;
+import javax.lang.model.element.AnnotationValue;
+import javax.lang.model.element.Element;
+import javax.lang.model.element.ElementKind;
+import javax.lang.model.element.ExecutableElement;
+import javax.lang.model.element.TypeElement;
+import javax.lang.model.element.VariableElement;
+import javax.lang.model.type.ArrayType;
+import javax.lang.model.type.DeclaredType;
+import javax.lang.model.type.TypeMirror;
+import javax.tools.Diagnostic;
+import javax.tools.FileObject;
+import javax.tools.StandardLocation;
+
+import spartan.annotations.ChildWorkerCommand;
+import spartan.annotations.SupervisorCommand;
+import spartan.annotations.SupervisorMain;
+
+/**
+ * Compile-time annotation processor that writes the {@link CommandDispatchInfo#ANNOTATION_INDEX_RESOURCE}
+ * resource listing the methods annotated with @SupervisorMain, @SupervisorCommand and @ChildWorkerCommand.
+ * At supervisor startup a jar having this index is not scanned class file by class file.
+ * <p>
+ * The processor is registered via META-INF/services so it takes effect for any project that
+ * compiles with the Spartan jar on its classpath. It runs for every compilation (even one
+ * without Spartan annotations) so that such jars get an empty index and are not scanned either.
+ * <p>
+ * The index is a full-build artifact - a compilation of only some of a module's source files
+ * would write an incomplete index (do a clean build of the module when packaging its jar).
+ */
+@SuppressWarnings("unused")
+public final class AnnotationIndexProcessor extends AbstractProcessor {
+  private final List<String> entries = new ArrayList<>();
+  private boolean isValid = true;
+
+  @Override
+  public Set<String> getSupportedAnnotationTypes() {
+    return Collections.singleton("*");
+  }
+
+  @Override
+  public SourceVersion getSupportedSourceVersion() {
+    return SourceVersion.latestSupported();
+  }
+
+  @Override
+  public boolean process(Set<? extends TypeElement> annotations, RoundEnvironment roundEnv) {
+    if (roundEnv.processingOver()) {
+      if (isValid) {
+        writeIndex();
+      }
+    } else {
+      collect(roundEnv, SupervisorMain.class.getName());
+      collect(roundEnv, SupervisorCommand.class.getName());
+      collect(roundEnv, ChildWorkerCommand.class.getName());
+    }
+    return false; // never claim the annotations - other processors may handle them too
+  }
+
+  private void collect(final RoundEnvironment roundEnv, final String annotationType) {
+    final TypeElement annotationElm = processingEnv.getElementUtils().getTypeElement(annotationType);
+    if (annotationElm == null) return;
+    for(final Element elm : roundEnv.getElementsAnnotatedWith(annotationElm)) {
+      if (elm.getKind() != ElementKind.METHOD) continue;
+      final ExecutableElement method = (ExecutableElement) elm;
+      final TypeElement clsElm = (TypeElement) method.getEnclosingElement();
+      String cmd = "";
+      boolean persistent = false; // the index's boolean column - concurrent, for a @SupervisorCommand
+      final List<String> jvmArgs = new ArrayList<>();
+      for(final AnnotationMirror mirror : method.getAnnotationMirrors()) {
+        if (!((TypeElement) mirror.getAnnotationType().asElement()).getQualifiedName().contentEquals(annotationType)) {
+          continue;
+        }
+        for(final Map.Entry<? extends ExecutableElement, ? extends AnnotationValue> e
+            : mirror.getElementValues().entrySet())
+        {
+          final String name = e.getKey().getSimpleName().toString();
+          final Object value = e.getValue().getValue();
+          switch (name) {
+            case "value":
+            case "cmd":
+              cmd = value.toString();
+              break;
+            case "persistent":
+            case "concurrent":
+              persistent = (Boolean) value;
+              break;
+            case "jvmArgs":
+              for(final Object jvmArg : (List<?>) value) {
+                jvmArgs.add(((AnnotationValue) jvmArg).getValue().toString());
+              }
+              break;
+          }
+        }
+      }
+      final String className = processingEnv.getElementUtils().getBinaryName(clsElm).toString();
+      final String methodName = method.getSimpleName().toString();
+      try {
+        entries.add(CommandDispatchInfo.formatAnnotationIndexEntry(annotationType, className, methodName,
+            methodDescriptor(method), cmd, persistent, jvmArgs.toArray(new String[0])));
+      } catch (IllegalArgumentException ex) {
+        isValid = false;
+        processingEnv.getMessager().printMessage(Diagnostic.Kind.ERROR, ex.getMessage(), method);
+      }
+    }
+  }
+
+  private void writeIndex() {
+    try {
+      final FileObject resource = processingEnv.getFiler()
+          .createResource(StandardLocation.CLASS_OUTPUT, "", CommandDispatchInfo.ANNOTATION_INDEX_RESOURCE);
+      try (final Writer writer = new OutputStreamWriter(resource.openOutputStream(), UTF_8)) {
+        writer.write(CommandDispatchInfo.ANNOTATION_INDEX_HEADER);
+        writer.write('\n');
+        for(final String entry : entries) {
+          writer.write(entry);
+          writer.write('\n');
+        }
+      }
+    } catch (IOException ex) {
+      processingEnv.getMessager().printMessage(Diagnostic.Kind.WARNING,
+          "failed writing " + CommandDispatchInfo.ANNOTATION_INDEX_RESOURCE + ": " + ex.getMessage());
+    }
+  }
+
+  // the JVM method descriptor, e.g. ([Ljava/lang/String;Ljava/io/PrintStream;)V
+  private String methodDescriptor(final ExecutableElement method) {
+    final StringBuilder sb = new StringBuilder(64).append('(');
+    for(final VariableElement param : method.getParameters()) {
+      sb.append(typeDescriptor(param.asType()));
+    }
+    return sb.append(')').append(typeDescriptor(method.getReturnType())).toString();
+  }
+
+  private String typeDescriptor(final TypeMirror type) {
+    switch (type.getKind()) {
+      case BOOLEAN: return "Z";
+      case BYTE:    return "B";
+      case CHAR:    return "C";
+      case SHORT:   return "S";
+      case INT:     return "I";
+      case LONG:    return "J";
+      case FLOAT:   return "F";
+      case DOUBLE:  return "D";
+      case VOID:    return "V";
+      case ARRAY:   return "[" + typeDescriptor(((ArrayType) type).getComponentType());
+      case DECLARED: {
+        final TypeElement typeElm = (TypeElement) ((DeclaredType) type).asElement();
+        return "L" + processingEnv.getElementUtils().getBinaryName(typeElm).toString().replace('.', '/') + ";";
+      }
+      default: { // type variables
+        final TypeMirror erasure = processingEnv.getTypeUtils().erasure(type);
+        return erasure.getKind() != type.getKind() ? typeDescriptor(erasure) : "Ljava/lang/Object;";
+      }
+    }
+  }
+}
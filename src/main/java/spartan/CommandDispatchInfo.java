@@ -19,13 +19,16 @@ limitations under the License.
 package spartan;
 
 import static java.lang.String.format;
+import static java.nio.charset.StandardCharsets.UTF_8;
 import static spartan.util.EnumAsStream.enumerationAsStream;
 
+import java.io.BufferedReader;
 import java.io.ByteArrayInputStream;
 import java.io.DataInputStream;
 import java.io.File;
 import java.io.IOException;
 import java.io.InputStream;
+import java.io.InputStreamReader;
 import java.io.ObjectInputStream;
 import java.io.ObjectOutputStream;
 import java.io.OutputStream;
@@ -47,13 +50,13 @@ import java.util.Map;
 import java.util.Objects;
 import java.util.Properties;
 import java.util.Set;
-import java.util.concurrent.atomic.AtomicBoolean;
 import java.util.function.Consumer;
 import java.util.function.Function;
 import java.util.function.Predicate;
 import java.util.function.Supplier;
 import java.util.jar.Attributes;
 import java.util.jar.JarEntry;
+import java.util.jar.JarFile;
 import java.util.jar.JarInputStream;
 import java.util.jar.Manifest;
 import java.util.stream.Stream;
@@ -63,6 +66,7 @@ import javassist.bytecode.ClassFile;
 import javassist.bytecode.MethodInfo;
 import javassist.bytecode.annotation.Annotation;
 import javassist.bytecode.annotation.ArrayMemberValue;
+import javassist.bytecode.annotation.BooleanMemberValue;
 import javassist.bytecode.annotation.MemberValue;
 import javassist.bytecode.annotation.StringMemberValue;
 import spartan.annotations.ChildWorkerCommand;
@@ -84,6 +88,14 @@ public final class CommandDispatchInfo implements Serializable {
   private static final Set<String> spartanAnnotationValidMetaData;
   private static int loggingLevel = 0;
 
+  // jar resource written at build time by AnnotationIndexProcessor - one tab separated line per annotated
+  // method: annotation type, class name, method name, method descriptor, cmd, persistent|concurrent [, jvmArgs...]
+  static final String ANNOTATION_INDEX_RESOURCE = "META-INF/spartan/annotation.idx";
+  static final String ANNOTATION_INDEX_HEADER = "# spartan annotation index v1";
+  // system property - "prefer" (default) uses a jar's index if it has one, else scans the jar's class files;
+  // "only" skips scanning jars that have no index (the Spartan jar is still scanned); "ignore" always scans
+  private static final String ANNOTATION_INDEX_MODE_PROP = "spartan.annotationIndex";
+
   static {
     spartanAnnotations = new HashSet<>();
     spartanAnnotations.add(SupervisorMain.class.getName());
@@ -93,6 +105,8 @@ public final class CommandDispatchInfo implements Serializable {
     spartanAnnotationValidMetaData.add("value");
     spartanAnnotationValidMetaData.add("cmd");
     spartanAnnotationValidMetaData.add("jvmArgs");
+    spartanAnnotationValidMetaData.add("persistent");
+    spartanAnnotationValidMetaData.add("concurrent");
   }
 
   // these private fields will be accessible to C++ code via JNI APIs
@@ -181,25 +195,34 @@ public final class CommandDispatchInfo implements Serializable {
     private static final long serialVersionUID = 1L;
     // these private fields will be accessible to C++ code via JNI APIs
     protected String cmd;
+    private boolean concurrent;
     public void setCmd(String cmd) {
       this.cmd = cmd;
     }
+    public void setConcurrent(boolean concurrent) {
+      this.concurrent = concurrent;
+    }
     public CmdInfo(String className, String methodName, String descriptor) {
       super(className, methodName, descriptor);
       this.cmd = "";
     }
     @Override
     public String toString() {
-      return toStringBuilder().append("      cmd: ").append(cmd).append(eol).toString();
+      return toStringBuilder().append("      cmd: ").append(cmd).append(eol)
+          .append("      concurrent: ").append(concurrent).append(eol).toString();
     }
   }
   public static class ChildCmdInfo extends CmdInfo {
     private static final long serialVersionUID = 1L;
     // these private fields will be accessible to C++ code via JNI APIs
     private String[] jvmArgs;
+    private boolean persistent;
     public void setJvmArgs(String[] jvmArgs) {
       this.jvmArgs = jvmArgs;
     }
+    public void setPersistent(boolean persistent) {
+      this.persistent = persistent;
+    }
     public String getJvmOptionsCommandLine() {
       return String.join(" ", jvmArgs);
     }
@@ -215,7 +238,8 @@ public final class CommandDispatchInfo implements Serializable {
       for(final String jvmArg : jvmArgs) {
         sb.append(jvmArg).append(' ');
       }
-      return sb.delete(sb.length() - 1, sb.length()).append(eol).toString();
+      return sb.delete(sb.length() - 1, sb.length()).append(eol)
+          .append("      persistent: ").append(persistent).append(eol).toString();
     }
   }
 
@@ -280,6 +304,28 @@ public final class CommandDispatchInfo implements Serializable {
     }
   }
 
+  static String formatAnnotationIndexEntry(String annotationType, String className, String methodName,
+                                          String descriptor, String cmd, boolean persistent, String[] jvmArgs)
+  {
+    final List<String> fields = new ArrayList<>(6 + jvmArgs.length);
+    fields.addAll(Arrays.asList(annotationType, className, methodName, descriptor, cmd, Boolean.toString(persistent)));
+    fields.addAll(Arrays.asList(jvmArgs));
+    for(final String field : fields) {
+      if (field.indexOf('\t') >= 0 || field.indexOf('\n') >= 0 || field.indexOf('\r') >= 0) {
+        throw new IllegalArgumentException(format("%s.%s: annotation values may not contain tab or line break"
+            + " characters: \"%s\"", className, methodName, field));
+      }
+    }
+    return String.join("\t", fields);
+  }
+
+  // scans (or loads the annotation index of) just the specified jar files - used for benchmarking
+  static CommandDispatchInfo scanAnnotationInfo(final Stream<URL> urlsStream)
+      throws MalformedURLException, URISyntaxException, IOException
+  {
+    return new CommandDispatchInfo().new AnnotationScanner().obtainAnnotationInfo(urlsStream);
+  }
+
   public static CommandDispatchInfo obtainAnnotationInfo()
       throws MalformedURLException, URISyntaxException, IOException
   {
@@ -389,6 +435,19 @@ public final class CommandDispatchInfo implements Serializable {
     return rslt;
   };
 
+  private static Path getSpartanJarPath() {
+    try {
+      return Paths.get(CommandDispatchInfo.class.getProtectionDomain().getCodeSource().getLocation().toURI());
+    } catch (Exception ex) {
+      return null;
+    }
+  }
+
+  private static final Predicate<MethInfo> isNullOrSpartanTestMethod = methInfo -> {
+    return methInfo == null || methInfo.className.startsWith("spartan.test")
+        || methInfo.className.startsWith("spartan/test");
+  };
+
   private final class AnnotationScanner {
     private final ArrayList<CmdInfo> spartanSupervisorCmds = new ArrayList<>();
     private final ArrayList<ChildCmdInfo> spartanChildWorkerCmds = new ArrayList<>();
@@ -424,11 +483,22 @@ public final class CommandDispatchInfo implements Serializable {
         }
       };
 
+      final String indexMode = System.getProperty(ANNOTATION_INDEX_MODE_PROP, "prefer");
+      final boolean isIgnoreIndex = "ignore".equalsIgnoreCase(indexMode);
+      final boolean isIndexOnly = "only".equalsIgnoreCase(indexMode);
+      final Path spartanJarPath = isIndexOnly ? getSpartanJarPath() : null;
+
       urlsStream
         .map(determineJarUrl)       // determine URL to jar file
         .map(getJarFilePath)        // convert URL->URI->Path per jar file
-        .map(getInputStream)        // convert file Path to an opened InputStream
-        .forEach(processJarStream); // process each .class entry per jar file
+        .forEach(jarPath -> {
+          if (!isIgnoreIndex && loadAnnotationIndex(jarPath)) return;
+          if (isIndexOnly && !jarPath.equals(spartanJarPath)) {
+            logF(()->format("skipping jar without annotation index: %s%n", jarPath));
+            return;
+          }
+          processJarStream.accept(getInputStream.apply(jarPath)); // process each .class entry of the jar file
+        });
 
       int size = this.spartanSupervisorCmds.size();
       if (size > 0) {
@@ -448,6 +518,37 @@ public final class CommandDispatchInfo implements Serializable {
       return CommandDispatchInfo.this;
     }
 
+    /**
+     * Populates from the annotation index resource of the jar file, if it has one.
+     *
+     * @param jarPath jar file to obtain the annotation index from
+     * @return true if the jar file had an annotation index (the jar need not be scanned)
+     */
+    private boolean loadAnnotationIndex(final Path jarPath) {
+      try (final JarFile jarFile = new JarFile(jarPath.toFile())) {
+        final JarEntry indexEntry = jarFile.getJarEntry(ANNOTATION_INDEX_RESOURCE);
+        if (indexEntry == null) return false;
+        try (final BufferedReader reader =
+                 new BufferedReader(new InputStreamReader(jarFile.getInputStream(indexEntry), UTF_8)))
+        {
+          String line = reader.readLine();
+          if (!ANNOTATION_INDEX_HEADER.equals(line)) {
+            logF(()->format("unrecognized annotation index in jar (will scan instead): %s%n", jarPath));
+            return false;
+          }
+          while ((line = reader.readLine()) != null) {
+            if (!line.isEmpty() && line.charAt(0) != '#') {
+              populate(line.split("\t", -1));
+            }
+          }
+        }
+        logF(()->format("loaded annotation index of jar: %s%n", jarPath));
+        return true;
+      } catch (IOException ex) {
+        return uncheckedExceptionThrow(ex);
+      }
+    }
+
     /**
     * Scans both the method for annotations.
     *
@@ -474,6 +575,14 @@ public final class CommandDispatchInfo implements Serializable {
       if (mVal instanceof StringMemberValue) {
         cmdInfo.setCmd(((StringMemberValue) mVal).getValue());
         logF(()->format("\t\t%s{%s}: %s%n", valueItem, String.class.getSimpleName(), mVal));
+      } else if (mVal instanceof BooleanMemberValue) {
+        final boolean boolVal = ((BooleanMemberValue) mVal).getValue();
+        if (cmdInfo instanceof ChildCmdInfo) {
+          ((ChildCmdInfo) cmdInfo).setPersistent(boolVal);
+        } else {
+          cmdInfo.setConcurrent(boolVal);
+        }
+        logF(()->format("\t\t%s{%s}: %s%n", valueItem, boolean.class.getSimpleName(), mVal));
       } else if (mVal instanceof ArrayMemberValue) {
         final MemberValue[] mVals = ((ArrayMemberValue) mVal).getValue();
         if (mVals != null && mVals.length > 0 && mVals[0] != null) {
@@ -496,70 +605,95 @@ public final class CommandDispatchInfo implements Serializable {
     }
 
     private void populate(final Annotation[] annotations, final String className, final MethodInfo method) {
-
-      final AtomicBoolean isNonSpartanTestSupervisorMain  = new AtomicBoolean();
-      final AtomicBoolean isNonSpartanTestSupervisorCmd   = new AtomicBoolean();
-      final AtomicBoolean isNonSpartanTestChildWorkerCmd  = new AtomicBoolean();
-
-      final Predicate<MethInfo> isNullOrSpartanTestMethod = methInfo -> {
-        return methInfo == null || methInfo.className.startsWith("spartan.test")
-            || methInfo.className.startsWith("spartan/test");
-      };
+      logF(()->format("method: %s.%s%s%n", className, method.getName(), method.getDescriptor()));
 
       final Consumer<Annotation> handleAnnotation = annotation -> {
-        final String annotationType = annotation.getTypeName();
-        logF(()->format("\tannotation: %s:%n", annotationType));
-        CmdInfo cmdInfo = null;
-        if (annotationType.compareTo(SupervisorMain.class.getName()) == 0) {
-          if (isNullOrSpartanTestMethod.test(CommandDispatchInfo.this.spartanMainEntryPoint)) {
-            logLn(()->"\t*** setting SupervisorMain program entry point ***");
-            if (!isNullOrSpartanTestMethod.test(CommandDispatchInfo.this.spartanMainEntryPoint = new MethInfo(className,
-                method.getName(), method.getDescriptor())))
-            {
-              isNonSpartanTestSupervisorMain.set(true);
-            }
-          }
-        } else if (annotationType.compareTo(SupervisorCommand.class.getName()) == 0) {
-          logLn(()->"\t*** setting SupervisorCommand dispatch entry ***");
-          spartanSupervisorCmds.add(cmdInfo = new CmdInfo(className, method.getName(), method.getDescriptor()));
-          if (!isNullOrSpartanTestMethod.test(cmdInfo)) {
-            isNonSpartanTestSupervisorCmd.set(true);
-          }
-        } else if (annotationType.compareTo(ChildWorkerCommand.class.getName()) == 0) {
-          logLn(()->"\t*** setting ChildWorkerCommand dispatch entry ***");
-          final ChildCmdInfo childCmdInfo = new ChildCmdInfo(className, method.getName(), method.getDescriptor());
-          cmdInfo = childCmdInfo;
-          spartanChildWorkerCmds.add(childCmdInfo);
-          if (!isNullOrSpartanTestMethod.test(cmdInfo)) {
-            isNonSpartanTestChildWorkerCmd.set(true);
-          }
-        }
+        final CmdInfo cmdInfo = register(annotation.getTypeName(), className, method.getName(), method.getDescriptor());
         @SuppressWarnings("unchecked")
         final java.util.Set<String> names = annotation.getMemberNames();
-        if (names != null) {
-          final CmdInfo cmdInfoArg = cmdInfo;
-          assert(cmdInfoArg != null);
+        if (names != null && cmdInfo != null) {
           names.stream()
             .filter(Objects::nonNull)
             .filter(spartanAnnotationValidMetaData::contains)
-            .forEach(e -> handleAnnotationValue(annotation, e, cmdInfoArg));
+            .forEach(e -> handleAnnotationValue(annotation, e, cmdInfo));
         }
       };
-  
-      logF(()->format("method: %s.%s%s%n", className, method.getName(), method.getDescriptor()));
-  
+
       Arrays.stream(annotations)
         .filter(Objects::nonNull)
         .filter(annotation -> spartanAnnotations.contains(annotation.getTypeName()))
         .forEach(handleAnnotation);
+    }
+
+    private void populate(final String[] indexFields) {
+      if (indexFields.length < 6 || !spartanAnnotations.contains(indexFields[0])) {
+        logF(()->format("skipping invalid annotation index entry: %s%n", String.join(" ", indexFields)));
+        return;
+      }
+      final String className = indexFields[1], methodName = indexFields[2], descriptor = indexFields[3];
+      logF(()->format("method: %s.%s%s (indexed)%n", className, methodName, descriptor));
+      final CmdInfo cmdInfo = register(indexFields[0], className, methodName, descriptor);
+      if (cmdInfo == null) return;
+      cmdInfo.setCmd(indexFields[4]);
+      if (cmdInfo instanceof ChildCmdInfo) {
+        final ChildCmdInfo childCmdInfo = (ChildCmdInfo) cmdInfo;
+        childCmdInfo.setPersistent(Boolean.parseBoolean(indexFields[5]));
+        if (indexFields.length > 6) {
+          childCmdInfo.setJvmArgs(Arrays.copyOfRange(indexFields, 6, indexFields.length));
+        }
+      } else {
+        cmdInfo.setConcurrent(Boolean.parseBoolean(indexFields[5]));
+      }
+    }
+
+    /**
+     * Registers an annotated method as the supervisor main entry point, a supervisor command, or a child
+     * worker command; registering a method not of the spartan.test class evicts the spartan.test commands.
+     *
+     * @return the registered command (its annotation member values are yet to be set), else null
+     */
+    private CmdInfo register(final String annotationType, final String className, final String methodName,
+                             final String descriptor)
+    {
+      boolean isNonSpartanTestSupervisorMain = false;
+      boolean isNonSpartanTestSupervisorCmd  = false;
+      boolean isNonSpartanTestChildWorkerCmd = false;
+
+      logF(()->format("\tannotation: %s:%n", annotationType));
+      CmdInfo cmdInfo = null;
+      if (annotationType.compareTo(SupervisorMain.class.getName()) == 0) {
+        if (isNullOrSpartanTestMethod.test(CommandDispatchInfo.this.spartanMainEntryPoint)) {
+          logLn(()->"\t*** setting SupervisorMain program entry point ***");
+          if (!isNullOrSpartanTestMethod.test(CommandDispatchInfo.this.spartanMainEntryPoint = new MethInfo(className,
+              methodName, descriptor)))
+          {
+            isNonSpartanTestSupervisorMain = true;
+          }
+        }
+      } else if (annotationType.compareTo(SupervisorCommand.class.getName()) == 0) {
+        logLn(()->"\t*** setting SupervisorCommand dispatch entry ***");
+        spartanSupervisorCmds.add(cmdInfo = new CmdInfo(className, methodName, descriptor));
+        if (!isNullOrSpartanTestMethod.test(cmdInfo)) {
+          isNonSpartanTestSupervisorCmd = true;
+        }
+      } else if (annotationType.compareTo(ChildWorkerCommand.class.getName()) == 0) {
+        logLn(()->"\t*** setting ChildWorkerCommand dispatch entry ***");
+        final ChildCmdInfo childCmdInfo = new ChildCmdInfo(className, methodName, descriptor);
+        cmdInfo = childCmdInfo;
+        spartanChildWorkerCmds.add(childCmdInfo);
+        if (!isNullOrSpartanTestMethod.test(cmdInfo)) {
+          isNonSpartanTestChildWorkerCmd = true;
+        }
+      }
 
-      if (isNonSpartanTestSupervisorMain.get() || isNonSpartanTestSupervisorCmd.get()) {
+      if (isNonSpartanTestSupervisorMain || isNonSpartanTestSupervisorCmd) {
         spartanSupervisorCmds.removeIf(isNullOrSpartanTestMethod);
       }
 
-      if (isNonSpartanTestSupervisorMain.get() || isNonSpartanTestChildWorkerCmd.get()) {
+      if (isNonSpartanTestSupervisorMain || isNonSpartanTestChildWorkerCmd) {
         spartanChildWorkerCmds.removeIf(isNullOrSpartanTestMethod);
       }
+      return cmdInfo;
     }
   }
 }
@@ -28,6 +28,17 @@ public interface Spartan {
   default void status(java.io.PrintStream statusRspStream) { statusRspStream.close(); }
   default void childProcessNotify(int pid, String commandLine) {}
   default void childProcessCompletionNotify(int pid) {}
+  // a batch of child process start and completion notifications, in the order they occurred - element i is a start
+  // notification when commandLines[i] is non-null, otherwise a completion notification with exit status exitStatuses[i]
+  default void childProcessBatchNotify(int[] pids, String[] commandLines, int[] exitStatuses) {
+    for (int i = 0; i < pids.length; i++) {
+      if (commandLines[i] != null) {
+        childProcessNotify(pids[i], commandLines[i]);
+      } else {
+        childProcessCompletionNotify(pids[i]);
+      }
+    }
+  }
   default void supervisorDoCommand(String[] args, java.io.PrintStream rspStream) { rspStream.close(); }
 
   @SuppressWarnings("WeakerAccess")
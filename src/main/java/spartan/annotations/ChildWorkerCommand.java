@@ -28,4 +28,5 @@ import java.lang.annotation.ElementType;
 public @interface ChildWorkerCommand {
   String cmd();
   String[] jvmArgs() default {};
+  boolean persistent() default false;
 }
@@ -27,4 +27,7 @@ import java.lang.annotation.ElementType;
 @Retention(RetentionPolicy.RUNTIME)
 public @interface SupervisorCommand {
   String value();
+  // false (default) - invoked one at a time with the other non-concurrent supervisor commands;
+  // true - invoked on any free supervisor thread, concurrently with other commands (must be thread safe)
+  boolean concurrent() default false;
 }
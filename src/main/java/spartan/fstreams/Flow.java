@@ -21,8 +21,11 @@ package spartan.fstreams;
 import spartan.Spartan;
 import spartan.Spartan.InvokeResponseEx;
 
+import java.io.IOException;
 import java.io.InputStream;
 import java.io.OutputStream;
+import java.nio.Buffer;
+import java.nio.ByteBuffer;
 import java.util.ArrayList;
 import java.util.LinkedHashSet;
 import java.util.List;
@@ -36,22 +39,42 @@ import java.util.function.BiConsumer;
  * Interrelated interfaces and static methods for establishing flow-controlled components in which
  * invoked child processes are managed for consuming their generated output via a reactive programming
  * API.
+ * <p>
+ * By default each subscribed stream is consumed by a task of a thread pool - a thread per stream. With a
+ * {@link FlowReactor} ({@link #subscribe(FlowReactor, InvokeResponseEx)}) the streams are instead drained by the
+ * reactor's few threads and consumed via the {@link Subscriber#onNextData}/{@link Subscriber#onErrorData}
+ * callbacks - which the thread pool supports as well, so switching between the two is a matter of how the
+ * first subscription is made.
+ * <p>
+ * The reactor is not a drop-in replacement for the InputStream callbacks ({@link Subscriber#onNext}/{@link
+ * Subscriber#onError}): a consumer blocked reading an InputStream needs a thread per stream regardless of how
+ * the stream is filled, so with a reactor those throw UnsupportedOperationException, and consumers are to be
+ * ported to the ByteBuffer callbacks.
  */
 @SuppressWarnings({"unused", "WeakerAccess"})
 public final class Flow {
   private static final String clsName = Flow.class.getSimpleName();
+  private static final int READ_BUFFER_SIZE = 64 * 1024;
   private final ExecutorService executorService;
+  private final FlowReactor reactor;
   private final ExecutorCompletionService<Integer> exec;
   private final List<Entry<Integer, Callable<Integer>>> taskList = new ArrayList<>();
+  private final List<Entry<Integer, Runnable>> registrationList = new ArrayList<>(); // streams for the reactor
   @SuppressWarnings("MismatchedQueryAndUpdateOfCollection")
   private final Set<Integer> pids = new LinkedHashSet<>(); // currently not made use of - for future use
-  private final BiConsumer<InputStream, Subscription> noopAction = (os, sc) -> {};
   private boolean subscribeDisabled = false;
 
   private Flow(ExecutorService executorService) {
     this.executorService = executorService;
+    this.reactor = null;
     this.exec = new ExecutorCompletionService<>(executorService);
   }
+  private Flow(FlowReactor reactor) {
+    this.executorService = null;
+    this.reactor = reactor;
+    // a reactor serviced stream's task is submitted as it ends - run in place, it just yields the outcome
+    this.exec = new ExecutorCompletionService<>(Runnable::run);
+  }
   private static ExecutorService makeDefaultCachedTheadPool() {
     final AtomicInteger workerThreadNbr = new AtomicInteger(1);
     return Executors.newCachedThreadPool(r -> {
@@ -78,6 +101,17 @@ public final class Flow {
   public interface Subscriber {
     Subscriber onError(BiConsumer<InputStream, Subscription> onErrorAction);
     Subscriber onNext(BiConsumer<InputStream, Subscription> onNextAction);
+    /**
+     * Alternative to {@link #onError}, supported by both the thread pool and the {@link FlowReactor}: the
+     * action is called with each chunk of data read from the child process stderr stream - the ByteBuffer is
+     * positioned at the data and is only valid for the duration of the call - and, at the end of the stream,
+     * once more with an empty ByteBuffer. The stream is closed thereafter.
+     */
+    Subscriber onErrorData(BiConsumer<ByteBuffer, Subscription> onErrorAction);
+    /**
+     * Alternative to {@link #onNext} - as per {@link #onErrorData}, of the child process stdout stream.
+     */
+    Subscriber onNextData(BiConsumer<ByteBuffer, Subscription> onNextAction);
     Subscriber subscribe(InvokeResponseEx rsp);
     FuturesCompletion start();
   }
@@ -122,7 +156,8 @@ public final class Flow {
      */
     Future<Integer> take() throws InterruptedException;
     /**
-     * @return the {@link ExecutorService} thread pool executor that is in use
+     * @return the {@link ExecutorService} thread pool executor that is in use (null when the subscriptions are
+     *         serviced by a {@link FlowReactor})
      */
     ExecutorService getExecutor();
     /**
@@ -160,10 +195,26 @@ public final class Flow {
     return new Flow(executorService).makeSubscriber(rsp);
   }
 
+  /**
+   * Identical to {@link #subscribe(InvokeResponseEx)} but the child process streams are serviced by the native
+   * {@link FlowReactor} (e.g., {@link FlowReactor#getDefault()}) rather than by a thread pool thread per stream.
+   * The streams are consumed via the {@link Subscriber#onNextData}/{@link Subscriber#onErrorData} callbacks,
+   * which are called on the reactor's threads; the InputStream callbacks ({@link Subscriber#onNext}/{@link
+   * Subscriber#onError}) are not supported and throw UnsupportedOperationException.
+   *
+   * @param reactor the reactor to service the subscriptions' streams
+   * @param rsp the child process context returned by {@link spartan.Spartan#invokeCommandEx(String...)}
+   * @return the subscriber context which should be populated with child process stdout and stderr
+   *         callback handlers (either lambdas or method pointers).
+   */
+  public static Subscriber subscribe(FlowReactor reactor, InvokeResponseEx rsp) {
+    return new Flow(reactor).makeSubscriber(rsp);
+  }
+
   private Subscriber makeSubscriber(final InvokeResponseEx rsp) {
     return new Subscriber() {
-      private BiConsumer<InputStream, Subscription> onErrorAction = noopAction;
-      private BiConsumer<InputStream, Subscription> onNextAction = noopAction;
+      private boolean isOnErrorSet = false;
+      private boolean isOnNextSet = false;
       private final Subscription subscription = new Subscription() {
         @Override
         public void cancel() throws Exception {
@@ -180,31 +231,52 @@ public final class Flow {
         }
       };
       private void validateInit() {
-        if (onErrorAction == noopAction) {
+        if (!isOnErrorSet) {
           throw new AssertionError("onErrorAction callback not initialized");
         }
-        if (onNextAction == noopAction) {
+        if (!isOnNextSet) {
           throw new AssertionError("onNextAction callback not initialized");
         }
       }
+      private void validateStreamAction() {
+        if (reactor != null) {
+          throw new UnsupportedOperationException(String.format(
+              "InputStream callbacks need a thread per stream - use onNextData()/onErrorData() with a %s",
+              FlowReactor.class.getSimpleName()));
+        }
+      }
       @Override
       public Subscriber onError(BiConsumer<InputStream, Subscription> onErrorAction) {
-        this.onErrorAction = onErrorAction;
+        validateStreamAction();
+        isOnErrorSet = true;
         final Callable<Integer> callableTask = () -> {
           onErrorAction.accept(rsp.errStream, subscription);
           return rsp.childPID;
         };
-        taskList.add(makeCallableEntry(rsp.childPID, callableTask));
+        taskList.add(makeEntry(rsp.childPID, callableTask));
         return this;
       }
       @Override
       public Subscriber onNext(BiConsumer<InputStream, Subscription> onNextAction) {
-        this.onNextAction = onNextAction;
+        validateStreamAction();
+        isOnNextSet = true;
         final Callable<Integer> callableTask = () -> {
           onNextAction.accept(rsp.inStream, subscription);
           return rsp.childPID;
         };
-        taskList.add(makeCallableEntry(rsp.childPID, callableTask));
+        taskList.add(makeEntry(rsp.childPID, callableTask));
+        return this;
+      }
+      @Override
+      public Subscriber onErrorData(BiConsumer<ByteBuffer, Subscription> onErrorAction) {
+        isOnErrorSet = true;
+        addDataTask(rsp.childPID, rsp.errStream, onErrorAction, subscription);
+        return this;
+      }
+      @Override
+      public Subscriber onNextData(BiConsumer<ByteBuffer, Subscription> onNextAction) {
+        isOnNextSet = true;
+        addDataTask(rsp.childPID, rsp.inStream, onNextAction, subscription);
         return this;
       }
       @Override
@@ -221,10 +293,13 @@ public final class Flow {
       public FuturesCompletion start() {
         subscribeDisabled = true;
         validateInit();
-        final int tasksCount = taskList.size();
+        final int tasksCount = taskList.size() + registrationList.size();
         pids.clear();
         taskList.stream().map(entry -> { pids.add(entry.getKey()); return entry.getValue(); }).forEach(exec::submit);
         taskList.clear();
+        registrationList.stream().map(entry -> { pids.add(entry.getKey()); return entry.getValue(); })
+                        .forEach(Runnable::run);
+        registrationList.clear();
         return new FuturesCompletion() {
           @Override
           public Future<Integer> poll() {
@@ -251,19 +326,88 @@ public final class Flow {
     };
   }
 
-  private static Entry<Integer, Callable<Integer>> makeCallableEntry(int childPID, Callable<Integer> callable) {
-    return new Entry<Integer, Callable<Integer>>() {
+  private void addDataTask(int childPID, InputStream strm, BiConsumer<ByteBuffer, Subscription> action,
+                           Subscription subscription) {
+    if (reactor != null) {
+      registrationList.add(makeEntry(childPID, () -> registerStream(childPID, strm, action, subscription)));
+    } else {
+      taskList.add(makeEntry(childPID, () -> {
+        readStream(strm, action, subscription);
+        return childPID;
+      }));
+    }
+  }
+
+  // the thread pool task of a data callback - reads the stream to its end
+  private static void readStream(InputStream strm, BiConsumer<ByteBuffer, Subscription> action,
+                                 Subscription subscription) throws IOException {
+    try (InputStream is = strm) {
+      final byte[] bytes = new byte[READ_BUFFER_SIZE];
+      final ByteBuffer data = ByteBuffer.wrap(bytes);
+      final Buffer dataBuf = data; // via Buffer - its positioning methods are covariant as of Java 9
+      int n;
+      while ((n = is.read(bytes)) != -1) {
+        dataBuf.clear();
+        dataBuf.limit(n);
+        action.accept(data, subscription);
+      }
+      dataBuf.clear();
+      dataBuf.limit(0);
+      action.accept(data, subscription);
+    }
+  }
+
+  // registers the stream of a data callback with the reactor - its task is submitted as the stream ends
+  private void registerStream(int childPID, InputStream strm, BiConsumer<ByteBuffer, Subscription> action,
+                              Subscription subscription) {
+    final ByteBuffer endOfStream = ByteBuffer.allocate(0);
+    final FlowReactor.StreamHandler handler = new FlowReactor.StreamHandler() {
+      @Override
+      public void onData(ByteBuffer data) {
+        action.accept(data, subscription);
+      }
+      @Override
+      public void onEnd(Throwable failure) {
+        Throwable outcome = failure;
+        if (outcome == null) {
+          try {
+            action.accept(endOfStream, subscription);
+          } catch (Throwable e) {
+            outcome = e;
+          }
+        }
+        final Throwable rslt = outcome;
+        exec.submit(() -> {
+          if (rslt != null) throw asException(rslt);
+          return childPID;
+        });
+      }
+    };
+    try {
+      reactor.register(strm, handler);
+    } catch (IOException e) {
+      exec.submit(() -> { throw e; });
+    }
+  }
+
+  private static Exception asException(Throwable t) {
+    if (t instanceof Error) throw (Error) t; // the Future's get() throws it wrapped as per any other failure
+    return t instanceof Exception ? (Exception) t : new Exception(t);
+  }
+
+  private static <T> Entry<Integer, T> makeEntry(int childPID, T value) {
+    return new Entry<Integer, T>() {
       @Override
       public Integer getKey() {
         return childPID;
       }
       @Override
-      public Callable<Integer> getValue() {
-        return callable;
+      public T getValue() {
+        return value;
       }
       @Override
-      public Callable<Integer> setValue(Callable<Integer> value) { // ignore setter - Entry<> instance is immutable
-        return callable;
+      public T setValue(T ignored) { // ignore setter - Entry<> instance is immutable
+        return value;
       }
     };
   }
@@ -0,0 +1,260 @@
+/* FlowReactor.java
+
+Copyright 2018 Tideworks Technology
+Author: Roger D. Voss
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+package spartan.fstreams;
+
+import java.io.FileDescriptor;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.nio.Buffer;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * A native (epoll) I/O engine that drains the stdout and stderr pipe streams of invoked child processes
+ * from a small, fixed number of threads - the alternative to {@link Flow}'s default of a thread pool thread
+ * blocked reading each stream.
+ * <p>
+ * Pass it to {@link Flow#subscribe(FlowReactor, spartan.Spartan.InvokeResponseEx)} and consume the streams
+ * with the {@link Flow.Subscriber#onNextData} and {@link Flow.Subscriber#onErrorData} callbacks. Those are
+ * called on the reactor's threads, with a (direct) ByteBuffer of the data as read from the stream; a stream's
+ * data is delivered in order and by one thread at a time, but the callbacks of different streams run
+ * concurrently when the reactor has more than one thread - and should not block for long, as they hold up
+ * the other streams serviced by that thread.
+ * <p>
+ * A reactor can service any number of flows; {@link #getDefault()} returns one shared by the process.
+ */
+@SuppressWarnings({"unused", "WeakerAccess"})
+public final class FlowReactor implements AutoCloseable {
+  static {
+    System.loadLibrary("spartan-shared");
+  }
+  private static final String clsName = FlowReactor.class.getSimpleName();
+  // per reactor thread - as per flow-reactor.h BATCH_BUFFER_SIZE and BATCH_MAX_READY (what flow-reactor-bench measures)
+  private static final int BUFFER_SIZE = 1024 * 1024; // shared out among the streams read per poll()
+  private static final int MAX_READY = 16;            // streams read per poll() - a 64 KB share each at least
+  private static final int READY_ENTRY_INTS = 3;     // token, offset, length (flow-reactor.h ready_t)
+  private static final int POLL_TIMEOUT_MS = 1000;
+
+  private static native long create() throws IOException;
+  private static native void register(long handle, FileDescriptor fdesc, int token) throws IOException;
+  private static native void wakeup(long handle);
+  private static native void release(long handle);
+  private static native long newBatch(long handle, ByteBuffer buf, ByteBuffer ready);
+  private static native int poll(long batchHandle, int timeoutMs);
+  private static native void freeBatch(long batchHandle);
+
+  /**
+   * The handler of a stream registered with the reactor.
+   */
+  interface StreamHandler {
+    // data is positioned at the bytes read, and is only valid for the duration of the call
+    void onData(ByteBuffer data) throws Exception;
+    // the stream has ended (failure is null), or reading it failed, or the reactor was closed
+    void onEnd(Throwable failure);
+  }
+
+  private static final class Stream {
+    final InputStream strm;
+    final StreamHandler handler;
+    volatile Throwable failure; // the handler's onData() exception - the stream is drained and discarded thereafter
+    Stream(InputStream strm, StreamHandler handler) {
+      this.strm = strm;
+      this.handler = handler;
+    }
+  }
+
+  private final long handle;
+  private final List<Thread> threads = new ArrayList<>();
+  private final ConcurrentHashMap<Integer, Stream> streams = new ConcurrentHashMap<>();
+  private final AtomicInteger nextToken = new AtomicInteger(1);
+  private volatile boolean isClosed = false;
+  private boolean isDefault = false;
+
+  private FlowReactor(int threadsCount) throws IOException {
+    this.handle = create();
+    for (int i = 1; i <= threadsCount; i++) {
+      final Thread t = new Thread(this::run);
+      t.setDaemon(true);
+      t.setName(String.format("%s-thread-#%d", clsName, i));
+      threads.add(t);
+    }
+    threads.forEach(Thread::start);
+  }
+
+  /**
+   * Creates a reactor with its own threads - {@link #close()} it when done with.
+   * @param threadsCount the number of reactor threads (at least 1)
+   * @return the reactor
+   * @throws IOException if the native reactor could not be created
+   */
+  public static FlowReactor open(int threadsCount) throws IOException {
+    if (threadsCount < 1) {
+      throw new IllegalArgumentException("a flow reactor needs at least one thread");
+    }
+    return new FlowReactor(threadsCount);
+  }
+
+  /**
+   * @return a reactor of as many threads as half the available processors (between 1 and 4)
+   * @throws IOException if the native reactor could not be created
+   */
+  public static FlowReactor open() throws IOException {
+    return open(Math.max(1, Math.min(4, Runtime.getRuntime().availableProcessors() / 2)));
+  }
+
+  private static final class DefaultHolder {
+    static final FlowReactor instance;
+    static {
+      try {
+        instance = open();
+        instance.isDefault = true;
+      } catch (IOException e) {
+        throw new ExceptionInInitializerError(e);
+      }
+    }
+  }
+
+  /**
+   * @return the process wide reactor (as per {@link #open()}), created on first use and never closed
+   */
+  public static FlowReactor getDefault() {
+    return DefaultHolder.instance;
+  }
+
+  /**
+   * @return the number of the reactor's threads
+   */
+  public int threadsCount() {
+    return threads.size();
+  }
+
+  /**
+   * @return the number of streams currently registered
+   */
+  public int streamsCount() {
+    return streams.size();
+  }
+
+  /**
+   * Registers a child process pipe stream - as returned by {@link spartan.Spartan#invokeCommandEx(String...)} -
+   * with the reactor. From then on the stream is read by the reactor only, and is closed by it once it ends.
+   */
+  void register(InputStream strm, StreamHandler handler) throws IOException {
+    if (!(strm instanceof FileInputStream)) {
+      throw new IOException(String.format("%s can only service the pipe streams of child processes", clsName));
+    }
+    final int token = nextToken.getAndIncrement();
+    synchronized (this) { // not racing close() - which releases the native reactor
+      if (isClosed) {
+        throw new IOException(String.format("%s has been closed", clsName));
+      }
+      streams.put(token, new Stream(strm, handler));
+      try {
+        register(handle, ((FileInputStream) strm).getFD(), token);
+      } catch (IOException e) {
+        streams.remove(token);
+        throw e;
+      }
+    }
+  }
+
+  private void run() {
+    final ByteBuffer buf = ByteBuffer.allocateDirect(BUFFER_SIZE);
+    final ByteBuffer ready = ByteBuffer.allocateDirect(MAX_READY * READY_ENTRY_INTS * Integer.BYTES)
+                                       .order(ByteOrder.nativeOrder());
+    final IntBuffer readyInts = ready.asIntBuffer();
+    final ByteBuffer data = buf.asReadOnlyBuffer();
+    final Buffer dataBuf = data; // via Buffer - its positioning methods are covariant as of Java 9
+    final long batchHandle = newBatch(handle, buf, ready);
+    try {
+      int n;
+      while ((n = poll(batchHandle, POLL_TIMEOUT_MS)) >= 0) {
+        for (int i = 0, j = 0; i < n; i++, j += READY_ENTRY_INTS) {
+          final int token = readyInts.get(j);
+          final int offset = readyInts.get(j + 1);
+          final int length = readyInts.get(j + 2);
+          if (length > 0) {
+            final Stream stream = streams.get(token);
+            if (stream == null || stream.failure != null) continue;
+            dataBuf.clear();
+            dataBuf.position(offset);
+            dataBuf.limit(offset + length);
+            try {
+              stream.handler.onData(data);
+            } catch (Throwable e) {
+              stream.failure = e;
+              stream.handler.onEnd(e);
+            }
+          } else {
+            final Stream stream = streams.remove(token);
+            if (stream == null) continue;
+            closeStream(stream.strm);
+            if (stream.failure == null) {
+              stream.handler.onEnd(length == 0 ? null : new IOException(String.format(
+                  "reading child process stream failed (errno %d)", -length)));
+            }
+          }
+        }
+      }
+    } finally {
+      freeBatch(batchHandle);
+    }
+  }
+
+  private static void closeStream(InputStream strm) {
+    try {
+      strm.close();
+    } catch (IOException ignored) {
+    }
+  }
+
+  /**
+   * Stops the reactor's threads, ends the streams still registered (their handlers see an IOException)
+   * and releases the native reactor. The default reactor can't be closed.
+   */
+  @Override
+  public void close() throws InterruptedException {
+    if (isDefault) {
+      throw new UnsupportedOperationException(String.format("the default %s can't be closed", clsName));
+    }
+    synchronized (this) {
+      if (isClosed) return;
+      isClosed = true;
+    }
+    wakeup(handle);
+    for (final Thread t : threads) {
+      t.join();
+    }
+    final IOException closed = new IOException(String.format("%s has been closed", clsName));
+    streams.values().forEach(stream -> {
+      closeStream(stream.strm);
+      if (stream.failure == null) {
+        stream.handler.onEnd(closed);
+      }
+    });
+    streams.clear();
+    release(handle);
+  }
+}
@@ -116,7 +116,7 @@ public final class test extends SpartanBase {
     rspStream.printf("invoked %s.%s(\"%s\")%n", test.class.getName(), methodName, output);
   }
 
-  @SupervisorCommand("GENFIB")
+  @SupervisorCommand(value = "GENFIB", concurrent = true)
   public void generateFibonacciSequence(String[] args, PrintStream rspStream) {
     final String methodName = "generateFibonacciSequence";
     assert (args.length > 0);
@@ -0,0 +1,123 @@
+package spartan;
+
+import static java.nio.charset.StandardCharsets.UTF_8;
+
+import java.io.IOException;
+import java.net.URL;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.time.Duration;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.jar.JarEntry;
+import java.util.jar.JarOutputStream;
+
+import javassist.ClassPool;
+import javassist.CtClass;
+import javassist.CtMethod;
+import javassist.CtNewMethod;
+import javassist.bytecode.AnnotationsAttribute;
+import javassist.bytecode.ConstPool;
+import javassist.bytecode.annotation.Annotation;
+import javassist.bytecode.annotation.StringMemberValue;
+import spartan.annotations.ChildWorkerCommand;
+
+/**
+ * Startup benchmark comparing annotation discovery by class file scanning against loading the
+ * build-time annotation index, over a synthetic classpath of jar files.
+ * <p>
+ * usage: AnnotationIndexBenchmark [jar-count [classes-per-jar [iterations]]]
+ */
+public class AnnotationIndexBenchmark {
+  private static final String ANNOTATION_INDEX_MODE_PROP = "spartan.annotationIndex";
+
+  public static void main(String[] args) throws Exception {
+    final int jarCount = args.length > 0 ? Integer.parseInt(args[0]) : 200;
+    final int classesPerJar = args.length > 1 ? Integer.parseInt(args[1]) : 250;
+    final int iterations = args.length > 2 ? Integer.parseInt(args[2]) : 5;
+
+    final Path workDir = Files.createTempDirectory("spartan-idx-bench");
+    System.out.printf("generating %d jars of %d classes each under %s%n", jarCount, classesPerJar, workDir);
+    final List<URL> manifestUrls = generateClassPath(workDir, jarCount, classesPerJar);
+
+    final long scanNanos = run("ignore", manifestUrls, iterations, jarCount);
+    final long indexNanos = run("prefer", manifestUrls, iterations, jarCount);
+    System.err.printf("%nINFO: scan: %s, index: %s (per startup, average of %d) - %.1fx%n",
+        Duration.ofNanos(scanNanos), Duration.ofNanos(indexNanos), iterations, (double) scanNanos / indexNanos);
+  }
+
+  private static long run(String indexMode, List<URL> manifestUrls, int iterations, int expectedCmds)
+      throws Exception
+  {
+    System.setProperty(ANNOTATION_INDEX_MODE_PROP, indexMode);
+    CommandDispatchInfo.scanAnnotationInfo(manifestUrls.stream()); // warm up
+    long total = 0;
+    for(int i = 0; i < iterations; i++) {
+      final long start = System.nanoTime();
+      final CommandDispatchInfo info = CommandDispatchInfo.scanAnnotationInfo(manifestUrls.stream());
+      total += System.nanoTime() - start;
+      final int cmds = countChildWorkerCommands(info);
+      if (cmds != expectedCmds) {
+        throw new AssertionError(String.format("%s: found %d child worker commands, expected %d",
+            indexMode, cmds, expectedCmds));
+      }
+    }
+    final long avg = total / iterations;
+    System.out.printf("%s: %s%n", indexMode, Duration.ofNanos(avg));
+    return avg;
+  }
+
+  private static int countChildWorkerCommands(CommandDispatchInfo info) throws Exception {
+    final java.lang.reflect.Field field = CommandDispatchInfo.class.getDeclaredField("spartanChildWorkerCommands");
+    field.setAccessible(true);
+    return ((Object[]) field.get(info)).length;
+  }
+
+  // each jar holds one class with an annotated child worker command method plus filler classes,
+  // along with the annotation index that AnnotationIndexProcessor would have written for it
+  private static List<URL> generateClassPath(Path workDir, int jarCount, int classesPerJar) throws Exception {
+    final ClassPool pool = ClassPool.getDefault();
+    final List<URL> manifestUrls = new ArrayList<>(jarCount);
+    final String[] noJvmArgs = new String[0];
+    for(int j = 0; j < jarCount; j++) {
+      final Path jarPath = workDir.resolve(String.format("synthetic-%04d.jar", j));
+      final String cmdClsName = String.format("bench.jar%04d.Commands", j);
+      try (final JarOutputStream jar = new JarOutputStream(Files.newOutputStream(jarPath))) {
+        addEntry(jar, "META-INF/MANIFEST.MF", "Manifest-Version: 1.0\n".getBytes(UTF_8));
+        final CtClass cmdCls = pool.makeClass(cmdClsName);
+        final CtMethod cmdMethod = CtNewMethod.make(
+            "public static void doCmd(String[] args, java.io.PrintStream rspStrm) {}", cmdCls);
+        final ConstPool constPool = cmdCls.getClassFile().getConstPool();
+        final AnnotationsAttribute attr = new AnnotationsAttribute(constPool, AnnotationsAttribute.visibleTag);
+        final Annotation annotation = new Annotation(ChildWorkerCommand.class.getName(), constPool);
+        annotation.addMemberValue("cmd", new StringMemberValue("cmd" + j, constPool));
+        attr.addAnnotation(annotation);
+        cmdMethod.getMethodInfo().addAttribute(attr);
+        cmdCls.addMethod(cmdMethod);
+        addEntry(jar, cmdClsName.replace('.', '/') + ".class", cmdCls.toBytecode());
+        cmdCls.detach();
+        for(int c = 1; c < classesPerJar; c++) {
+          final String clsName = String.format("bench.jar%04d.Filler%04d", j, c);
+          final CtClass cls = pool.makeClass(clsName);
+          for(int m = 0; m < 8; m++) {
+            cls.addMethod(CtNewMethod.make(String.format("public int method%d(int x) { return x + %d; }", m, m), cls));
+          }
+          addEntry(jar, clsName.replace('.', '/') + ".class", cls.toBytecode());
+          cls.detach();
+        }
+        final String index = CommandDispatchInfo.ANNOTATION_INDEX_HEADER + '\n'
+            + CommandDispatchInfo.formatAnnotationIndexEntry(ChildWorkerCommand.class.getName(), cmdClsName,
+                "doCmd", "([Ljava/lang/String;Ljava/io/PrintStream;)V", "cmd" + j, false, noJvmArgs) + '\n';
+        addEntry(jar, CommandDispatchInfo.ANNOTATION_INDEX_RESOURCE, index.getBytes(UTF_8));
+      }
+      manifestUrls.add(new URL("jar:" + jarPath.toUri() + "!/META-INF/MANIFEST.MF"));
+    }
+    return manifestUrls;
+  }
+
+  private static void addEntry(JarOutputStream jar, String name, byte[] bytes) throws IOException {
+    jar.putNextEntry(new JarEntry(name));
+    jar.write(bytes);
+    jar.closeEntry();
+  }
+}